@@ -0,0 +1,177 @@
+#include "BindlessTable.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using std::runtime_error;
+
+
+uint32_t BindlessTable::Slots::acquire()
+{
+    if (!freeList.empty())
+    {
+        uint32_t index = freeList.back();
+        freeList.pop_back();
+        return index;
+    }
+
+    if (next == capacity)
+        throw runtime_error("bindless table is full");
+
+    return next++;
+}
+
+
+void BindlessTable::Slots::release(uint32_t index)
+{
+    if (index < next)
+        freeList.push_back(index);
+}
+
+
+void BindlessTable::create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice, uint32_t maxBuffers, uint32_t maxImages)
+{
+    this->pDevice = pDevice;
+
+    VkPhysicalDeviceDescriptorIndexingProperties indexingProperties{};
+    indexingProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_PROPERTIES;
+
+    VkPhysicalDeviceProperties2 deviceProperties{};
+    deviceProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+    deviceProperties.pNext = &indexingProperties;
+    vkGetPhysicalDeviceProperties2(pPhysicalDevice, &deviceProperties);
+
+    buffers = {};
+    buffers.capacity = std::min({ maxBuffers,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        indexingProperties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+
+    images = {};
+    images.capacity = std::min({ maxImages,
+        indexingProperties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        indexingProperties.maxDescriptorSetUpdateAfterBindSampledImages });
+
+    VkDescriptorSetLayoutBinding bindings[2]{};
+    bindings[StorageBuffers].binding = StorageBuffers;
+    bindings[StorageBuffers].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    bindings[StorageBuffers].descriptorCount = buffers.capacity;
+    bindings[StorageBuffers].stageFlags = VK_SHADER_STAGE_ALL;
+
+    bindings[SampledImages].binding = SampledImages;
+    bindings[SampledImages].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    bindings[SampledImages].descriptorCount = images.capacity;
+    bindings[SampledImages].stageFlags = VK_SHADER_STAGE_ALL;
+
+    // only the last binding may have a variable count
+    VkDescriptorBindingFlags bindingFlags[2] =
+    {
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT,
+        VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT | VK_DESCRIPTOR_BINDING_VARIABLE_DESCRIPTOR_COUNT_BIT
+    };
+
+    VkDescriptorSetLayoutBindingFlagsCreateInfo bindingFlagsInfo{};
+    bindingFlagsInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO;
+    bindingFlagsInfo.bindingCount = 2;
+    bindingFlagsInfo.pBindingFlags = bindingFlags;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.pNext = &bindingFlagsInfo;
+    layoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = bindings;
+
+    if (vkCreateDescriptorSetLayout(pDevice, &layoutInfo, nullptr, &pSetLayout) != VK_SUCCESS)
+        throw runtime_error("failed to create bindless descriptor set layout");
+
+    // a single set, so the pool is sized exactly for it
+    allocator.init(pDevice, 1,
+        { { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, buffers.capacity }, { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, images.capacity } },
+        VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT);
+
+    VkDescriptorSetVariableDescriptorCountAllocateInfo variableCountInfo{};
+    variableCountInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_VARIABLE_DESCRIPTOR_COUNT_ALLOCATE_INFO;
+    variableCountInfo.descriptorSetCount = 1;
+    variableCountInfo.pDescriptorCounts = &images.capacity;
+
+    pSet = allocator.allocate(pSetLayout, &variableCountInfo);
+}
+
+
+void BindlessTable::destroy()
+{
+    allocator.destroy();
+    vkDestroyDescriptorSetLayout(pDevice, pSetLayout, nullptr);
+
+    pSetLayout = nullptr;
+    pSet = nullptr;
+    buffers = {};
+    images = {};
+}
+
+
+uint32_t BindlessTable::addBuffer(VkBuffer pBuffer, VkDeviceSize offset, VkDeviceSize range)
+{
+    uint32_t index = buffers.acquire();
+
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = pBuffer;
+    bufferInfo.offset = offset;
+    bufferInfo.range = range;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = pSet;
+    descriptorWrite.dstBinding = StorageBuffers;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(pDevice, 1, &descriptorWrite, 0, nullptr);
+
+    return index;
+}
+
+
+uint32_t BindlessTable::addImage(VkImageView pImageView, VkSampler pSampler, VkImageLayout layout)
+{
+    uint32_t index = images.acquire();
+
+    VkDescriptorImageInfo imageInfo{};
+    imageInfo.sampler = pSampler;
+    imageInfo.imageView = pImageView;
+    imageInfo.imageLayout = layout;
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = pSet;
+    descriptorWrite.dstBinding = SampledImages;
+    descriptorWrite.dstArrayElement = index;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pImageInfo = &imageInfo;
+
+    vkUpdateDescriptorSets(pDevice, 1, &descriptorWrite, 0, nullptr);
+
+    return index;
+}
+
+
+// partially bound - a stale descriptor is fine as long as no shader indexes it
+void BindlessTable::removeBuffer(uint32_t index)
+{
+    buffers.release(index);
+}
+
+
+void BindlessTable::removeImage(uint32_t index)
+{
+    images.release(index);
+}
+
+
+void BindlessTable::bind(VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout) const
+{
+    vkCmdBindDescriptorSets(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineLayout, 0, 1, &pSet, 0, nullptr);
+}
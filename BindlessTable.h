@@ -0,0 +1,68 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include "DescriptorAllocator.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// one descriptor set holding every buffer and image in large arrays (descriptor indexing)
+// shaders reach a resource through its index, so draws never rebind descriptors
+//   binding 0 : readonly buffer arrays  (storage buffers)
+//   binding 1 : sampler2D arrays        (combined image samplers, variable count)
+// both bindings are partially bound and update after bind - slots can be written while the set is bound
+// as long as no pending command buffer uses them
+class BindlessTable
+{
+public:
+
+    static constexpr uint32_t InvalidIndex = ~0u;
+
+    enum Binding : uint32_t
+    {
+        StorageBuffers = 0,
+        SampledImages = 1
+    };
+
+    // capacities are clamped to the device's update after bind limits
+    void create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice, uint32_t maxBuffers, uint32_t maxImages);
+    void destroy();
+
+    uint32_t addBuffer(VkBuffer pBuffer, VkDeviceSize offset = 0, VkDeviceSize range = VK_WHOLE_SIZE);
+    uint32_t addImage(VkImageView pImageView, VkSampler pSampler, VkImageLayout layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+    // the index is handed out again - only remove once the frames that used it have retired
+    void removeBuffer(uint32_t index);
+    void removeImage(uint32_t index);
+
+    // binds the table as set 0
+    void bind(VkCommandBuffer pCommandBuffer, VkPipelineLayout pPipelineLayout) const;
+
+    VkDescriptorSetLayout getLayout() const { return pSetLayout; }
+    VkDescriptorSet getSet() const { return pSet; }
+
+    uint32_t getBufferCapacity() const { return buffers.capacity; }
+    uint32_t getImageCapacity() const { return images.capacity; }
+
+private:
+
+    // index allocator for one binding, recycles removed indices first
+    struct Slots
+    {
+        uint32_t capacity = 0;
+        uint32_t next = 0;
+        std::vector<uint32_t> freeList;
+
+        uint32_t acquire();
+        void release(uint32_t index);
+    };
+
+    VkDevice pDevice = nullptr;
+    VkDescriptorSetLayout pSetLayout = nullptr;
+    VkDescriptorSet pSet = nullptr;
+    DescriptorAllocator allocator;
+
+    Slots buffers;
+    Slots images;
+};
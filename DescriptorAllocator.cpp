@@ -0,0 +1,110 @@
+#include "DescriptorAllocator.h"
+
+#include <stdexcept>
+
+using std::vector;
+using std::runtime_error;
+
+
+void DescriptorAllocator::init(VkDevice pDevice, uint32_t setsPerPool, const vector<VkDescriptorPoolSize>& sizesPerSet, VkDescriptorPoolCreateFlags poolFlags)
+{
+    this->pDevice = pDevice;
+    this->setsPerPool = setsPerPool;
+    this->poolFlags = poolFlags;
+
+    poolSizes = sizesPerSet;
+    for (VkDescriptorPoolSize& poolSize : poolSizes)
+        poolSize.descriptorCount *= setsPerPool;
+}
+
+
+void DescriptorAllocator::destroy()
+{
+    for (VkDescriptorPool pPool : usedPools)
+        vkDestroyDescriptorPool(pDevice, pPool, nullptr);
+
+    for (VkDescriptorPool pPool : freePools)
+        vkDestroyDescriptorPool(pDevice, pPool, nullptr);
+
+    usedPools.clear();
+    freePools.clear();
+    pCurrentPool = nullptr;
+}
+
+
+VkDescriptorPool DescriptorAllocator::createPool()
+{
+    VkDescriptorPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
+    poolInfo.flags = poolFlags;
+    poolInfo.maxSets = setsPerPool;
+    poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
+    poolInfo.pPoolSizes = poolSizes.data();
+
+    VkDescriptorPool pPool = nullptr;
+    if (vkCreateDescriptorPool(pDevice, &poolInfo, nullptr, &pPool) != VK_SUCCESS)
+        throw runtime_error("failed to create descriptor pool");
+
+    return pPool;
+}
+
+
+VkDescriptorPool DescriptorAllocator::grabPool()
+{
+    if (!freePools.empty())
+    {
+        VkDescriptorPool pPool = freePools.back();
+        freePools.pop_back();
+        return pPool;
+    }
+
+    return createPool();
+}
+
+
+VkDescriptorSet DescriptorAllocator::allocate(VkDescriptorSetLayout pLayout, const void* pNext)
+{
+    if (pCurrentPool == nullptr)
+    {
+        pCurrentPool = grabPool();
+        usedPools.push_back(pCurrentPool);
+    }
+
+    VkDescriptorSetAllocateInfo allocInfo{};
+    allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
+    allocInfo.pNext = pNext;
+    allocInfo.descriptorPool = pCurrentPool;
+    allocInfo.descriptorSetCount = 1;
+    allocInfo.pSetLayouts = &pLayout;
+
+    VkDescriptorSet pSet = nullptr;
+    VkResult result = vkAllocateDescriptorSets(pDevice, &allocInfo, &pSet);
+
+    // current pool is full - move on to a fresh one and try once more
+    if (result == VK_ERROR_OUT_OF_POOL_MEMORY || result == VK_ERROR_FRAGMENTED_POOL)
+    {
+        pCurrentPool = grabPool();
+        usedPools.push_back(pCurrentPool);
+
+        allocInfo.descriptorPool = pCurrentPool;
+        result = vkAllocateDescriptorSets(pDevice, &allocInfo, &pSet);
+    }
+
+    if (result != VK_SUCCESS)
+        throw runtime_error("failed to allocate descriptor set");
+
+    return pSet;
+}
+
+
+void DescriptorAllocator::reset()
+{
+    for (VkDescriptorPool pPool : usedPools)
+    {
+        vkResetDescriptorPool(pDevice, pPool, 0);
+        freePools.push_back(pPool);
+    }
+
+    usedPools.clear();
+    pCurrentPool = nullptr;
+}
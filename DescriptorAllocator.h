@@ -0,0 +1,36 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+
+// hands out descriptor sets from a list of pools, creating another pool when the current one runs out
+// pool sizes are given per set and multiplied by setsPerPool
+class DescriptorAllocator
+{
+public:
+
+    void init(VkDevice pDevice, uint32_t setsPerPool, const std::vector<VkDescriptorPoolSize>& sizesPerSet, VkDescriptorPoolCreateFlags poolFlags = 0);
+    void destroy();
+
+    // pNext is chained into VkDescriptorSetAllocateInfo (variable descriptor counts)
+    VkDescriptorSet allocate(VkDescriptorSetLayout pLayout, const void* pNext = nullptr);
+
+    // returns every set to its pool, the pools are kept for reuse
+    void reset();
+
+private:
+
+    VkDescriptorPool createPool();
+    VkDescriptorPool grabPool();
+
+    VkDevice pDevice = nullptr;
+    uint32_t setsPerPool = 0;
+    VkDescriptorPoolCreateFlags poolFlags = 0;
+    std::vector<VkDescriptorPoolSize> poolSizes;
+
+    VkDescriptorPool pCurrentPool = nullptr;
+    std::vector<VkDescriptorPool> usedPools;
+    std::vector<VkDescriptorPool> freePools;
+};
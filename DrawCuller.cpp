@@ -0,0 +1,49 @@
+#include "DrawCuller.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cmath>
+
+using std::vector;
+
+
+DrawCuller::DrawCuller()
+    : clipVolume(Frustum::fromMatrix(glm::mat4(1.0f)))
+{
+}
+
+
+void DrawCuller::cull(JobSystem& jobSystem, vector<DrawCommand>& draws, float modelRadius)
+{
+    uint32_t count = static_cast<uint32_t>(draws.size());
+    bounds.resize(count);
+
+    // chunks write disjoint ranges of the bounds, no synchronisation beyond the final wait
+    jobSystem.parallelFor(count, 1024, [&](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            const glm::mat4& m = draws[i].transform;
+
+            float scale = std::sqrt(std::max({ glm::dot(glm::vec3(m[0]), glm::vec3(m[0])), glm::dot(glm::vec3(m[1]), glm::vec3(m[1])), glm::dot(glm::vec3(m[2]), glm::vec3(m[2])) }));
+            float w = (m[3].w != 0.0f) ? m[3].w : 1.0f;
+
+            bounds.set(i, glm::vec3(m[3]) / w, modelRadius * scale / w);
+        }
+    });
+
+    frustumCuller.cullSpheres(&jobSystem, clipVolume, bounds, visibleIndices);
+
+    // the indices ascend, so moving down in place never overwrites a draw that is still to come
+    uint32_t kept = static_cast<uint32_t>(visibleIndices.size());
+    for (uint32_t k = 0; k < kept; ++k)
+    {
+        if (visibleIndices[k] != k)
+            draws[k] = draws[visibleIndices[k]];
+    }
+
+    draws.resize(kept);
+
+    stats.tested = count;
+    stats.visible = kept;
+}
@@ -0,0 +1,44 @@
+#pragma once
+#include "FrameInputs.h"
+#include "FrustumCuller.h"
+
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+
+struct CullStats
+{
+    uint32_t tested = 0;
+    uint32_t visible = 0;
+};
+
+
+// drops draws whose bounding sphere lies outside the clip volume (x, y in [-w, w], z in [0, w])
+// the transforms map straight to clip space, so the bounds are the draw's origin (transform[3]) with
+// radius = model radius * the longest transform axis
+// the spheres are gathered into SoA bounds and tested by FrustumCuller, the compaction keeps the draw order
+class DrawCuller
+{
+public:
+
+    DrawCuller();
+
+    // modelRadius - the largest distance of a vertex from the model origin
+    void cull(JobSystem& jobSystem, std::vector<DrawCommand>& draws, float modelRadius);
+
+    const CullStats& getStats() const { return stats; }
+
+private:
+
+    // the clip volume as a frustum, the draws are already in clip space
+    Frustum clipVolume;
+    FrustumCuller frustumCuller;
+
+    // reused between frames
+    SphereBounds bounds;
+    std::vector<uint32_t> visibleIndices;
+
+    CullStats stats;
+};
@@ -0,0 +1,47 @@
+#include "DrawSorter.h"
+
+#include <algorithm>
+#include <cmath>
+
+using std::vector;
+
+
+uint64_t DrawSorter::makeKey(const DrawCommand& draw, Order order)
+{
+    const glm::vec4& origin = draw.transform[3];
+    float depth = (origin.w != 0.0f) ? origin.z / origin.w : origin.z;
+
+    // anything outside [0, 1] is clipped, clamp so it still gets a valid key
+    uint32_t depthBits = static_cast<uint32_t>(std::clamp(depth, 0.0f, 1.0f) * 4294967295.0);
+
+    bool translucent = draw.color.a < 1.0f;
+
+    if (order == Order::BackToFront || translucent)
+        depthBits = ~depthBits;
+
+    uint64_t key = depthBits;
+    if (translucent && order == Order::FrontToBack)
+        key |= 1ull << 63;
+
+    return key;
+}
+
+
+void DrawSorter::sort(vector<DrawCommand>& draws, Order order)
+{
+    if (order == Order::Submission || draws.size() < 2)
+        return;
+
+    // sort 16 byte keys rather than 96 byte draws, then move each draw once
+    keys.resize(draws.size());
+    for (size_t i = 0; i < draws.size(); ++i)
+        keys[i] = { makeKey(draws[i], order), static_cast<uint32_t>(i) };
+
+    std::stable_sort(keys.begin(), keys.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+    sorted.resize(draws.size());
+    for (size_t i = 0; i < keys.size(); ++i)
+        sorted[i] = draws[keys[i].second];
+
+    draws.swap(sorted);
+}
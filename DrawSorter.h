@@ -0,0 +1,35 @@
+#pragma once
+#include "FrameInputs.h"
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+
+// orders a frame's draws by a 64 bit key so early depth testing rejects as much overdraw as possible
+//   bit  63     : 0 opaque, 1 translucent (color.a < 1) - opaque draws go first
+//   bits 32..62 : reserved for state (pipeline/material) once draws differ in it
+//   bits  0..31 : depth, ascending for opaque (front to back), descending for translucent (back to front)
+// depth is the clip space z of the draw's origin (transform[3].z / transform[3].w), 0 near and 1 far
+class DrawSorter
+{
+public:
+
+    enum class Order
+    {
+        Submission,     // as built, no sorting
+        FrontToBack,    // opaque front to back, translucent back to front
+        BackToFront     // worst case for early-Z, everything back to front
+    };
+
+    static uint64_t makeKey(const DrawCommand& draw, Order order = Order::FrontToBack);
+
+    // stable, so draws with equal keys keep their submission order
+    void sort(std::vector<DrawCommand>& draws, Order order = Order::FrontToBack);
+
+private:
+
+    // reused between frames
+    std::vector<std::pair<uint64_t, uint32_t>> keys;
+    std::vector<DrawCommand> sorted;
+};
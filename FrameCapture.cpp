@@ -0,0 +1,169 @@
+#include "FrameCapture.h"
+#include "Utils.h"
+
+#include <cstring>
+#include <stdexcept>
+
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+
+namespace
+{
+    const char CaptureMagic[8] = { 'V', 'T', 'C', 'A', 'P', '0', '0', '2' };
+    constexpr std::streamoff FrameCountOffset = sizeof(CaptureMagic);
+
+    static_assert(sizeof(DrawCommand) == 4 * sizeof(uint32_t) + 20 * sizeof(float), "DrawCommand is written as raw bytes");
+
+
+    void put(vector<char>& out, const void* pData, size_t size)
+    {
+        const char* pBytes = static_cast<const char*>(pData);
+        out.insert(out.end(), pBytes, pBytes + size);
+    }
+
+
+    void putU32(vector<char>& out, uint32_t value)
+    {
+        put(out, &value, sizeof(value));
+    }
+
+
+    struct Cursor
+    {
+        const unsigned char* pData;
+        size_t size;
+        size_t offset = 0;
+
+        void read(void* pOut, size_t count)
+        {
+            if (offset + count > size)
+                throw runtime_error("frame capture is truncated");
+
+            memcpy(pOut, pData + offset, count);
+            offset += count;
+        }
+
+        uint32_t readU32()
+        {
+            uint32_t value = 0;
+            read(&value, sizeof(value));
+            return value;
+        }
+
+        // an element count, checked against what is left before anything is allocated for it
+        uint32_t readCount(size_t minElementSize)
+        {
+            uint32_t count = readU32();
+            if (count > (size - offset) / minElementSize)
+                throw runtime_error("frame capture is truncated");
+
+            return count;
+        }
+    };
+
+    // pipelineId, width, height, update count, draw count
+    constexpr size_t MinFrameSize = 5 * sizeof(uint32_t);
+
+    // bufferId, offset, size
+    constexpr size_t MinUpdateSize = 3 * sizeof(uint32_t);
+}
+
+
+FrameRecorder::~FrameRecorder()
+{
+    close();
+}
+
+
+void FrameRecorder::open(const string& filename)
+{
+    close();
+
+    outFile.open(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!outFile.is_open())
+        throw runtime_error("failed to open frame capture for writing");
+
+    frameCount = 0;
+
+    outFile.write(CaptureMagic, sizeof(CaptureMagic));
+    outFile.write(reinterpret_cast<const char*>(&frameCount), sizeof(frameCount));
+}
+
+
+void FrameRecorder::close()
+{
+    if (!outFile.is_open())
+        return;
+
+    // patch the frame count now that it is known
+    outFile.seekp(FrameCountOffset);
+    outFile.write(reinterpret_cast<const char*>(&frameCount), sizeof(frameCount));
+    outFile.close();
+}
+
+
+void FrameRecorder::record(const FrameInputs& frame)
+{
+    if (!outFile.is_open())
+        return;
+
+    scratch.clear();
+
+    putU32(scratch, frame.pipelineId);
+    putU32(scratch, frame.width);
+    putU32(scratch, frame.height);
+
+    putU32(scratch, static_cast<uint32_t>(frame.bufferUpdates.size()));
+    for (const BufferUpdate& update : frame.bufferUpdates)
+    {
+        putU32(scratch, update.bufferId);
+        putU32(scratch, update.offset);
+        putU32(scratch, static_cast<uint32_t>(update.data.size()));
+        put(scratch, update.data.data(), update.data.size());
+    }
+
+    putU32(scratch, static_cast<uint32_t>(frame.draws.size()));
+    put(scratch, frame.draws.data(), frame.draws.size() * sizeof(DrawCommand));
+
+    outFile.write(scratch.data(), scratch.size());
+    ++frameCount;
+}
+
+
+vector<FrameInputs> FrameCapture::load(const string& filename)
+{
+    vector<unsigned char> bytes = Utils::readFile(filename);
+    Cursor cursor{ bytes.data(), bytes.size() };
+
+    char magic[sizeof(CaptureMagic)] = {};
+    cursor.read(magic, sizeof(magic));
+
+    if (memcmp(magic, CaptureMagic, sizeof(magic)) != 0)
+        throw runtime_error("not a frame capture file");
+
+    uint32_t frameCount = cursor.readCount(MinFrameSize);
+
+    vector<FrameInputs> frames(frameCount);
+    for (FrameInputs& frame : frames)
+    {
+        frame.pipelineId = cursor.readU32();
+        frame.width = cursor.readU32();
+        frame.height = cursor.readU32();
+
+        frame.bufferUpdates.resize(cursor.readCount(MinUpdateSize));
+        for (BufferUpdate& update : frame.bufferUpdates)
+        {
+            update.bufferId = cursor.readU32();
+            update.offset = cursor.readU32();
+            update.data.resize(cursor.readCount(1));
+            cursor.read(update.data.data(), update.data.size());
+        }
+
+        frame.draws.resize(cursor.readCount(sizeof(DrawCommand)));
+        cursor.read(frame.draws.data(), frame.draws.size() * sizeof(DrawCommand));
+    }
+
+    return frames;
+}
@@ -0,0 +1,42 @@
+#pragma once
+#include "FrameInputs.h"
+
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+
+// capture file layout (little endian)
+//   header : char[8] "VTCAP002", uint32 frameCount (patched on close)
+//   frame  : uint32 pipelineId, uint32 width, uint32 height
+//            uint32 updateCount, { uint32 bufferId, uint32 offset, uint32 size, uint8[size] } * updateCount
+//            uint32 drawCount, DrawCommand * drawCount
+class FrameRecorder
+{
+public:
+
+    ~FrameRecorder();
+
+    void open(const std::string& filename);
+    void close();
+
+    bool isOpen() const { return outFile.is_open(); }
+    uint32_t getFrameCount() const { return frameCount; }
+
+    // serialises into a reused scratch buffer and appends it with a single write
+    void record(const FrameInputs& frame);
+
+private:
+
+    std::ofstream outFile;
+    std::vector<char> scratch;
+    uint32_t frameCount = 0;
+};
+
+
+namespace FrameCapture
+{
+    // reads a whole capture into memory so replay is not bound by file i/o
+    std::vector<FrameInputs> load(const std::string& filename);
+}
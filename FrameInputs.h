@@ -0,0 +1,67 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+#include <vector>
+
+
+// well known buffer ids for BufferUpdate::bufferId
+enum class FrameBufferId : uint32_t
+{
+    Vertex = 0
+};
+
+
+// well known pipeline ids for FrameInputs::pipelineId
+// all draw the same geometry, they differ in how the per draw transform/color reach the shader
+enum class DrawPipelineId : uint32_t
+{
+    UniformRing = 0,      // dynamic offset into the uniform ring (shaders/uniformDraw.vert)
+    PushConstants = 1,    // vkCmdPushConstants (shaders/pushDraw.vert)
+    Bindless = 2          // index into a bindless storage buffer, drawn indirect (shaders/bindlessDraw.vert)
+};
+
+
+// vertexCount, instanceCount, firstVertex, firstInstance - same order as vkCmdDraw
+// transform and color are the per draw data handed to the shaders
+struct DrawCommand
+{
+    uint32_t vertexCount = 0;
+    uint32_t instanceCount = 1;
+    uint32_t firstVertex = 0;
+    uint32_t firstInstance = 0;
+
+    glm::mat4 transform = glm::mat4(1.0f);
+    glm::vec4 color = glm::vec4(1.0f);
+};
+
+
+// bytes written into a host visible buffer before the frame is recorded
+struct BufferUpdate
+{
+    uint32_t bufferId = 0;
+    uint32_t offset = 0;
+    std::vector<uint8_t> data;
+};
+
+
+// everything recordCommandBuffer() consumes for one frame
+// built by the live loop or loaded from a capture, so a frame can be reproduced without GLFW input
+struct FrameInputs
+{
+    uint32_t pipelineId = 0;
+    uint32_t width = 0;
+    uint32_t height = 0;
+
+    std::vector<BufferUpdate> bufferUpdates;
+    std::vector<DrawCommand> draws;
+
+    void clear()
+    {
+        pipelineId = 0;
+        width = 0;
+        height = 0;
+        bufferUpdates.clear();
+        draws.clear();
+    }
+};
@@ -0,0 +1,165 @@
+#include "FrameProfiler.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <limits>
+
+using std::string;
+
+
+const char* framePhaseName(FramePhase phase)
+{
+    switch (phase)
+    {
+    case FramePhase::FenceWait: return "FenceWait";
+    case FramePhase::Acquire:   return "Acquire";
+    case FramePhase::Reset:     return "Reset";
+    case FramePhase::Record:    return "Record";
+    case FramePhase::Submit:    return "Submit";
+    case FramePhase::Present:   return "Present";
+    case FramePhase::Recreate:  return "Recreate";
+    default:                    return "Unknown";
+    }
+}
+
+
+void FrameProfiler::beginFrame()
+{
+    FrameTiming& frame = current();
+
+    frame.phaseBeginNs.fill(0);
+    frame.phaseEndNs.fill(0);
+    frame.frameIndex = frameCount;
+    frame.beginNs = nowNs();
+    frame.endNs = 0;
+}
+
+
+void FrameProfiler::endFrame()
+{
+    current().endNs = nowNs();
+    ++frameCount;
+}
+
+
+uint32_t FrameProfiler::getFrameCount() const
+{
+    return static_cast<uint32_t>(std::min<uint64_t>(frameCount, HistorySize));
+}
+
+
+const FrameTiming& FrameProfiler::getFrame(uint32_t framesAgo) const
+{
+    return frames[(frameCount - 1 - framesAgo) % HistorySize];
+}
+
+
+namespace
+{
+    struct Accumulator
+    {
+        uint32_t samples = 0;
+        uint64_t totalNs = 0;
+        uint64_t minNs = std::numeric_limits<uint64_t>::max();
+        uint64_t maxNs = 0;
+
+        void add(uint64_t ns)
+        {
+            ++samples;
+            totalNs += ns;
+            minNs = std::min(minNs, ns);
+            maxNs = std::max(maxNs, ns);
+        }
+
+        FramePhaseStats stats() const
+        {
+            FramePhaseStats phaseStats;
+            if (samples == 0)
+                return phaseStats;
+
+            phaseStats.samples = samples;
+            phaseStats.avgMs = (double)totalNs / samples * 1e-6;
+            phaseStats.minMs = (double)minNs * 1e-6;
+            phaseStats.maxMs = (double)maxNs * 1e-6;
+            return phaseStats;
+        }
+    };
+}
+
+
+FrameStats FrameProfiler::getStats() const
+{
+    Accumulator frame;
+    Accumulator phases[FramePhaseCount];
+
+    uint32_t count = getFrameCount();
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const FrameTiming& timing = getFrame(i);
+        frame.add(timing.endNs - timing.beginNs);
+
+        for (uint32_t p = 0; p < FramePhaseCount; ++p)
+        {
+            if (timing.phaseBeginNs[p] != 0 && timing.phaseEndNs[p] >= timing.phaseBeginNs[p])
+                phases[p].add(timing.phaseEndNs[p] - timing.phaseBeginNs[p]);
+        }
+    }
+
+    FrameStats stats;
+    stats.frameCount = count;
+    stats.frame = frame.stats();
+
+    for (uint32_t p = 0; p < FramePhaseCount; ++p)
+        stats.phases[p] = phases[p].stats();
+
+    return stats;
+}
+
+
+void FrameProfiler::reset()
+{
+    frames.fill(FrameTiming{});
+    frameCount = 0;
+}
+
+
+bool FrameProfiler::writeChromeTrace(const string& filename) const
+{
+    std::ofstream outFile(filename, std::ios::out | std::ios::trunc);
+    if (!outFile.is_open())
+        return false;
+
+    uint32_t count = getFrameCount();
+    uint64_t originNs = (count > 0) ? getFrame(count - 1).beginNs : 0;
+
+    // ts/dur are microseconds, tid 0 is the whole frame and tid 1 the phases so they stack in the viewer
+    outFile << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    bool first = true;
+    auto writeEvent = [&](const char* name, uint32_t tid, uint64_t beginNs, uint64_t endNs, uint64_t frameIndex)
+    {
+        char event[256];
+        snprintf(event, sizeof(event), "%s{\"name\":\"%s\",\"cat\":\"frame\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"frame\":%llu}}",
+            first ? "" : ",\n", name, tid, (beginNs - originNs) * 1e-3, (endNs - beginNs) * 1e-3, (unsigned long long)frameIndex);
+        outFile << event;
+        first = false;
+    };
+
+    // oldest first
+    for (uint32_t i = count; i-- > 0;)
+    {
+        const FrameTiming& timing = getFrame(i);
+        writeEvent("Frame", 0, timing.beginNs, timing.endNs, timing.frameIndex);
+
+        for (uint32_t p = 0; p < FramePhaseCount; ++p)
+        {
+            if (timing.phaseBeginNs[p] != 0 && timing.phaseEndNs[p] >= timing.phaseBeginNs[p])
+                writeEvent(framePhaseName(static_cast<FramePhase>(p)), 1, timing.phaseBeginNs[p], timing.phaseEndNs[p], timing.frameIndex);
+        }
+    }
+
+    outFile << "\n]}\n";
+
+    return outFile.good();
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+
+// CPU phases of VulkanTriangleApp::drawFrame()
+enum class FramePhase : uint8_t
+{
+    FenceWait = 0,
+    Acquire,
+    Reset,
+    Record,
+    Submit,
+    Present,
+    Recreate,
+    Count
+};
+
+constexpr uint32_t FramePhaseCount = static_cast<uint32_t>(FramePhase::Count);
+
+const char* framePhaseName(FramePhase phase);
+
+
+// raw timestamps of one frame, 0 means the phase did not run
+struct FrameTiming
+{
+    uint64_t frameIndex = 0;
+    uint64_t beginNs = 0;
+    uint64_t endNs = 0;
+    std::array<uint64_t, FramePhaseCount> phaseBeginNs{};
+    std::array<uint64_t, FramePhaseCount> phaseEndNs{};
+
+    uint64_t phaseNs(FramePhase phase) const
+    {
+        uint32_t i = static_cast<uint32_t>(phase);
+        return phaseEndNs[i] - phaseBeginNs[i];
+    }
+};
+
+
+struct FramePhaseStats
+{
+    uint32_t samples = 0;
+    double avgMs = 0.0;
+    double minMs = 0.0;
+    double maxMs = 0.0;
+};
+
+
+struct FrameStats
+{
+    uint32_t frameCount = 0;
+    FramePhaseStats frame;
+    std::array<FramePhaseStats, FramePhaseCount> phases;
+};
+
+
+// fixed ring of the last HistorySize frames - recording never allocates or locks
+// single threaded: the thread that calls drawFrame() owns it
+class FrameProfiler
+{
+public:
+
+    static constexpr uint32_t HistorySize = 256;
+
+    static uint64_t nowNs()
+    {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+    }
+
+    void beginFrame();
+    void endFrame();
+
+    void beginPhase(FramePhase phase) { current().phaseBeginNs[static_cast<uint32_t>(phase)] = nowNs(); }
+    void endPhase(FramePhase phase) { current().phaseEndNs[static_cast<uint32_t>(phase)] = nowNs(); }
+
+
+    class ScopedFrame
+    {
+    public:
+        explicit ScopedFrame(FrameProfiler& profiler) : profiler(profiler) { profiler.beginFrame(); }
+        ~ScopedFrame() { profiler.endFrame(); }
+
+        ScopedFrame(const ScopedFrame&) = delete;
+        ScopedFrame& operator=(const ScopedFrame&) = delete;
+
+    private:
+        FrameProfiler& profiler;
+    };
+
+
+    class ScopedPhase
+    {
+    public:
+        ScopedPhase(FrameProfiler& profiler, FramePhase phase) : profiler(profiler), phase(phase) { profiler.beginPhase(phase); }
+        ~ScopedPhase() { profiler.endPhase(phase); }
+
+        ScopedPhase(const ScopedPhase&) = delete;
+        ScopedPhase& operator=(const ScopedPhase&) = delete;
+
+    private:
+        FrameProfiler& profiler;
+        FramePhase phase;
+    };
+
+
+    // completed frames only
+    uint32_t getFrameCount() const;
+
+    // 0 is the most recently completed frame
+    const FrameTiming& getFrame(uint32_t framesAgo) const;
+
+    // min/avg/max over the frames still in the ring
+    FrameStats getStats() const;
+
+    void reset();
+
+    // chrome://tracing / Perfetto "trace event" json with one complete event per frame and phase
+    bool writeChromeTrace(const std::string& filename) const;
+
+private:
+
+    FrameTiming& current() { return frames[frameCount % HistorySize]; }
+
+    std::array<FrameTiming, HistorySize> frames{};
+
+    // completed frames
+    uint64_t frameCount = 0;
+};
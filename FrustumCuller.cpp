@@ -0,0 +1,440 @@
+#include "FrustumCuller.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define CULL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC compiles intrinsics for any instruction set, gcc and clang need the functions marked
+#if defined(CULL_X86) && !defined(_MSC_VER)
+#define CULL_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CULL_TARGET_AVX2
+#endif
+
+using std::vector;
+
+
+namespace
+{
+    // the planes one component per array, as the kernels broadcast them
+    struct CullPlanes
+    {
+        float x[6];
+        float y[6];
+        float z[6];
+        float w[6];
+
+        // |normal| for the box test
+        float absX[6];
+        float absY[6];
+        float absZ[6];
+    };
+
+
+    CullPlanes toCullPlanes(const Frustum& frustum)
+    {
+        CullPlanes planes;
+        for (uint32_t p = 0; p < 6; ++p)
+        {
+            planes.x[p] = frustum.planes[p].x;
+            planes.y[p] = frustum.planes[p].y;
+            planes.z[p] = frustum.planes[p].z;
+            planes.w[p] = frustum.planes[p].w;
+            planes.absX[p] = std::fabs(planes.x[p]);
+            planes.absY[p] = std::fabs(planes.y[p]);
+            planes.absZ[p] = std::fabs(planes.z[p]);
+        }
+        return planes;
+    }
+
+
+    // one index per set bit of mask, lowest first
+    inline uint32_t appendIndices(uint32_t mask, uint32_t base, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        while (mask != 0)
+        {
+            pOut[written++] = base + static_cast<uint32_t>(std::countr_zero(mask));
+            mask &= mask - 1;
+        }
+        return written;
+    }
+
+
+    uint32_t cullSpheresScalar(const CullPlanes& planes, const SphereBounds& bounds, uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            bool inside = true;
+            for (uint32_t p = 0; p < 6 && inside; ++p)
+            {
+                float distance = planes.x[p] * bounds.centerX[i] + planes.y[p] * bounds.centerY[i] + planes.z[p] * bounds.centerZ[i] + planes.w[p];
+                inside = distance >= -bounds.radius[i];
+            }
+
+            if (inside)
+                pOut[written++] = i;
+        }
+        return written;
+    }
+
+
+    // the box reaches |normal| . extent further along the normal than its center
+    uint32_t cullBoxesScalar(const CullPlanes& planes, const BoxBounds& bounds, uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            bool inside = true;
+            for (uint32_t p = 0; p < 6 && inside; ++p)
+            {
+                float distance = planes.x[p] * bounds.centerX[i] + planes.y[p] * bounds.centerY[i] + planes.z[p] * bounds.centerZ[i] + planes.w[p];
+                float reach = planes.absX[p] * bounds.extentX[i] + planes.absY[p] * bounds.extentY[i] + planes.absZ[p] * bounds.extentZ[i];
+                inside = distance >= -reach;
+            }
+
+            if (inside)
+                pOut[written++] = i;
+        }
+        return written;
+    }
+
+
+#ifdef CULL_X86
+
+    // SSE2 only, which every x64 CPU has - mul + add rather than FMA keeps the results equal to the scalar path
+    uint32_t cullSpheresSse(const CullPlanes& planes, const SphereBounds& bounds, uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        uint32_t i = begin;
+
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+            __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+            __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+            __m128 negRadius = _mm_sub_ps(_mm_setzero_ps(), _mm_loadu_ps(&bounds.radius[i]));
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (uint32_t p = 0; p < 6; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), cx), _mm_mul_ps(_mm_set1_ps(planes.y[p]), cy)),
+                    _mm_mul_ps(_mm_set1_ps(planes.z[p]), cz)), _mm_set1_ps(planes.w[p]));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negRadius));
+            }
+
+            written += appendIndices(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, pOut + written);
+        }
+
+        return written + cullSpheresScalar(planes, bounds, i, end, pOut + written);
+    }
+
+
+    uint32_t cullBoxesSse(const CullPlanes& planes, const BoxBounds& bounds, uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        uint32_t i = begin;
+
+        for (; i + 4 <= end; i += 4)
+        {
+            __m128 cx = _mm_loadu_ps(&bounds.centerX[i]);
+            __m128 cy = _mm_loadu_ps(&bounds.centerY[i]);
+            __m128 cz = _mm_loadu_ps(&bounds.centerZ[i]);
+            __m128 ex = _mm_loadu_ps(&bounds.extentX[i]);
+            __m128 ey = _mm_loadu_ps(&bounds.extentY[i]);
+            __m128 ez = _mm_loadu_ps(&bounds.extentZ[i]);
+
+            __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            for (uint32_t p = 0; p < 6; ++p)
+            {
+                __m128 distance = _mm_add_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.x[p]), cx), _mm_mul_ps(_mm_set1_ps(planes.y[p]), cy)),
+                    _mm_mul_ps(_mm_set1_ps(planes.z[p]), cz)), _mm_set1_ps(planes.w[p]));
+                __m128 reach = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_set1_ps(planes.absX[p]), ex), _mm_mul_ps(_mm_set1_ps(planes.absY[p]), ey)),
+                    _mm_mul_ps(_mm_set1_ps(planes.absZ[p]), ez));
+                inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, _mm_sub_ps(_mm_setzero_ps(), reach)));
+            }
+
+            written += appendIndices(static_cast<uint32_t>(_mm_movemask_ps(inside)), i, pOut + written);
+        }
+
+        return written + cullBoxesScalar(planes, bounds, i, end, pOut + written);
+    }
+
+
+    CULL_TARGET_AVX2 uint32_t cullSpheresAvx2(const CullPlanes& planes, const SphereBounds& bounds, uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        uint32_t i = begin;
+
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+            __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+            __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+            __m256 negRadius = _mm256_sub_ps(_mm256_setzero_ps(), _mm256_loadu_ps(&bounds.radius[i]));
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (uint32_t p = 0; p < 6; ++p)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), cx), _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), cy)),
+                    _mm256_mul_ps(_mm256_set1_ps(planes.z[p]), cz)), _mm256_set1_ps(planes.w[p]));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negRadius, _CMP_GE_OQ));
+            }
+
+            written += appendIndices(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, pOut + written);
+        }
+
+        return written + cullSpheresSse(planes, bounds, i, end, pOut + written);
+    }
+
+
+    CULL_TARGET_AVX2 uint32_t cullBoxesAvx2(const CullPlanes& planes, const BoxBounds& bounds, uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+        uint32_t written = 0;
+        uint32_t i = begin;
+
+        for (; i + 8 <= end; i += 8)
+        {
+            __m256 cx = _mm256_loadu_ps(&bounds.centerX[i]);
+            __m256 cy = _mm256_loadu_ps(&bounds.centerY[i]);
+            __m256 cz = _mm256_loadu_ps(&bounds.centerZ[i]);
+            __m256 ex = _mm256_loadu_ps(&bounds.extentX[i]);
+            __m256 ey = _mm256_loadu_ps(&bounds.extentY[i]);
+            __m256 ez = _mm256_loadu_ps(&bounds.extentZ[i]);
+
+            __m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+            for (uint32_t p = 0; p < 6; ++p)
+            {
+                __m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.x[p]), cx), _mm256_mul_ps(_mm256_set1_ps(planes.y[p]), cy)),
+                    _mm256_mul_ps(_mm256_set1_ps(planes.z[p]), cz)), _mm256_set1_ps(planes.w[p]));
+                __m256 reach = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(planes.absX[p]), ex), _mm256_mul_ps(_mm256_set1_ps(planes.absY[p]), ey)),
+                    _mm256_mul_ps(_mm256_set1_ps(planes.absZ[p]), ez));
+                inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, _mm256_sub_ps(_mm256_setzero_ps(), reach), _CMP_GE_OQ));
+            }
+
+            written += appendIndices(static_cast<uint32_t>(_mm256_movemask_ps(inside)), i, pOut + written);
+        }
+
+        return written + cullBoxesSse(planes, bounds, i, end, pOut + written);
+    }
+
+
+    // AVX2 needs the CPU bit and the OS saving the ymm registers (OSXSAVE + XCR0 bits 1 and 2)
+    bool cpuHasAvx2()
+    {
+#ifdef _MSC_VER
+        int info[4];
+        __cpuid(info, 0);
+        if (info[0] < 7)
+            return false;
+
+        __cpuid(info, 1);
+        bool osxsave = (info[2] & (1 << 27)) != 0;
+        bool avx = (info[2] & (1 << 28)) != 0;
+        if (!osxsave || !avx || (_xgetbv(0) & 6) != 6)
+            return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+#else
+        __builtin_cpu_init();
+        return __builtin_cpu_supports("avx2");
+#endif
+    }
+
+#endif
+}
+
+
+Frustum Frustum::fromMatrix(const glm::mat4& m)
+{
+    // glm is column major, row r of the matrix is (m[0][r], m[1][r], m[2][r], m[3][r])
+    glm::vec4 row0(m[0][0], m[1][0], m[2][0], m[3][0]);
+    glm::vec4 row1(m[0][1], m[1][1], m[2][1], m[3][1]);
+    glm::vec4 row2(m[0][2], m[1][2], m[2][2], m[3][2]);
+    glm::vec4 row3(m[0][3], m[1][3], m[2][3], m[3][3]);
+
+    Frustum frustum;
+    frustum.planes[0] = row3 + row0;    // left    x >= -w
+    frustum.planes[1] = row3 - row0;    // right   x <= w
+    frustum.planes[2] = row3 + row1;    // top     y >= -w
+    frustum.planes[3] = row3 - row1;    // bottom  y <= w
+    frustum.planes[4] = row2;           // near    z >= 0
+    frustum.planes[5] = row3 - row2;    // far     z <= w
+
+    for (glm::vec4& plane : frustum.planes)
+    {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f)
+            plane /= length;
+    }
+
+    return frustum;
+}
+
+
+void SphereBounds::resize(uint32_t count)
+{
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    radius.resize(count);
+}
+
+
+void SphereBounds::set(uint32_t index, const glm::vec3& center, float sphereRadius)
+{
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    radius[index] = sphereRadius;
+}
+
+
+void BoxBounds::resize(uint32_t count)
+{
+    centerX.resize(count);
+    centerY.resize(count);
+    centerZ.resize(count);
+    extentX.resize(count);
+    extentY.resize(count);
+    extentZ.resize(count);
+}
+
+
+void BoxBounds::set(uint32_t index, const glm::vec3& center, const glm::vec3& extent)
+{
+    centerX[index] = center.x;
+    centerY[index] = center.y;
+    centerZ[index] = center.z;
+    extentX[index] = extent.x;
+    extentY[index] = extent.y;
+    extentZ[index] = extent.z;
+}
+
+
+const char* cullIsaName(CullIsa isa)
+{
+    switch (isa)
+    {
+    case CullIsa::Sse:  return "SSE";
+    case CullIsa::Avx2: return "AVX2";
+    default:            return "scalar";
+    }
+}
+
+
+FrustumCuller::FrustumCuller()
+    : isa(detectIsa())
+{
+}
+
+
+CullIsa FrustumCuller::detectIsa()
+{
+#ifdef CULL_X86
+    static const CullIsa detected = cpuHasAvx2() ? CullIsa::Avx2 : CullIsa::Sse;
+    return detected;
+#else
+    return CullIsa::Scalar;
+#endif
+}
+
+
+void FrustumCuller::setIsa(CullIsa isa)
+{
+    this->isa = std::min(isa, detectIsa());
+}
+
+
+// chunk c writes its indices from visibleIndices[c * ChunkSize], then the slices are moved down to close the gaps
+template<typename Kernel>
+void FrustumCuller::cullChunks(JobSystem* pJobSystem, uint32_t count, vector<uint32_t>& visibleIndices, const Kernel& kernel)
+{
+    uint32_t chunkCount = (count + ChunkSize - 1) / ChunkSize;
+
+    visibleIndices.resize(count);
+    chunkCounts.resize(chunkCount);
+
+    uint32_t* pIndices = visibleIndices.data();
+    uint32_t* pCounts = chunkCounts.data();
+
+    auto cullRange = [pIndices, pCounts, count, &kernel](uint32_t chunkBegin, uint32_t chunkEnd)
+    {
+        for (uint32_t c = chunkBegin; c < chunkEnd; ++c)
+        {
+            uint32_t begin = c * ChunkSize;
+            uint32_t end = std::min(count, begin + ChunkSize);
+            pCounts[c] = kernel(begin, end, pIndices + begin);
+        }
+    };
+
+    if (pJobSystem != nullptr)
+        pJobSystem->parallelFor(chunkCount, 1, cullRange);
+    else
+        cullRange(0, chunkCount);
+
+    uint32_t visibleCount = 0;
+    for (uint32_t c = 0; c < chunkCount; ++c)
+    {
+        if (visibleCount != c * ChunkSize)
+            memmove(pIndices + visibleCount, pIndices + c * ChunkSize, pCounts[c] * sizeof(uint32_t));
+
+        visibleCount += pCounts[c];
+    }
+
+    visibleIndices.resize(visibleCount);
+}
+
+
+void FrustumCuller::cullSpheres(JobSystem* pJobSystem, const Frustum& frustum, const SphereBounds& bounds, vector<uint32_t>& visibleIndices)
+{
+    CullPlanes planes = toCullPlanes(frustum);
+    const CullPlanes* pPlanes = &planes;
+    const SphereBounds* pBounds = &bounds;
+    CullIsa kernelIsa = isa;
+
+    cullChunks(pJobSystem, bounds.size(), visibleIndices, [pPlanes, pBounds, kernelIsa](uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+#ifdef CULL_X86
+        if (kernelIsa == CullIsa::Avx2)
+            return cullSpheresAvx2(*pPlanes, *pBounds, begin, end, pOut);
+
+        if (kernelIsa == CullIsa::Sse)
+            return cullSpheresSse(*pPlanes, *pBounds, begin, end, pOut);
+#endif
+        return cullSpheresScalar(*pPlanes, *pBounds, begin, end, pOut);
+    });
+}
+
+
+void FrustumCuller::cullBoxes(JobSystem* pJobSystem, const Frustum& frustum, const BoxBounds& bounds, vector<uint32_t>& visibleIndices)
+{
+    CullPlanes planes = toCullPlanes(frustum);
+    const CullPlanes* pPlanes = &planes;
+    const BoxBounds* pBounds = &bounds;
+    CullIsa kernelIsa = isa;
+
+    cullChunks(pJobSystem, bounds.size(), visibleIndices, [pPlanes, pBounds, kernelIsa](uint32_t begin, uint32_t end, uint32_t* pOut)
+    {
+#ifdef CULL_X86
+        if (kernelIsa == CullIsa::Avx2)
+            return cullBoxesAvx2(*pPlanes, *pBounds, begin, end, pOut);
+
+        if (kernelIsa == CullIsa::Sse)
+            return cullBoxesSse(*pPlanes, *pBounds, begin, end, pOut);
+#endif
+        return cullBoxesScalar(*pPlanes, *pBounds, begin, end, pOut);
+    });
+}
@@ -0,0 +1,94 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+
+// six inward facing planes, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+
+    // Gribb-Hartmann extraction for Vulkan clip space (z in [0, w]), the planes are normalised
+    // so the distances can be compared with radii - identity gives the clip volume itself
+    static Frustum fromMatrix(const glm::mat4& viewProjection);
+};
+
+
+// one array per component, so a SIMD load picks up the same component of 4 or 8 objects
+struct SphereBounds
+{
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> radius;
+
+    uint32_t size() const { return static_cast<uint32_t>(radius.size()); }
+    void resize(uint32_t count);
+    void set(uint32_t index, const glm::vec3& center, float sphereRadius);
+};
+
+
+// axis aligned, center and half extents
+struct BoxBounds
+{
+    std::vector<float> centerX;
+    std::vector<float> centerY;
+    std::vector<float> centerZ;
+    std::vector<float> extentX;
+    std::vector<float> extentY;
+    std::vector<float> extentZ;
+
+    uint32_t size() const { return static_cast<uint32_t>(extentX.size()); }
+    void resize(uint32_t count);
+    void set(uint32_t index, const glm::vec3& center, const glm::vec3& extent);
+};
+
+
+enum class CullIsa
+{
+    Scalar,
+    Sse,
+    Avx2,
+};
+
+const char* cullIsaName(CullIsa isa);
+
+
+// tests bounds against a frustum 4 (SSE) or 8 (AVX2) objects at a time and writes the indices of the visible
+// ones in ascending order - the instruction set is picked at runtime, scalar where neither is available
+// large sets are split into chunks on the job system, every chunk writes its own slice of the output and
+// the slices are packed afterwards, so the result is the same for any thread count
+class FrustumCuller
+{
+public:
+
+    static constexpr uint32_t ChunkSize = 4096;
+
+    FrustumCuller();
+
+    // the best one the CPU supports
+    static CullIsa detectIsa();
+
+    // clamped to what the CPU supports, for benchmarks and comparisons
+    void setIsa(CullIsa isa);
+    CullIsa getIsa() const { return isa; }
+
+    // pJobSystem nullptr - on the calling thread
+    void cullSpheres(JobSystem* pJobSystem, const Frustum& frustum, const SphereBounds& bounds, std::vector<uint32_t>& visibleIndices);
+    void cullBoxes(JobSystem* pJobSystem, const Frustum& frustum, const BoxBounds& bounds, std::vector<uint32_t>& visibleIndices);
+
+private:
+
+    template<typename Kernel>
+    void cullChunks(JobSystem* pJobSystem, uint32_t count, std::vector<uint32_t>& visibleIndices, const Kernel& kernel);
+
+    CullIsa isa = CullIsa::Scalar;
+
+    // visible count of each chunk, reused between calls
+    std::vector<uint32_t> chunkCounts;
+};
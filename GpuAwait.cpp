@@ -0,0 +1,325 @@
+#include "GpuAwait.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <chrono>
+#include <stdexcept>
+
+using std::endl;
+using std::runtime_error;
+using std::vector;
+
+
+GpuTask& GpuTask::operator=(GpuTask&& other) noexcept
+{
+    if (this != &other)
+    {
+        if (handle)
+            handle.destroy();
+
+        handle = std::exchange(other.handle, nullptr);
+    }
+
+    return *this;
+}
+
+
+GpuTask::~GpuTask()
+{
+    if (handle)
+        handle.destroy();
+}
+
+
+void GpuTask::wait() const
+{
+    // nothing notifies done, see FinalAwaiter
+    while (!isDone())
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+}
+
+
+void GpuTask::rethrow() const
+{
+    if (handle && handle.promise().exception)
+        std::rethrow_exception(handle.promise().exception);
+}
+
+
+bool GpuFence::Awaiter::await_ready()
+{
+    result = vkGetFenceStatus(pWaiter->pDevice, pFence);
+    if (result == VK_NOT_READY)
+        return false;
+
+    pWaiter->readyOnAwait.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+void GpuFence::Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    pWaiter->enqueue({ pFence, nullptr, 0, &result, handle });
+}
+
+
+void GpuFence::Awaiter::await_resume() const
+{
+    if (result != VK_SUCCESS)
+        throw runtime_error("failed to wait for fence");
+}
+
+
+bool GpuTimeline::Awaiter::await_ready()
+{
+    if (!pWaiter->timelineSemaphores)
+        throw runtime_error("timeline awaits need timeline semaphores");
+
+    uint64_t counter = 0;
+    result = vkGetSemaphoreCounterValue(pWaiter->pDevice, pSemaphore, &counter);
+    if (result != VK_SUCCESS)
+        return true;
+
+    if (counter < value)
+    {
+        result = VK_NOT_READY;
+        return false;
+    }
+
+    pWaiter->readyOnAwait.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+void GpuTimeline::Awaiter::await_suspend(std::coroutine_handle<> handle)
+{
+    pWaiter->enqueue({ nullptr, pSemaphore, value, &result, handle });
+}
+
+
+void GpuTimeline::Awaiter::await_resume() const
+{
+    if (result != VK_SUCCESS)
+        throw runtime_error("failed to wait for timeline semaphore");
+}
+
+
+void GpuWaiter::create(VkDevice pDevice, bool timelineSemaphores)
+{
+    destroy();
+
+    this->pDevice = pDevice;
+    this->timelineSemaphores = timelineSemaphores;
+
+    if (timelineSemaphores)
+    {
+        VkSemaphoreTypeCreateInfo typeInfo{};
+        typeInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+        typeInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+        typeInfo.initialValue = 0;
+
+        VkSemaphoreCreateInfo semaphoreInfo{};
+        semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+        semaphoreInfo.pNext = &typeInfo;
+
+        if (vkCreateSemaphore(pDevice, &semaphoreInfo, nullptr, &pWakeSemaphore) != VK_SUCCESS)
+            throw runtime_error("failed to create gpu waiter semaphore");
+
+        wakeValue = 0;
+    }
+
+    stopping = false;
+    thread = std::thread(&GpuWaiter::waiterMain, this);
+}
+
+
+void GpuWaiter::destroy()
+{
+    if (!thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+
+        if (pWakeSemaphore != nullptr)
+        {
+            VkSemaphoreSignalInfo signalInfo{};
+            signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+            signalInfo.semaphore = pWakeSemaphore;
+            signalInfo.value = ++wakeValue;
+            vkSignalSemaphore(pDevice, &signalInfo);
+        }
+    }
+
+    wake.notify_one();
+    thread.join();
+
+    vkDestroySemaphore(pDevice, pWakeSemaphore, nullptr);
+    pWakeSemaphore = nullptr;
+    pDevice = nullptr;
+}
+
+
+void GpuWaiter::enqueue(const Waiter& waiter)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        incoming.push_back(waiter);
+
+        // the host signal ends a vkWaitSemaphores that includes the wake semaphore
+        if (pWakeSemaphore != nullptr)
+        {
+            VkSemaphoreSignalInfo signalInfo{};
+            signalInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SIGNAL_INFO;
+            signalInfo.semaphore = pWakeSemaphore;
+            signalInfo.value = ++wakeValue;
+            vkSignalSemaphore(pDevice, &signalInfo);
+        }
+    }
+
+    wake.notify_one();
+}
+
+
+void GpuWaiter::waiterMain()
+{
+    for (;;)
+    {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+
+            // stopping still drains what is pending, a coroutine is never left suspended
+            if (pending.empty())
+                wake.wait(lock, [this]() { return stopping || !incoming.empty(); });
+
+            if (stopping && pending.empty() && incoming.empty())
+                break;
+
+            pending.insert(pending.end(), incoming.begin(), incoming.end());
+            incoming.clear();
+        }
+
+        maxPending.store(std::max(maxPending.load(std::memory_order_relaxed), static_cast<uint32_t>(pending.size())), std::memory_order_relaxed);
+
+        if (!resumeReady())
+            block();
+    }
+}
+
+
+bool GpuWaiter::resumeReady()
+{
+    // resumed coroutines may await again, those come back through incoming
+    vector<Waiter> ready;
+
+    for (size_t i = 0; i < pending.size();)
+    {
+        Waiter& waiter = pending[i];
+        VkResult result = VK_NOT_READY;
+
+        if (waiter.pFence != nullptr)
+        {
+            result = vkGetFenceStatus(pDevice, waiter.pFence);
+        }
+        else
+        {
+            uint64_t counter = 0;
+            result = vkGetSemaphoreCounterValue(pDevice, waiter.pSemaphore, &counter);
+            if (result == VK_SUCCESS && counter < waiter.value)
+                result = VK_NOT_READY;
+        }
+
+        if (result == VK_NOT_READY)
+        {
+            ++i;
+            continue;
+        }
+
+        *waiter.pResult = result;
+        ready.push_back(waiter);
+
+        waiter = pending.back();
+        pending.pop_back();
+    }
+
+    for (const Waiter& waiter : ready)
+        waiter.handle.resume();
+
+    resumed.fetch_add(ready.size(), std::memory_order_relaxed);
+    return !ready.empty();
+}
+
+
+// until one of the pending waits may have finished or a new one came in
+void GpuWaiter::block()
+{
+    waitFences.clear();
+    waitSemaphores.clear();
+    waitValues.clear();
+
+    for (const Waiter& waiter : pending)
+    {
+        if (waiter.pFence != nullptr)
+        {
+            waitFences.push_back(waiter.pFence);
+        }
+        else
+        {
+            waitSemaphores.push_back(waiter.pSemaphore);
+            waitValues.push_back(waiter.value);
+        }
+    }
+
+    if (!waitSemaphores.empty())
+    {
+        // with fences pending the wait has to come back to them
+        uint64_t timeout = waitFences.empty() ? UINT64_MAX : PollNs / 2;
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!incoming.empty())
+                return;
+
+            waitSemaphores.push_back(pWakeSemaphore);
+            waitValues.push_back(wakeValue + 1);
+        }
+
+        VkSemaphoreWaitInfo waitInfo{};
+        waitInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_WAIT_INFO;
+        waitInfo.flags = VK_SEMAPHORE_WAIT_ANY_BIT;
+        waitInfo.semaphoreCount = static_cast<uint32_t>(waitSemaphores.size());
+        waitInfo.pSemaphores = waitSemaphores.data();
+        waitInfo.pValues = waitValues.data();
+
+        vkWaitSemaphores(pDevice, &waitInfo, timeout);
+    }
+
+    if (!waitFences.empty())
+    {
+        uint64_t timeout = waitSemaphores.empty() ? PollNs : PollNs / 2;
+        vkWaitForFences(pDevice, static_cast<uint32_t>(waitFences.size()), waitFences.data(), VK_FALSE, timeout);
+    }
+}
+
+
+GpuWaiterStats GpuWaiter::getStats() const
+{
+    GpuWaiterStats stats;
+    stats.resumed = resumed.load(std::memory_order_relaxed);
+    stats.readyOnAwait = readyOnAwait.load(std::memory_order_relaxed);
+    stats.maxPending = maxPending.load(std::memory_order_relaxed);
+    return stats;
+}
+
+
+void GpuWaiter::logStats() const
+{
+    GpuWaiterStats stats = getStats();
+    if (stats.resumed == 0 && stats.readyOnAwait == 0)
+        return;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "gpu waiter: " << stats.resumed << " awaits resumed, " << stats.readyOnAwait << " ready on await, "
+        << stats.maxPending << " pending at most" << endl;
+}
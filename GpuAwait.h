@@ -0,0 +1,198 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+
+// a coroutine that runs until its first co_await on GPU work, the GpuWaiter resumes it once that work is done
+// the frame stays alive after the coroutine ends so isDone() and the exception can still be read
+// it must not be destroyed while it is suspended on a GpuWaiter
+class GpuTask
+{
+public:
+
+    struct promise_type
+    {
+        std::exception_ptr exception;
+        std::atomic<bool> done{ false };
+
+        // marks the task done only once it is suspended for good, so another thread may destroy it right away
+        // the store is the last touch of the frame - no notify after it, the reaper may have freed it by then
+        struct FinalAwaiter
+        {
+            bool await_ready() const noexcept { return false; }
+
+            void await_suspend(std::coroutine_handle<promise_type> handle) const noexcept
+            {
+                handle.promise().done.store(true, std::memory_order_release);
+            }
+
+            void await_resume() const noexcept {}
+        };
+
+        GpuTask get_return_object() { return GpuTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_never initial_suspend() noexcept { return {}; }
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { exception = std::current_exception(); }
+    };
+
+    GpuTask() = default;
+    GpuTask(GpuTask&& other) noexcept : handle(std::exchange(other.handle, nullptr)) {}
+    GpuTask& operator=(GpuTask&& other) noexcept;
+    ~GpuTask();
+
+    GpuTask(const GpuTask&) = delete;
+    GpuTask& operator=(const GpuTask&) = delete;
+
+    bool isDone() const { return !handle || handle.promise().done.load(std::memory_order_acquire); }
+
+    // polls until the task is done - for shutdown, frame code polls isDone()
+    void wait() const;
+
+    // rethrows what escaped the coroutine, call once it is done
+    void rethrow() const;
+
+private:
+
+    explicit GpuTask(std::coroutine_handle<promise_type> handle) : handle(handle) {}
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+
+struct GpuWaiterStats
+{
+    uint64_t resumed = 0;
+
+    // awaits that found the work done already and never suspended
+    uint64_t readyOnAwait = 0;
+
+    uint32_t maxPending = 0;
+};
+
+
+class GpuWaiter;
+
+
+// co_await GpuFence{ &waiter, pFence }
+struct GpuFence
+{
+    GpuWaiter* pWaiter = nullptr;
+    VkFence pFence = nullptr;
+
+    struct Awaiter
+    {
+        GpuWaiter* pWaiter;
+        VkFence pFence;
+        VkResult result = VK_NOT_READY;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const;
+    };
+
+    Awaiter operator co_await() const { return { pWaiter, pFence }; }
+};
+
+
+// co_await (GpuTimeline{ &waiter, pSemaphore } >= value)
+struct GpuTimeline
+{
+    GpuWaiter* pWaiter = nullptr;
+    VkSemaphore pSemaphore = nullptr;
+
+    struct Awaiter
+    {
+        GpuWaiter* pWaiter;
+        VkSemaphore pSemaphore;
+        uint64_t value;
+        VkResult result = VK_NOT_READY;
+
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> handle);
+        void await_resume() const;
+    };
+
+    Awaiter operator>=(uint64_t value) const { return { pWaiter, pSemaphore, value }; }
+};
+
+
+// one thread that blocks on the fences and timeline values coroutines await and resumes them when they signal,
+// so loading, upload and readback code reads top to bottom without ever blocking a worker or the render thread
+// the coroutines continue on the waiter thread - anything longer than a few copies belongs on the job system
+// fences cannot interrupt a wait, so with fences pending a new await is noticed within PollNs
+// timelines wait together with a host signalled wake semaphore and are noticed right away
+class GpuWaiter
+{
+public:
+
+    static constexpr uint64_t PollNs = 1000000;
+
+    ~GpuWaiter() { destroy(); }
+
+    // timelineSemaphores - the device has them enabled, GpuTimeline needs it
+    void create(VkDevice pDevice, bool timelineSemaphores);
+
+    // resumes whatever is still waiting - the device must be idle or about to finish it
+    void destroy();
+
+    GpuTimeline getTimeline(VkSemaphore pSemaphore) { return { this, pSemaphore }; }
+    GpuFence getFence(VkFence pFence) { return { this, pFence }; }
+
+    GpuWaiterStats getStats() const;
+    void logStats() const;
+
+private:
+
+    friend struct GpuFence::Awaiter;
+    friend struct GpuTimeline::Awaiter;
+
+    struct Waiter
+    {
+        VkFence pFence = nullptr;
+        VkSemaphore pSemaphore = nullptr;
+        uint64_t value = 0;
+        VkResult* pResult = nullptr;
+        std::coroutine_handle<> handle;
+    };
+
+    void enqueue(const Waiter& waiter);
+    void waiterMain();
+
+    // resumes the finished ones and drops them from pending, true if any was
+    bool resumeReady();
+    void block();
+
+    VkDevice pDevice = nullptr;
+    bool timelineSemaphores = false;
+
+    // signalled by enqueue() so a timeline wait notices new waiters
+    VkSemaphore pWakeSemaphore = nullptr;
+    uint64_t wakeValue = 0;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::vector<Waiter> incoming;
+    bool stopping = false;
+
+    // only touched by the waiter thread
+    std::vector<Waiter> pending;
+    std::vector<VkFence> waitFences;
+    std::vector<VkSemaphore> waitSemaphores;
+    std::vector<uint64_t> waitValues;
+
+    std::thread thread;
+
+    std::atomic<uint64_t> resumed{ 0 };
+    std::atomic<uint64_t> readyOnAwait{ 0 };
+    std::atomic<uint32_t> maxPending{ 0 };
+};
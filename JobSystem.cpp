@@ -0,0 +1,326 @@
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using std::runtime_error;
+
+
+namespace
+{
+    // the calling thread's state in the current JobSystem, generation tells a stale one from a live one
+    struct ThreadSlot
+    {
+        const void* pOwner = nullptr;
+        uint64_t generation = 0;
+        void* pState = nullptr;
+    };
+
+    thread_local ThreadSlot threadSlot;
+
+    std::atomic<uint64_t> nextGeneration{ 1 };
+
+
+    uint32_t xorshift(uint32_t& state)
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+}
+
+
+bool JobSystem::Deque::push(Job* pJob)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+
+    if (b - t >= static_cast<int64_t>(QueueCapacity))
+        return false;
+
+    jobs[b & Mask].store(pJob, std::memory_order_relaxed);
+    bottom.store(b + 1, std::memory_order_release);
+    return true;
+}
+
+
+JobSystem::Job* JobSystem::Deque::pop()
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        // empty
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    Job* pJob = jobs[b & Mask].load(std::memory_order_relaxed);
+
+    // the last job - race the thieves for it
+    if (t == b)
+    {
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            pJob = nullptr;
+
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    return pJob;
+}
+
+
+JobSystem::Job* JobSystem::Deque::steal()
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+
+    if (t >= b)
+        return nullptr;
+
+    Job* pJob = jobs[t & Mask].load(std::memory_order_relaxed);
+
+    // another thief or the owner got there first
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        return nullptr;
+
+    return pJob;
+}
+
+
+void JobSystem::create(uint32_t workerCount)
+{
+    destroy();
+
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::thread::hardware_concurrency()) - 1;
+
+    this->workerCount = std::min(workerCount, MaxThreads / 2);
+    generation = nextGeneration.fetch_add(1);
+    running = true;
+
+    // the creating thread takes slot 0, workers register themselves as they start
+    registerThread();
+
+    workers.reserve(this->workerCount);
+    for (uint32_t i = 0; i < this->workerCount; ++i)
+        workers.emplace_back(&JobSystem::workerMain, this);
+}
+
+
+void JobSystem::destroy()
+{
+    if (!running)
+        return;
+
+    running = false;
+
+    wakeEpoch.fetch_add(1);
+    wakeEpoch.notify_all();
+
+    for (std::thread& worker : workers)
+        worker.join();
+
+    workers.clear();
+
+    for (auto& pState : threadStates)
+        pState.store(nullptr, std::memory_order_relaxed);
+
+    threadCount = 0;
+    ownedStates.clear();
+    workerCount = 0;
+}
+
+
+JobSystem::ThreadState& JobSystem::getThreadState()
+{
+    if (threadSlot.pOwner == this && threadSlot.generation == generation)
+        return *static_cast<ThreadState*>(threadSlot.pState);
+
+    return registerThread();
+}
+
+
+JobSystem::ThreadState& JobSystem::registerThread()
+{
+    std::lock_guard<std::mutex> lock(registerMutex);
+
+    uint32_t index = threadCount.load(std::memory_order_relaxed);
+    if (index >= MaxThreads)
+        throw runtime_error("too many threads use the job system");
+
+    ownedStates.push_back(std::make_unique<ThreadState>());
+    ThreadState* pState = ownedStates.back().get();
+    pState->rng = 0x9E3779B9u * (index + 1);
+
+    threadStates[index].store(pState, std::memory_order_release);
+    threadCount.store(index + 1, std::memory_order_release);
+
+    threadSlot = { this, generation, pState };
+    return *pState;
+}
+
+
+// nullptr when the slot still holds a job that has not started
+JobSystem::Job* JobSystem::allocateJob(ThreadState& state)
+{
+    Job* pJob = &state.jobPool[state.nextJob & (QueueCapacity - 1)];
+    if (pJob->pending.load(std::memory_order_acquire))
+        return nullptr;
+
+    ++state.nextJob;
+    pJob->pending.store(true, std::memory_order_relaxed);
+    return pJob;
+}
+
+
+void JobSystem::push(ThreadState& state, Job* pJob)
+{
+    if (!state.deque.push(pJob))
+    {
+        state.jobsInlined.fetch_add(1, std::memory_order_relaxed);
+        execute(pJob);
+        return;
+    }
+
+    // pairs with the fence in workerMain - either the worker sees the job or we see the worker asleep
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    if (sleepingWorkers.load(std::memory_order_relaxed) > 0)
+    {
+        wakeEpoch.fetch_add(1, std::memory_order_release);
+        wakeEpoch.notify_one();
+    }
+}
+
+
+// the job is copied out first so its slot can be reused while it runs
+void JobSystem::execute(Job* pJob)
+{
+    void (*invoke)(const void*) = pJob->invoke;
+    JobCounter* pCounter = pJob->pCounter;
+
+    alignas(16) unsigned char data[MaxJobData];
+    memcpy(data, pJob->data, MaxJobData);
+
+    pJob->pending.store(false, std::memory_order_release);
+
+    invoke(data);
+    pCounter->value.fetch_sub(1, std::memory_order_release);
+}
+
+
+// own deque first (newest job, still in cache), then steal the oldest job of a random other thread
+bool JobSystem::runOne(ThreadState& state)
+{
+    Job* pJob = state.deque.pop();
+
+    if (pJob == nullptr)
+    {
+        uint32_t count = threadCount.load(std::memory_order_acquire);
+        uint32_t start = xorshift(state.rng) % count;
+
+        for (uint32_t i = 0; i < count && pJob == nullptr; ++i)
+        {
+            ThreadState* pVictim = threadStates[(start + i) % count].load(std::memory_order_acquire);
+            if (pVictim != nullptr && pVictim != &state)
+                pJob = pVictim->deque.steal();
+        }
+
+        if (pJob == nullptr)
+            return false;
+
+        state.jobsStolen.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    execute(pJob);
+    state.jobsRun.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+void JobSystem::wait(JobCounter& counter)
+{
+    ThreadState& state = getThreadState();
+
+    while (!counter.isDone())
+    {
+        if (!runOne(state))
+            std::this_thread::yield();
+    }
+}
+
+
+void JobSystem::workerMain()
+{
+    ThreadState& state = registerThread();
+
+    while (running.load(std::memory_order_relaxed))
+    {
+        uint32_t epoch = wakeEpoch.load(std::memory_order_acquire);
+
+        if (runOne(state))
+            continue;
+
+        // spin briefly before sleeping, jobs tend to come in bursts
+        bool found = false;
+        for (uint32_t spin = 0; spin < 64 && !found; ++spin)
+        {
+            std::this_thread::yield();
+            found = runOne(state);
+        }
+
+        if (found)
+            continue;
+
+        sleepingWorkers.fetch_add(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (!runOne(state) && running.load(std::memory_order_relaxed))
+            wakeEpoch.wait(epoch, std::memory_order_acquire);
+
+        sleepingWorkers.fetch_sub(1, std::memory_order_relaxed);
+    }
+}
+
+
+JobSystemStats JobSystem::getStats() const
+{
+    JobSystemStats stats;
+
+    uint32_t count = threadCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        const ThreadState* pState = threadStates[i].load(std::memory_order_acquire);
+        if (pState == nullptr)
+            continue;
+
+        stats.jobsRun += pState->jobsRun.load(std::memory_order_relaxed);
+        stats.jobsStolen += pState->jobsStolen.load(std::memory_order_relaxed);
+        stats.jobsInlined += pState->jobsInlined.load(std::memory_order_relaxed);
+    }
+
+    return stats;
+}
+
+
+void JobSystem::resetStats()
+{
+    uint32_t count = threadCount.load(std::memory_order_acquire);
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        ThreadState* pState = threadStates[i].load(std::memory_order_acquire);
+        if (pState == nullptr)
+            continue;
+
+        pState->jobsRun.store(0, std::memory_order_relaxed);
+        pState->jobsStolen.store(0, std::memory_order_relaxed);
+        pState->jobsInlined.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,197 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+
+// counts the unfinished jobs started with it, JobSystem::wait() returns once it is back to 0
+// a job that has to run after others waits on their counter - waiting runs other jobs meanwhile
+struct JobCounter
+{
+    std::atomic<uint32_t> value{ 0 };
+
+    bool isDone() const { return value.load(std::memory_order_acquire) == 0; }
+};
+
+
+struct JobSystemStats
+{
+    uint64_t jobsRun = 0;
+    uint64_t jobsStolen = 0;
+
+    // jobs that found the owner's ring or deque full and ran right away
+    uint64_t jobsInlined = 0;
+};
+
+
+// work stealing scheduler - every thread that starts jobs owns a deque, it pushes and pops at the bottom
+// while idle threads steal from the top of the others (Chase-Lev), so there is no shared queue to contend on
+// jobs live in a per thread ring, nothing is allocated per job - when the ring wraps onto a job that has
+// not started yet the new job runs right away instead, parallelFor() chunks so that stays rare
+// threads that are not workers (main, render) get a deque on first use and run jobs while they wait
+class JobSystem
+{
+public:
+
+    static constexpr uint32_t MaxThreads = 64;
+    static constexpr uint32_t QueueCapacity = 4096;
+    static constexpr size_t MaxJobData = 48;
+
+    ~JobSystem() { destroy(); }
+
+    // workerCount 0 - one worker per core besides the calling thread
+    void create(uint32_t workerCount = 0);
+    void destroy();
+
+    // copies function into the job, it has to be small and trivially copyable (a lambda capturing references is)
+    template<typename F>
+    void run(JobCounter& counter, const F& function);
+
+    // function(begin, end) over [0, count) in chunks of at least grain, returns when all of them are done
+    template<typename F>
+    void parallelFor(uint32_t count, uint32_t grain, const F& function);
+
+    // runs jobs until counter reaches 0
+    void wait(JobCounter& counter);
+
+    // workers plus the thread that created the system
+    uint32_t getThreadCount() const { return workerCount + 1; }
+    uint32_t getWorkerCount() const { return workerCount; }
+
+    JobSystemStats getStats() const;
+    void resetStats();
+
+private:
+
+    struct Job
+    {
+        void (*invoke)(const void* pData) = nullptr;
+        JobCounter* pCounter = nullptr;
+        alignas(16) unsigned char data[MaxJobData];
+
+        // set while the job waits to run, execute() clears it once it has copied the job out
+        std::atomic<bool> pending{ false };
+    };
+
+    // Chase-Lev deque over a fixed ring, the owner pushes and pops at bottom, thieves take from top
+    class Deque
+    {
+    public:
+
+        bool push(Job* pJob);
+        Job* pop();
+        Job* steal();
+
+    private:
+
+        static constexpr int64_t Mask = QueueCapacity - 1;
+
+        alignas(64) std::atomic<int64_t> top{ 0 };
+        alignas(64) std::atomic<int64_t> bottom{ 0 };
+        std::array<std::atomic<Job*>, QueueCapacity> jobs{};
+    };
+
+    struct ThreadState
+    {
+        Deque deque;
+        std::array<Job, QueueCapacity> jobPool;
+        uint32_t nextJob = 0;
+        uint32_t rng = 0;
+
+        // only written by the owning thread
+        std::atomic<uint64_t> jobsRun{ 0 };
+        std::atomic<uint64_t> jobsStolen{ 0 };
+        std::atomic<uint64_t> jobsInlined{ 0 };
+    };
+
+    static_assert((QueueCapacity & (QueueCapacity - 1)) == 0, "QueueCapacity must be a power of two");
+
+    ThreadState& getThreadState();
+    ThreadState& registerThread();
+    Job* allocateJob(ThreadState& state);
+    void push(ThreadState& state, Job* pJob);
+    bool runOne(ThreadState& state);
+    static void execute(Job* pJob);
+    void workerMain();
+
+    uint32_t workerCount = 0;
+    uint64_t generation = 0;
+
+    std::array<std::atomic<ThreadState*>, MaxThreads> threadStates{};
+    std::atomic<uint32_t> threadCount{ 0 };
+
+    // owns what threadStates points to, only locked while a thread registers
+    std::mutex registerMutex;
+    std::vector<std::unique_ptr<ThreadState>> ownedStates;
+
+    std::vector<std::thread> workers;
+    std::atomic<bool> running{ false };
+
+    // idle workers sleep on wakeEpoch, pushes only bump it when someone is asleep
+    std::atomic<uint32_t> wakeEpoch{ 0 };
+    std::atomic<uint32_t> sleepingWorkers{ 0 };
+};
+
+
+template<typename F>
+void JobSystem::run(JobCounter& counter, const F& function)
+{
+    static_assert(sizeof(F) <= MaxJobData, "job function captures too much, capture a pointer to the data instead");
+    static_assert(alignof(F) <= 16, "job function is over aligned");
+    static_assert(std::is_trivially_copyable<F>::value && std::is_trivially_destructible<F>::value, "job function must be trivially copyable");
+
+    ThreadState& state = getThreadState();
+
+    Job* pJob = allocateJob(state);
+    if (pJob == nullptr)
+    {
+        state.jobsInlined.fetch_add(1, std::memory_order_relaxed);
+        function();
+        return;
+    }
+
+    pJob->invoke = [](const void* pData) { (*static_cast<const F*>(pData))(); };
+    pJob->pCounter = &counter;
+    new (pJob->data) F(function);
+
+    counter.value.fetch_add(1, std::memory_order_relaxed);
+    push(state, pJob);
+}
+
+
+template<typename F>
+void JobSystem::parallelFor(uint32_t count, uint32_t grain, const F& function)
+{
+    if (count == 0)
+        return;
+
+    // a few chunks per thread so the stealing can even out uneven chunks
+    uint32_t chunkSize = std::max(std::max(grain, 1u), (count + getThreadCount() * 4 - 1) / (getThreadCount() * 4));
+    chunkSize = std::max(chunkSize, (count + QueueCapacity / 2 - 1) / (QueueCapacity / 2));
+
+    if (chunkSize >= count)
+    {
+        function(0u, count);
+        return;
+    }
+
+    JobCounter counter;
+    const F* pFunction = &function;
+
+    for (uint32_t begin = 0; begin < count; begin += chunkSize)
+    {
+        uint32_t end = std::min(count, begin + chunkSize);
+        run(counter, [pFunction, begin, end]() { (*pFunction)(begin, end); });
+    }
+
+    wait(counter);
+}
@@ -0,0 +1,488 @@
+#include "LogBackend.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+using std::string;
+using std::string_view;
+using std::vector;
+using std::shared_ptr;
+using std::atomic;
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+using std::runtime_error;
+
+
+namespace
+{
+    // one record is a cache-line multiple, long messages span consecutive records
+    constexpr size_t RecordSize = 256;
+    constexpr uint8_t RecordContinues = 0x01;
+
+    struct LogRecord
+    {
+        uint64_t timestamp;     // system_clock nanoseconds since epoch
+        uint32_t threadId;
+        LogLevel level;
+        uint8_t flags;
+        uint16_t length;
+        char text[RecordSize - 16];
+    };
+
+    static_assert(sizeof(LogRecord) == RecordSize, "LogRecord must stay packed");
+
+    constexpr size_t PayloadSize = sizeof(LogRecord::text);
+
+
+    // single producer (owning thread) / single consumer (writer thread)
+    struct LogRing
+    {
+        LogRing(uint32_t capacity, uint32_t threadId, uint64_t generation)
+            : records(capacity), mask(capacity - 1), threadId(threadId), generation(generation)
+        {
+        }
+
+        vector<LogRecord> records;
+        const uint64_t mask;
+        const uint32_t threadId;
+        const uint64_t generation;
+
+        alignas(64) atomic<uint64_t> head{ 0 };     // written by producer
+        alignas(64) atomic<uint64_t> tail{ 0 };     // written by consumer
+        atomic<bool> retired{ false };
+    };
+
+
+    struct PendingMessage
+    {
+        uint64_t timestamp = 0;
+        uint32_t threadId = 0;
+        LogLevel level = LogLevel::Info;
+        string text;
+    };
+
+
+    struct Backend
+    {
+        LogConfig config;
+        std::ofstream file;
+        std::ostream* pSink = nullptr;
+
+        atomic<bool> running{ false };
+        atomic<uint64_t> generation{ 0 };
+        atomic<uint64_t> dropped{ 0 };
+        atomic<uint32_t> nextThreadId{ 0 };
+        atomic<LogLevel> level{ LogLevel::Trace };
+
+        // only taken when a thread registers its ring and by the writer while draining
+        mutex ringsMutex;
+        vector<shared_ptr<LogRing>> rings;
+
+        mutex wakeMutex;
+        std::condition_variable wake;
+        bool stopRequested = false;
+        std::thread writer;
+
+        // writer-owned scratch, reused across drains
+        vector<PendingMessage> pending;
+        string output;
+    };
+
+    Backend& backend()
+    {
+        static Backend instance;
+        return instance;
+    }
+
+
+    struct ThreadRing
+    {
+        shared_ptr<LogRing> ring;
+
+        ~ThreadRing()
+        {
+            if (ring)
+                ring->retired.store(true, std::memory_order_release);
+        }
+    };
+
+    thread_local ThreadRing threadRing;
+
+
+    uint32_t roundUpPow2(uint32_t value)
+    {
+        uint32_t pow2 = 16;
+        while (pow2 < value)
+            pow2 <<= 1;
+
+        return pow2;
+    }
+
+
+    uint64_t now()
+    {
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch());
+        return static_cast<uint64_t>(ns.count());
+    }
+
+
+    LogRing* acquireRing(Backend& be)
+    {
+        uint64_t generation = be.generation.load(std::memory_order_acquire);
+
+        if (threadRing.ring && threadRing.ring->generation == generation)
+            return threadRing.ring.get();
+
+        if (threadRing.ring)
+            threadRing.ring->retired.store(true, std::memory_order_release);
+
+        auto ring = std::make_shared<LogRing>(roundUpPow2(be.config.ringCapacity), be.nextThreadId.fetch_add(1), generation);
+        {
+            lock_guard<mutex> lock(be.ringsMutex);
+            be.rings.push_back(ring);
+        }
+
+        threadRing.ring = ring;
+        return ring.get();
+    }
+
+
+    const char* levelName(LogLevel level)
+    {
+        switch (level)
+        {
+        case LogLevel::Trace:   return "trace";
+        case LogLevel::Debug:   return "debug";
+        case LogLevel::Info:    return "info";
+        case LogLevel::Warning: return "warning";
+        case LogLevel::Error:   return "error";
+        default:                return "off";
+        }
+    }
+
+
+    void appendJsonEscaped(string& out, string_view text)
+    {
+        for (char c : text)
+        {
+            switch (c)
+            {
+            case '"':  out += "\\\""; break;
+            case '\\': out += "\\\\"; break;
+            case '\n': out += "\\n"; break;
+            case '\r': out += "\\r"; break;
+            case '\t': out += "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    char escaped[8];
+                    snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                    out += escaped;
+                }
+                else
+                {
+                    out += c;
+                }
+            }
+        }
+    }
+
+
+    template<typename T>
+    void appendBinary(string& out, const T& value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+
+    // binary record: uint64 timestamp, uint32 threadId, uint8 level, uint32 length, char[length]
+    void formatMessage(string& out, LogFormat format, const PendingMessage& msg)
+    {
+        switch (format)
+        {
+        case LogFormat::Text:
+            out += msg.text;
+            out += '\n';
+            break;
+
+        case LogFormat::JsonLines:
+            out += "{\"ts\":";
+            out += std::to_string(msg.timestamp);
+            out += ",\"tid\":";
+            out += std::to_string(msg.threadId);
+            out += ",\"level\":\"";
+            out += levelName(msg.level);
+            out += "\",\"msg\":\"";
+            appendJsonEscaped(out, msg.text);
+            out += "\"}\n";
+            break;
+
+        case LogFormat::Binary:
+            appendBinary(out, msg.timestamp);
+            appendBinary(out, msg.threadId);
+            appendBinary(out, static_cast<uint8_t>(msg.level));
+            appendBinary(out, static_cast<uint32_t>(msg.text.size()));
+            out += msg.text;
+            break;
+        }
+    }
+
+
+    void drainRing(LogRing& ring, vector<PendingMessage>& pending)
+    {
+        uint64_t tail = ring.tail.load(std::memory_order_relaxed);
+        uint64_t head = ring.head.load(std::memory_order_acquire);
+
+        // the producer publishes whole messages so a message never straddles a drain
+        while (tail != head)
+        {
+            const LogRecord& first = ring.records[tail & ring.mask];
+
+            PendingMessage msg;
+            msg.timestamp = first.timestamp;
+            msg.threadId = first.threadId;
+            msg.level = first.level;
+
+            for (;;)
+            {
+                const LogRecord& record = ring.records[tail & ring.mask];
+                msg.text.append(record.text, record.length);
+                ++tail;
+
+                if ((record.flags & RecordContinues) == 0)
+                    break;
+            }
+
+            pending.push_back(std::move(msg));
+        }
+
+        ring.tail.store(tail, std::memory_order_release);
+    }
+
+
+    void drainAll(Backend& be)
+    {
+        be.pending.clear();
+        be.output.clear();
+
+        {
+            lock_guard<mutex> lock(be.ringsMutex);
+
+            for (auto& ring : be.rings)
+                drainRing(*ring, be.pending);
+
+            // forget rings of threads that have exited once they are empty
+            std::erase_if(be.rings, [](const shared_ptr<LogRing>& ring)
+            {
+                return ring->retired.load(std::memory_order_acquire)
+                    && ring->tail.load(std::memory_order_relaxed) == ring->head.load(std::memory_order_acquire);
+            });
+        }
+
+        if (be.pending.empty())
+            return;
+
+        // interleave threads by time, per thread order is already correct
+        std::stable_sort(be.pending.begin(), be.pending.end(), [](const PendingMessage& a, const PendingMessage& b)
+        {
+            return a.timestamp < b.timestamp;
+        });
+
+        for (const auto& msg : be.pending)
+            formatMessage(be.output, be.config.format, msg);
+
+        be.pSink->write(be.output.data(), be.output.size());
+        be.pSink->flush();
+    }
+
+
+    void writerLoop(Backend& be)
+    {
+        unique_lock<mutex> lock(be.wakeMutex);
+
+        while (!be.stopRequested)
+        {
+            be.wake.wait_for(lock, std::chrono::milliseconds(be.config.flushIntervalMs));
+
+            lock.unlock();
+            drainAll(be);
+            lock.lock();
+        }
+
+        lock.unlock();
+        drainAll(be);
+    }
+}
+
+
+void Logging::startBackend(const LogConfig& config)
+{
+    Backend& be = backend();
+
+    if (be.running.load())
+        stopBackend();
+
+    be.config = config;
+    be.level.store(config.level);
+
+    if (config.filename.empty())
+    {
+        be.pSink = &std::cerr;
+    }
+    else
+    {
+        be.file.open(config.filename, std::ios::out | std::ios::trunc | std::ios::binary);
+        if (!be.file.is_open())
+            throw runtime_error("failed to open log file");
+
+        be.pSink = &be.file;
+    }
+
+    if (config.format == LogFormat::Binary)
+        be.pSink->write("VTLOG001", 8);
+
+    be.stopRequested = false;
+    be.generation.fetch_add(1, std::memory_order_acq_rel);
+    be.writer = std::thread(writerLoop, std::ref(be));
+    be.running.store(true, std::memory_order_release);
+}
+
+
+void Logging::stopBackend()
+{
+    Backend& be = backend();
+
+    if (!be.running.exchange(false))
+        return;
+
+    {
+        lock_guard<mutex> lock(be.wakeMutex);
+        be.stopRequested = true;
+    }
+
+    be.wake.notify_one();
+    be.writer.join();
+
+    // a producer that saw running before it was cleared may have published after the writer's last drain
+    drainAll(be);
+
+    {
+        lock_guard<mutex> lock(be.ringsMutex);
+        be.rings.clear();
+    }
+
+    if (be.file.is_open())
+        be.file.close();
+
+    be.pSink = nullptr;
+}
+
+
+uint64_t Logging::droppedRecords()
+{
+    return backend().dropped.load(std::memory_order_relaxed);
+}
+
+
+void Logging::write(LogLevel level, string_view msg)
+{
+    Backend& be = backend();
+
+    if (level < CompileLevel || level < be.level.load(std::memory_order_relaxed))
+        return;
+
+    if (!be.running.load(std::memory_order_acquire))
+    {
+        // no writer yet - behave like the old cerr path
+        fwrite(msg.data(), 1, msg.size(), stderr);
+        fputc('\n', stderr);
+        return;
+    }
+
+    LogRing& ring = *acquireRing(be);
+
+    size_t recordCount = std::max<size_t>(1, (msg.size() + PayloadSize - 1) / PayloadSize);
+
+    uint64_t head = ring.head.load(std::memory_order_relaxed);
+    uint64_t tail = ring.tail.load(std::memory_order_acquire);
+
+    if (recordCount > ring.records.size() - (head - tail))
+    {
+        be.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    uint64_t timestamp = now();
+
+    for (size_t i = 0; i < recordCount; ++i)
+    {
+        LogRecord& record = ring.records[(head + i) & ring.mask];
+
+        size_t offset = i * PayloadSize;
+        size_t length = std::min(PayloadSize, msg.size() - offset);
+
+        record.timestamp = timestamp;
+        record.threadId = ring.threadId;
+        record.level = level;
+        record.flags = (i + 1 < recordCount) ? RecordContinues : 0;
+        record.length = static_cast<uint16_t>(length);
+        memcpy(record.text, msg.data() + offset, length);
+    }
+
+    ring.head.store(head + recordCount, std::memory_order_release);
+
+    // errors should not wait for the next tick
+    if (level >= LogLevel::Error)
+        be.wake.notify_one();
+}
+
+
+Logging::LogStream::LogStream(LogLevel level)
+    : std::ostream(nullptr)
+{
+    lineBuffer.level = level;
+    rdbuf(&lineBuffer);
+    setf(std::ios::boolalpha);
+
+    // filtered streams skip all formatting
+    if (!isCompiledIn(level))
+        setstate(std::ios::badbit);
+}
+
+
+Logging::LogStream::~LogStream()
+{
+    lineBuffer.pubsync();
+}
+
+
+int Logging::LogStream::LineBuffer::sync()
+{
+    const string& text = str();
+
+    size_t begin = 0;
+    while (begin < text.size())
+    {
+        size_t end = text.find('\n', begin);
+        if (end == string::npos)
+            end = text.size();
+
+        Logging::write(level, string_view(text).substr(begin, end - begin));
+        begin = end + 1;
+    }
+
+    str(string());
+    return 0;
+}
@@ -0,0 +1,109 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+
+enum class LogLevel : uint8_t
+{
+    Trace = 0,
+    Debug,
+    Info,
+    Warning,
+    Error,
+    Off
+};
+
+
+// levels below LOG_COMPILE_LEVEL are removed at compile time (0 = Trace .. 5 = Off)
+#ifndef LOG_COMPILE_LEVEL
+#ifdef NDEBUG
+#define LOG_COMPILE_LEVEL 2
+#else
+#define LOG_COMPILE_LEVEL 0
+#endif
+#endif
+
+
+// Text      - the message only, one per line (what cerr used to print)
+// JsonLines - {"ts":..,"tid":..,"level":"..","msg":".."} one object per line
+// Binary    - "VTLOG001" header followed by packed records (see LogBackend.cpp)
+enum class LogFormat : uint8_t
+{
+    Text,
+    JsonLines,
+    Binary
+};
+
+
+struct LogConfig
+{
+    LogFormat format = LogFormat::Text;
+
+    // empty writes to stderr
+    std::string filename;
+
+    // runtime threshold, cannot go below LOG_COMPILE_LEVEL
+    LogLevel level = LogLevel::Trace;
+
+    // records per thread ring, rounded up to a power of two
+    uint32_t ringCapacity = 4096;
+
+    // how long the writer sleeps between drains
+    uint32_t flushIntervalMs = 2;
+};
+
+
+namespace Logging
+{
+    constexpr LogLevel CompileLevel = static_cast<LogLevel>(LOG_COMPILE_LEVEL);
+
+    constexpr bool isCompiledIn(LogLevel level) { return level >= CompileLevel; }
+
+    // starts the background writer - until then (and after stopBackend) messages are written synchronously
+    void startBackend(const LogConfig& config);
+
+    // drains every thread ring, flushes the sink and joins the writer
+    void stopBackend();
+
+    // records dropped because a thread ring was full
+    uint64_t droppedRecords();
+
+    // copies msg into the calling thread's ring - never blocks, never flushes
+    void write(LogLevel level, std::string_view msg);
+
+    template<LogLevel Level>
+    inline void log(std::string_view msg)
+    {
+        if constexpr (isCompiledIn(Level))
+            write(Level, msg);
+    }
+
+
+    // ostream front end so existing "<< value << endl" code keeps working
+    // every line (endl / flush) becomes one record, nothing is formatted when the level is filtered out
+    class LogStream : public std::ostream
+    {
+    public:
+        explicit LogStream(LogLevel level);
+        ~LogStream();
+
+        LogStream(const LogStream&) = delete;
+        LogStream& operator=(const LogStream&) = delete;
+
+    private:
+        class LineBuffer : public std::stringbuf
+        {
+        public:
+            LogLevel level = LogLevel::Info;
+
+        protected:
+            int sync() override;
+        };
+
+        LineBuffer lineBuffer;
+    };
+}
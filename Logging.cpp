@@ -1,14 +1,15 @@
 #include "Logging.h"
+#include "LogBackend.h"
 
 #include <iostream>
 #include <stdexcept>
 #include <cstdlib>
 #include <cstring>
+#include <iterator>
 
 using std::string;
 
 using std::endl;
-using std::cerr;
 using std::boolalpha;
 using std::noboolalpha;
 using std::runtime_error;
@@ -17,7 +18,10 @@ using std::exception;
 
 string Logging::FormatLog(string msg)
 {
-    auto datetime = std::chrono::current_zone()->to_local(std::chrono::system_clock::now());
+    // current_zone() walks the tz database, look it up once
+    static const std::chrono::time_zone* pZone = std::chrono::current_zone();
+
+    auto datetime = pZone->to_local(std::chrono::system_clock::now());
     string output = format("{0:%F} {0:%X} : {1}", datetime, msg);
     return output;
 }
@@ -25,257 +29,282 @@ string Logging::FormatLog(string msg)
 
 void Logging::logDeviceProps(const VkPhysicalDeviceProperties& deviceProperties)
 {
-    cerr << "PhysicalDevice Name: " << deviceProperties.deviceName << endl;
-    cerr << "PhysicalDevice VenderID: " << deviceProperties.vendorID << endl;
-    cerr << "PhysicalDevice DeviceID: " << deviceProperties.deviceID << endl;
-    cerr << "PhysicalDevice DeviceType: " << deviceProperties.deviceType << endl;
-    cerr << "PhysicalDevice Driver Version: " << deviceProperties.driverVersion << endl;
-    cerr << "PhysicalDevice API Version: " << deviceProperties.apiVersion << endl;
-    cerr << "PhysicalDevice Pipeline Cache UUID: " << deviceProperties.pipelineCacheUUID << endl;
+    if constexpr (!isCompiledIn(LogLevel::Debug))
+        return;
+
+    LogStream out(LogLevel::Debug);
+
+    out << "PhysicalDevice Name: " << deviceProperties.deviceName << endl;
+    out << "PhysicalDevice VenderID: " << deviceProperties.vendorID << endl;
+    out << "PhysicalDevice DeviceID: " << deviceProperties.deviceID << endl;
+    out << "PhysicalDevice DeviceType: " << deviceProperties.deviceType << endl;
+    out << "PhysicalDevice Driver Version: " << deviceProperties.driverVersion << endl;
+    out << "PhysicalDevice API Version: " << deviceProperties.apiVersion << endl;
+    out << "PhysicalDevice Pipeline Cache UUID: " << deviceProperties.pipelineCacheUUID << endl;
 }
 
 
 void Logging::logDeviceLimits(const VkPhysicalDeviceLimits& limits)
 {
-    cerr << "PhysicalDevice Limits" << endl;
-    cerr << "\tmaxImageDimension1D: " << limits.maxImageDimension1D << endl;
-    cerr << "\tmaxImageDimension2D: " << limits.maxImageDimension2D << endl;
-    cerr << "\tmaxImageDimension3D: " << limits.maxImageDimension3D << endl;
-    cerr << "\tmaxImageDimensionCube: " << limits.maxImageDimensionCube << endl;
-    cerr << "\tmaxImageArrayLayers: " << limits.maxImageArrayLayers << endl;
-    cerr << "\tmaxTexelBufferElements: " << limits.maxTexelBufferElements << endl;
-    cerr << "\tmaxUniformBufferRange: " << limits.maxUniformBufferRange << endl;
-    cerr << "\tmaxStorageBufferRange: " << limits.maxStorageBufferRange << endl;
-    cerr << "\tmaxPushConstantsSize: " << limits.maxPushConstantsSize << endl;
-    cerr << "\tmaxMemoryAllocationCount: " << limits.maxMemoryAllocationCount << endl;
-    cerr << "\tmaxSamplerAllocationCount: " << limits.maxSamplerAllocationCount << endl;
-    cerr << "\tbufferImageGranularity: " << limits.bufferImageGranularity << endl;
-    cerr << "\tsparseAddressSpaceSize: " << limits.sparseAddressSpaceSize << endl;
-    cerr << "\tmaxBoundDescriptorSets: " << limits.maxBoundDescriptorSets << endl;
-    cerr << "\tmaxPerStageDescriptorSamplers: " << limits.maxPerStageDescriptorSamplers << endl;
-    cerr << "\tmaxPerStageDescriptorUniformBuffers: " << limits.maxPerStageDescriptorUniformBuffers << endl;
-    cerr << "\tmaxPerStageDescriptorStorageBuffers: " << limits.maxPerStageDescriptorStorageBuffers << endl;
-    cerr << "\tmaxPerStageDescriptorSampledImages: " << limits.maxPerStageDescriptorSampledImages << endl;
-    cerr << "\tmaxPerStageDescriptorStorageImages: " << limits.maxPerStageDescriptorStorageImages << endl;
-    cerr << "\tmaxPerStageDescriptorInputAttachments: " << limits.maxPerStageDescriptorInputAttachments << endl;
-    cerr << "\tmaxPerStageResources: " << limits.maxPerStageResources << endl;
-    cerr << "\tmaxDescriptorSetSamplers: " << limits.maxDescriptorSetSamplers << endl;
-    cerr << "\tmaxDescriptorSetUniformBuffers: " << limits.maxDescriptorSetUniformBuffers << endl;
-    cerr << "\tmaxDescriptorSetUniformBuffersDynamic: " << limits.maxDescriptorSetUniformBuffersDynamic << endl;
-    cerr << "\tmaxDescriptorSetStorageBuffers: " << limits.maxDescriptorSetStorageBuffers << endl;
-    cerr << "\tmaxDescriptorSetStorageBuffersDynamic: " << limits.maxDescriptorSetStorageBuffersDynamic << endl;
-    cerr << "\tmaxDescriptorSetSampledImages: " << limits.maxDescriptorSetSampledImages << endl;
-    cerr << "\tmaxDescriptorSetStorageImages: " << limits.maxDescriptorSetStorageImages << endl;
-    cerr << "\tmaxDescriptorSetInputAttachments: " << limits.maxDescriptorSetInputAttachments << endl;
-    cerr << "\tmaxVertexInputAttributes: " << limits.maxVertexInputAttributes << endl;
-    cerr << "\tmaxVertexInputBindings: " << limits.maxVertexInputBindings << endl;
-    cerr << "\tmaxVertexInputAttributeOffset: " << limits.maxVertexInputAttributeOffset << endl;
-    cerr << "\tmaxVertexInputBindingStride: " << limits.maxVertexInputBindingStride << endl;
-    cerr << "\tmaxVertexOutputComponents: " << limits.maxVertexOutputComponents << endl;
-    cerr << "\tmaxTessellationGenerationLevel: " << limits.maxTessellationGenerationLevel << endl;
-    cerr << "\tmaxTessellationPatchSize: " << limits.maxTessellationPatchSize << endl;
-    cerr << "\tmaxTessellationControlPerVertexInputComponents: " << limits.maxTessellationControlPerVertexInputComponents << endl;
-    cerr << "\tmaxTessellationControlPerVertexOutputComponents: " << limits.maxTessellationControlPerVertexOutputComponents << endl;
-    cerr << "\tmaxTessellationControlPerPatchOutputComponents: " << limits.maxTessellationControlPerPatchOutputComponents << endl;
-    cerr << "\tmaxTessellationControlTotalOutputComponents: " << limits.maxTessellationControlTotalOutputComponents << endl;
-    cerr << "\tmaxTessellationEvaluationInputComponents: " << limits.maxTessellationEvaluationInputComponents << endl;
-    cerr << "\tmaxTessellationEvaluationOutputComponents: " << limits.maxTessellationEvaluationOutputComponents << endl;
-    cerr << "\tmaxGeometryShaderInvocations: " << limits.maxGeometryShaderInvocations << endl;
-    cerr << "\tmaxGeometryInputComponents: " << limits.maxGeometryInputComponents << endl;
-    cerr << "\tmaxGeometryOutputComponents: " << limits.maxGeometryOutputComponents << endl;
-    cerr << "\tmaxGeometryOutputVertices: " << limits.maxGeometryOutputVertices << endl;
-    cerr << "\tmaxGeometryTotalOutputComponents: " << limits.maxGeometryTotalOutputComponents << endl;
-    cerr << "\tmaxFragmentInputComponents: " << limits.maxFragmentInputComponents << endl;
-    cerr << "\tmaxFragmentOutputAttachments: " << limits.maxFragmentOutputAttachments << endl;
-    cerr << "\tmaxFragmentDualSrcAttachments: " << limits.maxFragmentDualSrcAttachments << endl;
-    cerr << "\tmaxFragmentCombinedOutputResources: " << limits.maxFragmentCombinedOutputResources << endl;
-    cerr << "\tmaxComputeSharedMemorySize: " << limits.maxComputeSharedMemorySize << endl;
-
-    cerr << "\tmaxComputeWorkGroupCount[" << _countof(limits.maxComputeWorkGroupCount) << "]" << endl;
+    if constexpr (!isCompiledIn(LogLevel::Debug))
+        return;
+
+    LogStream out(LogLevel::Debug);
+
+    out << "PhysicalDevice Limits" << endl;
+    out << "\tmaxImageDimension1D: " << limits.maxImageDimension1D << endl;
+    out << "\tmaxImageDimension2D: " << limits.maxImageDimension2D << endl;
+    out << "\tmaxImageDimension3D: " << limits.maxImageDimension3D << endl;
+    out << "\tmaxImageDimensionCube: " << limits.maxImageDimensionCube << endl;
+    out << "\tmaxImageArrayLayers: " << limits.maxImageArrayLayers << endl;
+    out << "\tmaxTexelBufferElements: " << limits.maxTexelBufferElements << endl;
+    out << "\tmaxUniformBufferRange: " << limits.maxUniformBufferRange << endl;
+    out << "\tmaxStorageBufferRange: " << limits.maxStorageBufferRange << endl;
+    out << "\tmaxPushConstantsSize: " << limits.maxPushConstantsSize << endl;
+    out << "\tmaxMemoryAllocationCount: " << limits.maxMemoryAllocationCount << endl;
+    out << "\tmaxSamplerAllocationCount: " << limits.maxSamplerAllocationCount << endl;
+    out << "\tbufferImageGranularity: " << limits.bufferImageGranularity << endl;
+    out << "\tsparseAddressSpaceSize: " << limits.sparseAddressSpaceSize << endl;
+    out << "\tmaxBoundDescriptorSets: " << limits.maxBoundDescriptorSets << endl;
+    out << "\tmaxPerStageDescriptorSamplers: " << limits.maxPerStageDescriptorSamplers << endl;
+    out << "\tmaxPerStageDescriptorUniformBuffers: " << limits.maxPerStageDescriptorUniformBuffers << endl;
+    out << "\tmaxPerStageDescriptorStorageBuffers: " << limits.maxPerStageDescriptorStorageBuffers << endl;
+    out << "\tmaxPerStageDescriptorSampledImages: " << limits.maxPerStageDescriptorSampledImages << endl;
+    out << "\tmaxPerStageDescriptorStorageImages: " << limits.maxPerStageDescriptorStorageImages << endl;
+    out << "\tmaxPerStageDescriptorInputAttachments: " << limits.maxPerStageDescriptorInputAttachments << endl;
+    out << "\tmaxPerStageResources: " << limits.maxPerStageResources << endl;
+    out << "\tmaxDescriptorSetSamplers: " << limits.maxDescriptorSetSamplers << endl;
+    out << "\tmaxDescriptorSetUniformBuffers: " << limits.maxDescriptorSetUniformBuffers << endl;
+    out << "\tmaxDescriptorSetUniformBuffersDynamic: " << limits.maxDescriptorSetUniformBuffersDynamic << endl;
+    out << "\tmaxDescriptorSetStorageBuffers: " << limits.maxDescriptorSetStorageBuffers << endl;
+    out << "\tmaxDescriptorSetStorageBuffersDynamic: " << limits.maxDescriptorSetStorageBuffersDynamic << endl;
+    out << "\tmaxDescriptorSetSampledImages: " << limits.maxDescriptorSetSampledImages << endl;
+    out << "\tmaxDescriptorSetStorageImages: " << limits.maxDescriptorSetStorageImages << endl;
+    out << "\tmaxDescriptorSetInputAttachments: " << limits.maxDescriptorSetInputAttachments << endl;
+    out << "\tmaxVertexInputAttributes: " << limits.maxVertexInputAttributes << endl;
+    out << "\tmaxVertexInputBindings: " << limits.maxVertexInputBindings << endl;
+    out << "\tmaxVertexInputAttributeOffset: " << limits.maxVertexInputAttributeOffset << endl;
+    out << "\tmaxVertexInputBindingStride: " << limits.maxVertexInputBindingStride << endl;
+    out << "\tmaxVertexOutputComponents: " << limits.maxVertexOutputComponents << endl;
+    out << "\tmaxTessellationGenerationLevel: " << limits.maxTessellationGenerationLevel << endl;
+    out << "\tmaxTessellationPatchSize: " << limits.maxTessellationPatchSize << endl;
+    out << "\tmaxTessellationControlPerVertexInputComponents: " << limits.maxTessellationControlPerVertexInputComponents << endl;
+    out << "\tmaxTessellationControlPerVertexOutputComponents: " << limits.maxTessellationControlPerVertexOutputComponents << endl;
+    out << "\tmaxTessellationControlPerPatchOutputComponents: " << limits.maxTessellationControlPerPatchOutputComponents << endl;
+    out << "\tmaxTessellationControlTotalOutputComponents: " << limits.maxTessellationControlTotalOutputComponents << endl;
+    out << "\tmaxTessellationEvaluationInputComponents: " << limits.maxTessellationEvaluationInputComponents << endl;
+    out << "\tmaxTessellationEvaluationOutputComponents: " << limits.maxTessellationEvaluationOutputComponents << endl;
+    out << "\tmaxGeometryShaderInvocations: " << limits.maxGeometryShaderInvocations << endl;
+    out << "\tmaxGeometryInputComponents: " << limits.maxGeometryInputComponents << endl;
+    out << "\tmaxGeometryOutputComponents: " << limits.maxGeometryOutputComponents << endl;
+    out << "\tmaxGeometryOutputVertices: " << limits.maxGeometryOutputVertices << endl;
+    out << "\tmaxGeometryTotalOutputComponents: " << limits.maxGeometryTotalOutputComponents << endl;
+    out << "\tmaxFragmentInputComponents: " << limits.maxFragmentInputComponents << endl;
+    out << "\tmaxFragmentOutputAttachments: " << limits.maxFragmentOutputAttachments << endl;
+    out << "\tmaxFragmentDualSrcAttachments: " << limits.maxFragmentDualSrcAttachments << endl;
+    out << "\tmaxFragmentCombinedOutputResources: " << limits.maxFragmentCombinedOutputResources << endl;
+    out << "\tmaxComputeSharedMemorySize: " << limits.maxComputeSharedMemorySize << endl;
+
+    out << "\tmaxComputeWorkGroupCount[" << std::size(limits.maxComputeWorkGroupCount) << "]" << endl;
     {
         uint32_t i = 0;
         for (uint32_t maxCompute : limits.maxComputeWorkGroupCount)
-            cerr << "\t\tmaxComputeWorkGroupCount[" << i++ << "] = " << maxCompute << endl;
+            out << "\t\tmaxComputeWorkGroupCount[" << i++ << "] = " << maxCompute << endl;
     }
-    cerr << "\tmaxComputeWorkGroupInvocations: " << limits.maxComputeWorkGroupInvocations << endl;
+    out << "\tmaxComputeWorkGroupInvocations: " << limits.maxComputeWorkGroupInvocations << endl;
 
-    cerr << "\tmaxComputeWorkGroupSize[" << _countof(limits.maxComputeWorkGroupSize) << "]" << endl;
+    out << "\tmaxComputeWorkGroupSize[" << std::size(limits.maxComputeWorkGroupSize) << "]" << endl;
     {
         uint32_t i = 0;
         for (uint32_t maxSize : limits.maxComputeWorkGroupSize)
-            cerr << "\t\tmaxComputeWorkGroupSize[" << i++ << "] = " << maxSize << endl;
+            out << "\t\tmaxComputeWorkGroupSize[" << i++ << "] = " << maxSize << endl;
     }
 
-    cerr << "\tsubPixelPrecisionBits: " << limits.subPixelPrecisionBits << endl;
-    cerr << "\tsubTexelPrecisionBits: " << limits.subTexelPrecisionBits << endl;
-    cerr << "\tmipmapPrecisionBits: " << limits.mipmapPrecisionBits << endl;
-    cerr << "\tmaxDrawIndirectCount: " << limits.maxDrawIndirectCount << endl;
-    cerr << "\tmaxSamplerLodBias: " << limits.maxSamplerLodBias << endl;
-    cerr << "\tmaxSamplerAnisotropy: " << limits.maxSamplerAnisotropy << endl;
+    out << "\tsubPixelPrecisionBits: " << limits.subPixelPrecisionBits << endl;
+    out << "\tsubTexelPrecisionBits: " << limits.subTexelPrecisionBits << endl;
+    out << "\tmipmapPrecisionBits: " << limits.mipmapPrecisionBits << endl;
+    out << "\tmaxDrawIndirectCount: " << limits.maxDrawIndirectCount << endl;
+    out << "\tmaxSamplerLodBias: " << limits.maxSamplerLodBias << endl;
+    out << "\tmaxSamplerAnisotropy: " << limits.maxSamplerAnisotropy << endl;
 
-    cerr << "\tmaxViewports: " << limits.maxViewports << endl;
-    cerr << "\tmaxViewportDimensions[" << _countof(limits.maxViewportDimensions) << "]" << endl;
+    out << "\tmaxViewports: " << limits.maxViewports << endl;
+    out << "\tmaxViewportDimensions[" << std::size(limits.maxViewportDimensions) << "]" << endl;
     {
         uint32_t i = 0;
         for (uint32_t maxDim : limits.maxViewportDimensions)
-            cerr << "\t\tmaxViewportDimensions[" << i++ << "] = " << maxDim << endl;
+            out << "\t\tmaxViewportDimensions[" << i++ << "] = " << maxDim << endl;
     }
 
-    cerr << "\tviewportBoundsRange[" << _countof(limits.viewportBoundsRange) << "]" << endl;
+    out << "\tviewportBoundsRange[" << std::size(limits.viewportBoundsRange) << "]" << endl;
     {
         uint32_t i = 0;
         for (float maxBounds : limits.viewportBoundsRange)
-            cerr << "\t\tviewportBoundsRange[" << i++ << "] = " << maxBounds << endl;
+            out << "\t\tviewportBoundsRange[" << i++ << "] = " << maxBounds << endl;
     }
 
-    cerr << "\tviewportSubPixelBits: " << limits.viewportSubPixelBits << endl;
-    cerr << "\tminMemoryMapAlignment: " << limits.minMemoryMapAlignment << endl;
+    out << "\tviewportSubPixelBits: " << limits.viewportSubPixelBits << endl;
+    out << "\tminMemoryMapAlignment: " << limits.minMemoryMapAlignment << endl;
 
     // VkDeviceSize (uint64_t)
-    cerr << "\tminTexelBufferOffsetAlignment: " << limits.minTexelBufferOffsetAlignment << endl;
-    cerr << "\tminUniformBufferOffsetAlignment: " << limits.minUniformBufferOffsetAlignment << endl;
-    cerr << "\tminStorageBufferOffsetAlignment: " << limits.minStorageBufferOffsetAlignment << endl;
-
-    cerr << "\tminTexelOffset: " << limits.minTexelOffset << endl;
-    cerr << "\tmaxTexelOffset: " << limits.maxTexelOffset << endl;
-    cerr << "\tminTexelGatherOffset: " << limits.minTexelGatherOffset << endl;
-    cerr << "\tmaxTexelGatherOffset: " << limits.maxTexelGatherOffset << endl;
-    cerr << "\tminInterpolationOffset: " << limits.minInterpolationOffset << endl;
-    cerr << "\tmaxInterpolationOffset: " << limits.maxInterpolationOffset << endl;
-    cerr << "\tsubPixelInterpolationOffsetBits: " << limits.subPixelInterpolationOffsetBits << endl;
-    cerr << "\tmaxFramebufferWidth: " << limits.maxFramebufferWidth << endl;
-    cerr << "\tmaxFramebufferHeight: " << limits.maxFramebufferHeight << endl;
-    cerr << "\tmaxFramebufferLayers: " << limits.maxFramebufferLayers << endl;
+    out << "\tminTexelBufferOffsetAlignment: " << limits.minTexelBufferOffsetAlignment << endl;
+    out << "\tminUniformBufferOffsetAlignment: " << limits.minUniformBufferOffsetAlignment << endl;
+    out << "\tminStorageBufferOffsetAlignment: " << limits.minStorageBufferOffsetAlignment << endl;
+
+    out << "\tminTexelOffset: " << limits.minTexelOffset << endl;
+    out << "\tmaxTexelOffset: " << limits.maxTexelOffset << endl;
+    out << "\tminTexelGatherOffset: " << limits.minTexelGatherOffset << endl;
+    out << "\tmaxTexelGatherOffset: " << limits.maxTexelGatherOffset << endl;
+    out << "\tminInterpolationOffset: " << limits.minInterpolationOffset << endl;
+    out << "\tmaxInterpolationOffset: " << limits.maxInterpolationOffset << endl;
+    out << "\tsubPixelInterpolationOffsetBits: " << limits.subPixelInterpolationOffsetBits << endl;
+    out << "\tmaxFramebufferWidth: " << limits.maxFramebufferWidth << endl;
+    out << "\tmaxFramebufferHeight: " << limits.maxFramebufferHeight << endl;
+    out << "\tmaxFramebufferLayers: " << limits.maxFramebufferLayers << endl;
 
     // VkSampleCountFlags
-    cerr << "\tframebufferColorSampleCounts: " << limits.framebufferColorSampleCounts << endl;
-    cerr << "\tframebufferDepthSampleCounts: " << limits.framebufferDepthSampleCounts << endl;
-    cerr << "\tframebufferStencilSampleCounts: " << limits.framebufferStencilSampleCounts << endl;
-    cerr << "\tframebufferNoAttachmentsSampleCounts: " << limits.framebufferNoAttachmentsSampleCounts << endl;
+    out << "\tframebufferColorSampleCounts: " << limits.framebufferColorSampleCounts << endl;
+    out << "\tframebufferDepthSampleCounts: " << limits.framebufferDepthSampleCounts << endl;
+    out << "\tframebufferStencilSampleCounts: " << limits.framebufferStencilSampleCounts << endl;
+    out << "\tframebufferNoAttachmentsSampleCounts: " << limits.framebufferNoAttachmentsSampleCounts << endl;
 
-    cerr << "\tmaxColorAttachments: " << limits.maxColorAttachments << endl;
+    out << "\tmaxColorAttachments: " << limits.maxColorAttachments << endl;
 
     // VkSampleCountFlags
-    cerr << "\tsampledImageColorSampleCounts: " << limits.sampledImageColorSampleCounts << endl;
-    cerr << "\tsampledImageIntegerSampleCounts: " << limits.sampledImageIntegerSampleCounts << endl;
-    cerr << "\tsampledImageDepthSampleCounts: " << limits.sampledImageDepthSampleCounts << endl;
-    cerr << "\tsampledImageStencilSampleCounts: " << limits.sampledImageStencilSampleCounts << endl;
-    cerr << "\tstorageImageSampleCounts: " << limits.storageImageSampleCounts << endl;
-    cerr << "\tmaxSampleMaskWords: " << limits.maxSampleMaskWords << endl;
-    cerr << "\ttimestampComputeAndGraphics: " << limits.timestampComputeAndGraphics << endl;
-    cerr << "\ttimestampPeriod: " << limits.timestampPeriod << endl;
-    cerr << "\tmaxClipDistances: " << limits.maxClipDistances << endl;
-    cerr << "\tmaxCullDistances: " << limits.maxCullDistances << endl;
-    cerr << "\tdiscreteQueuePriorities: " << limits.discreteQueuePriorities << endl;
-
-    cerr << "\tpointSizeRange[" << _countof(limits.pointSizeRange) << "]" << endl;
+    out << "\tsampledImageColorSampleCounts: " << limits.sampledImageColorSampleCounts << endl;
+    out << "\tsampledImageIntegerSampleCounts: " << limits.sampledImageIntegerSampleCounts << endl;
+    out << "\tsampledImageDepthSampleCounts: " << limits.sampledImageDepthSampleCounts << endl;
+    out << "\tsampledImageStencilSampleCounts: " << limits.sampledImageStencilSampleCounts << endl;
+    out << "\tstorageImageSampleCounts: " << limits.storageImageSampleCounts << endl;
+    out << "\tmaxSampleMaskWords: " << limits.maxSampleMaskWords << endl;
+    out << "\ttimestampComputeAndGraphics: " << limits.timestampComputeAndGraphics << endl;
+    out << "\ttimestampPeriod: " << limits.timestampPeriod << endl;
+    out << "\tmaxClipDistances: " << limits.maxClipDistances << endl;
+    out << "\tmaxCullDistances: " << limits.maxCullDistances << endl;
+    out << "\tdiscreteQueuePriorities: " << limits.discreteQueuePriorities << endl;
+
+    out << "\tpointSizeRange[" << std::size(limits.pointSizeRange) << "]" << endl;
     {
         uint32_t i = 0;
         for (float pointSize : limits.pointSizeRange)
-            cerr << "\t\tpointSizeRange[" << i++ << "] = " << pointSize << endl;
+            out << "\t\tpointSizeRange[" << i++ << "] = " << pointSize << endl;
     }
 
-    cerr << "\tlineWidthRange[" << _countof(limits.lineWidthRange) << "]" << endl;
+    out << "\tlineWidthRange[" << std::size(limits.lineWidthRange) << "]" << endl;
     {
         uint32_t i = 0;
         for (float lineWidth : limits.lineWidthRange)
-            cerr << "\t\tlineWidthRange[" << i++ << "] = " << lineWidth << endl;
+            out << "\t\tlineWidthRange[" << i++ << "] = " << lineWidth << endl;
     }
 
-    cerr << "\tpointSizeGranularity: " << limits.pointSizeGranularity << endl;
-    cerr << "\tlineWidthGranularity: " << limits.lineWidthGranularity << endl;
-    cerr << "\tstrictLines: " << limits.strictLines << endl;
-    cerr << "\tstandardSampleLocations: " << limits.standardSampleLocations << endl;
+    out << "\tpointSizeGranularity: " << limits.pointSizeGranularity << endl;
+    out << "\tlineWidthGranularity: " << limits.lineWidthGranularity << endl;
+    out << "\tstrictLines: " << limits.strictLines << endl;
+    out << "\tstandardSampleLocations: " << limits.standardSampleLocations << endl;
 
     // VkDeviceSize (uint64_t)
-    cerr << "\toptimalBufferCopyOffsetAlignment: " << limits.optimalBufferCopyOffsetAlignment << endl;
-    cerr << "\toptimalBufferCopyRowPitchAlignment: " << limits.optimalBufferCopyRowPitchAlignment << endl;
-    cerr << "\tnonCoherentAtomSize: " << limits.nonCoherentAtomSize << endl;
+    out << "\toptimalBufferCopyOffsetAlignment: " << limits.optimalBufferCopyOffsetAlignment << endl;
+    out << "\toptimalBufferCopyRowPitchAlignment: " << limits.optimalBufferCopyRowPitchAlignment << endl;
+    out << "\tnonCoherentAtomSize: " << limits.nonCoherentAtomSize << endl;
 }
 
 
 void Logging::logDeviceSparseProps(const VkPhysicalDeviceSparseProperties& sparseProps)
 {
-    cerr << "PhysicalDevice SparseProperties" << endl;
-    cerr << "\tResidency Standard 2D Block Shape: " << sparseProps.residencyStandard2DBlockShape << endl;
-    cerr << "\tResidency Standard 2D Multisample Block Shape: " << sparseProps.residencyStandard2DMultisampleBlockShape << endl;
-    cerr << "\tResidency Standard 3D Block Shape: " << sparseProps.residencyStandard3DBlockShape << endl;
-    cerr << "\tResidency Aligned Mip Size: " << sparseProps.residencyAlignedMipSize << endl;
-    cerr << "\tResidency NonResident Strict: " << sparseProps.residencyNonResidentStrict << endl;
+    if constexpr (!isCompiledIn(LogLevel::Debug))
+        return;
+
+    LogStream out(LogLevel::Debug);
+
+    out << "PhysicalDevice SparseProperties" << endl;
+    out << "\tResidency Standard 2D Block Shape: " << sparseProps.residencyStandard2DBlockShape << endl;
+    out << "\tResidency Standard 2D Multisample Block Shape: " << sparseProps.residencyStandard2DMultisampleBlockShape << endl;
+    out << "\tResidency Standard 3D Block Shape: " << sparseProps.residencyStandard3DBlockShape << endl;
+    out << "\tResidency Aligned Mip Size: " << sparseProps.residencyAlignedMipSize << endl;
+    out << "\tResidency NonResident Strict: " << sparseProps.residencyNonResidentStrict << endl;
 }
 
 
 void Logging::logDeviceFeatures(const VkPhysicalDeviceFeatures& deviceFeatures)
 {
-    cerr << "PhysicalDevice Features" << endl;
-    cerr << "\trobustBufferAccess: " << deviceFeatures.robustBufferAccess << endl;
-    cerr << "\tfullDrawIndexUint32: " << deviceFeatures.fullDrawIndexUint32 << endl;
-    cerr << "\timageCubeArray: " << deviceFeatures.imageCubeArray << endl;
-    cerr << "\tindependentBlend: " << deviceFeatures.independentBlend << endl;
-    cerr << "\tgeometryShader: " << deviceFeatures.geometryShader << endl;
-    cerr << "\ttessellationShader: " << deviceFeatures.tessellationShader << endl;
-    cerr << "\tsampleRateShading: " << deviceFeatures.sampleRateShading << endl;
-    cerr << "\tdualSrcBlend: " << deviceFeatures.dualSrcBlend << endl;
-    cerr << "\tlogicOp: " << deviceFeatures.logicOp << endl;
-    cerr << "\tmultiDrawIndirect: " << deviceFeatures.multiDrawIndirect << endl;
-    cerr << "\tdrawIndirectFirstInstance: " << deviceFeatures.drawIndirectFirstInstance << endl;
-    cerr << "\tdepthClamp: " << deviceFeatures.depthClamp << endl;
-    cerr << "\tdepthBiasClamp: " << deviceFeatures.depthBiasClamp << endl;
-    cerr << "\tfillModeNonSolid: " << deviceFeatures.fillModeNonSolid << endl;
-    cerr << "\tdepthBounds: " << deviceFeatures.depthBounds << endl;
-    cerr << "\twideLines: " << deviceFeatures.wideLines << endl;
-    cerr << "\tlargePoints: " << deviceFeatures.largePoints << endl;
-    cerr << "\talphaToOne: " << deviceFeatures.alphaToOne << endl;
-    cerr << "\tmultiViewport: " << deviceFeatures.multiViewport << endl;
-    cerr << "\tsamplerAnisotropy: " << deviceFeatures.samplerAnisotropy << endl;
-    cerr << "\ttextureCompressionETC2: " << deviceFeatures.textureCompressionETC2 << endl;
-    cerr << "\ttextureCompressionASTC_LDR: " << deviceFeatures.textureCompressionASTC_LDR << endl;
-    cerr << "\ttextureCompressionBC: " << deviceFeatures.textureCompressionBC << endl;
-    cerr << "\tocclusionQueryPrecise: " << deviceFeatures.occlusionQueryPrecise << endl;
-    cerr << "\tpipelineStatisticsQuery: " << deviceFeatures.pipelineStatisticsQuery << endl;
-    cerr << "\tvertexPipelineStoresAndAtomics: " << deviceFeatures.vertexPipelineStoresAndAtomics << endl;
-    cerr << "\tfragmentStoresAndAtomics: " << deviceFeatures.fragmentStoresAndAtomics << endl;
-    cerr << "\tshaderTessellationAndGeometryPointSize: " << deviceFeatures.shaderTessellationAndGeometryPointSize << endl;
-    cerr << "\tshaderImageGatherExtended: " << deviceFeatures.shaderImageGatherExtended << endl;
-    cerr << "\tshaderStorageImageExtendedFormats: " << deviceFeatures.shaderStorageImageExtendedFormats << endl;
-    cerr << "\tshaderStorageImageMultisample: " << deviceFeatures.shaderStorageImageMultisample << endl;
-    cerr << "\tshaderStorageImageReadWithoutFormat: " << deviceFeatures.shaderStorageImageReadWithoutFormat << endl;
-    cerr << "\tshaderStorageImageWriteWithoutFormat: " << deviceFeatures.shaderStorageImageWriteWithoutFormat << endl;
-    cerr << "\tshaderUniformBufferArrayDynamicIndexing: " << deviceFeatures.shaderUniformBufferArrayDynamicIndexing << endl;
-    cerr << "\tshaderSampledImageArrayDynamicIndexing: " << deviceFeatures.shaderSampledImageArrayDynamicIndexing << endl;
-    cerr << "\tshaderStorageBufferArrayDynamicIndexing: " << deviceFeatures.shaderStorageBufferArrayDynamicIndexing << endl;
-    cerr << "\tshaderStorageImageArrayDynamicIndexing: " << deviceFeatures.shaderStorageImageArrayDynamicIndexing << endl;
-    cerr << "\tshaderClipDistance: " << deviceFeatures.shaderClipDistance << endl;
-    cerr << "\tshaderCullDistance: " << deviceFeatures.shaderCullDistance << endl;
-    cerr << "\tshaderFloat64: " << deviceFeatures.shaderFloat64 << endl;
-    cerr << "\tshaderInt64: " << deviceFeatures.shaderInt64 << endl;
-    cerr << "\tshaderInt16: " << deviceFeatures.shaderInt16 << endl;
-    cerr << "\tshaderResourceResidency: " << deviceFeatures.shaderResourceResidency << endl;
-    cerr << "\tshaderResourceMinLod: " << deviceFeatures.shaderResourceMinLod << endl;
-    cerr << "\tsparseBinding: " << deviceFeatures.sparseBinding << endl;
-    cerr << "\tsparseResidencyBuffer: " << deviceFeatures.sparseResidencyBuffer << endl;
-    cerr << "\tsparseResidencyImage2D: " << deviceFeatures.sparseResidencyImage2D << endl;
-    cerr << "\tsparseResidencyImage3D: " << deviceFeatures.sparseResidencyImage3D << endl;
-    cerr << "\tsparseResidency2Samples: " << deviceFeatures.sparseResidency2Samples << endl;
-    cerr << "\tsparseResidency4Samples: " << deviceFeatures.sparseResidency4Samples << endl;
-    cerr << "\tsparseResidency8Samples: " << deviceFeatures.sparseResidency8Samples << endl;
-    cerr << "\tsparseResidency16Samples: " << deviceFeatures.sparseResidency16Samples << endl;
-    cerr << "\tsparseResidencyAliased: " << deviceFeatures.sparseResidencyAliased << endl;
-    cerr << "\tvariableMultisampleRate: " << deviceFeatures.variableMultisampleRate << endl;
-    cerr << "\tinheritedQueries: " << deviceFeatures.inheritedQueries << endl;
+    if constexpr (!isCompiledIn(LogLevel::Debug))
+        return;
+
+    LogStream out(LogLevel::Debug);
+
+    out << "PhysicalDevice Features" << endl;
+    out << "\trobustBufferAccess: " << deviceFeatures.robustBufferAccess << endl;
+    out << "\tfullDrawIndexUint32: " << deviceFeatures.fullDrawIndexUint32 << endl;
+    out << "\timageCubeArray: " << deviceFeatures.imageCubeArray << endl;
+    out << "\tindependentBlend: " << deviceFeatures.independentBlend << endl;
+    out << "\tgeometryShader: " << deviceFeatures.geometryShader << endl;
+    out << "\ttessellationShader: " << deviceFeatures.tessellationShader << endl;
+    out << "\tsampleRateShading: " << deviceFeatures.sampleRateShading << endl;
+    out << "\tdualSrcBlend: " << deviceFeatures.dualSrcBlend << endl;
+    out << "\tlogicOp: " << deviceFeatures.logicOp << endl;
+    out << "\tmultiDrawIndirect: " << deviceFeatures.multiDrawIndirect << endl;
+    out << "\tdrawIndirectFirstInstance: " << deviceFeatures.drawIndirectFirstInstance << endl;
+    out << "\tdepthClamp: " << deviceFeatures.depthClamp << endl;
+    out << "\tdepthBiasClamp: " << deviceFeatures.depthBiasClamp << endl;
+    out << "\tfillModeNonSolid: " << deviceFeatures.fillModeNonSolid << endl;
+    out << "\tdepthBounds: " << deviceFeatures.depthBounds << endl;
+    out << "\twideLines: " << deviceFeatures.wideLines << endl;
+    out << "\tlargePoints: " << deviceFeatures.largePoints << endl;
+    out << "\talphaToOne: " << deviceFeatures.alphaToOne << endl;
+    out << "\tmultiViewport: " << deviceFeatures.multiViewport << endl;
+    out << "\tsamplerAnisotropy: " << deviceFeatures.samplerAnisotropy << endl;
+    out << "\ttextureCompressionETC2: " << deviceFeatures.textureCompressionETC2 << endl;
+    out << "\ttextureCompressionASTC_LDR: " << deviceFeatures.textureCompressionASTC_LDR << endl;
+    out << "\ttextureCompressionBC: " << deviceFeatures.textureCompressionBC << endl;
+    out << "\tocclusionQueryPrecise: " << deviceFeatures.occlusionQueryPrecise << endl;
+    out << "\tpipelineStatisticsQuery: " << deviceFeatures.pipelineStatisticsQuery << endl;
+    out << "\tvertexPipelineStoresAndAtomics: " << deviceFeatures.vertexPipelineStoresAndAtomics << endl;
+    out << "\tfragmentStoresAndAtomics: " << deviceFeatures.fragmentStoresAndAtomics << endl;
+    out << "\tshaderTessellationAndGeometryPointSize: " << deviceFeatures.shaderTessellationAndGeometryPointSize << endl;
+    out << "\tshaderImageGatherExtended: " << deviceFeatures.shaderImageGatherExtended << endl;
+    out << "\tshaderStorageImageExtendedFormats: " << deviceFeatures.shaderStorageImageExtendedFormats << endl;
+    out << "\tshaderStorageImageMultisample: " << deviceFeatures.shaderStorageImageMultisample << endl;
+    out << "\tshaderStorageImageReadWithoutFormat: " << deviceFeatures.shaderStorageImageReadWithoutFormat << endl;
+    out << "\tshaderStorageImageWriteWithoutFormat: " << deviceFeatures.shaderStorageImageWriteWithoutFormat << endl;
+    out << "\tshaderUniformBufferArrayDynamicIndexing: " << deviceFeatures.shaderUniformBufferArrayDynamicIndexing << endl;
+    out << "\tshaderSampledImageArrayDynamicIndexing: " << deviceFeatures.shaderSampledImageArrayDynamicIndexing << endl;
+    out << "\tshaderStorageBufferArrayDynamicIndexing: " << deviceFeatures.shaderStorageBufferArrayDynamicIndexing << endl;
+    out << "\tshaderStorageImageArrayDynamicIndexing: " << deviceFeatures.shaderStorageImageArrayDynamicIndexing << endl;
+    out << "\tshaderClipDistance: " << deviceFeatures.shaderClipDistance << endl;
+    out << "\tshaderCullDistance: " << deviceFeatures.shaderCullDistance << endl;
+    out << "\tshaderFloat64: " << deviceFeatures.shaderFloat64 << endl;
+    out << "\tshaderInt64: " << deviceFeatures.shaderInt64 << endl;
+    out << "\tshaderInt16: " << deviceFeatures.shaderInt16 << endl;
+    out << "\tshaderResourceResidency: " << deviceFeatures.shaderResourceResidency << endl;
+    out << "\tshaderResourceMinLod: " << deviceFeatures.shaderResourceMinLod << endl;
+    out << "\tsparseBinding: " << deviceFeatures.sparseBinding << endl;
+    out << "\tsparseResidencyBuffer: " << deviceFeatures.sparseResidencyBuffer << endl;
+    out << "\tsparseResidencyImage2D: " << deviceFeatures.sparseResidencyImage2D << endl;
+    out << "\tsparseResidencyImage3D: " << deviceFeatures.sparseResidencyImage3D << endl;
+    out << "\tsparseResidency2Samples: " << deviceFeatures.sparseResidency2Samples << endl;
+    out << "\tsparseResidency4Samples: " << deviceFeatures.sparseResidency4Samples << endl;
+    out << "\tsparseResidency8Samples: " << deviceFeatures.sparseResidency8Samples << endl;
+    out << "\tsparseResidency16Samples: " << deviceFeatures.sparseResidency16Samples << endl;
+    out << "\tsparseResidencyAliased: " << deviceFeatures.sparseResidencyAliased << endl;
+    out << "\tvariableMultisampleRate: " << deviceFeatures.variableMultisampleRate << endl;
+    out << "\tinheritedQueries: " << deviceFeatures.inheritedQueries << endl;
 }
 
 
 void Logging::logDeviceQueueFamily(const string& name, const VkQueueFamilyProperties& queueFamily)
 {
-    cerr << "PhysicalDevice Queue Family" << name << endl;
-    cerr << "\tqueueFlags: " << queueFamily.queueFlags << endl;
-    cerr << "\tqueueCount: " << queueFamily.queueCount << endl;
-    cerr << "\ttimestampValidBits: " << queueFamily.timestampValidBits << endl;
-    cerr << "\tminImageTransferGranularity:" << endl;
-    cerr << "\t\twidth: " << queueFamily.minImageTransferGranularity.width << endl;
-    cerr << "\t\theight: " << queueFamily.minImageTransferGranularity.height << endl;
-    cerr << "\t\tdepth: " << queueFamily.minImageTransferGranularity.depth << endl;
+    if constexpr (!isCompiledIn(LogLevel::Debug))
+        return;
+
+    LogStream out(LogLevel::Debug);
+
+    out << "PhysicalDevice Queue Family" << name << endl;
+    out << "\tqueueFlags: " << queueFamily.queueFlags << endl;
+    out << "\tqueueCount: " << queueFamily.queueCount << endl;
+    out << "\ttimestampValidBits: " << queueFamily.timestampValidBits << endl;
+    out << "\tminImageTransferGranularity:" << endl;
+    out << "\t\twidth: " << queueFamily.minImageTransferGranularity.width << endl;
+    out << "\t\theight: " << queueFamily.minImageTransferGranularity.height << endl;
+    out << "\t\tdepth: " << queueFamily.minImageTransferGranularity.depth << endl;
 }
 
 
@@ -296,10 +325,15 @@ void Logging::logPresentModes(std::vector<VkPresentModeKHR> presentModes)
 
 void Logging::logDeviceExtensions(std::vector<VkExtensionProperties> availableExtensions)
 {
-    cerr << "PhysicalDevice Extensions" << endl;
+    if constexpr (!isCompiledIn(LogLevel::Debug))
+        return;
+
+    LogStream out(LogLevel::Debug);
+
+    out << "PhysicalDevice Extensions" << endl;
     for (const VkExtensionProperties& extensionProperties : availableExtensions)
     {
-        cerr << "\textension: " << extensionProperties.extensionName << " : " << extensionProperties.specVersion << endl;
+        out << "\textension: " << extensionProperties.extensionName << " : " << extensionProperties.specVersion << endl;
     }
 }
 
@@ -30,6 +30,9 @@ struct LogProfile
     bool logExtensions = true;
 
     //:
+
+    // every flag off, for queries that must not log
+    static LogProfile none() { return { false, false, false, false, false, false, false, false, false, false, false, false }; }
 };
 
 namespace Logging
@@ -0,0 +1,104 @@
+#include "Mesh.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+using std::runtime_error;
+
+
+float Mesh::getRadius() const
+{
+    float radius = 0.0f;
+    for (const Vertex& vertex : vertices)
+        radius = std::max(radius, glm::length(vertex.pos));
+
+    return radius;
+}
+
+
+uint64_t Mesh::hash() const
+{
+    uint64_t value = 14695981039346656037ull;
+
+    auto hashBytes = [&value](const void* pData, size_t size)
+    {
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+        for (size_t i = 0; i < size; ++i)
+        {
+            value ^= pBytes[i];
+            value *= 1099511628211ull;
+        }
+    };
+
+    hashBytes(vertices.data(), vertices.size() * sizeof(Vertex));
+    hashBytes(indices.data(), indices.size() * sizeof(uint32_t));
+
+    return value;
+}
+
+
+Mesh makeSphereMesh(uint32_t rings, uint32_t segments)
+{
+    if (rings < 2 || segments < 3)
+        throw runtime_error("sphere mesh needs at least 2 rings and 3 segments");
+
+    const float pi = 3.14159265358979f;
+
+    Mesh mesh;
+
+    // north pole, rings - 1 rings of segments vertices, south pole
+    mesh.vertices.push_back({ { 0.0f, -1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+
+    for (uint32_t r = 1; r < rings; ++r)
+    {
+        float theta = pi * r / rings;
+
+        for (uint32_t s = 0; s < segments; ++s)
+        {
+            float phi = 2.0f * pi * s / segments;
+            glm::vec3 position(std::sin(theta) * std::cos(phi), -std::cos(theta), std::sin(theta) * std::sin(phi));
+
+            Vertex vertex;
+            vertex.pos = position;
+            vertex.color = glm::vec4(0.5f + 0.5f * position.x, 0.5f + 0.5f * position.y, 0.5f + 0.5f * position.z, 1.0f);
+            mesh.vertices.push_back(vertex);
+        }
+    }
+
+    mesh.vertices.push_back({ { 0.0f, 1.0f, 0.0f }, { 1.0f, 1.0f, 1.0f, 1.0f } });
+
+    uint32_t southPole = static_cast<uint32_t>(mesh.vertices.size() - 1);
+    auto ringVertex = [segments](uint32_t ring, uint32_t segment) { return 1 + (ring - 1) * segments + segment % segments; };
+
+    // outward facing, turned around where the winding came out the other way
+    auto addTriangle = [&mesh](uint32_t i0, uint32_t i1, uint32_t i2)
+    {
+        const glm::vec3& p0 = mesh.vertices[i0].pos;
+        const glm::vec3& p1 = mesh.vertices[i1].pos;
+        const glm::vec3& p2 = mesh.vertices[i2].pos;
+
+        glm::vec3 normal = glm::cross(p2 - p0, p1 - p0);
+        if (glm::dot(normal, p0 + p1 + p2) < 0.0f)
+            std::swap(i1, i2);
+
+        mesh.indices.insert(mesh.indices.end(), { i0, i1, i2 });
+    };
+
+    for (uint32_t s = 0; s < segments; ++s)
+        addTriangle(0, ringVertex(1, s), ringVertex(1, s + 1));
+
+    for (uint32_t r = 1; r + 1 < rings; ++r)
+    {
+        for (uint32_t s = 0; s < segments; ++s)
+        {
+            addTriangle(ringVertex(r, s), ringVertex(r + 1, s), ringVertex(r + 1, s + 1));
+            addTriangle(ringVertex(r, s), ringVertex(r + 1, s + 1), ringVertex(r, s + 1));
+        }
+    }
+
+    for (uint32_t s = 0; s < segments; ++s)
+        addTriangle(southPole, ringVertex(rings - 1, s + 1), ringVertex(rings - 1, s));
+
+    return mesh;
+}
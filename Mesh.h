@@ -0,0 +1,27 @@
+#pragma once
+#include "Vertex.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// indexed triangle list in model space, front faces are clockwise as seen by the viewer like the rest of the app
+// (cross(p2 - p0, p1 - p0) points towards the viewer for a front face)
+struct Mesh
+{
+    std::vector<Vertex> vertices;
+    std::vector<uint32_t> indices;
+
+    uint32_t getTriangleCount() const { return static_cast<uint32_t>(indices.size() / 3); }
+
+    // largest distance of a vertex from the model origin
+    float getRadius() const;
+
+    // FNV-1a over the vertices and indices, identifies the mesh a meshlet cache was built from
+    uint64_t hash() const;
+};
+
+
+// unit sphere of rings x segments quads (triangles at the poles), colored by position
+// no seam - every ring wraps around, so the surface is closed and each position exists once
+Mesh makeSphereMesh(uint32_t rings, uint32_t segments);
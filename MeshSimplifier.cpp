@@ -0,0 +1,340 @@
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+using std::vector;
+
+
+namespace
+{
+    const uint32_t InvalidVertex = 0xFFFFFFFF;
+
+
+    // sum of area * (dot(n, p) + d)^2 over the planes of a vertex's triangles, upper triangle of the symmetric 4x4
+    // doubles - the terms of a large mesh cancel out badly in float
+    struct Quadric
+    {
+        double a00 = 0.0, a01 = 0.0, a02 = 0.0, a03 = 0.0;
+        double a11 = 0.0, a12 = 0.0, a13 = 0.0;
+        double a22 = 0.0, a23 = 0.0;
+        double a33 = 0.0;
+
+        // summed area, turns the sum into a mean
+        double weight = 0.0;
+
+        void addPlane(const glm::vec3& normal, float distance, double area)
+        {
+            double a = normal.x, b = normal.y, c = normal.z, d = distance;
+
+            a00 += area * a * a; a01 += area * a * b; a02 += area * a * c; a03 += area * a * d;
+            a11 += area * b * b; a12 += area * b * c; a13 += area * b * d;
+            a22 += area * c * c; a23 += area * c * d;
+            a33 += area * d * d;
+            weight += area;
+        }
+
+        void add(const Quadric& rhs)
+        {
+            a00 += rhs.a00; a01 += rhs.a01; a02 += rhs.a02; a03 += rhs.a03;
+            a11 += rhs.a11; a12 += rhs.a12; a13 += rhs.a13;
+            a22 += rhs.a22; a23 += rhs.a23;
+            a33 += rhs.a33;
+            weight += rhs.weight;
+        }
+
+        // mean squared distance of position to the planes
+        double evaluate(const glm::vec3& position) const
+        {
+            double x = position.x, y = position.y, z = position.z;
+
+            double value = a00 * x * x + 2.0 * a01 * x * y + 2.0 * a02 * x * z + 2.0 * a03 * x
+                + a11 * y * y + 2.0 * a12 * y * z + 2.0 * a13 * y
+                + a22 * z * z + 2.0 * a23 * z
+                + a33;
+
+            return (weight > 0.0) ? std::max(0.0, value) / weight : 0.0;
+        }
+    };
+
+
+    struct Collapse
+    {
+        double cost = 0.0;
+        uint32_t from = InvalidVertex;
+        uint32_t to = InvalidVertex;
+    };
+
+
+    uint64_t edgeKey(uint32_t a, uint32_t b)
+    {
+        return (a < b) ? (uint64_t(a) << 32) | b : (uint64_t(b) << 32) | a;
+    }
+
+
+    void appendEdges(const vector<uint32_t>& indices, vector<uint64_t>& edges)
+    {
+        edges.clear();
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            edges.push_back(edgeKey(indices[i + 0], indices[i + 1]));
+            edges.push_back(edgeKey(indices[i + 1], indices[i + 2]));
+            edges.push_back(edgeKey(indices[i + 2], indices[i + 0]));
+        }
+
+        std::sort(edges.begin(), edges.end());
+    }
+}
+
+
+uint32_t MeshLodChain::selectLod(float meshRadius, float radiusPixels, float maxErrorPixels) const
+{
+    if (lods.empty() || meshRadius <= 0.0f)
+        return 0;
+
+    float pixelsPerUnit = radiusPixels / meshRadius;
+
+    // errors grow along the chain
+    uint32_t lod = 0;
+    while (lod + 1 < lods.size() && lods[lod + 1].error * pixelsPerUnit <= maxErrorPixels)
+        ++lod;
+
+    return lod;
+}
+
+
+uint64_t MeshLodChain::hash() const
+{
+    uint64_t value = 14695981039346656037ull;
+
+    auto hashBytes = [&value](const void* pData, size_t size)
+    {
+        const unsigned char* pBytes = static_cast<const unsigned char*>(pData);
+        for (size_t i = 0; i < size; ++i)
+        {
+            value ^= pBytes[i];
+            value *= 1099511628211ull;
+        }
+    };
+
+    hashBytes(indices.data(), indices.size() * sizeof(uint32_t));
+    hashBytes(lods.data(), lods.size() * sizeof(MeshLod));
+
+    return value;
+}
+
+
+void buildLodChain(const Mesh& mesh, MeshLodChain& chain, uint32_t maxLods, uint32_t minTriangles)
+{
+    chain.indices = mesh.indices;
+    chain.lods = { MeshLod{ 0, static_cast<uint32_t>(mesh.indices.size()), 0.0f } };
+
+    uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+    if (mesh.getTriangleCount() <= minTriangles)
+        return;
+
+    auto position = [&mesh](uint32_t vertex) -> const glm::vec3& { return mesh.vertices[vertex].pos; };
+
+    // planes of the full mesh, collapses add the quadric of the removed vertex to the one it moves onto
+    vector<Quadric> quadrics(vertexCount);
+    for (size_t i = 0; i < mesh.indices.size(); i += 3)
+    {
+        const glm::vec3& p0 = position(mesh.indices[i + 0]);
+        const glm::vec3& p1 = position(mesh.indices[i + 1]);
+        const glm::vec3& p2 = position(mesh.indices[i + 2]);
+
+        glm::vec3 normal = glm::cross(p1 - p0, p2 - p0);
+        float length = glm::length(normal);
+        if (length == 0.0f)
+            continue;
+
+        normal /= length;
+        for (uint32_t k = 0; k < 3; ++k)
+            quadrics[mesh.indices[i + k]].addPlane(normal, -glm::dot(normal, p0), 0.5 * length);
+    }
+
+    // an edge shared by anything but two triangles is an open border, a seam between split vertices or non-manifold
+    vector<bool> locked(vertexCount, false);
+    vector<uint64_t> edges;
+    appendEdges(mesh.indices, edges);
+
+    for (size_t e = 0; e < edges.size();)
+    {
+        size_t end = e + 1;
+        while (end < edges.size() && edges[end] == edges[e])
+            ++end;
+
+        if (end - e != 2)
+        {
+            locked[static_cast<uint32_t>(edges[e] >> 32)] = true;
+            locked[static_cast<uint32_t>(edges[e])] = true;
+        }
+
+        e = end;
+    }
+
+    vector<uint32_t> indices = mesh.indices;
+    vector<uint32_t> adjacencyOffsets(vertexCount + 1);
+    vector<uint32_t> adjacency;
+    vector<uint32_t> remap(vertexCount);
+    vector<bool> touched(vertexCount);
+    vector<Collapse> collapses;
+
+    // costs are mean squared plane distances, so the level error derived from it is an estimate (see MeshLod::error)
+    double maxCost = 0.0;
+
+    auto addLod = [&]()
+    {
+        chain.lods.push_back({ static_cast<uint32_t>(chain.indices.size()), static_cast<uint32_t>(indices.size()), static_cast<float>(std::sqrt(maxCost)) });
+        chain.indices.insert(chain.indices.end(), indices.begin(), indices.end());
+    };
+
+    uint32_t targetTriangles = mesh.getTriangleCount() / 2;
+
+    // each pass collapses the cheapest edges with at most one collapse per vertex, until the level's target is reached
+    while (chain.lods.size() < maxLods)
+    {
+        uint32_t triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+        // triangles of every vertex (offsets + list)
+        std::fill(adjacencyOffsets.begin(), adjacencyOffsets.end(), 0);
+        for (uint32_t index : indices)
+            ++adjacencyOffsets[index + 1];
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+        adjacency.resize(indices.size());
+        vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < indices.size(); ++i)
+            adjacency[fill[indices[i]]++] = i / 3;
+
+        // the cheaper direction of every edge that may collapse at all
+        appendEdges(indices, edges);
+        edges.erase(std::unique(edges.begin(), edges.end()), edges.end());
+
+        collapses.clear();
+        for (uint64_t edge : edges)
+        {
+            uint32_t a = static_cast<uint32_t>(edge >> 32);
+            uint32_t b = static_cast<uint32_t>(edge);
+
+            Quadric quadric = quadrics[a];
+            quadric.add(quadrics[b]);
+
+            Collapse collapse;
+            collapse.cost = std::numeric_limits<double>::max();
+
+            if (!locked[a])
+                collapse = { quadric.evaluate(position(b)), a, b };
+
+            if (!locked[b])
+            {
+                double cost = quadric.evaluate(position(a));
+                if (cost < collapse.cost)
+                    collapse = { cost, b, a };
+            }
+
+            if (collapse.from != InvalidVertex)
+                collapses.push_back(collapse);
+        }
+
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse& lhs, const Collapse& rhs) { return lhs.cost < rhs.cost; });
+
+        std::fill(touched.begin(), touched.end(), false);
+        std::iota(remap.begin(), remap.end(), 0);
+
+        uint32_t removed = 0;
+        uint32_t needed = triangleCount - targetTriangles;
+
+        for (const Collapse& collapse : collapses)
+        {
+            if (removed >= needed)
+                break;
+
+            if (touched[collapse.from] || touched[collapse.to])
+                continue;
+
+            // the triangles around from with this pass's earlier collapses applied - they must not turn over,
+            // the ones that also hold to disappear
+            bool flips = false;
+            uint32_t disappearing = 0;
+
+            for (uint32_t a = adjacencyOffsets[collapse.from]; a < adjacencyOffsets[collapse.from + 1] && !flips; ++a)
+            {
+                uint32_t triangle = adjacency[a];
+                uint32_t corners[3] = { remap[indices[triangle * 3 + 0]], remap[indices[triangle * 3 + 1]], remap[indices[triangle * 3 + 2]] };
+
+                if (corners[0] == collapse.to || corners[1] == collapse.to || corners[2] == collapse.to)
+                {
+                    ++disappearing;
+                    continue;
+                }
+
+                glm::vec3 before[3] = { position(corners[0]), position(corners[1]), position(corners[2]) };
+                glm::vec3 after[3] = { before[0], before[1], before[2] };
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    if (corners[k] == collapse.from)
+                        after[k] = position(collapse.to);
+                }
+
+                glm::vec3 normalBefore = glm::cross(before[1] - before[0], before[2] - before[0]);
+                glm::vec3 normalAfter = glm::cross(after[1] - after[0], after[2] - after[0]);
+
+                // turning by more than ~75 degrees counts as a flip, degenerate triangles have no side to flip to
+                float lengths = glm::length(normalBefore) * glm::length(normalAfter);
+                flips = lengths > 0.0f && glm::dot(normalBefore, normalAfter) <= 0.25f * lengths;
+            }
+
+            if (flips)
+                continue;
+
+            remap[collapse.from] = collapse.to;
+            quadrics[collapse.to].add(quadrics[collapse.from]);
+            touched[collapse.from] = true;
+            touched[collapse.to] = true;
+
+            maxCost = std::max(maxCost, collapse.cost);
+            removed += disappearing;
+        }
+
+        if (removed == 0)
+            break;
+
+        // collapsed triangles have two equal corners now
+        size_t write = 0;
+        for (size_t i = 0; i < indices.size(); i += 3)
+        {
+            uint32_t i0 = remap[indices[i + 0]];
+            uint32_t i1 = remap[indices[i + 1]];
+            uint32_t i2 = remap[indices[i + 2]];
+
+            if (i0 == i1 || i1 == i2 || i2 == i0)
+                continue;
+
+            indices[write++] = i0;
+            indices[write++] = i1;
+            indices[write++] = i2;
+        }
+
+        indices.resize(write);
+        triangleCount = static_cast<uint32_t>(indices.size() / 3);
+
+        if (triangleCount <= targetTriangles)
+        {
+            addLod();
+
+            if (triangleCount <= minTriangles)
+                return;
+
+            targetTriangles = triangleCount / 2;
+        }
+    }
+
+    // stuck before the target - keep what the last passes reached when it is a real step down
+    if (chain.lods.size() < maxLods && indices.size() * 4 < chain.lods.back().indexCount * 3)
+        addLod();
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include "Mesh.h"
+
+#include <cstdint>
+#include <vector>
+
+
+// one level of detail - a range of MeshLodChain::indices
+struct MeshLod
+{
+    uint32_t indexOffset = 0;
+    uint32_t indexCount = 0;
+
+    // estimated distance (mesh units) of the level's surface from the full detail one - the root of the largest area
+    // weighted mean squared plane distance of any collapse so far, so an RMS estimate and not a bound on the deviation
+    float error = 0.0f;
+};
+
+
+// every level indexes the mesh's own vertices, so one vertex array serves the whole chain
+struct MeshLodChain
+{
+    // all levels back to back, level 0 is the mesh's own index list
+    std::vector<uint32_t> indices;
+    std::vector<MeshLod> lods;
+
+    // coarsest level whose estimated error stays within maxErrorPixels when the mesh's radius covers radiusPixels on screen
+    uint32_t selectLod(float meshRadius, float radiusPixels, float maxErrorPixels) const;
+
+    // FNV-1a over the levels, part of the meshlet cache key when meshlets are built per level
+    uint64_t hash() const;
+};
+
+
+// quadric error edge collapse (Garland-Heckbert), each vertex collapses onto a neighbour so no new vertices appear
+// every level aims for half the triangles of the one before, the quadrics keep accumulating over the whole chain so each
+// level's error is estimated against the full mesh; vertices on open or non-manifold edges (split attributes included) stay
+// where they are, collapses that would flip a triangle are skipped
+// the chain ends after maxLods levels, below minTriangles or when the mesh stops shrinking
+void buildLodChain(const Mesh& mesh, MeshLodChain& chain, uint32_t maxLods = 8, uint32_t minTriangles = 64);
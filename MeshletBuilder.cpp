@@ -0,0 +1,375 @@
+#include "MeshletBuilder.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using std::runtime_error;
+using std::string;
+using std::vector;
+
+
+namespace
+{
+    // file layout (little endian): char[8] "VTMLT002", uint64 mesh hash, uint32 max vertices, uint32 max triangles,
+    // uint32 meshlet count, uint32 vertex count, uint32 triangle byte count, uint32 level count,
+    // then the meshlets, vertices, triangles and level offsets
+    const char MeshletMagic[8] = { 'V', 'T', 'M', 'L', 'T', '0', '0', '2' };
+
+    const uint32_t InvalidSlot = 0xFFFFFFFF;
+
+
+    // sphere around the meshlet's vertices and the cone around its triangle normals (see MeshletDesc)
+    void computeBounds(const Mesh& mesh, const MeshletData& data, MeshletDesc& meshlet)
+    {
+        const uint32_t* pVertices = data.vertices.data() + meshlet.vertexOffset;
+        const uint8_t* pTriangles = data.triangles.data() + meshlet.triangleOffset;
+
+        glm::vec3 minimum = mesh.vertices[pVertices[0]].pos;
+        glm::vec3 maximum = minimum;
+        for (uint32_t v = 1; v < meshlet.vertexCount; ++v)
+        {
+            const glm::vec3& position = mesh.vertices[pVertices[v]].pos;
+            minimum = glm::min(minimum, position);
+            maximum = glm::max(maximum, position);
+        }
+
+        glm::vec3 center = (minimum + maximum) * 0.5f;
+        float radius = 0.0f;
+        for (uint32_t v = 0; v < meshlet.vertexCount; ++v)
+            radius = std::max(radius, glm::length(mesh.vertices[pVertices[v]].pos - center));
+
+        meshlet.sphere = glm::vec4(center, radius);
+
+        // towards the viewer for front faces (see Mesh), zero for degenerate triangles - they face nowhere,
+        // so they neither widen the cone nor keep it from culling
+        vector<glm::vec3> normals(meshlet.triangleCount, glm::vec3(0.0f));
+
+        glm::vec3 axis(0.0f);
+        for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+        {
+            const glm::vec3& p0 = mesh.vertices[pVertices[pTriangles[t * 3 + 0]]].pos;
+            const glm::vec3& p1 = mesh.vertices[pVertices[pTriangles[t * 3 + 1]]].pos;
+            const glm::vec3& p2 = mesh.vertices[pVertices[pTriangles[t * 3 + 2]]].pos;
+
+            glm::vec3 normal = glm::cross(p2 - p0, p1 - p0);
+            float length = glm::length(normal);
+
+            if (length > 0.0f)
+            {
+                normals[t] = normal / length;
+                axis += normals[t];
+            }
+        }
+
+        meshlet.cone = glm::vec4(0.0f, 0.0f, 1.0f, 2.0f);
+        meshlet.apex = glm::vec4(center, 1.0f);
+
+        float axisLength = glm::length(axis);
+        if (axisLength == 0.0f)
+            return;
+
+        axis /= axisLength;
+
+        float minDot = 1.0f;
+        for (const glm::vec3& normal : normals)
+        {
+            if (normal != glm::vec3(0.0f))
+                minDot = std::min(minDot, glm::dot(normal, axis));
+        }
+
+        // a cone of 90 degrees or more has front faces from every direction
+        if (minDot <= 0.1f)
+            return;
+
+        // the apex sits on the axis behind every triangle's plane, so the test also holds for a perspective viewer
+        float maxT = 0.0f;
+        for (uint32_t t = 0; t < meshlet.triangleCount; ++t)
+        {
+            if (normals[t] == glm::vec3(0.0f))
+                continue;
+
+            const glm::vec3& p0 = mesh.vertices[pVertices[pTriangles[t * 3]]].pos;
+            maxT = std::max(maxT, glm::dot(center - p0, normals[t]) / glm::dot(axis, normals[t]));
+        }
+
+        meshlet.cone = glm::vec4(axis, std::sqrt(1.0f - minDot * minDot));
+        meshlet.apex = glm::vec4(center - axis * maxT, 1.0f);
+    }
+
+
+    // greedy clustering of one index list, appended to data's arrays
+    void appendMeshlets(const Mesh& mesh, const uint32_t* pIndices, uint32_t indexCount, MeshletData& data)
+    {
+        uint32_t vertexCount = static_cast<uint32_t>(mesh.vertices.size());
+        uint32_t triangleCount = indexCount / 3;
+
+        if (triangleCount == 0)
+            return;
+
+        // triangles of every vertex (offsets + list)
+        vector<uint32_t> adjacencyOffsets(vertexCount + 1, 0);
+        for (uint32_t i = 0; i < indexCount; ++i)
+            ++adjacencyOffsets[pIndices[i] + 1];
+
+        for (uint32_t v = 0; v < vertexCount; ++v)
+            adjacencyOffsets[v + 1] += adjacencyOffsets[v];
+
+        vector<uint32_t> adjacency(indexCount);
+        vector<uint32_t> fill(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+        for (uint32_t i = 0; i < indexCount; ++i)
+            adjacency[fill[pIndices[i]]++] = i / 3;
+
+        vector<bool> emitted(triangleCount, false);
+
+        // meshlet local slot of a mesh vertex, valid while localOwner matches the current meshlet
+        vector<uint32_t> localSlot(vertexCount, InvalidSlot);
+        vector<uint32_t> localOwner(vertexCount, InvalidSlot);
+
+        // triangles next to the meshlet's vertices, the next one is picked from here
+        vector<uint32_t> candidates;
+
+        uint32_t cursor = 0;
+        uint32_t emittedCount = 0;
+
+        while (emittedCount < triangleCount)
+        {
+            uint32_t meshletIndex = static_cast<uint32_t>(data.meshlets.size());
+
+            MeshletDesc meshlet{};
+            meshlet.vertexOffset = static_cast<uint32_t>(data.vertices.size());
+            meshlet.triangleOffset = static_cast<uint32_t>(data.triangles.size());
+
+            glm::vec3 centerSum(0.0f);
+            candidates.clear();
+
+            auto newVertices = [&](uint32_t triangle)
+            {
+                uint32_t count = 0;
+                for (uint32_t k = 0; k < 3; ++k)
+                    count += (localOwner[pIndices[triangle * 3 + k]] != meshletIndex) ? 1 : 0;
+                return count;
+            };
+
+            for (;;)
+            {
+                // most shared vertices first, ties go to the triangle closest to the meshlet's center, which keeps it round
+                uint32_t best = InvalidSlot;
+                uint32_t bestNew = 4;
+                float bestDistance = 0.0f;
+
+                glm::vec3 center = (meshlet.vertexCount > 0) ? centerSum / static_cast<float>(meshlet.vertexCount) : glm::vec3(0.0f);
+
+                for (uint32_t triangle : candidates)
+                {
+                    if (emitted[triangle])
+                        continue;
+
+                    uint32_t added = newVertices(triangle);
+                    if (added > bestNew)
+                        continue;
+
+                    const glm::vec3& p0 = mesh.vertices[pIndices[triangle * 3 + 0]].pos;
+                    const glm::vec3& p1 = mesh.vertices[pIndices[triangle * 3 + 1]].pos;
+                    const glm::vec3& p2 = mesh.vertices[pIndices[triangle * 3 + 2]].pos;
+                    glm::vec3 offset = (p0 + p1 + p2) / 3.0f - center;
+                    float distance = glm::dot(offset, offset);
+
+                    if (added < bestNew || distance < bestDistance)
+                    {
+                        best = triangle;
+                        bestNew = added;
+                        bestDistance = distance;
+                    }
+                }
+
+                // nothing adjacent left - the next unused triangle in index order
+                if (best == InvalidSlot)
+                {
+                    while (cursor < triangleCount && emitted[cursor])
+                        ++cursor;
+
+                    if (cursor == triangleCount)
+                        break;
+
+                    best = cursor;
+                    bestNew = newVertices(best);
+                }
+
+                if (meshlet.vertexCount + bestNew > MeshletData::MaxVertices || meshlet.triangleCount + 1 > MeshletData::MaxTriangles)
+                    break;
+
+                for (uint32_t k = 0; k < 3; ++k)
+                {
+                    uint32_t vertex = pIndices[best * 3 + k];
+
+                    if (localOwner[vertex] != meshletIndex)
+                    {
+                        localOwner[vertex] = meshletIndex;
+                        localSlot[vertex] = meshlet.vertexCount++;
+                        data.vertices.push_back(vertex);
+                        centerSum += mesh.vertices[vertex].pos;
+
+                        for (uint32_t a = adjacencyOffsets[vertex]; a < adjacencyOffsets[vertex + 1]; ++a)
+                        {
+                            if (!emitted[adjacency[a]])
+                                candidates.push_back(adjacency[a]);
+                        }
+                    }
+
+                    data.triangles.push_back(static_cast<uint8_t>(localSlot[vertex]));
+                }
+
+                emitted[best] = true;
+                ++meshlet.triangleCount;
+                ++emittedCount;
+
+                // emitted entries pile up as the meshlet grows, drop them before the list gets long
+                if (candidates.size() > 4 * MeshletData::MaxVertices)
+                    candidates.erase(std::remove_if(candidates.begin(), candidates.end(), [&emitted](uint32_t triangle) { return emitted[triangle]; }), candidates.end());
+            }
+
+            // the mesh shader reads the triangle bytes as uints
+            while (data.triangles.size() % 4 != 0)
+                data.triangles.push_back(0);
+
+            computeBounds(mesh, data, meshlet);
+            data.meshlets.push_back(meshlet);
+        }
+    }
+}
+
+
+void buildMeshlets(const Mesh& mesh, MeshletData& data)
+{
+    data.meshlets.clear();
+    data.vertices.clear();
+    data.triangles.clear();
+    data.lodOffsets = { 0 };
+
+    appendMeshlets(mesh, mesh.indices.data(), static_cast<uint32_t>(mesh.indices.size()), data);
+    data.lodOffsets.push_back(static_cast<uint32_t>(data.meshlets.size()));
+}
+
+
+void buildMeshlets(const Mesh& mesh, const MeshLodChain& lods, MeshletData& data)
+{
+    data.meshlets.clear();
+    data.vertices.clear();
+    data.triangles.clear();
+    data.lodOffsets = { 0 };
+
+    for (const MeshLod& lod : lods.lods)
+    {
+        appendMeshlets(mesh, lods.indices.data() + lod.indexOffset, lod.indexCount, data);
+        data.lodOffsets.push_back(static_cast<uint32_t>(data.meshlets.size()));
+    }
+}
+
+
+void MeshletData::save(const string& filename, uint64_t meshHash) const
+{
+    std::ofstream outFile(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!outFile.is_open())
+        throw runtime_error("failed to open meshlet file for writing");
+
+    uint32_t header[6] =
+    {
+        MaxVertices,
+        MaxTriangles,
+        static_cast<uint32_t>(meshlets.size()),
+        static_cast<uint32_t>(vertices.size()),
+        static_cast<uint32_t>(triangles.size()),
+        static_cast<uint32_t>(lodOffsets.size())
+    };
+
+    outFile.write(MeshletMagic, sizeof(MeshletMagic));
+    outFile.write(reinterpret_cast<const char*>(&meshHash), sizeof(meshHash));
+    outFile.write(reinterpret_cast<const char*>(header), sizeof(header));
+    outFile.write(reinterpret_cast<const char*>(meshlets.data()), meshlets.size() * sizeof(MeshletDesc));
+    outFile.write(reinterpret_cast<const char*>(vertices.data()), vertices.size() * sizeof(uint32_t));
+    outFile.write(reinterpret_cast<const char*>(triangles.data()), triangles.size());
+    outFile.write(reinterpret_cast<const char*>(lodOffsets.data()), lodOffsets.size() * sizeof(uint32_t));
+}
+
+
+bool MeshletData::load(const string& filename, uint64_t meshHash, size_t meshVertexCount)
+{
+    std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+    if (!inFile.is_open())
+        return false;
+
+    char magic[sizeof(MeshletMagic)] = {};
+    uint64_t fileHash = 0;
+    uint32_t header[6] = {};
+
+    inFile.read(magic, sizeof(magic));
+    inFile.read(reinterpret_cast<char*>(&fileHash), sizeof(fileHash));
+    inFile.read(reinterpret_cast<char*>(header), sizeof(header));
+
+    if (!inFile || memcmp(magic, MeshletMagic, sizeof(magic)) != 0)
+        return false;
+
+    if (fileHash != meshHash || header[0] != MaxVertices || header[1] != MaxTriangles)
+        return false;
+
+    // the counts must account for exactly the rest of the file before anything is allocated for them
+    uint64_t expectedSize = uint64_t(header[2]) * sizeof(MeshletDesc) + uint64_t(header[3]) * sizeof(uint32_t) + header[4] + uint64_t(header[5]) * sizeof(uint32_t);
+
+    std::streamoff headerSize = inFile.tellg();
+    inFile.seekg(0, std::ios::end);
+    std::streamoff fileSize = inFile.tellg();
+    inFile.seekg(headerSize);
+
+    if (static_cast<uint64_t>(fileSize - headerSize) != expectedSize)
+        return false;
+
+    meshlets.resize(header[2]);
+    vertices.resize(header[3]);
+    triangles.resize(header[4]);
+    lodOffsets.resize(header[5]);
+
+    inFile.read(reinterpret_cast<char*>(meshlets.data()), meshlets.size() * sizeof(MeshletDesc));
+    inFile.read(reinterpret_cast<char*>(vertices.data()), vertices.size() * sizeof(uint32_t));
+    inFile.read(reinterpret_cast<char*>(triangles.data()), triangles.size());
+    inFile.read(reinterpret_cast<char*>(lodOffsets.data()), lodOffsets.size() * sizeof(uint32_t));
+
+    if (!inFile)
+        return false;
+
+    // the mesh shader trusts the ranges, a damaged file is rebuilt rather than read out of bounds
+    for (const MeshletDesc& meshlet : meshlets)
+    {
+        if (meshlet.vertexCount > MaxVertices || meshlet.triangleCount > MaxTriangles ||
+            uint64_t(meshlet.vertexOffset) + meshlet.vertexCount > vertices.size() ||
+            uint64_t(meshlet.triangleOffset) + uint64_t(meshlet.triangleCount) * 3 > triangles.size())
+            return false;
+
+        // and the values within them, vertices index the mesh and triangles the meshlet's own vertices
+        for (uint32_t v = 0; v < meshlet.vertexCount; ++v)
+        {
+            if (vertices[meshlet.vertexOffset + v] >= meshVertexCount)
+                return false;
+        }
+
+        for (uint32_t t = 0; t < meshlet.triangleCount * 3; ++t)
+        {
+            if (triangles[meshlet.triangleOffset + t] >= meshlet.vertexCount)
+                return false;
+        }
+    }
+
+    // the levels must split the meshlets into consecutive ranges that cover all of them
+    if (lodOffsets.empty() || lodOffsets.front() != 0 || lodOffsets.back() != meshlets.size())
+        return false;
+
+    for (size_t l = 1; l < lodOffsets.size(); ++l)
+    {
+        if (lodOffsets[l] < lodOffsets[l - 1])
+            return false;
+    }
+
+    return true;
+}
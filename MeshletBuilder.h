@@ -0,0 +1,47 @@
+#pragma once
+#include "Mesh.h"
+#include "MeshSimplifier.h"
+#include "ShaderTypes.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+// the clusters of one mesh and the two arrays they index, uploaded as they are for the mesh shader path
+struct MeshletData
+{
+    // mesh shader output limits the clusters are built for - 124 keeps the triangle bytes of a full meshlet a multiple of 4
+    static constexpr uint32_t MaxVertices = 64;
+    static constexpr uint32_t MaxTriangles = 124;
+
+    std::vector<MeshletDesc> meshlets;
+
+    // meshlets of level l are [lodOffsets[l], lodOffsets[l + 1]), one level unless built from a MeshLodChain
+    std::vector<uint32_t> lodOffsets;
+
+    // mesh vertex index of every meshlet vertex
+    std::vector<uint32_t> vertices;
+
+    // 3 meshlet local vertex indices per triangle, every meshlet starts on a 4 byte boundary
+    std::vector<uint8_t> triangles;
+
+    uint32_t getLodCount() const { return lodOffsets.empty() ? 0 : static_cast<uint32_t>(lodOffsets.size() - 1); }
+
+    // offline builds - meshHash (Mesh::hash, combined with MeshLodChain::hash) ties the file to the mesh it was built from
+    void save(const std::string& filename, uint64_t meshHash) const;
+
+    // false when the file is missing, damaged, or was built from another mesh or with other limits
+    // every index is checked against meshVertexCount and its meshlet, the mesh shader reads them unchecked
+    bool load(const std::string& filename, uint64_t meshHash, size_t meshVertexCount);
+};
+
+
+// greedy clustering - a meshlet grows by the triangle that shares the most vertices with it (the one closest to its
+// center among equals) and starts over at the next unused triangle in index order when nothing adjacent fits, so
+// meshlets stay compact and their normal cones narrow; bounds are a sphere around the vertices and the cone around
+// the triangle normals
+void buildMeshlets(const Mesh& mesh, MeshletData& meshlets);
+
+// the same per level of the chain, all levels' meshlets index the mesh's vertices
+void buildMeshlets(const Mesh& mesh, const MeshLodChain& lods, MeshletData& meshlets);
@@ -0,0 +1,525 @@
+#include "OcclusionCuller.h"
+#include "ShaderTypes.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+using std::runtime_error;
+using std::vector;
+
+
+void OcclusionCuller::create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice, uint32_t frameCount, VkBuffer pDrawBuffer,
+    const vector<unsigned char>& pyramidShaderCode, const vector<unsigned char>& cullShaderCode)
+{
+    this->pPhysicalDevice = pPhysicalDevice;
+    this->pDevice = pDevice;
+    this->pDrawBuffer = pDrawBuffer;
+    this->frameCount = frameCount;
+
+    // pyramid - binding 0 the source level (or the depth buffer), binding 1 the level written
+    VkDescriptorSetLayoutBinding pyramidBindings[2]{};
+    pyramidBindings[0].binding = 0;
+    pyramidBindings[0].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pyramidBindings[0].descriptorCount = 1;
+    pyramidBindings[0].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    pyramidBindings[1].binding = 1;
+    pyramidBindings[1].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+    pyramidBindings[1].descriptorCount = 1;
+    pyramidBindings[1].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+
+    // cull - in the binding order of shaders/occlusionCull.comp
+    VkDescriptorSetLayoutBinding cullBindings[4]{};
+    const VkDescriptorType cullTypes[4] = { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER };
+
+    for (uint32_t b = 0; b < 4; ++b)
+    {
+        cullBindings[b].binding = b;
+        cullBindings[b].descriptorType = cullTypes[b];
+        cullBindings[b].descriptorCount = 1;
+        cullBindings[b].stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    }
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 2;
+    layoutInfo.pBindings = pyramidBindings;
+
+    if (vkCreateDescriptorSetLayout(pDevice, &layoutInfo, nullptr, &pPyramidSetLayout) != VK_SUCCESS)
+        throw runtime_error("failed to create depth pyramid descriptor set layout");
+
+    layoutInfo.bindingCount = 4;
+    layoutInfo.pBindings = cullBindings;
+
+    if (vkCreateDescriptorSetLayout(pDevice, &layoutInfo, nullptr, &pCullSetLayout) != VK_SUCCESS)
+        throw runtime_error("failed to create occlusion cull descriptor set layout");
+
+    createPipeline(pyramidShaderCode, pPyramidSetLayout, 0, pPyramidLayout, pPyramidPipeline);
+    createPipeline(cullShaderCode, pCullSetLayout, sizeof(OcclusionCullPushConstants), pCullLayout, pCullPipeline);
+
+    // texelFetch ignores filtering, the sampler only has to exist
+    VkSamplerCreateInfo samplerInfo{};
+    samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+    samplerInfo.magFilter = VK_FILTER_NEAREST;
+    samplerInfo.minFilter = VK_FILTER_NEAREST;
+    samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+    samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+    samplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+
+    if (vkCreateSampler(pDevice, &samplerInfo, nullptr, &pSampler) != VK_SUCCESS)
+        throw runtime_error("failed to create depth pyramid sampler");
+
+    // all sets up front, setDepth() only rewrites them
+    allocator.init(pDevice, MaxLevels + 1, { { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 3 } });
+
+    for (uint32_t level = 0; level < MaxLevels; ++level)
+        pyramidSets[level] = allocator.allocate(pPyramidSetLayout);
+
+    pCullSet = allocator.allocate(pCullSetLayout);
+
+    statsRing.create(pPhysicalDevice, pDevice, frameCount, CounterCount * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    VkDescriptorBufferInfo bufferInfos[3]{};
+    bufferInfos[0] = { pDrawBuffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[1] = { pDrawBuffer, 0, VK_WHOLE_SIZE };
+    bufferInfos[2] = { statsRing.getBuffer(), 0, VK_WHOLE_SIZE };
+
+    const uint32_t bufferBindings[3] = { 0, 1, 3 };
+    VkWriteDescriptorSet descriptorWrites[3]{};
+
+    for (uint32_t w = 0; w < 3; ++w)
+    {
+        descriptorWrites[w].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[w].dstSet = pCullSet;
+        descriptorWrites[w].dstBinding = bufferBindings[w];
+        descriptorWrites[w].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[w].descriptorCount = 1;
+        descriptorWrites[w].pBufferInfo = &bufferInfos[w];
+    }
+
+    vkUpdateDescriptorSets(pDevice, 3, descriptorWrites, 0, nullptr);
+
+    // timestamps on the graphics queue, which is where the passes run
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(pPhysicalDevice, &deviceProperties);
+
+    if (deviceProperties.limits.timestampComputeAndGraphics)
+    {
+        VkQueryPoolCreateInfo queryPoolInfo{};
+        queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+        queryPoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+        queryPoolInfo.queryCount = QueryCount * frameCount;
+
+        if (vkCreateQueryPool(pDevice, &queryPoolInfo, nullptr, &pQueryPool) != VK_SUCCESS)
+            throw runtime_error("failed to create occlusion cull query pool");
+
+        timestampPeriodNs = deviceProperties.limits.timestampPeriod;
+    }
+
+    pending.assign(frameCount, false);
+    stats = OcclusionStats{};
+}
+
+
+void OcclusionCuller::createPipeline(const vector<unsigned char>& shaderCode, VkDescriptorSetLayout pSetLayout, uint32_t pushConstantsSize,
+    VkPipelineLayout& pLayout, VkPipeline& pPipeline)
+{
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantsSize;
+
+    VkPipelineLayoutCreateInfo pipelineLayoutInfo{};
+    pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+    pipelineLayoutInfo.setLayoutCount = 1;
+    pipelineLayoutInfo.pSetLayouts = &pSetLayout;
+    pipelineLayoutInfo.pushConstantRangeCount = (pushConstantsSize > 0) ? 1 : 0;
+    pipelineLayoutInfo.pPushConstantRanges = &pushConstantRange;
+
+    if (vkCreatePipelineLayout(pDevice, &pipelineLayoutInfo, nullptr, &pLayout) != VK_SUCCESS)
+        throw runtime_error("failed to create occlusion cull pipeline layout");
+
+    VkShaderModuleCreateInfo moduleInfo{};
+    moduleInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    moduleInfo.codeSize = shaderCode.size();
+    moduleInfo.pCode = reinterpret_cast<const uint32_t*>(shaderCode.data());
+
+    VkShaderModule pModule = nullptr;
+    if (vkCreateShaderModule(pDevice, &moduleInfo, nullptr, &pModule) != VK_SUCCESS)
+        throw runtime_error("failed to create occlusion cull shader module");
+
+    VkComputePipelineCreateInfo pipelineInfo{};
+    pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+    pipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    pipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    pipelineInfo.stage.module = pModule;
+    pipelineInfo.stage.pName = "main";
+    pipelineInfo.layout = pLayout;
+
+    VkResult result = vkCreateComputePipelines(pDevice, nullptr, 1, &pipelineInfo, nullptr, &pPipeline);
+
+    vkDestroyShaderModule(pDevice, pModule, nullptr);
+
+    if (result != VK_SUCCESS)
+        throw runtime_error("failed to create occlusion cull pipeline");
+}
+
+
+void OcclusionCuller::destroy()
+{
+    if (pDevice == nullptr)
+        return;
+
+    destroyPyramid();
+
+    statsRing.destroy();
+    allocator.destroy();
+
+    vkDestroyQueryPool(pDevice, pQueryPool, nullptr);
+    vkDestroySampler(pDevice, pSampler, nullptr);
+    vkDestroyPipeline(pDevice, pPyramidPipeline, nullptr);
+    vkDestroyPipeline(pDevice, pCullPipeline, nullptr);
+    vkDestroyPipelineLayout(pDevice, pPyramidLayout, nullptr);
+    vkDestroyPipelineLayout(pDevice, pCullLayout, nullptr);
+    vkDestroyDescriptorSetLayout(pDevice, pPyramidSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(pDevice, pCullSetLayout, nullptr);
+
+    *this = OcclusionCuller{};
+}
+
+
+void OcclusionCuller::destroyPyramid()
+{
+    for (uint32_t level = 0; level < levelCount; ++level)
+        vkDestroyImageView(pDevice, levelViews[level], nullptr);
+
+    vkDestroyImageView(pDevice, pPyramidView, nullptr);
+    vkDestroyImage(pDevice, pPyramid, nullptr);
+    vkFreeMemory(pDevice, pPyramidMemory, nullptr);
+
+    pPyramidView = nullptr;
+    pPyramid = nullptr;
+    pPyramidMemory = nullptr;
+    levelCount = 0;
+}
+
+
+void OcclusionCuller::setDepth(VkImage pDepthImage, VkImageView pDepthImageView, VkFormat depthFormat, VkExtent2D extent)
+{
+    destroyPyramid();
+
+    this->pDepthImage = pDepthImage;
+    depthValid = false;
+
+    // without separateDepthStencilLayouts a layout transition covers both aspects
+    bool hasStencil = (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT || depthFormat == VK_FORMAT_D16_UNORM_S8_UINT);
+    depthAspect = hasStencil ? (VK_IMAGE_ASPECT_DEPTH_BIT | VK_IMAGE_ASPECT_STENCIL_BIT) : VK_IMAGE_ASPECT_DEPTH_BIT;
+
+    // level 0 at half the size, halved (rounding down) until 1x1
+    VkExtent2D levelExtent = { std::max(1u, extent.width / 2), std::max(1u, extent.height / 2) };
+    for (levelCount = 0; levelCount < MaxLevels; ++levelCount)
+    {
+        levelExtents[levelCount] = levelExtent;
+
+        if (levelExtent.width == 1 && levelExtent.height == 1)
+        {
+            ++levelCount;
+            break;
+        }
+
+        levelExtent = { std::max(1u, levelExtent.width / 2), std::max(1u, levelExtent.height / 2) };
+    }
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = VK_FORMAT_R32_SFLOAT;
+    imageInfo.extent = { levelExtents[0].width, levelExtents[0].height, 1 };
+    imageInfo.mipLevels = levelCount;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_STORAGE_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(pDevice, &imageInfo, nullptr, &pPyramid) != VK_SUCCESS)
+        throw runtime_error("failed to create depth pyramid image");
+
+    VkMemoryRequirements memReqs{};
+    vkGetImageMemoryRequirements(pDevice, pPyramid, &memReqs);
+
+    VkMemoryAllocateInfo memAlloc{};
+    memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = Utils::findMemoryType(pPhysicalDevice, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &pPyramidMemory) != VK_SUCCESS)
+        throw runtime_error("failed to allocate depth pyramid memory");
+
+    vkBindImageMemory(pDevice, pPyramid, pPyramidMemory, 0);
+
+    // every level for the cull, one level each for the reduction
+    VkImageViewCreateInfo viewInfo{};
+    viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    viewInfo.image = pPyramid;
+    viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    viewInfo.format = VK_FORMAT_R32_SFLOAT;
+    viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+    if (vkCreateImageView(pDevice, &viewInfo, nullptr, &pPyramidView) != VK_SUCCESS)
+        throw runtime_error("failed to create depth pyramid view");
+
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        viewInfo.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, level, 1, 0, 1 };
+
+        if (vkCreateImageView(pDevice, &viewInfo, nullptr, &levelViews[level]) != VK_SUCCESS)
+            throw runtime_error("failed to create depth pyramid level view");
+    }
+
+    // the pyramid stays in VK_IMAGE_LAYOUT_GENERAL, written as a storage image and read through the sampler
+    vector<VkDescriptorImageInfo> imageInfos(2 * levelCount + 1);
+    vector<VkWriteDescriptorSet> descriptorWrites(2 * levelCount + 1);
+
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        VkDescriptorImageInfo& sourceInfo = imageInfos[2 * level];
+        sourceInfo.sampler = pSampler;
+        sourceInfo.imageView = (level == 0) ? pDepthImageView : levelViews[level - 1];
+        sourceInfo.imageLayout = (level == 0) ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_GENERAL;
+
+        VkDescriptorImageInfo& levelInfo = imageInfos[2 * level + 1];
+        levelInfo.imageView = levelViews[level];
+        levelInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+        for (uint32_t b = 0; b < 2; ++b)
+        {
+            VkWriteDescriptorSet& descriptorWrite = descriptorWrites[2 * level + b];
+            descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+            descriptorWrite.dstSet = pyramidSets[level];
+            descriptorWrite.dstBinding = b;
+            descriptorWrite.descriptorType = (b == 0) ? VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER : VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+            descriptorWrite.descriptorCount = 1;
+            descriptorWrite.pImageInfo = &imageInfos[2 * level + b];
+        }
+    }
+
+    VkDescriptorImageInfo& pyramidInfo = imageInfos[2 * levelCount];
+    pyramidInfo.sampler = pSampler;
+    pyramidInfo.imageView = pPyramidView;
+    pyramidInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+    VkWriteDescriptorSet& pyramidWrite = descriptorWrites[2 * levelCount];
+    pyramidWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    pyramidWrite.dstSet = pCullSet;
+    pyramidWrite.dstBinding = 2;
+    pyramidWrite.descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+    pyramidWrite.descriptorCount = 1;
+    pyramidWrite.pImageInfo = &pyramidInfo;
+
+    vkUpdateDescriptorSets(pDevice, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+}
+
+
+void OcclusionCuller::recordEarly(VkCommandBuffer pCommandBuffer, uint32_t frameIndex, uint32_t firstDraw, VkDeviceSize commandOffset, uint32_t drawCount, float radius)
+{
+    // same offset every time the frame comes around
+    statsRing.beginFrame(frameIndex);
+    UniformAllocation counters = statsRing.allocate(CounterCount * sizeof(uint32_t));
+
+    collect(frameIndex, static_cast<const uint32_t*>(counters.pData));
+    memset(counters.pData, 0, CounterCount * sizeof(uint32_t));
+
+    uint32_t firstQuery = QueryCount * frameIndex;
+    if (pQueryPool != nullptr)
+    {
+        vkCmdResetQueryPool(pCommandBuffer, pQueryPool, firstQuery, QueryCount);
+        vkCmdWriteTimestamp(pCommandBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, pQueryPool, firstQuery);
+    }
+
+    recordPyramid(pCommandBuffer);
+
+    if (pQueryPool != nullptr)
+        vkCmdWriteTimestamp(pCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pQueryPool, firstQuery + 1);
+
+    constants = OcclusionCullPushConstants{};
+    constants.firstDraw = firstDraw;
+    constants.firstCommand = static_cast<uint32_t>(commandOffset / sizeof(uint32_t));
+    constants.drawCount = drawCount;
+    constants.statsOffset = static_cast<uint32_t>(counters.offset / sizeof(uint32_t));
+    constants.radius = radius;
+    constants.occlusion = depthValid ? 1 : 0;
+    constants.pyramidLevels = levelCount;
+
+    vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCullPipeline);
+    vkCmdBindDescriptorSets(pCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCullLayout, 0, 1, &pCullSet, 0, nullptr);
+    vkCmdPushConstants(pCommandBuffer, pCullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(constants), &constants);
+    vkCmdDispatch(pCommandBuffer, (drawCount + 63) / 64, 1, 1);
+
+    if (pQueryPool != nullptr)
+        vkCmdWriteTimestamp(pCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pQueryPool, firstQuery + 2);
+
+    recordToAttachment(pCommandBuffer, depthValid ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED);
+
+    pending[frameIndex] = true;
+
+    // the render pass that follows stores its depth for recordLate()
+    depthValid = true;
+}
+
+
+void OcclusionCuller::recordLate(VkCommandBuffer pCommandBuffer, uint32_t frameIndex, VkDeviceSize lateCommandOffset)
+{
+    // the first render pass has finished once the timestamp is written
+    uint32_t firstQuery = QueryCount * frameIndex;
+    if (pQueryPool != nullptr)
+        vkCmdWriteTimestamp(pCommandBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, pQueryPool, firstQuery + 3);
+
+    recordPyramid(pCommandBuffer);
+
+    if (pQueryPool != nullptr)
+        vkCmdWriteTimestamp(pCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pQueryPool, firstQuery + 4);
+
+    // the early commands still hold the first cull's result, the pyramid now always has depth in it
+    OcclusionCullPushConstants lateConstants = constants;
+    lateConstants.occlusion = 1;
+    lateConstants.late = 1;
+    lateConstants.firstLateCommand = static_cast<uint32_t>(lateCommandOffset / sizeof(uint32_t));
+
+    vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCullPipeline);
+    vkCmdBindDescriptorSets(pCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pCullLayout, 0, 1, &pCullSet, 0, nullptr);
+    vkCmdPushConstants(pCommandBuffer, pCullLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(lateConstants), &lateConstants);
+    vkCmdDispatch(pCommandBuffer, (lateConstants.drawCount + 63) / 64, 1, 1);
+
+    if (pQueryPool != nullptr)
+        vkCmdWriteTimestamp(pCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, pQueryPool, firstQuery + 5);
+
+    recordToAttachment(pCommandBuffer, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+}
+
+
+// the depth buffer goes from the attachment layout to VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL and is reduced into the pyramid,
+// while it holds nothing yet the pyramid is only made writable
+void OcclusionCuller::recordPyramid(VkCommandBuffer pCommandBuffer)
+{
+    // the pyramid's old contents are not needed - only the last reads of it have to finish
+    VkImageMemoryBarrier barriers[2]{};
+    barriers[0].sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    barriers[0].srcAccessMask = 0;
+    barriers[0].dstAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    barriers[0].oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    barriers[0].newLayout = VK_IMAGE_LAYOUT_GENERAL;
+    barriers[0].srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    barriers[0].image = pPyramid;
+    barriers[0].subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levelCount, 0, 1 };
+
+    // the depth writes of the render pass before, submitted earlier on the same queue
+    barriers[1] = barriers[0];
+    barriers[1].srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barriers[1].oldLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    barriers[1].image = pDepthImage;
+    barriers[1].subresourceRange = { depthAspect, 0, 1, 0, 1 };
+
+    // the early cull's instanceCounts, which the late cull reads
+    VkMemoryBarrier commandBarrier{};
+    commandBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    commandBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    commandBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+        1, &commandBarrier, 0, nullptr, depthValid ? 2 : 1, barriers);
+
+    if (!depthValid)
+        return;
+
+    // each level reads the one before it
+    vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPyramidPipeline);
+
+    VkMemoryBarrier levelBarrier{};
+    levelBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    levelBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    levelBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+    for (uint32_t level = 0; level < levelCount; ++level)
+    {
+        vkCmdBindDescriptorSets(pCommandBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, pPyramidLayout, 0, 1, &pyramidSets[level], 0, nullptr);
+        vkCmdDispatch(pCommandBuffer, (levelExtents[level].width + 7) / 8, (levelExtents[level].height + 7) / 8, 1);
+
+        vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0,
+            1, &levelBarrier, 0, nullptr, 0, nullptr);
+    }
+}
+
+
+// commands for the indirect draws, counters for the host once the fence signals, depth back to the render pass
+void OcclusionCuller::recordToAttachment(VkCommandBuffer pCommandBuffer, VkImageLayout depthLayout)
+{
+    VkMemoryBarrier cullBarrier{};
+    cullBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+    cullBarrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+    cullBarrier.dstAccessMask = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_HOST_READ_BIT;
+
+    VkImageMemoryBarrier toAttachment{};
+    toAttachment.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toAttachment.srcAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    toAttachment.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    toAttachment.oldLayout = depthLayout;
+    toAttachment.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    toAttachment.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toAttachment.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toAttachment.image = pDepthImage;
+    toAttachment.subresourceRange = { depthAspect, 0, 1, 0, 1 };
+
+    vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+        VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_HOST_BIT, 0,
+        1, &cullBarrier, 0, nullptr, 1, &toAttachment);
+}
+
+
+// the slot's previous use has finished - its counters are still in place, its queries not yet reset
+void OcclusionCuller::collect(uint32_t frameIndex, const uint32_t* pCounters)
+{
+    if (!pending[frameIndex])
+        return;
+
+    pending[frameIndex] = false;
+
+    // the second pass only counts what it takes back from the first pass's occluded ones
+    ++stats.frames;
+    stats.frustumCulled += pCounters[0];
+    stats.occluded += pCounters[1] - pCounters[3];
+    stats.lateVisible += pCounters[3];
+    stats.tested += uint64_t(pCounters[0]) + pCounters[1] + pCounters[2];
+
+    if (pQueryPool == nullptr)
+        return;
+
+    // value and availability per query
+    uint64_t results[2 * QueryCount] = {};
+    VkResult result = vkGetQueryPoolResults(pDevice, pQueryPool, QueryCount * frameIndex, QueryCount, sizeof(results), results, 2 * sizeof(uint64_t),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    if (result != VK_SUCCESS)
+        return;
+
+    for (uint32_t q = 0; q < QueryCount; ++q)
+    {
+        if (results[2 * q + 1] == 0)
+            return;
+    }
+
+    // start, pyramid done, cull done - once per pass
+    auto ms = [&](uint32_t from, uint32_t to) { return (results[2 * to] - results[2 * from]) * timestampPeriodNs * 1e-6; };
+
+    ++stats.timedFrames;
+    stats.pyramidMs += ms(0, 1) + ms(3, 4);
+    stats.cullMs += ms(1, 2) + ms(4, 5);
+}
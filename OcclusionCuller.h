@@ -0,0 +1,119 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include "DescriptorAllocator.h"
+#include "ShaderTypes.h"
+#include "UniformRing.h"
+
+#include <cstdint>
+#include <vector>
+
+
+struct OcclusionStats
+{
+    uint64_t frames = 0;
+    uint64_t tested = 0;
+    uint64_t frustumCulled = 0;
+
+    // still hidden after the second pass, and hidden by the previous frame's depth but not by this frame's
+    uint64_t occluded = 0;
+    uint64_t lateVisible = 0;
+
+    // GPU time of the pyramid builds and of the culls, both passes, summed over the frames whose timestamps were read back
+    uint64_t timedFrames = 0;
+    double pyramidMs = 0.0;
+    double cullMs = 0.0;
+};
+
+
+// two phase hierarchical Z occlusion culling of indexed indirect draws
+//   recordEarly() - before the first render pass: shaders/depthPyramid.comp reduces the depth buffer the previous frame
+//                   left behind to a mip chain (R32F), each texel the farthest depth below it, then shaders/occlusionCull.comp
+//                   tests every instance's bounding sphere against the clip volume and the pyramid level where it covers
+//                   2x2 texels, and zeroes the instanceCount of the commands it rejects
+//   recordLate()  - between the first render pass and a second one that loads color and depth: the pyramid is built again
+//                   from what the first pass drew, and the instances the first cull found occluded are tested against it -
+//                   the ones visible now get instanceCount 1 in a second set of commands, drawn by the second pass
+// the previous frame's depth only decides what is drawn first, so an instance that comes out from behind an occluder
+// is still drawn in the frame it appears
+// the depth buffer must be single sampled, sampled as well as an attachment and stored at the end of both render passes
+class OcclusionCuller
+{
+public:
+
+    // 2^16 pixels along the longer side
+    static constexpr uint32_t MaxLevels = 16;
+
+    // pDrawBuffer holds the BindlessDrawData of the instances and the indirect commands, the same buffer every frame
+    void create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice, uint32_t frameCount, VkBuffer pDrawBuffer,
+        const std::vector<unsigned char>& pyramidShaderCode, const std::vector<unsigned char>& cullShaderCode);
+    void destroy();
+
+    // the depth buffer was (re)created - the device must be idle, its contents count as lost until a frame has drawn into it
+    // pDepthImageView must see the depth aspect only
+    void setDepth(VkImage pDepthImage, VkImageView pDepthImageView, VkFormat depthFormat, VkExtent2D extent);
+
+    // the frame's fence must have been waited on - its counters and timestamps from last time go into the stats first
+    // the depth buffer is left in VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL and the commands ready for the indirect read
+    void recordEarly(VkCommandBuffer pCommandBuffer, uint32_t frameIndex, uint32_t firstDraw, VkDeviceSize commandOffset, uint32_t drawCount, float radius);
+
+    // after the render pass that drew recordEarly()'s commands, before the one that draws lateCommandOffset's
+    // the late commands must hold the same draws as the early ones, their instanceCount is overwritten
+    void recordLate(VkCommandBuffer pCommandBuffer, uint32_t frameIndex, VkDeviceSize lateCommandOffset);
+
+    const OcclusionStats& getStats() const { return stats; }
+    uint32_t getLevelCount() const { return levelCount; }
+
+private:
+
+    void createPipeline(const std::vector<unsigned char>& shaderCode, VkDescriptorSetLayout pSetLayout, uint32_t pushConstantsSize,
+        VkPipelineLayout& pLayout, VkPipeline& pPipeline);
+    void destroyPyramid();
+    void recordPyramid(VkCommandBuffer pCommandBuffer);
+    void recordToAttachment(VkCommandBuffer pCommandBuffer, VkImageLayout depthLayout);
+    void collect(uint32_t frameIndex, const uint32_t* pCounters);
+
+    VkPhysicalDevice pPhysicalDevice = nullptr;
+    VkDevice pDevice = nullptr;
+    VkBuffer pDrawBuffer = nullptr;
+
+    VkDescriptorSetLayout pPyramidSetLayout = nullptr;
+    VkDescriptorSetLayout pCullSetLayout = nullptr;
+    VkPipelineLayout pPyramidLayout = nullptr;
+    VkPipelineLayout pCullLayout = nullptr;
+    VkPipeline pPyramidPipeline = nullptr;
+    VkPipeline pCullPipeline = nullptr;
+    VkSampler pSampler = nullptr;
+
+    // one set per level (its source and itself), written again whenever the depth buffer changes
+    DescriptorAllocator allocator;
+    VkDescriptorSet pyramidSets[MaxLevels] = {};
+    VkDescriptorSet pCullSet = nullptr;
+
+    VkImage pDepthImage = nullptr;
+    VkImageAspectFlags depthAspect = VK_IMAGE_ASPECT_DEPTH_BIT;
+    bool depthValid = false;
+
+    VkImage pPyramid = nullptr;
+    VkDeviceMemory pPyramidMemory = nullptr;
+    VkImageView pPyramidView = nullptr;
+    VkImageView levelViews[MaxLevels] = {};
+    VkExtent2D levelExtents[MaxLevels] = {};
+    uint32_t levelCount = 0;
+
+    // per frame - frustum culled, occluded, visible, taken back by the second cull; read back once the frame's fence has been waited on
+    static constexpr uint32_t CounterCount = 4;
+    UniformRing statsRing;
+    uint32_t frameCount = 0;
+
+    // what recordEarly() culled, recordLate() tests the same instances again
+    OcclusionCullPushConstants constants{};
+
+    // per frame - start, pyramid done, cull done for each pass; null when the queue cannot time compute work
+    static constexpr uint32_t QueryCount = 6;
+    VkQueryPool pQueryPool = nullptr;
+    double timestampPeriodNs = 0.0;
+    std::vector<bool> pending;
+
+    OcclusionStats stats;
+};
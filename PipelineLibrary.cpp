@@ -0,0 +1,346 @@
+#include "PipelineLibrary.h"
+#include "LogBackend.h"
+
+#include <algorithm>
+#include <exception>
+#include <stdexcept>
+
+using std::vector;
+using std::runtime_error;
+using std::endl;
+
+
+template<typename T, size_t N>
+static size_t indexOf(const T (&values)[N], T value)
+{
+    size_t index = std::find(values, values + N, value) - values;
+    if (index == N)
+        throw runtime_error("pipeline variant is not covered by the pipeline library");
+
+    return index;
+}
+
+
+void PipelineLibrary::create(VkDevice pDevice, const PipelineLibraryState& state)
+{
+    this->pDevice = pDevice;
+    this->state = state;
+
+    // vertex input interface - vertex layout and topology
+    VkPipelineVertexInputStateCreateInfo vertexInputState{};
+    vertexInputState.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+    vertexInputState.vertexBindingDescriptionCount = static_cast<uint32_t>(this->state.vertexBindings.size());
+    vertexInputState.pVertexBindingDescriptions = this->state.vertexBindings.data();
+    vertexInputState.vertexAttributeDescriptionCount = static_cast<uint32_t>(this->state.vertexAttributes.size());
+    vertexInputState.pVertexAttributeDescriptions = this->state.vertexAttributes.data();
+
+    for (size_t i = 0; i < std::size(Topologies); ++i)
+    {
+        VkPipelineInputAssemblyStateCreateInfo inputAssemblyState{};
+        inputAssemblyState.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        inputAssemblyState.topology = Topologies[i];
+        inputAssemblyState.primitiveRestartEnable = VK_FALSE;
+
+        VkGraphicsPipelineCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        createInfo.pVertexInputState = &vertexInputState;
+        createInfo.pInputAssemblyState = &inputAssemblyState;
+
+        pVertexInput[i] = createLibrary(createInfo, VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT);
+    }
+
+    // fragment output interface - blending and the attachment formats
+    for (size_t i = 0; i < std::size(pFragmentOutput); ++i)
+    {
+        VkPipelineColorBlendStateCreateInfo colorBlendState{};
+        colorBlendState.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        colorBlendState.logicOpEnable = VK_FALSE;
+        colorBlendState.logicOp = VK_LOGIC_OP_COPY;
+        colorBlendState.attachmentCount = 1;
+        colorBlendState.pAttachments = &this->state.blendAttachments[i];
+
+        VkGraphicsPipelineCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        createInfo.pColorBlendState = &colorBlendState;
+        createInfo.pMultisampleState = &this->state.multisampleState;
+
+        pFragmentOutput[i] = createLibrary(createInfo, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_OUTPUT_INTERFACE_BIT_EXT);
+    }
+
+    stopLinking = false;
+    linkThread = std::thread(&PipelineLibrary::linkThreadMain, this);
+}
+
+
+void PipelineLibrary::destroy()
+{
+    // the thread links what is still queued before it returns
+    {
+        std::lock_guard<std::mutex> lock(linkMutex);
+        stopLinking = true;
+    }
+    linkWake.notify_one();
+
+    if (linkThread.joinable())
+        linkThread.join();
+
+    for (auto& [variant, entry] : linked)
+    {
+        vkDestroyPipeline(pDevice, entry.pFastLinked, nullptr);
+        vkDestroyPipeline(pDevice, entry.pLinked, nullptr);
+    }
+
+    linked.clear();
+
+    for (const Program& program : programs)
+    {
+        for (VkPipeline pLibrary : program.pPreRasterization)
+            vkDestroyPipeline(pDevice, pLibrary, nullptr);
+
+        vkDestroyPipeline(pDevice, program.pFragmentShader, nullptr);
+    }
+
+    programs.clear();
+
+    for (VkPipeline& pLibrary : pVertexInput)
+    {
+        vkDestroyPipeline(pDevice, pLibrary, nullptr);
+        pLibrary = nullptr;
+    }
+
+    for (VkPipeline& pLibrary : pFragmentOutput)
+    {
+        vkDestroyPipeline(pDevice, pLibrary, nullptr);
+        pLibrary = nullptr;
+    }
+}
+
+
+uint32_t PipelineLibrary::addProgram(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, VkPipelineLayout pLayout)
+{
+    Program program;
+    program.pLayout = pLayout;
+
+    // pre-rasterization - vertex shader, viewport and rasterizer
+    VkPipelineShaderStageCreateInfo vertStage{};
+    vertStage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    vertStage.stage = VK_SHADER_STAGE_VERTEX_BIT;
+    vertStage.module = vertShaderModule;
+    vertStage.pName = "main";
+
+    // viewport and scissor are dynamic, only the count is baked
+    VkPipelineViewportStateCreateInfo viewportState{};
+    viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+    viewportState.viewportCount = 1;
+    viewportState.scissorCount = 1;
+
+    VkPipelineDynamicStateCreateInfo dynamicState{};
+    dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+    dynamicState.dynamicStateCount = static_cast<uint32_t>(state.dynamicStates.size());
+    dynamicState.pDynamicStates = state.dynamicStates.data();
+
+    for (size_t i = 0; i < std::size(CullModes); ++i)
+    {
+        VkPipelineRasterizationStateCreateInfo rasterizationState = state.rasterizationState;
+        rasterizationState.cullMode = CullModes[i];
+
+        VkGraphicsPipelineCreateInfo createInfo{};
+        createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        createInfo.stageCount = 1;
+        createInfo.pStages = &vertStage;
+        createInfo.pViewportState = &viewportState;
+        createInfo.pRasterizationState = &rasterizationState;
+        createInfo.pDynamicState = &dynamicState;
+        createInfo.layout = pLayout;
+
+        program.pPreRasterization[i] = createLibrary(createInfo, VK_GRAPHICS_PIPELINE_LIBRARY_PRE_RASTERIZATION_SHADERS_BIT_EXT);
+    }
+
+    // fragment shader
+    VkPipelineShaderStageCreateInfo fragStage = vertStage;
+    fragStage.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    fragStage.module = fragShaderModule;
+
+    VkGraphicsPipelineCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.stageCount = 1;
+    createInfo.pStages = &fragStage;
+    createInfo.pMultisampleState = &state.multisampleState;
+    createInfo.pDepthStencilState = &state.depthStencilState;
+    createInfo.layout = pLayout;
+
+    program.pFragmentShader = createLibrary(createInfo, VK_GRAPHICS_PIPELINE_LIBRARY_FRAGMENT_SHADER_BIT_EXT);
+
+    programs.push_back(program);
+
+    return static_cast<uint32_t>(programs.size() - 1);
+}
+
+
+VkPipeline PipelineLibrary::getPipeline(const PipelineVariant& variant)
+{
+    auto it = linked.find(variant);
+
+    if (it == linked.end())
+    {
+        if (variant.program >= programs.size())
+            throw runtime_error("unknown pipeline library program");
+
+        const Program& program = programs[variant.program];
+
+        vector<VkPipeline> libraries =
+        {
+            pVertexInput[indexOf(Topologies, variant.topology)],
+            program.pPreRasterization[indexOf(CullModes, variant.cullMode)],
+            program.pFragmentShader,
+            pFragmentOutput[variant.blendEnable ? 1 : 0]
+        };
+        VkPipeline pFastLinked = link(libraries, program.pLayout, false);
+
+        // map nodes do not move, the link thread keeps the pointer until it sets linkDone
+        Linked& entry = linked[variant];
+        entry.pFastLinked = pFastLinked;
+        entry.libraries = std::move(libraries);
+        entry.pLayout = program.pLayout;
+
+        {
+            std::lock_guard<std::mutex> lock(linkMutex);
+            linkQueue.push_back(&entry);
+            ++linksPending;
+        }
+        linkWake.notify_one();
+
+        return entry.pFastLinked;
+    }
+
+    Linked& entry = it->second;
+
+    if (entry.pOptimized == nullptr && entry.linkDone.load(std::memory_order_acquire))
+        entry.pOptimized = entry.pLinked;
+
+    // the fast-linked pipeline may still be referenced by frames in flight, it lives until destroy()
+    return (entry.pOptimized != nullptr) ? entry.pOptimized : entry.pFastLinked;
+}
+
+
+bool PipelineLibrary::isOptimized(const PipelineVariant& variant) const
+{
+    auto it = linked.find(variant);
+    return it != linked.end() && it->second.pOptimized != nullptr;
+}
+
+
+void PipelineLibrary::waitForOptimized()
+{
+    {
+        std::unique_lock<std::mutex> lock(linkMutex);
+        linkIdle.wait(lock, [this]() { return linksPending == 0; });
+    }
+
+    for (auto& [variant, entry] : linked)
+        entry.pOptimized = entry.pLinked;
+}
+
+
+uint32_t PipelineLibrary::getLibraryCount() const
+{
+    uint32_t programLibraries = static_cast<uint32_t>(std::size(CullModes)) + 1;
+    return static_cast<uint32_t>(std::size(pVertexInput) + std::size(pFragmentOutput) + programs.size() * programLibraries);
+}
+
+
+VkPipeline PipelineLibrary::createLibrary(VkGraphicsPipelineCreateInfo& createInfo, VkGraphicsPipelineLibraryFlagsEXT flags)
+{
+    VkGraphicsPipelineLibraryCreateInfoEXT libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_LIBRARY_CREATE_INFO_EXT;
+    libraryInfo.flags = flags;
+
+    // everything but the vertex input interface is tied to the attachments
+    VkPipelineRenderingCreateInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachmentFormats = &state.colorFormat;
+    renderingInfo.depthAttachmentFormat = state.depthFormat;
+
+    if (flags != VK_GRAPHICS_PIPELINE_LIBRARY_VERTEX_INPUT_INTERFACE_BIT_EXT)
+    {
+        if (state.pRenderPass != nullptr)
+        {
+            createInfo.renderPass = state.pRenderPass;
+            createInfo.subpass = 0;
+        }
+        else
+            libraryInfo.pNext = &renderingInfo;
+    }
+
+    // retain the link time optimisation info so link(..., true) can optimise across the libraries
+    createInfo.pNext = &libraryInfo;
+    createInfo.flags |= VK_PIPELINE_CREATE_LIBRARY_BIT_KHR | VK_PIPELINE_CREATE_RETAIN_LINK_TIME_OPTIMIZATION_INFO_BIT_EXT;
+    createInfo.basePipelineHandle = VK_NULL_HANDLE;
+    createInfo.basePipelineIndex = -1;
+
+    VkPipeline pLibrary = nullptr;
+    if (vkCreateGraphicsPipelines(pDevice, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pLibrary) != VK_SUCCESS)
+        throw runtime_error("failed to create graphics pipeline library");
+
+    return pLibrary;
+}
+
+
+VkPipeline PipelineLibrary::link(const vector<VkPipeline>& libraries, VkPipelineLayout pLayout, bool optimize) const
+{
+    VkPipelineLibraryCreateInfoKHR libraryInfo{};
+    libraryInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LIBRARY_CREATE_INFO_KHR;
+    libraryInfo.libraryCount = static_cast<uint32_t>(libraries.size());
+    libraryInfo.pLibraries = libraries.data();
+
+    // without the flag the driver only stitches the compiled parts together
+    VkGraphicsPipelineCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+    createInfo.pNext = &libraryInfo;
+    createInfo.flags = optimize ? VK_PIPELINE_CREATE_LINK_TIME_OPTIMIZATION_BIT_EXT : 0;
+    createInfo.layout = pLayout;
+    createInfo.basePipelineHandle = VK_NULL_HANDLE;
+    createInfo.basePipelineIndex = -1;
+
+    VkPipeline pPipeline = nullptr;
+    if (vkCreateGraphicsPipelines(pDevice, VK_NULL_HANDLE, 1, &createInfo, nullptr, &pPipeline) != VK_SUCCESS)
+        throw runtime_error(optimize ? "failed to link optimized graphics pipeline" : "failed to fast-link graphics pipeline");
+
+    return pPipeline;
+}
+
+
+// one link at a time, so a burst of new variants does not start a thread each
+void PipelineLibrary::linkThreadMain()
+{
+    std::unique_lock<std::mutex> lock(linkMutex);
+
+    for (;;)
+    {
+        linkWake.wait(lock, [this]() { return stopLinking || !linkQueue.empty(); });
+
+        if (linkQueue.empty())
+            return;
+
+        Linked* pEntry = linkQueue.front();
+        linkQueue.pop_front();
+        lock.unlock();
+
+        try
+        {
+            pEntry->pLinked = link(pEntry->libraries, pEntry->pLayout, true);
+        }
+        catch (const std::exception& e)
+        {
+            Logging::LogStream out(LogLevel::Warning);
+            out << e.what() << ", keeping the fast-linked pipeline" << endl;
+        }
+
+        pEntry->linkDone.store(true, std::memory_order_release);
+
+        lock.lock();
+        if (--linksPending == 0)
+            linkIdle.notify_all();
+    }
+}
@@ -0,0 +1,137 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <iterator>
+
+
+// the state that varies between pipelines built from the same shaders
+// program is the index returned by PipelineLibrary::addProgram (DrawPipelineId order in VulkanTriangleApp)
+struct PipelineVariant
+{
+    uint32_t program = 0;
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    bool blendEnable = true;
+
+    bool operator<(const PipelineVariant& rhs) const
+    {
+        return std::tie(program, topology, cullMode, blendEnable) < std::tie(rhs.program, rhs.topology, rhs.cullMode, rhs.blendEnable);
+    }
+};
+
+
+// everything of createGraphicsPipeline() the libraries are built from, copied by PipelineLibrary::create
+struct PipelineLibraryState
+{
+    // vertex input - the topology comes from the variant
+    std::vector<VkVertexInputBindingDescription> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription> vertexAttributes;
+
+    // pre-rasterization - the cull mode comes from the variant
+    VkPipelineRasterizationStateCreateInfo rasterizationState{};
+    std::vector<VkDynamicState> dynamicStates;
+
+    // fragment output - [0] opaque, [1] alpha blended (disableAlphaBlending/enableAlphaBlending)
+    VkPipelineMultisampleStateCreateInfo multisampleState{};
+    VkPipelineColorBlendAttachmentState blendAttachments[2]{};
+
+    // fragment shader
+    VkPipelineDepthStencilStateCreateInfo depthStencilState{};
+
+    // nullptr with dynamic rendering, colorFormat/depthFormat are used instead
+    VkRenderPass pRenderPass = nullptr;
+    VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+};
+
+
+// VK_EXT_graphics_pipeline_library - the four pipeline parts are compiled up front as libraries
+// getPipeline() fast-links a variant from them (no shader compile), an optimised link of the same variant
+// runs on the library's link thread and replaces the fast-linked pipeline once it is ready
+// the links do not go through the job system - the render thread runs queued jobs while it waits on its own,
+// and an optimised link would stall its frame; a failed optimised link keeps the fast-linked pipeline
+class PipelineLibrary
+{
+public:
+
+    static constexpr VkCullModeFlags CullModes[] = { VK_CULL_MODE_NONE, VK_CULL_MODE_FRONT_BIT, VK_CULL_MODE_BACK_BIT };
+    static constexpr VkPrimitiveTopology Topologies[] = { VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_PRIMITIVE_TOPOLOGY_TRIANGLE_STRIP };
+
+    // compiles the vertex input and fragment output libraries for every topology and blend mode, starts the link thread
+    void create(VkDevice pDevice, const PipelineLibraryState& state);
+
+    // finishes outstanding optimised links and stops the link thread
+    void destroy();
+
+    // compiles the pre-rasterization library for every cull mode and the fragment shader library
+    // the modules may be destroyed once this returns
+    uint32_t addProgram(VkShaderModule vertShaderModule, VkShaderModule fragShaderModule, VkPipelineLayout pLayout);
+
+    // the optimised pipeline when its link has finished, otherwise the fast-linked one
+    VkPipeline getPipeline(const PipelineVariant& variant);
+
+    bool isOptimized(const PipelineVariant& variant) const;
+
+    // blocks until every optimised link started so far has finished
+    void waitForOptimized();
+
+    uint32_t getLibraryCount() const;
+    uint32_t getLinkedCount() const { return static_cast<uint32_t>(linked.size()); }
+
+private:
+
+    struct Program
+    {
+        VkPipelineLayout pLayout = nullptr;
+
+        // indexed like CullModes
+        VkPipeline pPreRasterization[std::size(CullModes)] = {};
+        VkPipeline pFragmentShader = nullptr;
+    };
+
+    struct Linked
+    {
+        VkPipeline pFastLinked = nullptr;
+        VkPipeline pOptimized = nullptr;
+
+        // copied so the link thread does not touch programs while it may grow
+        std::vector<VkPipeline> libraries;
+        VkPipelineLayout pLayout = nullptr;
+
+        // written by the link thread before linkDone, nullptr when the optimised link failed
+        VkPipeline pLinked = nullptr;
+        std::atomic<bool> linkDone{ false };
+    };
+
+    VkPipeline createLibrary(VkGraphicsPipelineCreateInfo& createInfo, VkGraphicsPipelineLibraryFlagsEXT flags);
+    VkPipeline link(const std::vector<VkPipeline>& libraries, VkPipelineLayout pLayout, bool optimize) const;
+    void linkThreadMain();
+
+    VkDevice pDevice = nullptr;
+    PipelineLibraryState state;
+
+    // indexed like Topologies and PipelineLibraryState::blendAttachments
+    VkPipeline pVertexInput[std::size(Topologies)] = {};
+    VkPipeline pFragmentOutput[2] = {};
+
+    std::vector<Program> programs;
+    std::map<PipelineVariant, Linked> linked;
+
+    // optimised links in request order, linksPending counts the queued one and the one being linked
+    std::thread linkThread;
+    std::mutex linkMutex;
+    std::condition_variable linkWake;
+    std::condition_variable linkIdle;
+    std::deque<Linked*> linkQueue;
+    uint32_t linksPending = 0;
+    bool stopLinking = false;
+};
@@ -0,0 +1,579 @@
+#include "PipelineRegistry.h"
+#include "FrameProfiler.h"
+#include "JobSystem.h"
+#include "Logging.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+using std::endl;
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+
+namespace
+{
+    // file layout (little endian): char[8] "VTPSO002", uint32 sizeof(PipelineDesc), uint32 count, PipelineDesc * count
+    const char ListMagic[8] = { 'V', 'T', 'P', 'S', 'O', '0', '0', '2' };
+
+
+    void copyName(char (&out)[PipelineDesc::MaxShaderName], const char* pName)
+    {
+        if (strlen(pName) >= PipelineDesc::MaxShaderName)
+            throw runtime_error("shader file name is too long for PipelineDesc");
+
+        memset(out, 0, sizeof(out));
+        memcpy(out, pName, strlen(pName));
+    }
+
+
+    // the Vk structs of one description, kept alive until vkCreateGraphicsPipelines returns
+    struct BuildState
+    {
+        VkPipelineShaderStageCreateInfo stages[3]{};
+        VkVertexInputBindingDescription binding{};
+        VkVertexInputAttributeDescription attributes[PipelineDesc::MaxVertexAttributes]{};
+        VkPipelineVertexInputStateCreateInfo vertexInput{};
+        VkPipelineInputAssemblyStateCreateInfo inputAssembly{};
+        VkPipelineViewportStateCreateInfo viewport{};
+        VkPipelineRasterizationStateCreateInfo rasterization{};
+        VkPipelineMultisampleStateCreateInfo multisample{};
+        VkPipelineDepthStencilStateCreateInfo depthStencil{};
+        VkPipelineColorBlendAttachmentState blendAttachment{};
+        VkPipelineColorBlendStateCreateInfo colorBlend{};
+        VkDynamicState dynamicStates[PipelineDesc::MaxDynamicStates + 2]{};
+        VkPipelineDynamicStateCreateInfo dynamic{};
+        VkFormat colorFormat = VK_FORMAT_UNDEFINED;
+        VkPipelineRenderingCreateInfo rendering{};
+    };
+}
+
+
+void PipelineDesc::setShaders(const char* pVertShader, const char* pFragShader)
+{
+    copyName(vertShader, pVertShader);
+    copyName(fragShader, pFragShader);
+    memset(taskShader, 0, sizeof(taskShader));
+    memset(meshShader, 0, sizeof(meshShader));
+}
+
+
+void PipelineDesc::setMeshShaders(const char* pTaskShader, const char* pMeshShader, const char* pFragShader)
+{
+    memset(vertShader, 0, sizeof(vertShader));
+    copyName(taskShader, (pTaskShader != nullptr) ? pTaskShader : "");
+    copyName(meshShader, pMeshShader);
+    copyName(fragShader, pFragShader);
+}
+
+
+void PipelineDesc::setVertexInput(const VkVertexInputBindingDescription& binding, const VkVertexInputAttributeDescription* pAttributes, uint32_t attributeCount)
+{
+    if (attributeCount > MaxVertexAttributes)
+        throw runtime_error("too many vertex attributes for PipelineDesc");
+
+    vertexStride = binding.stride;
+    vertexInputRate = binding.inputRate;
+    vertexAttributeCount = attributeCount;
+
+    for (uint32_t i = 0; i < MaxVertexAttributes; ++i)
+    {
+        vertexAttributes[i] = {};
+
+        if (i < attributeCount)
+        {
+            vertexAttributes[i].location = pAttributes[i].location;
+            vertexAttributes[i].format = pAttributes[i].format;
+            vertexAttributes[i].offset = pAttributes[i].offset;
+        }
+    }
+}
+
+
+void PipelineDesc::setRasterization(const VkPipelineRasterizationStateCreateInfo& rasterization)
+{
+    polygonMode = rasterization.polygonMode;
+    cullMode = rasterization.cullMode;
+    frontFace = rasterization.frontFace;
+    lineWidth = rasterization.lineWidth;
+    depthBiasEnable = rasterization.depthBiasEnable;
+}
+
+
+void PipelineDesc::setBlend(const VkPipelineColorBlendAttachmentState& blend)
+{
+    blendEnable = blend.blendEnable;
+    srcColorBlendFactor = blend.srcColorBlendFactor;
+    dstColorBlendFactor = blend.dstColorBlendFactor;
+    colorBlendOp = blend.colorBlendOp;
+    srcAlphaBlendFactor = blend.srcAlphaBlendFactor;
+    dstAlphaBlendFactor = blend.dstAlphaBlendFactor;
+    alphaBlendOp = blend.alphaBlendOp;
+    colorWriteMask = blend.colorWriteMask;
+}
+
+
+void PipelineDesc::setDynamicStates(const vector<VkDynamicState>& states)
+{
+    dynamicStateCount = 0;
+    memset(dynamicStates, 0, sizeof(dynamicStates));
+
+    for (VkDynamicState state : states)
+    {
+        // always dynamic, see PipelineDesc
+        if (state == VK_DYNAMIC_STATE_VIEWPORT || state == VK_DYNAMIC_STATE_SCISSOR)
+            continue;
+
+        if (dynamicStateCount == MaxDynamicStates)
+            throw runtime_error("too many dynamic states for PipelineDesc");
+
+        dynamicStates[dynamicStateCount++] = state;
+    }
+}
+
+
+uint64_t PipelineDesc::hash() const
+{
+    const unsigned char* pBytes = reinterpret_cast<const unsigned char*>(this);
+
+    uint64_t value = 14695981039346656037ull;
+    for (size_t i = 0; i < sizeof(PipelineDesc); ++i)
+    {
+        value ^= pBytes[i];
+        value *= 1099511628211ull;
+    }
+
+    return value;
+}
+
+
+bool PipelineDesc::operator==(const PipelineDesc& rhs) const
+{
+    return memcmp(this, &rhs, sizeof(PipelineDesc)) == 0;
+}
+
+
+bool PipelineDesc::isValid() const
+{
+    for (const char* pName : { vertShader, fragShader, taskShader, meshShader })
+    {
+        if (memchr(pName, '\0', MaxShaderName) == nullptr)
+            return false;
+    }
+
+    return vertexAttributeCount <= MaxVertexAttributes && dynamicStateCount <= MaxDynamicStates;
+}
+
+
+void PipelineRegistry::create(VkDevice pDevice)
+{
+    this->pDevice = pDevice;
+}
+
+
+void PipelineRegistry::destroy()
+{
+    for (const Entry& entry : entries)
+        vkDestroyPipeline(pDevice, entry.pPipeline, nullptr);
+
+    for (const auto& [filename, pModule] : shaderModules)
+        vkDestroyShaderModule(pDevice, pModule, nullptr);
+
+    entries.clear();
+    byHash.clear();
+    shaderModules.clear();
+    layouts.clear();
+    listFilter = nullptr;
+}
+
+
+void PipelineRegistry::setLayout(uint32_t layoutId, VkPipelineLayout pLayout)
+{
+    layouts[layoutId] = pLayout;
+}
+
+
+VkPipeline PipelineRegistry::get(const PipelineDesc& desc)
+{
+    uint64_t hash = desc.hash();
+    size_t index = findIndex(desc, hash);
+
+    if (index == entries.size())
+    {
+        prewarm(vector<PipelineDesc>{ desc });
+        index = entries.size() - 1;
+        ++missCount;
+    }
+    else
+        ++hitCount;
+
+    Entry& entry = entries[index];
+    ++entry.useCount;
+
+    return entry.pPipeline;
+}
+
+
+uint32_t PipelineRegistry::prewarm(const vector<PipelineDesc>& descs)
+{
+    // descriptions not created yet, without duplicates inside descs
+    vector<PipelineDesc> missing;
+    for (const PipelineDesc& desc : descs)
+    {
+        if (findIndex(desc, desc.hash()) == entries.size() && std::find(missing.begin(), missing.end(), desc) == missing.end())
+            missing.push_back(desc);
+    }
+
+    if (missing.empty())
+        return 0;
+
+    vector<BuildState> states(missing.size());
+    vector<VkGraphicsPipelineCreateInfo> createInfos(missing.size());
+
+    for (size_t i = 0; i < missing.size(); ++i)
+    {
+        const PipelineDesc& desc = missing[i];
+        BuildState& state = states[i];
+
+        auto layout = layouts.find(desc.layoutId);
+        if (layout == layouts.end())
+            throw runtime_error("unknown pipeline layout id");
+
+        bool meshPipeline = (desc.meshShader[0] != '\0');
+        uint32_t stageCount = 0;
+
+        auto addStage = [&](VkShaderStageFlagBits stage, const char* pFilename)
+        {
+            VkPipelineShaderStageCreateInfo& stageInfo = state.stages[stageCount++];
+            stageInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+            stageInfo.stage = stage;
+            stageInfo.module = getShaderModule(pFilename);
+            stageInfo.pName = "main";
+        };
+
+        if (meshPipeline)
+        {
+            if (desc.taskShader[0] != '\0')
+                addStage(VK_SHADER_STAGE_TASK_BIT_EXT, desc.taskShader);
+
+            addStage(VK_SHADER_STAGE_MESH_BIT_EXT, desc.meshShader);
+        }
+        else
+        {
+            addStage(VK_SHADER_STAGE_VERTEX_BIT, desc.vertShader);
+        }
+
+        addStage(VK_SHADER_STAGE_FRAGMENT_BIT, desc.fragShader);
+
+        state.binding.binding = 0;
+        state.binding.stride = desc.vertexStride;
+        state.binding.inputRate = static_cast<VkVertexInputRate>(desc.vertexInputRate);
+
+        for (uint32_t a = 0; a < desc.vertexAttributeCount; ++a)
+        {
+            state.attributes[a].location = desc.vertexAttributes[a].location;
+            state.attributes[a].binding = 0;
+            state.attributes[a].format = static_cast<VkFormat>(desc.vertexAttributes[a].format);
+            state.attributes[a].offset = desc.vertexAttributes[a].offset;
+        }
+
+        state.vertexInput.sType = VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
+        state.vertexInput.vertexBindingDescriptionCount = (desc.vertexStride > 0) ? 1 : 0;
+        state.vertexInput.pVertexBindingDescriptions = &state.binding;
+        state.vertexInput.vertexAttributeDescriptionCount = desc.vertexAttributeCount;
+        state.vertexInput.pVertexAttributeDescriptions = state.attributes;
+
+        state.inputAssembly.sType = VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO;
+        state.inputAssembly.topology = static_cast<VkPrimitiveTopology>(desc.topology);
+        state.inputAssembly.primitiveRestartEnable = desc.primitiveRestartEnable;
+
+        state.viewport.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
+        state.viewport.viewportCount = 1;
+        state.viewport.scissorCount = 1;
+
+        state.rasterization.sType = VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO;
+        state.rasterization.polygonMode = static_cast<VkPolygonMode>(desc.polygonMode);
+        state.rasterization.cullMode = desc.cullMode;
+        state.rasterization.frontFace = static_cast<VkFrontFace>(desc.frontFace);
+        state.rasterization.lineWidth = desc.lineWidth;
+        state.rasterization.depthBiasEnable = desc.depthBiasEnable;
+
+        state.multisample.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
+        state.multisample.rasterizationSamples = static_cast<VkSampleCountFlagBits>(desc.rasterizationSamples);
+        state.multisample.minSampleShading = 1.0f;
+
+        state.depthStencil.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+        state.depthStencil.depthTestEnable = desc.depthTestEnable;
+        state.depthStencil.depthWriteEnable = desc.depthWriteEnable;
+        state.depthStencil.depthCompareOp = static_cast<VkCompareOp>(desc.depthCompareOp);
+
+        state.blendAttachment.blendEnable = desc.blendEnable;
+        state.blendAttachment.srcColorBlendFactor = static_cast<VkBlendFactor>(desc.srcColorBlendFactor);
+        state.blendAttachment.dstColorBlendFactor = static_cast<VkBlendFactor>(desc.dstColorBlendFactor);
+        state.blendAttachment.colorBlendOp = static_cast<VkBlendOp>(desc.colorBlendOp);
+        state.blendAttachment.srcAlphaBlendFactor = static_cast<VkBlendFactor>(desc.srcAlphaBlendFactor);
+        state.blendAttachment.dstAlphaBlendFactor = static_cast<VkBlendFactor>(desc.dstAlphaBlendFactor);
+        state.blendAttachment.alphaBlendOp = static_cast<VkBlendOp>(desc.alphaBlendOp);
+        state.blendAttachment.colorWriteMask = desc.colorWriteMask;
+
+        state.colorBlend.sType = VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO;
+        state.colorBlend.logicOp = VK_LOGIC_OP_COPY;
+        state.colorBlend.attachmentCount = 1;
+        state.colorBlend.pAttachments = &state.blendAttachment;
+
+        state.dynamicStates[0] = VK_DYNAMIC_STATE_VIEWPORT;
+        state.dynamicStates[1] = VK_DYNAMIC_STATE_SCISSOR;
+        for (uint32_t d = 0; d < desc.dynamicStateCount; ++d)
+            state.dynamicStates[2 + d] = static_cast<VkDynamicState>(desc.dynamicStates[d]);
+
+        state.dynamic.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+        state.dynamic.dynamicStateCount = 2 + desc.dynamicStateCount;
+        state.dynamic.pDynamicStates = state.dynamicStates;
+
+        VkGraphicsPipelineCreateInfo& createInfo = createInfos[i];
+        createInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
+        createInfo.stageCount = stageCount;
+        createInfo.pStages = state.stages;
+
+        // mesh pipelines have no vertex input or input assembly
+        createInfo.pVertexInputState = meshPipeline ? nullptr : &state.vertexInput;
+        createInfo.pInputAssemblyState = meshPipeline ? nullptr : &state.inputAssembly;
+        createInfo.pViewportState = &state.viewport;
+        createInfo.pRasterizationState = &state.rasterization;
+        createInfo.pMultisampleState = &state.multisample;
+        createInfo.pDepthStencilState = &state.depthStencil;
+        createInfo.pColorBlendState = &state.colorBlend;
+        createInfo.pDynamicState = &state.dynamic;
+        createInfo.layout = layout->second;
+        createInfo.subpass = 0;
+        createInfo.basePipelineHandle = VK_NULL_HANDLE;
+        createInfo.basePipelineIndex = -1;
+
+        if (desc.dynamicRendering)
+        {
+            state.colorFormat = static_cast<VkFormat>(desc.colorFormat);
+            state.rendering.sType = VK_STRUCTURE_TYPE_PIPELINE_RENDERING_CREATE_INFO;
+            state.rendering.colorAttachmentCount = 1;
+            state.rendering.pColorAttachmentFormats = &state.colorFormat;
+            state.rendering.depthAttachmentFormat = static_cast<VkFormat>(desc.depthFormat);
+            createInfo.pNext = &state.rendering;
+        }
+        else
+            createInfo.renderPass = pRenderPass;
+    }
+
+    vector<VkPipeline> pipelines(missing.size(), nullptr);
+
+    uint64_t startNs = FrameProfiler::nowNs();
+
+    bool created = true;
+
+    if (pJobSystem != nullptr && missing.size() > 1)
+    {
+        // pipeline creation is thread safe, so each job's call compiles on its own thread
+        std::atomic<bool> failed{ false };
+
+        pJobSystem->parallelFor(static_cast<uint32_t>(missing.size()), 1, [&](uint32_t begin, uint32_t end)
+        {
+            if (vkCreateGraphicsPipelines(pDevice, VK_NULL_HANDLE, end - begin, createInfos.data() + begin, nullptr, pipelines.data() + begin) != VK_SUCCESS)
+                failed = true;
+        });
+
+        created = !failed;
+    }
+    else
+        created = (vkCreateGraphicsPipelines(pDevice, VK_NULL_HANDLE, static_cast<uint32_t>(createInfos.size()), createInfos.data(), nullptr, pipelines.data()) == VK_SUCCESS);
+
+    // the pipelines that did get created are not in entries yet, so destroy() would never see them
+    if (!created)
+    {
+        for (VkPipeline pPipeline : pipelines)
+        {
+            if (pPipeline != nullptr)
+                vkDestroyPipeline(pDevice, pPipeline, nullptr);
+        }
+
+        throw runtime_error("failed to create graphics pipeline");
+    }
+
+    uint64_t endNs = FrameProfiler::nowNs();
+
+    double createMs = (endNs - startNs) * 1e-6 / missing.size();
+
+    for (size_t i = 0; i < missing.size(); ++i)
+    {
+        Entry entry;
+        entry.desc = missing[i];
+        entry.hash = missing[i].hash();
+        entry.pPipeline = pipelines[i];
+        entry.createMs = createMs;
+        entry.createdNs = endNs;
+
+        byHash.emplace(entry.hash, entries.size());
+        entries.push_back(entry);
+    }
+
+    return static_cast<uint32_t>(missing.size());
+}
+
+
+uint32_t PipelineRegistry::prewarm(const string& filename)
+{
+    std::ifstream inFile(filename, std::ios::in | std::ios::binary);
+    if (!inFile.is_open())
+        return 0;
+
+    char magic[sizeof(ListMagic)] = {};
+    uint32_t descSize = 0;
+    uint32_t count = 0;
+
+    inFile.read(magic, sizeof(magic));
+    inFile.read(reinterpret_cast<char*>(&descSize), sizeof(descSize));
+    inFile.read(reinterpret_cast<char*>(&count), sizeof(count));
+
+    if (!inFile || memcmp(magic, ListMagic, sizeof(magic)) != 0)
+        throw runtime_error("not a pipeline list");
+
+    // written by a build with a different PipelineDesc - nothing in it can match
+    if (descSize != sizeof(PipelineDesc))
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "ignoring pipeline list " << filename << ", it was written for a different PipelineDesc" << endl;
+        return 0;
+    }
+
+    // the count must account for exactly the rest of the file before anything is allocated for it
+    std::streamoff headerSize = inFile.tellg();
+    inFile.seekg(0, std::ios::end);
+    std::streamoff fileSize = inFile.tellg();
+    inFile.seekg(headerSize);
+
+    if (fileSize - headerSize != static_cast<std::streamoff>(count) * static_cast<std::streamoff>(sizeof(PipelineDesc)))
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "ignoring pipeline list " << filename << ", its size does not match its count" << endl;
+        return 0;
+    }
+
+    vector<PipelineDesc> descs(count);
+    inFile.read(reinterpret_cast<char*>(descs.data()), static_cast<std::streamsize>(count) * sizeof(PipelineDesc));
+
+    if (!inFile)
+        throw runtime_error("pipeline list is truncated");
+
+    // the counts index fixed size arrays and the names are used as C strings
+    for (const PipelineDesc& desc : descs)
+    {
+        if (!desc.isValid())
+        {
+            Logging::LogStream out(LogLevel::Warning);
+            out << "ignoring pipeline list " << filename << ", it holds a damaged description" << endl;
+            return 0;
+        }
+    }
+
+    // a list from a run in another mode may hold descriptions this one cannot build
+    vector<PipelineDesc> usable;
+    for (const PipelineDesc& desc : descs)
+    {
+        if (canCreate(desc))
+            usable.push_back(desc);
+    }
+
+    return prewarm(usable);
+}
+
+
+void PipelineRegistry::save(const string& filename) const
+{
+    std::ofstream outFile(filename, std::ios::out | std::ios::trunc | std::ios::binary);
+    if (!outFile.is_open())
+        throw runtime_error("failed to open pipeline list for writing");
+
+    uint32_t descSize = sizeof(PipelineDesc);
+    uint32_t count = static_cast<uint32_t>(entries.size());
+
+    outFile.write(ListMagic, sizeof(ListMagic));
+    outFile.write(reinterpret_cast<const char*>(&descSize), sizeof(descSize));
+    outFile.write(reinterpret_cast<const char*>(&count), sizeof(count));
+
+    for (const Entry& entry : entries)
+        outFile.write(reinterpret_cast<const char*>(&entry.desc), sizeof(PipelineDesc));
+}
+
+
+const PipelineRegistry::Entry* PipelineRegistry::find(uint64_t hash) const
+{
+    auto it = byHash.find(hash);
+    return (it != byHash.end()) ? &entries[it->second] : nullptr;
+}
+
+
+void PipelineRegistry::logStats() const
+{
+    Logging::LogStream out(LogLevel::Info);
+    out << "pipeline registry: " << entries.size() << " pipelines, " << hitCount << " hits, " << missCount << " misses" << endl;
+
+    for (const Entry& entry : entries)
+    {
+        out << "\t" << std::hex << entry.hash << std::dec << " " << ((entry.desc.meshShader[0] != '\0') ? entry.desc.meshShader : entry.desc.vertShader) << " + " << entry.desc.fragShader
+            << " uses " << entry.useCount << ", created in " << entry.createMs << " ms" << endl;
+    }
+}
+
+
+// render pass descriptions need the registry's render pass, which runs with dynamic rendering do not set
+// layouts the device had no features for are not registered, or registered as nullptr
+bool PipelineRegistry::canCreate(const PipelineDesc& desc) const
+{
+    if (!desc.dynamicRendering && pRenderPass == nullptr)
+        return false;
+
+    auto layout = layouts.find(desc.layoutId);
+    if (layout == layouts.end() || layout->second == nullptr)
+        return false;
+
+    return !listFilter || listFilter(desc);
+}
+
+
+VkShaderModule PipelineRegistry::getShaderModule(const char* pFilename)
+{
+    auto it = shaderModules.find(pFilename);
+    if (it != shaderModules.end())
+        return it->second;
+
+    vector<unsigned char> code = Utils::readFile(pFilename);
+
+    VkShaderModuleCreateInfo createInfo{};
+    createInfo.sType = VK_STRUCTURE_TYPE_SHADER_MODULE_CREATE_INFO;
+    createInfo.codeSize = code.size();
+    createInfo.pCode = reinterpret_cast<const uint32_t*>(code.data());
+
+    VkShaderModule pModule = nullptr;
+    if (vkCreateShaderModule(pDevice, &createInfo, nullptr, &pModule) != VK_SUCCESS)
+        throw runtime_error("failed to create shader module");
+
+    shaderModules[pFilename] = pModule;
+
+    return pModule;
+}
+
+
+size_t PipelineRegistry::findIndex(const PipelineDesc& desc, uint64_t hash) const
+{
+    // equal hashes are compared in full, a collision gets its own entry
+    auto range = byHash.equal_range(hash);
+    for (auto it = range.first; it != range.second; ++it)
+    {
+        if (entries[it->second].desc == desc)
+            return it->second;
+    }
+
+    return entries.size();
+}
@@ -0,0 +1,183 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+class JobSystem;
+
+
+// everything a monolithic graphics pipeline is built from, as plain 4 byte fields with no padding or pointers
+// so the hash, equality and the prewarm file are all over the raw bytes and stable between runs
+// viewport and scissor are always dynamic, the entry point is always "main"
+struct PipelineDesc
+{
+    static constexpr uint32_t MaxShaderName = 64;
+    static constexpr uint32_t MaxVertexAttributes = 8;
+    static constexpr uint32_t MaxDynamicStates = 8;
+
+    struct VertexAttribute
+    {
+        uint32_t location = 0;
+        uint32_t format = 0;
+        uint32_t offset = 0;
+    };
+
+    // shaders - spv file names
+    char vertShader[MaxShaderName] = {};
+    char fragShader[MaxShaderName] = {};
+
+    // task + mesh instead of vertex shader and vertex input when meshShader is set, the task shader is optional
+    char taskShader[MaxShaderName] = {};
+    char meshShader[MaxShaderName] = {};
+
+    // see PipelineRegistry::setLayout
+    uint32_t layoutId = 0;
+
+    // vertex input - one binding at 0
+    uint32_t vertexStride = 0;
+    uint32_t vertexInputRate = VK_VERTEX_INPUT_RATE_VERTEX;
+    uint32_t vertexAttributeCount = 0;
+    VertexAttribute vertexAttributes[MaxVertexAttributes] = {};
+
+    // input assembly
+    uint32_t topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    uint32_t primitiveRestartEnable = VK_FALSE;
+
+    // rasterizer
+    uint32_t polygonMode = VK_POLYGON_MODE_FILL;
+    uint32_t cullMode = VK_CULL_MODE_BACK_BIT;
+    uint32_t frontFace = VK_FRONT_FACE_CLOCKWISE;
+    float lineWidth = 1.0f;
+    uint32_t depthBiasEnable = VK_FALSE;
+
+    // multisampling
+    uint32_t rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    // depth
+    uint32_t depthTestEnable = VK_FALSE;
+    uint32_t depthWriteEnable = VK_FALSE;
+    uint32_t depthCompareOp = VK_COMPARE_OP_LESS;
+
+    // color blending - one attachment
+    uint32_t blendEnable = VK_FALSE;
+    uint32_t srcColorBlendFactor = VK_BLEND_FACTOR_ONE;
+    uint32_t dstColorBlendFactor = VK_BLEND_FACTOR_ZERO;
+    uint32_t colorBlendOp = VK_BLEND_OP_ADD;
+    uint32_t srcAlphaBlendFactor = VK_BLEND_FACTOR_ONE;
+    uint32_t dstAlphaBlendFactor = VK_BLEND_FACTOR_ZERO;
+    uint32_t alphaBlendOp = VK_BLEND_OP_ADD;
+    uint32_t colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    // dynamic state besides viewport and scissor
+    uint32_t dynamicStateCount = 0;
+    uint32_t dynamicStates[MaxDynamicStates] = {};
+
+    // render target - the registry's render pass unless dynamicRendering
+    uint32_t colorFormat = VK_FORMAT_UNDEFINED;
+    uint32_t depthFormat = VK_FORMAT_UNDEFINED;
+    uint32_t dynamicRendering = VK_FALSE;
+
+    void setShaders(const char* pVertShader, const char* pFragShader);
+    void setMeshShaders(const char* pTaskShader, const char* pMeshShader, const char* pFragShader);
+    void setVertexInput(const VkVertexInputBindingDescription& binding, const VkVertexInputAttributeDescription* pAttributes, uint32_t attributeCount);
+    void setRasterization(const VkPipelineRasterizationStateCreateInfo& rasterization);
+    void setBlend(const VkPipelineColorBlendAttachmentState& blend);
+    void setDynamicStates(const std::vector<VkDynamicState>& states);
+
+    // FNV-1a over the bytes
+    uint64_t hash() const;
+
+    bool operator==(const PipelineDesc& rhs) const;
+
+    // counts within the arrays and every name terminated - anything read from a file must pass before it is used
+    bool isValid() const;
+};
+
+static_assert(std::is_trivially_copyable<PipelineDesc>::value, "PipelineDesc is hashed and written as raw bytes");
+static_assert(sizeof(PipelineDesc) % sizeof(uint32_t) == 0, "PipelineDesc must not contain padding");
+
+
+// deduplicates pipelines by PipelineDesc - identical descriptions share one VkPipeline
+// owns the pipelines and the shader modules they were built from
+class PipelineRegistry
+{
+public:
+
+    struct Entry
+    {
+        PipelineDesc desc;
+        uint64_t hash = 0;
+        VkPipeline pPipeline = nullptr;
+
+        // get() calls that returned this pipeline
+        uint64_t useCount = 0;
+
+        // CPU time of vkCreateGraphicsPipelines (share of it when created in a batch) and when it happened
+        double createMs = 0.0;
+        uint64_t createdNs = 0;
+    };
+
+    void create(VkDevice pDevice);
+    void destroy();
+
+    // layoutId in PipelineDesc refers to these
+    void setLayout(uint32_t layoutId, VkPipelineLayout pLayout);
+
+    // used by descriptions without dynamicRendering
+    void setRenderPass(VkRenderPass pRenderPass) { this->pRenderPass = pRenderPass; }
+
+    // prewarm() spreads its pipelines over the job system's threads instead of one call on the caller's
+    void setJobSystem(JobSystem* pJobSystem) { this->pJobSystem = pJobSystem; }
+
+    // false for list descriptions the device or options of this run have no support for - prewarm(filename) skips them
+    using ListFilter = std::function<bool(const PipelineDesc&)>;
+    void setListFilter(ListFilter filter) { listFilter = std::move(filter); }
+
+    // the existing pipeline for desc, created on first request
+    VkPipeline get(const PipelineDesc& desc);
+
+    // creates every missing description in one vkCreateGraphicsPipelines call (one per job with a job system)
+    // returns how many were created
+    uint32_t prewarm(const std::vector<PipelineDesc>& descs);
+
+    // a list written by save(), a missing file is not an error
+    // a damaged list is ignored with a warning, descriptions this run cannot build are skipped
+    uint32_t prewarm(const std::string& filename);
+
+    // every description the registry holds, for prewarm() in a later run
+    void save(const std::string& filename) const;
+
+    const Entry* find(uint64_t hash) const;
+    const std::vector<Entry>& getEntries() const { return entries; }
+
+    uint64_t getHitCount() const { return hitCount; }
+    uint64_t getMissCount() const { return missCount; }
+
+    void logStats() const;
+
+private:
+
+    VkShaderModule getShaderModule(const char* pFilename);
+    bool canCreate(const PipelineDesc& desc) const;
+    size_t findIndex(const PipelineDesc& desc, uint64_t hash) const;
+
+    VkDevice pDevice = nullptr;
+    VkRenderPass pRenderPass = nullptr;
+    JobSystem* pJobSystem = nullptr;
+    ListFilter listFilter;
+    std::map<uint32_t, VkPipelineLayout> layouts;
+    std::map<std::string, VkShaderModule> shaderModules;
+
+    std::vector<Entry> entries;
+    std::unordered_multimap<uint64_t, size_t> byHash;
+
+    uint64_t hitCount = 0;
+    uint64_t missCount = 0;
+};
@@ -0,0 +1,711 @@
+#include "RenderGraph.h"
+#include "FrameProfiler.h"
+#include "Logging.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+
+using std::endl;
+using std::string;
+using std::vector;
+using std::runtime_error;
+
+
+namespace
+{
+    struct UsageInfo
+    {
+        VkPipelineStageFlags stages;
+        VkAccessFlags readAccess;
+        VkAccessFlags writeAccess;
+        VkImageLayout layout;
+        VkImageUsageFlags imageUsage;
+        VkBufferUsageFlags bufferUsage;
+    };
+
+    // indexed by RenderGraphUsage
+    const UsageInfo UsageInfos[] =
+    {
+        // ColorAttachment
+        { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+          VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, 0 },
+        // DepthAttachment
+        { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT,
+          VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0 },
+        // SampledFragment
+        { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+        // SampledCompute
+        { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+          VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+        // StorageCompute
+        { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT,
+          VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT },
+        // TransferSrc
+        { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0,
+          VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT, VK_BUFFER_USAGE_TRANSFER_SRC_BIT },
+        // TransferDst
+        { VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT,
+          VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT, VK_BUFFER_USAGE_TRANSFER_DST_BIT },
+        // IndirectBuffer
+        { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0,
+          VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT },
+        // VertexBuffer
+        { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT, 0,
+          VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT },
+        // UniformBuffer
+        { VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_UNIFORM_READ_BIT, 0,
+          VK_IMAGE_LAYOUT_UNDEFINED, 0, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT },
+    };
+
+    static_assert(std::size(UsageInfos) == static_cast<size_t>(RenderGraphUsage::Count), "UsageInfos must cover every RenderGraphUsage");
+
+
+    const UsageInfo& usageInfo(RenderGraphUsage usage)
+    {
+        return UsageInfos[static_cast<size_t>(usage)];
+    }
+
+
+    VkDeviceSize alignUp(VkDeviceSize value, VkDeviceSize alignment)
+    {
+        return (value + alignment - 1) / alignment * alignment;
+    }
+
+
+    // what the previous accesses of a resource left behind, while walking the passes in buildBarriers()
+    struct ResourceState
+    {
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+
+        // reads since the last write, and the stages/accesses the last write is already visible to
+        VkPipelineStageFlags readStages = 0;
+        VkAccessFlags readAccess = 0;
+    };
+}
+
+
+void RenderGraph::create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice)
+{
+    this->pPhysicalDevice = pPhysicalDevice;
+    this->pDevice = pDevice;
+
+    VkPhysicalDeviceProperties properties{};
+    vkGetPhysicalDeviceProperties(pPhysicalDevice, &properties);
+
+    // linear buffers and optimal images may share a block, keep them on separate pages
+    bufferImageGranularity = std::max<VkDeviceSize>(1, properties.limits.bufferImageGranularity);
+}
+
+
+void RenderGraph::destroy()
+{
+    reset();
+
+    pDevice = nullptr;
+    pPhysicalDevice = nullptr;
+}
+
+
+void RenderGraph::reset()
+{
+    destroyTransients();
+
+    passes.clear();
+    resources.clear();
+    after = BarrierBatch{};
+
+    compiled = false;
+    stats = RenderGraphStats{};
+}
+
+
+uint32_t RenderGraph::importImage(const string& name, VkImage pImage, VkImageView pImageView, const RenderGraphImageDesc& desc,
+    VkImageLayout initialLayout, VkPipelineStageFlags initialStage, VkImageLayout finalLayout)
+{
+    Resource resource;
+    resource.name = name;
+    resource.image = true;
+    resource.imported = true;
+    resource.desc = desc;
+    resource.pImage = pImage;
+    resource.pImageView = pImageView;
+    resource.initialLayout = initialLayout;
+    resource.initialStage = initialStage;
+    resource.finalLayout = finalLayout;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+uint32_t RenderGraph::importBuffer(const string& name, VkBuffer pBuffer, VkDeviceSize size)
+{
+    Resource resource;
+    resource.name = name;
+    resource.image = false;
+    resource.imported = true;
+    resource.pBuffer = pBuffer;
+    resource.bufferSize = size;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+uint32_t RenderGraph::createImage(const string& name, const RenderGraphImageDesc& desc)
+{
+    Resource resource;
+    resource.name = name;
+    resource.image = true;
+    resource.desc = desc;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+uint32_t RenderGraph::createBuffer(const string& name, VkDeviceSize size)
+{
+    Resource resource;
+    resource.name = name;
+    resource.image = false;
+    resource.bufferSize = size;
+
+    resources.push_back(resource);
+    compiled = false;
+
+    return static_cast<uint32_t>(resources.size() - 1);
+}
+
+
+void RenderGraph::setImportedImage(uint32_t resource, VkImage pImage, VkImageView pImageView)
+{
+    if (!resources[resource].imported)
+        throw runtime_error("render graph resource " + resources[resource].name + " is not imported");
+
+    resources[resource].pImage = pImage;
+    resources[resource].pImageView = pImageView;
+}
+
+
+uint32_t RenderGraph::addPass(const string& name, Execute execute)
+{
+    Pass pass;
+    pass.name = name;
+    pass.execute = std::move(execute);
+
+    passes.push_back(std::move(pass));
+    compiled = false;
+
+    return static_cast<uint32_t>(passes.size() - 1);
+}
+
+
+void RenderGraph::read(uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+    for (const Access& access : passes[pass].accesses)
+    {
+        if (access.resource == resource)
+            throw runtime_error("render graph pass " + passes[pass].name + " declares " + resources[resource].name + " twice");
+    }
+
+    passes[pass].accesses.push_back({ resource, usage, false });
+    compiled = false;
+}
+
+
+void RenderGraph::write(uint32_t pass, uint32_t resource, RenderGraphUsage usage)
+{
+    if (usageInfo(usage).writeAccess == 0)
+        throw runtime_error("render graph usage of " + resources[resource].name + " can not write");
+
+    for (const Access& access : passes[pass].accesses)
+    {
+        if (access.resource == resource)
+            throw runtime_error("render graph pass " + passes[pass].name + " declares " + resources[resource].name + " twice");
+    }
+
+    passes[pass].accesses.push_back({ resource, usage, true });
+    compiled = false;
+}
+
+
+VkImageLayout RenderGraph::getLayout(RenderGraphUsage usage)
+{
+    return usageInfo(usage).layout;
+}
+
+
+void RenderGraph::compile()
+{
+    uint64_t startNs = FrameProfiler::nowNs();
+
+    destroyTransients();
+    stats = RenderGraphStats{};
+
+    cullPasses();
+    computeLifetimes();
+    createTransients();
+    placeTransients();
+    buildBarriers();
+
+    stats.passCount = static_cast<uint32_t>(passes.size());
+    stats.compileMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+    compiled = true;
+}
+
+
+void RenderGraph::execute(VkCommandBuffer pCommandBuffer)
+{
+    if (!compiled)
+        throw runtime_error("render graph executed before compile");
+
+    for (const Pass& pass : passes)
+    {
+        if (!pass.live)
+            continue;
+
+        recordBarriers(pCommandBuffer, pass.before);
+        pass.execute(pCommandBuffer);
+    }
+
+    recordBarriers(pCommandBuffer, after);
+}
+
+
+// walks the passes backwards from what leaves the graph (imported resources, side effects)
+// a pass is kept when a kept pass later uses anything it writes
+void RenderGraph::cullPasses()
+{
+    vector<bool> needed(resources.size(), false);
+
+    for (size_t p = passes.size(); p-- > 0;)
+    {
+        Pass& pass = passes[p];
+        pass.live = pass.sideEffect;
+
+        for (const Access& access : pass.accesses)
+        {
+            if (access.write && (resources[access.resource].imported || needed[access.resource]))
+                pass.live = true;
+        }
+
+        if (!pass.live)
+        {
+            ++stats.culledPassCount;
+            continue;
+        }
+
+        // writes too - the pass may only update part of the resource, so earlier writers stay
+        for (const Access& access : pass.accesses)
+            needed[access.resource] = true;
+    }
+}
+
+
+void RenderGraph::computeLifetimes()
+{
+    for (Resource& resource : resources)
+    {
+        resource.firstPass = UINT32_MAX;
+        resource.lastPass = 0;
+        resource.allStages = 0;
+        resource.allWrites = 0;
+        resource.imageUsage = 0;
+        resource.bufferUsage = 0;
+        resource.block = 0;
+        resource.offset = 0;
+    }
+
+    for (uint32_t p = 0; p < passes.size(); ++p)
+    {
+        if (!passes[p].live)
+            continue;
+
+        for (const Access& access : passes[p].accesses)
+        {
+            Resource& resource = resources[access.resource];
+            const UsageInfo& info = usageInfo(access.usage);
+
+            resource.firstPass = std::min(resource.firstPass, p);
+            resource.lastPass = std::max(resource.lastPass, p);
+
+            resource.allStages |= info.stages;
+            resource.allWrites |= access.write ? info.writeAccess : 0;
+            resource.imageUsage |= info.imageUsage;
+            resource.bufferUsage |= info.bufferUsage;
+        }
+    }
+}
+
+
+void RenderGraph::createTransients()
+{
+    for (Resource& resource : resources)
+    {
+        // unused resources (culled passes only) get no memory at all
+        if (resource.imported || resource.firstPass == UINT32_MAX)
+            continue;
+
+        if (resource.image)
+        {
+            VkImageCreateInfo imageInfo{};
+            imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+            imageInfo.imageType = VK_IMAGE_TYPE_2D;
+            imageInfo.format = resource.desc.format;
+            imageInfo.extent = { resource.desc.extent.width, resource.desc.extent.height, 1 };
+            imageInfo.mipLevels = 1;
+            imageInfo.arrayLayers = 1;
+            imageInfo.samples = resource.desc.samples;
+            imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            imageInfo.usage = resource.imageUsage;
+            imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+            if (vkCreateImage(pDevice, &imageInfo, nullptr, &resource.pImage) != VK_SUCCESS)
+                throw runtime_error("failed to create render graph image " + resource.name);
+
+            vkGetImageMemoryRequirements(pDevice, resource.pImage, &resource.memReqs);
+        }
+        else
+        {
+            VkBufferCreateInfo bufferInfo{};
+            bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+            bufferInfo.size = resource.bufferSize;
+            bufferInfo.usage = resource.bufferUsage;
+            bufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+            if (vkCreateBuffer(pDevice, &bufferInfo, nullptr, &resource.pBuffer) != VK_SUCCESS)
+                throw runtime_error("failed to create render graph buffer " + resource.name);
+
+            vkGetBufferMemoryRequirements(pDevice, resource.pBuffer, &resource.memReqs);
+        }
+
+        ++stats.transientCount;
+        stats.unaliasedBytes += resource.memReqs.size;
+    }
+}
+
+
+// greedy placement, largest first: each resource goes to the lowest offset that does not
+// overlap a resource already placed in the same block whose lifetime overlaps its own
+void RenderGraph::placeTransients()
+{
+    vector<uint32_t> order;
+    for (uint32_t r = 0; r < resources.size(); ++r)
+    {
+        if (!resources[r].imported && resources[r].firstPass != UINT32_MAX)
+            order.push_back(r);
+    }
+
+    std::stable_sort(order.begin(), order.end(), [this](uint32_t lhs, uint32_t rhs) { return resources[lhs].memReqs.size > resources[rhs].memReqs.size; });
+
+    vector<uint32_t> placed;
+
+    for (uint32_t r : order)
+    {
+        Resource& resource = resources[r];
+        uint32_t memoryTypeIndex = Utils::findMemoryType(pPhysicalDevice, resource.memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+        auto block = std::find_if(blocks.begin(), blocks.end(), [memoryTypeIndex](const MemoryBlock& b) { return b.memoryTypeIndex == memoryTypeIndex; });
+        if (block == blocks.end())
+        {
+            blocks.push_back({ memoryTypeIndex, 0, nullptr });
+            block = blocks.end() - 1;
+        }
+
+        resource.block = static_cast<uint32_t>(block - blocks.begin());
+
+        VkDeviceSize alignment = std::max(resource.memReqs.alignment, bufferImageGranularity);
+
+        // candidates are the start of the block and the end of every live neighbour
+        vector<uint32_t> neighbours;
+        vector<VkDeviceSize> candidates = { 0 };
+
+        for (uint32_t other : placed)
+        {
+            const Resource& o = resources[other];
+            if (o.block == resource.block && o.firstPass <= resource.lastPass && resource.firstPass <= o.lastPass)
+            {
+                neighbours.push_back(other);
+                candidates.push_back(alignUp(o.offset + o.memReqs.size, alignment));
+            }
+        }
+
+        std::sort(candidates.begin(), candidates.end());
+
+        for (VkDeviceSize offset : candidates)
+        {
+            bool overlaps = std::any_of(neighbours.begin(), neighbours.end(), [&](uint32_t other)
+            {
+                const Resource& o = resources[other];
+                return offset < o.offset + o.memReqs.size && o.offset < offset + resource.memReqs.size;
+            });
+
+            if (!overlaps)
+            {
+                resource.offset = offset;
+                break;
+            }
+        }
+
+        block->size = std::max(block->size, resource.offset + resource.memReqs.size);
+        placed.push_back(r);
+    }
+
+    for (MemoryBlock& block : blocks)
+    {
+        VkMemoryAllocateInfo memAlloc{};
+        memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+        memAlloc.allocationSize = block.size;
+        memAlloc.memoryTypeIndex = block.memoryTypeIndex;
+
+        if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &block.pMemory) != VK_SUCCESS)
+            throw runtime_error("failed to allocate render graph memory");
+
+        stats.transientBytes += block.size;
+    }
+
+    for (uint32_t r : placed)
+    {
+        Resource& resource = resources[r];
+        VkDeviceMemory pMemory = blocks[resource.block].pMemory;
+
+        if (!resource.image)
+        {
+            vkBindBufferMemory(pDevice, resource.pBuffer, pMemory, resource.offset);
+            continue;
+        }
+
+        vkBindImageMemory(pDevice, resource.pImage, pMemory, resource.offset);
+
+        VkImageViewCreateInfo imageViewCreateInfo{};
+        imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+        imageViewCreateInfo.image = resource.pImage;
+        imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+        imageViewCreateInfo.format = resource.desc.format;
+        imageViewCreateInfo.subresourceRange = { resource.desc.aspect, 0, 1, 0, 1 };
+
+        if (vkCreateImageView(pDevice, &imageViewCreateInfo, nullptr, &resource.pImageView) != VK_SUCCESS)
+            throw runtime_error("failed to create render graph image view " + resource.name);
+    }
+}
+
+
+// the minimal barrier set for the live passes in order
+//   write after anything, or a layout change  - wait for earlier writes and reads
+//   read after write                          - only if the write is not yet visible to this stage/access
+//   read after read in the same layout        - nothing
+void RenderGraph::buildBarriers()
+{
+    vector<ResourceState> states(resources.size());
+
+    for (uint32_t r = 0; r < resources.size(); ++r)
+    {
+        const Resource& resource = resources[r];
+        ResourceState& state = states[r];
+
+        if (resource.imported)
+        {
+            // whatever made the image available (e.g. the acquire semaphore) happened at initialStage
+            state.layout = resource.initialLayout;
+            state.writeStages = resource.image ? resource.initialStage : 0;
+            continue;
+        }
+
+        if (resource.firstPass == UINT32_MAX)
+            continue;
+
+        // the memory may last have been used by any resource aliasing it, in this frame or the one before
+        for (const Resource& other : resources)
+        {
+            if (other.imported || other.firstPass == UINT32_MAX || other.block != resource.block)
+                continue;
+
+            if (other.offset < resource.offset + resource.memReqs.size && resource.offset < other.offset + other.memReqs.size)
+            {
+                state.writeStages |= other.allStages;
+                state.writeAccess |= other.allWrites;
+            }
+        }
+    }
+
+    auto addBarrier = [this, &states](BarrierBatch& batch, uint32_t r, VkPipelineStageFlags dstStages, VkAccessFlags dstAccess, VkImageLayout newLayout, bool write)
+    {
+        const Resource& resource = resources[r];
+        ResourceState& state = states[r];
+
+        bool layoutChange = resource.image && newLayout != state.layout;
+        bool visible = (dstStages & ~state.readStages) == 0 && (dstAccess & ~state.readAccess) == 0;
+
+        bool needed = layoutChange
+            || (write && (state.writeStages | state.readStages) != 0)
+            || (!write && state.writeAccess != 0 && !visible);
+
+        if (needed)
+        {
+            VkPipelineStageFlags srcStages = state.writeStages | ((layoutChange || write) ? state.readStages : 0);
+
+            batch.srcStages |= (srcStages != 0) ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+            batch.dstStages |= dstStages;
+            batch.barriers.push_back({ r, state.writeAccess, dstAccess, state.layout, resource.image ? newLayout : VK_IMAGE_LAYOUT_UNDEFINED });
+
+            ++stats.barrierCount;
+        }
+
+        if (write)
+        {
+            state.writeStages = dstStages;
+            state.writeAccess = dstAccess & (VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT | VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_TRANSFER_WRITE_BIT);
+            state.readStages = 0;
+            state.readAccess = 0;
+        }
+        else if (needed)
+        {
+            // earlier readers were waited on by a layout change, later ones only need the write to be visible
+            state.readStages = layoutChange ? dstStages : (state.readStages | dstStages);
+            state.readAccess = layoutChange ? dstAccess : (state.readAccess | dstAccess);
+        }
+        else
+        {
+            state.readStages |= dstStages;
+            state.readAccess |= dstAccess;
+        }
+
+        if (resource.image)
+            state.layout = newLayout;
+    };
+
+    for (Pass& pass : passes)
+    {
+        pass.before = BarrierBatch{};
+
+        if (!pass.live)
+            continue;
+
+        for (const Access& access : pass.accesses)
+        {
+            const UsageInfo& info = usageInfo(access.usage);
+            VkAccessFlags dstAccess = info.readAccess | (access.write ? info.writeAccess : 0);
+
+            addBarrier(pass.before, access.resource, info.stages, dstAccess, info.layout, access.write);
+        }
+    }
+
+    // hand imported images back in the layout their owner expects, e.g. VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+    after = BarrierBatch{};
+
+    for (uint32_t r = 0; r < resources.size(); ++r)
+    {
+        const Resource& resource = resources[r];
+        const ResourceState& state = states[r];
+
+        if (!resource.imported || !resource.image || resource.finalLayout == VK_IMAGE_LAYOUT_UNDEFINED || resource.finalLayout == state.layout)
+            continue;
+
+        VkPipelineStageFlags srcStages = state.writeStages | state.readStages;
+
+        after.srcStages |= (srcStages != 0) ? srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        after.dstStages |= VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
+        after.barriers.push_back({ r, state.writeAccess, 0, state.layout, resource.finalLayout });
+
+        ++stats.barrierCount;
+    }
+}
+
+
+void RenderGraph::recordBarriers(VkCommandBuffer pCommandBuffer, const BarrierBatch& batch)
+{
+    if (batch.barriers.empty())
+        return;
+
+    imageBarriers.clear();
+    bufferBarriers.clear();
+
+    for (const Barrier& barrier : batch.barriers)
+    {
+        const Resource& resource = resources[barrier.resource];
+
+        if (resource.image)
+        {
+            VkImageMemoryBarrier imageBarrier{};
+            imageBarrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+            imageBarrier.srcAccessMask = barrier.srcAccess;
+            imageBarrier.dstAccessMask = barrier.dstAccess;
+            imageBarrier.oldLayout = barrier.oldLayout;
+            imageBarrier.newLayout = barrier.newLayout;
+            imageBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            imageBarrier.image = resource.pImage;
+            imageBarrier.subresourceRange = { resource.desc.aspect, 0, 1, 0, 1 };
+
+            imageBarriers.push_back(imageBarrier);
+        }
+        else
+        {
+            VkBufferMemoryBarrier bufferBarrier{};
+            bufferBarrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+            bufferBarrier.srcAccessMask = barrier.srcAccess;
+            bufferBarrier.dstAccessMask = barrier.dstAccess;
+            bufferBarrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            bufferBarrier.buffer = resource.pBuffer;
+            bufferBarrier.offset = 0;
+            bufferBarrier.size = VK_WHOLE_SIZE;
+
+            bufferBarriers.push_back(bufferBarrier);
+        }
+    }
+
+    vkCmdPipelineBarrier(pCommandBuffer, batch.srcStages, batch.dstStages, 0, 0, nullptr,
+        static_cast<uint32_t>(bufferBarriers.size()), bufferBarriers.data(),
+        static_cast<uint32_t>(imageBarriers.size()), imageBarriers.data());
+}
+
+
+void RenderGraph::destroyTransients()
+{
+    if (pDevice == nullptr)
+        return;
+
+    for (Resource& resource : resources)
+    {
+        if (resource.imported)
+            continue;
+
+        vkDestroyImageView(pDevice, resource.pImageView, nullptr);
+        vkDestroyImage(pDevice, resource.pImage, nullptr);
+        vkDestroyBuffer(pDevice, resource.pBuffer, nullptr);
+
+        resource.pImageView = nullptr;
+        resource.pImage = nullptr;
+        resource.pBuffer = nullptr;
+    }
+
+    for (MemoryBlock& block : blocks)
+        vkFreeMemory(pDevice, block.pMemory, nullptr);
+
+    blocks.clear();
+    compiled = false;
+}
+
+
+void RenderGraph::logStats() const
+{
+    Logging::LogStream out(LogLevel::Info);
+    out << "render graph: " << stats.passCount << " passes (" << stats.culledPassCount << " culled), " << stats.barrierCount << " barriers, "
+        << stats.transientCount << " transient resources in " << (stats.transientBytes >> 10) << " KB ("
+        << (stats.unaliasedBytes >> 10) << " KB without aliasing), compiled in " << stats.compileMs << " ms" << endl;
+}
@@ -0,0 +1,204 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+
+// how a pass touches a resource - decides the stage, access and image layout of the barriers in front of it
+enum class RenderGraphUsage : uint8_t
+{
+    ColorAttachment = 0,
+    DepthAttachment,
+    SampledFragment,
+    SampledCompute,
+    StorageCompute,
+    TransferSrc,
+    TransferDst,
+    IndirectBuffer,
+    VertexBuffer,
+    UniformBuffer,
+    Count
+};
+
+
+struct RenderGraphImageDesc
+{
+    VkFormat format = VK_FORMAT_UNDEFINED;
+    VkExtent2D extent = { 0, 0 };
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+};
+
+
+struct RenderGraphStats
+{
+    uint32_t passCount = 0;
+    uint32_t culledPassCount = 0;
+    uint32_t barrierCount = 0;
+    uint32_t transientCount = 0;
+
+    // memory of the transient resources with aliasing, and what they would take each on their own
+    uint64_t transientBytes = 0;
+    uint64_t unaliasedBytes = 0;
+
+    double compileMs = 0.0;
+};
+
+
+// frame graph over one command buffer
+//   passes declare which resources they read and write, in submission order
+//   compile() culls passes nothing depends on, derives the barriers and layout transitions between passes
+//   and places transient resources with disjoint lifetimes at the same offset of one memory block
+// compile once and execute every frame, imported resources can be swapped (setImportedImage) without compiling again
+class RenderGraph
+{
+public:
+
+    using Execute = std::function<void(VkCommandBuffer)>;
+
+    void create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice);
+    void destroy();
+
+    // drops passes and resources, transient memory included - the GPU must be done with them
+    void reset();
+
+    // resources owned elsewhere (swapchain images, persistent buffers)
+    // the image is in initialLayout after initialStage when the graph starts and is left in finalLayout
+    uint32_t importImage(const std::string& name, VkImage pImage, VkImageView pImageView, const RenderGraphImageDesc& desc,
+        VkImageLayout initialLayout, VkPipelineStageFlags initialStage, VkImageLayout finalLayout);
+    uint32_t importBuffer(const std::string& name, VkBuffer pBuffer, VkDeviceSize size);
+
+    // resources that only live inside the graph, created by compile()
+    uint32_t createImage(const std::string& name, const RenderGraphImageDesc& desc);
+    uint32_t createBuffer(const std::string& name, VkDeviceSize size);
+
+    void setImportedImage(uint32_t resource, VkImage pImage, VkImageView pImageView);
+
+    // passes run in the order they are added
+    uint32_t addPass(const std::string& name, Execute execute);
+    void read(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+    void write(uint32_t pass, uint32_t resource, RenderGraphUsage usage);
+
+    // keeps a pass whose writes nobody reads (e.g. timestamp or readback work)
+    void setSideEffect(uint32_t pass) { passes[pass].sideEffect = true; }
+
+    void compile();
+    void execute(VkCommandBuffer pCommandBuffer);
+
+    VkImage getImage(uint32_t resource) const { return resources[resource].pImage; }
+    VkImageView getImageView(uint32_t resource) const { return resources[resource].pImageView; }
+    VkBuffer getBuffer(uint32_t resource) const { return resources[resource].pBuffer; }
+
+    // the layout the pass sees the image in, e.g. for VkRenderingAttachmentInfo::imageLayout
+    static VkImageLayout getLayout(RenderGraphUsage usage);
+
+    bool isCompiled() const { return compiled; }
+    bool isCulled(uint32_t pass) const { return !passes[pass].live; }
+    const RenderGraphStats& getStats() const { return stats; }
+
+    void logStats() const;
+
+private:
+
+    struct Access
+    {
+        uint32_t resource = 0;
+        RenderGraphUsage usage = RenderGraphUsage::ColorAttachment;
+        bool write = false;
+    };
+
+    struct Barrier
+    {
+        uint32_t resource = 0;
+        VkAccessFlags srcAccess = 0;
+        VkAccessFlags dstAccess = 0;
+        VkImageLayout oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkImageLayout newLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    };
+
+    // all barriers in front of one pass (or behind the last) go into a single vkCmdPipelineBarrier
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        std::vector<Barrier> barriers;
+    };
+
+    struct Pass
+    {
+        std::string name;
+        Execute execute;
+        std::vector<Access> accesses;
+        bool sideEffect = false;
+        bool live = true;
+        BarrierBatch before;
+    };
+
+    struct Resource
+    {
+        std::string name;
+        bool image = true;
+        bool imported = false;
+
+        RenderGraphImageDesc desc;
+        VkImageUsageFlags imageUsage = 0;
+        VkDeviceSize bufferSize = 0;
+        VkBufferUsageFlags bufferUsage = 0;
+
+        VkImage pImage = nullptr;
+        VkImageView pImageView = nullptr;
+        VkBuffer pBuffer = nullptr;
+
+        // imported only
+        VkImageLayout initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        VkPipelineStageFlags initialStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // live passes using it, UINT32_MAX when unused
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+
+        // transient placement
+        VkMemoryRequirements memReqs{};
+        uint32_t block = 0;
+        VkDeviceSize offset = 0;
+
+        // every stage/write access it is used with, what an aliasing successor has to wait for
+        VkPipelineStageFlags allStages = 0;
+        VkAccessFlags allWrites = 0;
+    };
+
+    struct MemoryBlock
+    {
+        uint32_t memoryTypeIndex = 0;
+        VkDeviceSize size = 0;
+        VkDeviceMemory pMemory = nullptr;
+    };
+
+    void cullPasses();
+    void computeLifetimes();
+    void createTransients();
+    void placeTransients();
+    void buildBarriers();
+    void recordBarriers(VkCommandBuffer pCommandBuffer, const BarrierBatch& batch);
+    void destroyTransients();
+
+    VkPhysicalDevice pPhysicalDevice = nullptr;
+    VkDevice pDevice = nullptr;
+    VkDeviceSize bufferImageGranularity = 1;
+
+    std::vector<Pass> passes;
+    std::vector<Resource> resources;
+    std::vector<MemoryBlock> blocks;
+    BarrierBatch after;
+
+    // reused by execute()
+    std::vector<VkImageMemoryBarrier> imageBarriers;
+    std::vector<VkBufferMemoryBarrier> bufferBarriers;
+
+    bool compiled = false;
+    RenderGraphStats stats;
+};
@@ -0,0 +1,182 @@
+#include "ShaderObjects.h"
+
+#include <stdexcept>
+
+using std::vector;
+using std::runtime_error;
+
+
+void ShaderObjectState::setVertexInput(const VkVertexInputBindingDescription& binding, const VkVertexInputAttributeDescription* pAttributes, uint32_t attributeCount)
+{
+    VkVertexInputBindingDescription2EXT binding2{};
+    binding2.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_BINDING_DESCRIPTION_2_EXT;
+    binding2.binding = binding.binding;
+    binding2.stride = binding.stride;
+    binding2.inputRate = binding.inputRate;
+    binding2.divisor = 1;
+
+    vertexBindings = { binding2 };
+    vertexAttributes.clear();
+
+    for (uint32_t i = 0; i < attributeCount; ++i)
+    {
+        VkVertexInputAttributeDescription2EXT attribute2{};
+        attribute2.sType = VK_STRUCTURE_TYPE_VERTEX_INPUT_ATTRIBUTE_DESCRIPTION_2_EXT;
+        attribute2.location = pAttributes[i].location;
+        attribute2.binding = pAttributes[i].binding;
+        attribute2.format = pAttributes[i].format;
+        attribute2.offset = pAttributes[i].offset;
+
+        vertexAttributes.push_back(attribute2);
+    }
+}
+
+
+template<typename PFN>
+static PFN loadDeviceFunction(VkDevice pDevice, const char* pName)
+{
+    PFN pfn = reinterpret_cast<PFN>(vkGetDeviceProcAddr(pDevice, pName));
+    if (pfn == nullptr)
+        throw runtime_error(std::string("failed to load ") + pName);
+
+    return pfn;
+}
+
+
+void ShaderObjectRenderer::create(VkDevice pDevice)
+{
+    this->pDevice = pDevice;
+
+    pfnCreateShaders = loadDeviceFunction<PFN_vkCreateShadersEXT>(pDevice, "vkCreateShadersEXT");
+    pfnDestroyShader = loadDeviceFunction<PFN_vkDestroyShaderEXT>(pDevice, "vkDestroyShaderEXT");
+    pfnCmdBindShaders = loadDeviceFunction<PFN_vkCmdBindShadersEXT>(pDevice, "vkCmdBindShadersEXT");
+    pfnCmdSetVertexInput = loadDeviceFunction<PFN_vkCmdSetVertexInputEXT>(pDevice, "vkCmdSetVertexInputEXT");
+    pfnCmdSetPolygonMode = loadDeviceFunction<PFN_vkCmdSetPolygonModeEXT>(pDevice, "vkCmdSetPolygonModeEXT");
+    pfnCmdSetRasterizationSamples = loadDeviceFunction<PFN_vkCmdSetRasterizationSamplesEXT>(pDevice, "vkCmdSetRasterizationSamplesEXT");
+    pfnCmdSetSampleMask = loadDeviceFunction<PFN_vkCmdSetSampleMaskEXT>(pDevice, "vkCmdSetSampleMaskEXT");
+    pfnCmdSetAlphaToCoverageEnable = loadDeviceFunction<PFN_vkCmdSetAlphaToCoverageEnableEXT>(pDevice, "vkCmdSetAlphaToCoverageEnableEXT");
+    pfnCmdSetColorBlendEnable = loadDeviceFunction<PFN_vkCmdSetColorBlendEnableEXT>(pDevice, "vkCmdSetColorBlendEnableEXT");
+    pfnCmdSetColorBlendEquation = loadDeviceFunction<PFN_vkCmdSetColorBlendEquationEXT>(pDevice, "vkCmdSetColorBlendEquationEXT");
+    pfnCmdSetColorWriteMask = loadDeviceFunction<PFN_vkCmdSetColorWriteMaskEXT>(pDevice, "vkCmdSetColorWriteMaskEXT");
+}
+
+
+void ShaderObjectRenderer::destroy()
+{
+    for (const Program& program : programs)
+    {
+        pfnDestroyShader(pDevice, program.pVertShader, nullptr);
+        pfnDestroyShader(pDevice, program.pFragShader, nullptr);
+    }
+
+    programs.clear();
+}
+
+
+uint32_t ShaderObjectRenderer::addProgram(const vector<unsigned char>& vertCode, const vector<unsigned char>& fragCode,
+    const vector<VkDescriptorSetLayout>& setLayouts, const VkPushConstantRange& pushConstantRange)
+{
+    VkShaderCreateInfoEXT createInfos[2]{};
+
+    // linked - the driver may optimise across the interface like it would for a pipeline
+    createInfos[0].sType = VK_STRUCTURE_TYPE_SHADER_CREATE_INFO_EXT;
+    createInfos[0].flags = VK_SHADER_CREATE_LINK_STAGE_BIT_EXT;
+    createInfos[0].stage = VK_SHADER_STAGE_VERTEX_BIT;
+    createInfos[0].nextStage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    createInfos[0].codeType = VK_SHADER_CODE_TYPE_SPIRV_EXT;
+    createInfos[0].codeSize = vertCode.size();
+    createInfos[0].pCode = vertCode.data();
+    createInfos[0].pName = "main";
+    createInfos[0].setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+    createInfos[0].pSetLayouts = setLayouts.data();
+    createInfos[0].pushConstantRangeCount = 1;
+    createInfos[0].pPushConstantRanges = &pushConstantRange;
+
+    createInfos[1] = createInfos[0];
+    createInfos[1].stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+    createInfos[1].nextStage = 0;
+    createInfos[1].codeSize = fragCode.size();
+    createInfos[1].pCode = fragCode.data();
+
+    VkShaderEXT shaders[2] = { nullptr, nullptr };
+    if (pfnCreateShaders(pDevice, 2, createInfos, nullptr, shaders) != VK_SUCCESS)
+        throw runtime_error("failed to create shader objects");
+
+    Program program;
+    program.pVertShader = shaders[0];
+    program.pFragShader = shaders[1];
+    programs.push_back(program);
+
+    return static_cast<uint32_t>(programs.size() - 1);
+}
+
+
+void ShaderObjectRenderer::bind(VkCommandBuffer pCommandBuffer, uint32_t program) const
+{
+    if (program >= programs.size())
+        throw runtime_error("unknown shader object program");
+
+    // tessellation and geometry features are not enabled, so those stages are never bound
+    const VkShaderStageFlagBits stages[] = { VK_SHADER_STAGE_VERTEX_BIT, VK_SHADER_STAGE_FRAGMENT_BIT };
+    const VkShaderEXT shaders[] = { programs[program].pVertShader, programs[program].pFragShader };
+
+    pfnCmdBindShaders(pCommandBuffer, 2, stages, shaders);
+}
+
+
+void ShaderObjectRenderer::setState(VkCommandBuffer pCommandBuffer, const ShaderObjectState& state, VkExtent2D extent) const
+{
+    // viewport and scissor - the "with count" variants are the ones shader objects consume
+    VkViewport viewport{};
+    viewport.x = 0.0f;
+    viewport.y = 0.0f;
+    viewport.width = static_cast<float>(extent.width);
+    viewport.height = static_cast<float>(extent.height);
+    viewport.minDepth = 0.0f;
+    viewport.maxDepth = 1.0f;
+    vkCmdSetViewportWithCount(pCommandBuffer, 1, &viewport);
+
+    VkRect2D scissor{};
+    scissor.offset = { 0, 0 };
+    scissor.extent = extent;
+    vkCmdSetScissorWithCount(pCommandBuffer, 1, &scissor);
+
+    // vertex input and input assembly
+    pfnCmdSetVertexInput(pCommandBuffer,
+        static_cast<uint32_t>(state.vertexBindings.size()), state.vertexBindings.data(),
+        static_cast<uint32_t>(state.vertexAttributes.size()), state.vertexAttributes.data());
+
+    vkCmdSetPrimitiveTopology(pCommandBuffer, state.topology);
+    vkCmdSetPrimitiveRestartEnable(pCommandBuffer, VK_FALSE);
+
+    // rasterizer
+    vkCmdSetRasterizerDiscardEnable(pCommandBuffer, VK_FALSE);
+    pfnCmdSetPolygonMode(pCommandBuffer, state.polygonMode);
+    vkCmdSetCullMode(pCommandBuffer, state.cullMode);
+    vkCmdSetFrontFace(pCommandBuffer, state.frontFace);
+    vkCmdSetDepthBiasEnable(pCommandBuffer, VK_FALSE);
+
+    if (state.polygonMode == VK_POLYGON_MODE_LINE || state.topology == VK_PRIMITIVE_TOPOLOGY_LINE_LIST || state.topology == VK_PRIMITIVE_TOPOLOGY_LINE_STRIP)
+        vkCmdSetLineWidth(pCommandBuffer, state.lineWidth);
+
+    // multisampling
+    VkSampleMask sampleMask = ~0u;
+    pfnCmdSetRasterizationSamples(pCommandBuffer, state.samples);
+    pfnCmdSetSampleMask(pCommandBuffer, state.samples, &sampleMask);
+    pfnCmdSetAlphaToCoverageEnable(pCommandBuffer, VK_FALSE);
+
+    // depth and stencil
+    vkCmdSetDepthTestEnable(pCommandBuffer, state.depthTestEnable ? VK_TRUE : VK_FALSE);
+    vkCmdSetDepthWriteEnable(pCommandBuffer, state.depthWriteEnable ? VK_TRUE : VK_FALSE);
+    vkCmdSetDepthBoundsTestEnable(pCommandBuffer, VK_FALSE);
+    vkCmdSetStencilTestEnable(pCommandBuffer, VK_FALSE);
+
+    if (state.depthTestEnable)
+        vkCmdSetDepthCompareOp(pCommandBuffer, state.depthCompareOp);
+
+    // color blending, one attachment
+    VkBool32 blendEnable = state.blendEnable ? VK_TRUE : VK_FALSE;
+    pfnCmdSetColorBlendEnable(pCommandBuffer, 0, 1, &blendEnable);
+    pfnCmdSetColorBlendEquation(pCommandBuffer, 0, 1, &state.blendEquation);
+    pfnCmdSetColorWriteMask(pCommandBuffer, 0, 1, &state.colorWriteMask);
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+
+// everything a graphics pipeline would bake in, set with vkCmdSet* while recording instead
+// defaults match createGraphicsPipeline() - triangle list, back face culling, alpha blending
+struct ShaderObjectState
+{
+    VkPrimitiveTopology topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
+    VkPolygonMode polygonMode = VK_POLYGON_MODE_FILL;
+    VkCullModeFlags cullMode = VK_CULL_MODE_BACK_BIT;
+    VkFrontFace frontFace = VK_FRONT_FACE_CLOCKWISE;
+    float lineWidth = 1.0f;
+
+    VkSampleCountFlagBits samples = VK_SAMPLE_COUNT_1_BIT;
+
+    bool depthTestEnable = false;
+    bool depthWriteEnable = false;
+    VkCompareOp depthCompareOp = VK_COMPARE_OP_LESS;
+
+    bool blendEnable = true;
+    VkColorBlendEquationEXT blendEquation =
+    {
+        VK_BLEND_FACTOR_SRC_ALPHA, VK_BLEND_FACTOR_ONE_MINUS_SRC_ALPHA, VK_BLEND_OP_ADD,
+        VK_BLEND_FACTOR_ONE, VK_BLEND_FACTOR_ZERO, VK_BLEND_OP_ADD
+    };
+    VkColorComponentFlags colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
+
+    std::vector<VkVertexInputBindingDescription2EXT> vertexBindings;
+    std::vector<VkVertexInputAttributeDescription2EXT> vertexAttributes;
+
+    // converts the pipeline style descriptions (Vertex::getBindingDescription/getAttributeDescription)
+    void setVertexInput(const VkVertexInputBindingDescription& binding, const VkVertexInputAttributeDescription* pAttributes, uint32_t attributeCount);
+};
+
+
+// VK_EXT_shader_object renderer - vertex/fragment pairs are created straight from SPIR-V with no pipeline compile
+// programs are linked pairs, indexed in the order they were added
+// works on drivers without the extension through VK_LAYER_KHRONOS_shader_object (see createInstance)
+class ShaderObjectRenderer
+{
+public:
+
+    // loads the extension entry points, the loader does not export them
+    void create(VkDevice pDevice);
+    void destroy();
+
+    // setLayouts and pushConstantRange must match the pipeline layout used to bind descriptors and push constants
+    uint32_t addProgram(const std::vector<unsigned char>& vertCode, const std::vector<unsigned char>& fragCode,
+        const std::vector<VkDescriptorSetLayout>& setLayouts, const VkPushConstantRange& pushConstantRange);
+
+    uint32_t getProgramCount() const { return static_cast<uint32_t>(programs.size()); }
+
+    void bind(VkCommandBuffer pCommandBuffer, uint32_t program) const;
+
+    // all state a draw needs when no pipeline is bound, including viewport and scissor for extent
+    void setState(VkCommandBuffer pCommandBuffer, const ShaderObjectState& state, VkExtent2D extent) const;
+
+private:
+
+    struct Program
+    {
+        VkShaderEXT pVertShader = nullptr;
+        VkShaderEXT pFragShader = nullptr;
+    };
+
+    VkDevice pDevice = nullptr;
+    std::vector<Program> programs;
+
+    PFN_vkCreateShadersEXT pfnCreateShaders = nullptr;
+    PFN_vkDestroyShaderEXT pfnDestroyShader = nullptr;
+    PFN_vkCmdBindShadersEXT pfnCmdBindShaders = nullptr;
+    PFN_vkCmdSetVertexInputEXT pfnCmdSetVertexInput = nullptr;
+    PFN_vkCmdSetPolygonModeEXT pfnCmdSetPolygonMode = nullptr;
+    PFN_vkCmdSetRasterizationSamplesEXT pfnCmdSetRasterizationSamples = nullptr;
+    PFN_vkCmdSetSampleMaskEXT pfnCmdSetSampleMask = nullptr;
+    PFN_vkCmdSetAlphaToCoverageEnableEXT pfnCmdSetAlphaToCoverageEnable = nullptr;
+    PFN_vkCmdSetColorBlendEnableEXT pfnCmdSetColorBlendEnable = nullptr;
+    PFN_vkCmdSetColorBlendEquationEXT pfnCmdSetColorBlendEquation = nullptr;
+    PFN_vkCmdSetColorWriteMaskEXT pfnCmdSetColorWriteMask = nullptr;
+};
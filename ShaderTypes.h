@@ -0,0 +1,119 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <cstdint>
+
+
+// host side copies of shader interface blocks - keep in sync with the GLSL in shaders/
+
+
+// shaders/uniformDraw.vert : layout(set = 0, binding = 0) uniform DrawUniforms (std140)
+struct DrawUniforms
+{
+    alignas(16) glm::mat4 transform;
+    alignas(16) glm::vec4 color;
+};
+
+static_assert(sizeof(DrawUniforms) == 80, "DrawUniforms must match the std140 block");
+
+
+// shaders/pushDraw.vert : layout(push_constant) uniform DrawPushConstants (std430 offsets, same as std140 here)
+struct DrawPushConstants
+{
+    alignas(16) glm::mat4 transform;
+    alignas(16) glm::vec4 color;
+};
+
+// 128 bytes is the smallest maxPushConstantsSize the spec allows
+static_assert(sizeof(DrawPushConstants) <= 128, "DrawPushConstants must fit the guaranteed push constant range");
+
+
+// shaders/bindlessDraw.vert : readonly buffer DrawDataBuffer { BindlessDrawData draws[]; } (std430)
+// padded to 128 bytes so a ring offset aligned to it is a whole element index
+struct BindlessDrawData
+{
+    alignas(16) glm::mat4 transform;
+    alignas(16) glm::vec4 color;
+
+    // x : BindlessTable image index (BindlessTable::InvalidIndex when untextured), yzw : reserved
+    alignas(16) glm::uvec4 resources;
+    alignas(16) glm::vec4 reserved[2];
+};
+
+static_assert(sizeof(BindlessDrawData) == 128, "BindlessDrawData must match the std430 struct");
+
+
+// shaders/bindlessDraw.vert : layout(push_constant) uniform BindlessPushConstants
+struct BindlessPushConstants
+{
+    uint32_t drawBufferIndex;   // BindlessTable buffer index of the draw data
+    uint32_t firstDraw;         // element of this frame's first draw, gl_InstanceIndex is added to it
+};
+
+
+// shaders/pulledDraw.vert : layout(push_constant) uniform PulledPushConstants - buffer references are 8 byte addresses
+struct PulledPushConstants
+{
+    uint64_t vertexAddress;     // first Vertex of the bound mesh, read as floats
+    uint64_t drawAddress;       // BindlessDrawData the draw with firstInstance 0 would read, gl_InstanceIndex is added to it
+    uint32_t vertexStride;      // floats per vertex
+};
+
+static_assert(sizeof(PulledPushConstants) <= 128, "PulledPushConstants must fit the guaranteed push constant range");
+
+
+// shaders/meshlet.task, shaders/meshlet.mesh : readonly buffer MeshletBuffer { MeshletDesc meshlets[]; } (std430)
+struct MeshletDesc
+{
+    // bounding sphere in model space - xyz center, w radius
+    alignas(16) glm::vec4 sphere;
+
+    // normal cone - xyz axis, w cutoff; every triangle faces away from a viewer looking along v when dot(v, axis) >= cutoff
+    // (v from the camera to the apex, or the view direction of an orthographic camera), cutoff > 1 never culls
+    alignas(16) glm::vec4 cone;
+    alignas(16) glm::vec4 apex;
+
+    // into MeshletData::vertices (indices of the mesh's vertices) and MeshletData::triangles (3 bytes per triangle)
+    uint32_t vertexOffset;
+    uint32_t triangleOffset;
+    uint32_t vertexCount;
+    uint32_t triangleCount;
+};
+
+static_assert(sizeof(MeshletDesc) == 64, "MeshletDesc must match the std430 struct");
+
+
+// shaders/meshlet.task, shaders/meshlet.mesh : layout(push_constant) uniform MeshletPushConstants
+struct MeshletPushConstants
+{
+    alignas(16) glm::mat4 transform;
+
+    // camera in model space - xyz position and w 1, or xyz view direction and w 0 for an orthographic transform
+    alignas(16) glm::vec4 camera;
+    alignas(16) glm::vec4 color;
+
+    // the level's range of meshlets (MeshletData::lodOffsets)
+    uint32_t meshletOffset;
+    uint32_t meshletCount;
+};
+
+static_assert(sizeof(MeshletPushConstants) <= 128, "MeshletPushConstants must fit the guaranteed push constant range");
+
+
+// shaders/occlusionCull.comp : layout(push_constant) uniform OcclusionCullPushConstants
+struct OcclusionCullPushConstants
+{
+    uint32_t firstDraw;         // BindlessDrawData element of the first instance
+    uint32_t firstCommand;      // uint index of the first VkDrawIndexedIndirectCommand (5 uints each)
+    uint32_t drawCount;
+    uint32_t statsOffset;       // uint index of the frame's counters - frustum culled, occluded, visible, visible in the second pass
+
+    float radius;               // bounding sphere radius in model space, centered on the origin
+    uint32_t occlusion;         // 0 while the pyramid holds no depth yet - frustum test only
+    uint32_t pyramidLevels;
+    uint32_t late;              // 1 in the second pass - only the instances the first pass found occluded are tested again
+
+    uint32_t firstLateCommand;  // uint index of the second pass's commands, written by the second pass only
+};
+
+static_assert(sizeof(OcclusionCullPushConstants) <= 128, "OcclusionCullPushConstants must fit the guaranteed push constant range");
@@ -0,0 +1,179 @@
+#include "Simulation.h"
+#include "FrameProfiler.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <random>
+
+
+float SimSnapshot::getAlpha(uint64_t nowNs) const
+{
+    if (nowNs <= timeNs || stepNs == 0)
+        return 0.0f;
+
+    return std::min(1.0f, static_cast<float>(static_cast<double>(nowNs - timeNs) / stepNs));
+}
+
+
+glm::mat4 SimSnapshot::getTransform(size_t instance, float alpha) const
+{
+    const SimInstance& from = previous[instance];
+    const SimInstance& to = current[instance];
+
+    glm::vec3 position = glm::mix(from.position, to.position, alpha);
+    float angle = glm::mix(from.angle, to.angle, alpha);
+    float s = scales[instance];
+
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+    transform = glm::rotate(transform, angle, glm::vec3(0.0f, 0.0f, 1.0f));
+    return glm::scale(transform, glm::vec3(s, s, 1.0f));
+}
+
+
+void SnapshotMailbox::publish()
+{
+    // hand the finished slot over and take whatever the consumer is not holding
+    uint32_t previousShared = shared.exchange(writeIndex | FreshBit, std::memory_order_acq_rel);
+    writeIndex = previousShared & IndexMask;
+}
+
+
+const SimSnapshot* SnapshotMailbox::acquire()
+{
+    if (shared.load(std::memory_order_relaxed) & FreshBit)
+    {
+        uint32_t previousShared = shared.exchange(readIndex, std::memory_order_acq_rel);
+        readIndex = previousShared & IndexMask;
+        hasRead = true;
+    }
+
+    return hasRead ? &slots[readIndex] : nullptr;
+}
+
+
+void Simulation::create(uint32_t movingCount, uint64_t stepNs)
+{
+    this->stepNs = stepNs;
+    tick = 0;
+
+    uint32_t count = movingCount + 1;
+    current.assign(count, SimInstance{});
+    velocities.assign(count, glm::vec2(0.0f));
+    spins.assign(count, 0.0f);
+    scales.assign(count, 1.0f);
+    colors.assign(count, glm::vec4(1.0f));
+
+    // same seed every run, like the stress frame
+    std::mt19937 rng(2);
+    std::uniform_real_distribution<float> position(-0.9f, 0.9f);
+    std::uniform_real_distribution<float> depth(0.05f, 0.95f);
+    std::uniform_real_distribution<float> speed(-0.5f, 0.5f);
+    std::uniform_real_distribution<float> spin(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> scale(0.03f, 0.08f);
+    std::uniform_real_distribution<float> channel(0.25f, 1.0f);
+
+    for (uint32_t i = 1; i < count; ++i)
+    {
+        current[i].position = glm::vec3(position(rng), position(rng), depth(rng));
+        velocities[i] = glm::vec2(speed(rng), speed(rng));
+        spins[i] = spin(rng);
+        scales[i] = scale(rng);
+        colors[i] = glm::vec4(channel(rng), channel(rng), channel(rng), 1.0f);
+    }
+
+    previous = current;
+}
+
+
+void Simulation::start(SnapshotMailbox& mailbox)
+{
+    running = true;
+    thread = std::thread(&Simulation::run, this, &mailbox);
+}
+
+
+void Simulation::stop()
+{
+    running = false;
+
+    if (thread.joinable())
+        thread.join();
+}
+
+
+void Simulation::step()
+{
+    previous = current;
+
+    float dt = static_cast<float>(stepNs * 1e-9);
+
+    for (size_t i = 0; i < current.size(); ++i)
+    {
+        SimInstance& instance = current[i];
+        instance.position.x += velocities[i].x * dt;
+        instance.position.y += velocities[i].y * dt;
+        instance.angle += spins[i] * dt;
+
+        // bounce off the edges of clip space
+        for (int axis = 0; axis < 2; ++axis)
+        {
+            if (std::abs(instance.position[axis]) > 1.0f - scales[i])
+            {
+                instance.position[axis] = std::clamp(instance.position[axis], -1.0f + scales[i], 1.0f - scales[i]);
+                velocities[i][axis] = -velocities[i][axis];
+            }
+        }
+    }
+
+    ++tick;
+}
+
+
+void Simulation::writeSnapshot(SimSnapshot& snapshot, uint64_t timeNs) const
+{
+    // the slot's vectors keep their capacity, after the first few steps this never allocates
+    snapshot.tick = tick;
+    snapshot.timeNs = timeNs;
+    snapshot.stepNs = stepNs;
+    snapshot.previous.assign(previous.begin(), previous.end());
+    snapshot.current.assign(current.begin(), current.end());
+    snapshot.scales.assign(scales.begin(), scales.end());
+    snapshot.colors.assign(colors.begin(), colors.end());
+}
+
+
+void Simulation::run(SnapshotMailbox* pMailbox)
+{
+    uint64_t nextNs = FrameProfiler::nowNs() + stepNs;
+
+    while (running)
+    {
+        uint64_t nowNs = FrameProfiler::nowNs();
+        if (nowNs < nextNs)
+        {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(nextNs - nowNs));
+            continue;
+        }
+
+        // run every step that is due, then publish the last one
+        uint32_t steps = 0;
+        uint64_t stepTimeNs = nextNs;
+
+        while (nowNs >= nextNs && steps < MaxCatchUpSteps)
+        {
+            step();
+            stepTimeNs = nextNs;
+            nextNs += stepNs;
+            ++steps;
+        }
+
+        if (nowNs >= nextNs)
+            nextNs = nowNs + stepNs;
+
+        writeSnapshot(pMailbox->beginWrite(), stepTimeNs);
+        pMailbox->publish();
+    }
+}
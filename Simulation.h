@@ -0,0 +1,105 @@
+#pragma once
+#include <glm/glm.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+
+// what the simulation knows about an instance at the end of a step
+struct SimInstance
+{
+    glm::vec3 position = glm::vec3(0.0f);
+    float angle = 0.0f;
+};
+
+
+// one published simulation step - the states at the start and end of the step, so the renderer can
+// interpolate between them, and the per instance data that does not change
+// immutable while the renderer holds it
+struct SimSnapshot
+{
+    uint64_t tick = 0;
+    uint64_t timeNs = 0;    // FrameProfiler::nowNs() time that current belongs to
+    uint64_t stepNs = 0;
+
+    std::vector<SimInstance> previous;
+    std::vector<SimInstance> current;
+    std::vector<float> scales;
+    std::vector<glm::vec4> colors;
+
+    // the renderer runs one step behind the simulation, so both ends are always known
+    float getAlpha(uint64_t nowNs) const;
+    glm::mat4 getTransform(size_t instance, float alpha) const;
+};
+
+
+// triple buffer - the producer always has a slot to write, the consumer always has the newest complete one
+// and the third is handed between them with a single atomic exchange, so neither side locks, waits or copies
+class SnapshotMailbox
+{
+public:
+
+    // producer
+    SimSnapshot& beginWrite() { return slots[writeIndex]; }
+    void publish();
+
+    // consumer - the newest published snapshot, nullptr before the first publish
+    // valid until the next acquire()
+    const SimSnapshot* acquire();
+
+private:
+
+    static constexpr uint32_t IndexMask = 3;
+    static constexpr uint32_t FreshBit = 4;
+
+    std::array<SimSnapshot, 3> slots;
+
+    uint32_t writeIndex = 0;        // producer only
+    uint32_t readIndex = 1;         // consumer only
+    bool hasRead = false;           // consumer only
+
+    std::atomic<uint32_t> shared{ 2 };
+};
+
+
+// bouncing, spinning triangles advanced at a fixed timestep on a thread of its own
+// instance 0 is the original full screen triangle and never moves
+class Simulation
+{
+public:
+
+    void create(uint32_t movingCount, uint64_t stepNs);
+
+    // runs steps on a new thread and publishes a snapshot after each batch of them
+    void start(SnapshotMailbox& mailbox);
+    void stop();
+
+    // one fixed step, public so it can be driven without the thread
+    void step();
+    void writeSnapshot(SimSnapshot& snapshot, uint64_t timeNs) const;
+
+    uint64_t getTick() const { return tick; }
+
+private:
+
+    // steps run at most this far behind before the backlog is dropped (e.g. after a debugger break)
+    static constexpr uint32_t MaxCatchUpSteps = 8;
+
+    void run(SnapshotMailbox* pMailbox);
+
+    uint64_t stepNs = 0;
+    uint64_t tick = 0;
+
+    std::vector<SimInstance> previous;
+    std::vector<SimInstance> current;
+    std::vector<glm::vec2> velocities;
+    std::vector<float> spins;
+    std::vector<float> scales;
+    std::vector<glm::vec4> colors;
+
+    std::thread thread;
+    std::atomic<bool> running{ false };
+};
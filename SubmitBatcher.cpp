@@ -0,0 +1,261 @@
+#include "SubmitBatcher.h"
+#include "Logging.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using std::endl;
+using std::runtime_error;
+
+
+void SubmitBatcher::QueueWork::clear()
+{
+    batches.clear();
+    waits.clear();
+    commandBuffers.clear();
+    signals.clear();
+}
+
+
+void SubmitBatcher::create(VkDevice pDevice, bool synchronization2)
+{
+    this->pDevice = pDevice;
+    this->synchronization2 = synchronization2;
+}
+
+
+void SubmitBatcher::destroy()
+{
+    queues.clear();
+    pDevice = nullptr;
+}
+
+
+SubmitBatcher::QueueWork& SubmitBatcher::getWork(VkQueue pQueue)
+{
+    for (QueueWork& work : queues)
+    {
+        if (work.pQueue == pQueue)
+            return work;
+    }
+
+    queues.emplace_back();
+    queues.back().pQueue = pQueue;
+    return queues.back();
+}
+
+
+void SubmitBatcher::addWait(VkQueue pQueue, VkSemaphore pSemaphore, VkPipelineStageFlags2 stages, uint64_t value)
+{
+    QueueWork& work = getWork(pQueue);
+
+    // a wait only covers the command buffers of its own submit info
+    if (work.empty() || work.batches.back().commandBufferCount > 0 || work.batches.back().signalCount > 0)
+        work.batches.push_back({ static_cast<uint32_t>(work.waits.size()), 0, static_cast<uint32_t>(work.commandBuffers.size()), 0, static_cast<uint32_t>(work.signals.size()), 0 });
+
+    VkSemaphoreSubmitInfo wait{};
+    wait.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    wait.semaphore = pSemaphore;
+    wait.value = value;
+    wait.stageMask = stages;
+
+    work.waits.push_back(wait);
+    ++work.batches.back().waitCount;
+}
+
+
+void SubmitBatcher::addCommandBuffer(VkQueue pQueue, VkCommandBuffer pCommandBuffer)
+{
+    QueueWork& work = getWork(pQueue);
+
+    // a signal covers all command buffers before it in its submit info
+    if (work.empty() || work.batches.back().signalCount > 0)
+        work.batches.push_back({ static_cast<uint32_t>(work.waits.size()), 0, static_cast<uint32_t>(work.commandBuffers.size()), 0, static_cast<uint32_t>(work.signals.size()), 0 });
+
+    VkCommandBufferSubmitInfo commandBuffer{};
+    commandBuffer.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_SUBMIT_INFO;
+    commandBuffer.commandBuffer = pCommandBuffer;
+
+    work.commandBuffers.push_back(commandBuffer);
+    ++work.batches.back().commandBufferCount;
+}
+
+
+void SubmitBatcher::addSignal(VkQueue pQueue, VkSemaphore pSemaphore, VkPipelineStageFlags2 stages, uint64_t value)
+{
+    QueueWork& work = getWork(pQueue);
+
+    if (work.empty())
+        work.batches.push_back({ static_cast<uint32_t>(work.waits.size()), 0, static_cast<uint32_t>(work.commandBuffers.size()), 0, static_cast<uint32_t>(work.signals.size()), 0 });
+
+    VkSemaphoreSubmitInfo signal{};
+    signal.sType = VK_STRUCTURE_TYPE_SEMAPHORE_SUBMIT_INFO;
+    signal.semaphore = pSemaphore;
+    signal.value = value;
+    signal.stageMask = stages;
+
+    work.signals.push_back(signal);
+    ++work.batches.back().signalCount;
+}
+
+
+void SubmitBatcher::submit(VkQueue pQueue, VkFence pFence)
+{
+    QueueWork& work = getWork(pQueue);
+
+    // nothing to do, but the fence still has to signal
+    if (work.empty() && pFence == nullptr)
+        return;
+
+    if (!synchronization2)
+    {
+        submitLegacy(work, pFence);
+    }
+    else
+    {
+        submitInfos.clear();
+
+        for (const Batch& batch : work.batches)
+        {
+            VkSubmitInfo2 submitInfo{};
+            submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO_2;
+            submitInfo.waitSemaphoreInfoCount = batch.waitCount;
+            submitInfo.pWaitSemaphoreInfos = work.waits.data() + batch.firstWait;
+            submitInfo.commandBufferInfoCount = batch.commandBufferCount;
+            submitInfo.pCommandBufferInfos = work.commandBuffers.data() + batch.firstCommandBuffer;
+            submitInfo.signalSemaphoreInfoCount = batch.signalCount;
+            submitInfo.pSignalSemaphoreInfos = work.signals.data() + batch.firstSignal;
+
+            submitInfos.push_back(submitInfo);
+        }
+
+        if (vkQueueSubmit2(pQueue, static_cast<uint32_t>(submitInfos.size()), submitInfos.data(), pFence) != VK_SUCCESS)
+            throw runtime_error("failed to submit command buffers");
+    }
+
+    ++frameSubmitCalls;
+    ++stats.submitCalls;
+    stats.submitInfos += work.batches.size();
+    stats.commandBuffers += work.commandBuffers.size();
+
+    work.clear();
+}
+
+
+void SubmitBatcher::submitAll(VkFence pFence)
+{
+    size_t last = queues.size();
+    for (size_t q = 0; q < queues.size(); ++q)
+    {
+        if (!queues[q].empty())
+            last = q;
+    }
+
+    for (size_t q = 0; q < queues.size(); ++q)
+    {
+        if (!queues[q].empty())
+            submit(queues[q].pQueue, (q == last) ? pFence : nullptr);
+    }
+}
+
+
+void SubmitBatcher::endFrame()
+{
+    ++stats.frameCount;
+    stats.maxSubmitCallsPerFrame = std::max(stats.maxSubmitCallsPerFrame, frameSubmitCalls);
+    frameSubmitCalls = 0;
+}
+
+
+// the same batches as VkSubmitInfo, with a VkTimelineSemaphoreSubmitInfo where a value is set
+void SubmitBatcher::submitLegacy(QueueWork& work, VkFence pFence)
+{
+    legacyInfos.clear();
+    legacyTimelineInfos.clear();
+    legacySemaphores.clear();
+    legacyStages.clear();
+    legacyValues.clear();
+    legacyCommandBuffers.clear();
+
+    // sized up front, the infos point into these
+    legacyTimelineInfos.reserve(work.batches.size());
+    legacySemaphores.reserve(work.waits.size() + work.signals.size());
+    legacyStages.reserve(work.waits.size());
+    legacyValues.reserve(work.waits.size() + work.signals.size());
+    legacyCommandBuffers.reserve(work.commandBuffers.size());
+
+    for (const Batch& batch : work.batches)
+    {
+        VkSubmitInfo submitInfo{};
+        submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+
+        bool timeline = false;
+
+        submitInfo.waitSemaphoreCount = batch.waitCount;
+        submitInfo.pWaitSemaphores = legacySemaphores.data() + legacySemaphores.size();
+        submitInfo.pWaitDstStageMask = legacyStages.data() + legacyStages.size();
+
+        const uint64_t* pWaitValues = legacyValues.data() + legacyValues.size();
+
+        for (uint32_t w = 0; w < batch.waitCount; ++w)
+        {
+            const VkSemaphoreSubmitInfo& wait = work.waits[batch.firstWait + w];
+
+            // the synchronization2 stage bits below bit 32 are the legacy ones
+            legacySemaphores.push_back(wait.semaphore);
+            legacyStages.push_back(static_cast<VkPipelineStageFlags>(wait.stageMask));
+            legacyValues.push_back(wait.value);
+            timeline |= wait.value != 0;
+        }
+
+        submitInfo.commandBufferCount = batch.commandBufferCount;
+        submitInfo.pCommandBuffers = legacyCommandBuffers.data() + legacyCommandBuffers.size();
+
+        for (uint32_t c = 0; c < batch.commandBufferCount; ++c)
+            legacyCommandBuffers.push_back(work.commandBuffers[batch.firstCommandBuffer + c].commandBuffer);
+
+        submitInfo.signalSemaphoreCount = batch.signalCount;
+        submitInfo.pSignalSemaphores = legacySemaphores.data() + legacySemaphores.size();
+
+        const uint64_t* pSignalValues = legacyValues.data() + legacyValues.size();
+
+        for (uint32_t s = 0; s < batch.signalCount; ++s)
+        {
+            const VkSemaphoreSubmitInfo& signal = work.signals[batch.firstSignal + s];
+
+            legacySemaphores.push_back(signal.semaphore);
+            legacyValues.push_back(signal.value);
+            timeline |= signal.value != 0;
+        }
+
+        if (timeline)
+        {
+            VkTimelineSemaphoreSubmitInfo timelineInfo{};
+            timelineInfo.sType = VK_STRUCTURE_TYPE_TIMELINE_SEMAPHORE_SUBMIT_INFO;
+            timelineInfo.waitSemaphoreValueCount = batch.waitCount;
+            timelineInfo.pWaitSemaphoreValues = pWaitValues;
+            timelineInfo.signalSemaphoreValueCount = batch.signalCount;
+            timelineInfo.pSignalSemaphoreValues = pSignalValues;
+
+            legacyTimelineInfos.push_back(timelineInfo);
+            submitInfo.pNext = &legacyTimelineInfos.back();
+        }
+
+        legacyInfos.push_back(submitInfo);
+    }
+
+    if (vkQueueSubmit(work.pQueue, static_cast<uint32_t>(legacyInfos.size()), legacyInfos.data(), pFence) != VK_SUCCESS)
+        throw runtime_error("failed to submit command buffers");
+}
+
+
+void SubmitBatcher::logStats() const
+{
+    if (stats.frameCount == 0)
+        return;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "submits: " << (double)stats.submitCalls / stats.frameCount << " calls per frame (max " << stats.maxSubmitCallsPerFrame << "), "
+        << (double)stats.submitInfos / stats.frameCount << " submit infos, " << (double)stats.commandBuffers / stats.frameCount << " command buffers"
+        << (synchronization2 ? " - vkQueueSubmit2" : " - vkQueueSubmit") << endl;
+}
@@ -0,0 +1,92 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <vector>
+
+
+struct SubmitStats
+{
+    uint64_t frameCount = 0;
+    uint64_t submitCalls = 0;
+    uint64_t submitInfos = 0;
+    uint64_t commandBuffers = 0;
+    uint32_t maxSubmitCallsPerFrame = 0;
+};
+
+
+// collects a frame's command buffers and semaphores per queue and hands each queue's work to the driver
+// in one vkQueueSubmit2 call - consecutive command buffers share a VkSubmitInfo2, a new one only starts
+// where a wait has to come after command buffers or a command buffer after a signal
+// falls back to vkQueueSubmit (same batching) when synchronization2 is not enabled
+class SubmitBatcher
+{
+public:
+
+    void create(VkDevice pDevice, bool synchronization2);
+    void destroy();
+
+    // value is the timeline value, ignored for binary semaphores
+    void addWait(VkQueue pQueue, VkSemaphore pSemaphore, VkPipelineStageFlags2 stages, uint64_t value = 0);
+    void addCommandBuffer(VkQueue pQueue, VkCommandBuffer pCommandBuffer);
+    void addSignal(VkQueue pQueue, VkSemaphore pSemaphore, VkPipelineStageFlags2 stages, uint64_t value = 0);
+
+    // everything collected for pQueue, pFence (may be nullptr) signals when all of it is done
+    void submit(VkQueue pQueue, VkFence pFence);
+
+    // every queue with pending work, pFence is attached to the last submit
+    void submitAll(VkFence pFence);
+
+    // closes the frame's counters
+    void endFrame();
+
+    const SubmitStats& getStats() const { return stats; }
+    void logStats() const;
+
+private:
+
+    struct Batch
+    {
+        uint32_t firstWait = 0;
+        uint32_t waitCount = 0;
+        uint32_t firstCommandBuffer = 0;
+        uint32_t commandBufferCount = 0;
+        uint32_t firstSignal = 0;
+        uint32_t signalCount = 0;
+    };
+
+    struct QueueWork
+    {
+        VkQueue pQueue = nullptr;
+        std::vector<Batch> batches;
+        std::vector<VkSemaphoreSubmitInfo> waits;
+        std::vector<VkCommandBufferSubmitInfo> commandBuffers;
+        std::vector<VkSemaphoreSubmitInfo> signals;
+
+        bool empty() const { return batches.empty(); }
+        void clear();
+    };
+
+    QueueWork& getWork(VkQueue pQueue);
+    void submitLegacy(QueueWork& work, VkFence pFence);
+
+    VkDevice pDevice = nullptr;
+    bool synchronization2 = false;
+
+    // one per queue used, queues are few so a linear search is fine
+    std::vector<QueueWork> queues;
+
+    // reused by submit()
+    std::vector<VkSubmitInfo2> submitInfos;
+
+    // reused by submitLegacy()
+    std::vector<VkSubmitInfo> legacyInfos;
+    std::vector<VkTimelineSemaphoreSubmitInfo> legacyTimelineInfos;
+    std::vector<VkSemaphore> legacySemaphores;
+    std::vector<VkPipelineStageFlags> legacyStages;
+    std::vector<uint64_t> legacyValues;
+    std::vector<VkCommandBuffer> legacyCommandBuffers;
+
+    uint32_t frameSubmitCalls = 0;
+    SubmitStats stats;
+};
@@ -0,0 +1,423 @@
+#include "TransformHierarchy.h"
+#include "JobSystem.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define TRANSFORM_SSE 1
+#include <immintrin.h>
+#endif
+
+using std::runtime_error;
+using std::vector;
+
+
+namespace
+{
+    // the columns of translate(position) * mat4_cast(rotation) * scale(scale), the same terms as the SSE path
+    void composeLocal(float px, float py, float pz, float qx, float qy, float qz, float qw, float sx, float sy, float sz, float* pColumns)
+    {
+        float x2 = qx + qx, y2 = qy + qy, z2 = qz + qz;
+        float xx = qx * x2, yy = qy * y2, zz = qz * z2;
+        float xy = qx * y2, xz = qx * z2, yz = qy * z2;
+        float wx = qw * x2, wy = qw * y2, wz = qw * z2;
+
+        float local[16] =
+        {
+            (1.0f - (yy + zz)) * sx, (xy + wz) * sx, (xz - wy) * sx, 0.0f,
+            (xy - wz) * sy, (1.0f - (xx + zz)) * sy, (yz + wx) * sy, 0.0f,
+            (xz + wy) * sz, (yz - wx) * sz, (1.0f - (xx + yy)) * sz, 0.0f,
+            px, py, pz, 1.0f,
+        };
+
+        memcpy(pColumns, local, sizeof(local));
+    }
+}
+
+
+void TransformHierarchy::create(uint32_t outputCopies)
+{
+    clear();
+    this->outputCopies = std::max(1u, std::min(outputCopies, 255u));
+}
+
+
+void TransformHierarchy::clear()
+{
+    for (vector<float>* pArray : { &positionX, &positionY, &positionZ, &rotationX, &rotationY, &rotationZ, &rotationW, &scaleX, &scaleY, &scaleZ })
+        pArray->clear();
+
+    parentSlot.clear();
+    nodeOfSlot.clear();
+    worlds.clear();
+    localDirty.clear();
+    changed.clear();
+    pendingWrites.clear();
+    slotOfNode.clear();
+    depthOfNode.clear();
+    levelStart.clear();
+
+    sorted = true;
+    stats = {};
+}
+
+
+uint32_t TransformHierarchy::addNode(uint32_t parent, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    uint32_t node = static_cast<uint32_t>(slotOfNode.size());
+
+    if (parent != InvalidNode && parent >= node)
+        throw runtime_error("transform parent does not exist");
+
+    // appended as slot == node, sortByDepth() moves it to its level before the next update
+    positionX.push_back(position.x);
+    positionY.push_back(position.y);
+    positionZ.push_back(position.z);
+    rotationX.push_back(rotation.x);
+    rotationY.push_back(rotation.y);
+    rotationZ.push_back(rotation.z);
+    rotationW.push_back(rotation.w);
+    scaleX.push_back(scale.x);
+    scaleY.push_back(scale.y);
+    scaleZ.push_back(scale.z);
+
+    parentSlot.push_back(parent == InvalidNode ? InvalidNode : slotOfNode[parent]);
+    nodeOfSlot.push_back(node);
+    worlds.emplace_back();
+    localDirty.push_back(1);
+    changed.push_back(0);
+    pendingWrites.push_back(0);
+
+    slotOfNode.push_back(node);
+    depthOfNode.push_back(parent == InvalidNode ? 0 : depthOfNode[parent] + 1);
+
+    sorted = false;
+    return node;
+}
+
+
+void TransformHierarchy::setLocal(uint32_t node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale)
+{
+    uint32_t slot = slotOfNode[node];
+
+    positionX[slot] = position.x;
+    positionY[slot] = position.y;
+    positionZ[slot] = position.z;
+    rotationX[slot] = rotation.x;
+    rotationY[slot] = rotation.y;
+    rotationZ[slot] = rotation.z;
+    rotationW[slot] = rotation.w;
+    scaleX[slot] = scale.x;
+    scaleY[slot] = scale.y;
+    scaleZ[slot] = scale.z;
+
+    localDirty[slot] = 1;
+}
+
+
+void TransformHierarchy::setRotation(uint32_t node, const glm::quat& rotation)
+{
+    uint32_t slot = slotOfNode[node];
+
+    rotationX[slot] = rotation.x;
+    rotationY[slot] = rotation.y;
+    rotationZ[slot] = rotation.z;
+    rotationW[slot] = rotation.w;
+
+    localDirty[slot] = 1;
+}
+
+
+void TransformHierarchy::setSimd(bool enable)
+{
+#ifdef TRANSFORM_SSE
+    simd = enable;
+#else
+    simd = false;
+#endif
+}
+
+
+// counting sort on depth - stable, so siblings keep their creation order and stay next to each other
+void TransformHierarchy::sortByDepth()
+{
+    uint32_t count = getNodeCount();
+
+    uint32_t depthCount = 0;
+    for (uint32_t depth : depthOfNode)
+        depthCount = std::max(depthCount, depth + 1);
+
+    levelStart.assign(depthCount + 1, 0);
+    for (uint32_t depth : depthOfNode)
+        ++levelStart[depth + 1];
+
+    for (uint32_t d = 0; d < depthCount; ++d)
+        levelStart[d + 1] += levelStart[d];
+
+    // new slot of every current slot
+    vector<uint32_t> next(levelStart.begin(), levelStart.end() - 1);
+    vector<uint32_t> newSlot(count);
+    for (uint32_t slot = 0; slot < count; ++slot)
+        newSlot[slot] = next[depthOfNode[nodeOfSlot[slot]]]++;
+
+    auto permute = [&newSlot, count](auto& array)
+    {
+        std::remove_reference_t<decltype(array)> sortedArray(count);
+        for (uint32_t slot = 0; slot < count; ++slot)
+            sortedArray[newSlot[slot]] = array[slot];
+
+        array.swap(sortedArray);
+    };
+
+    permute(positionX);
+    permute(positionY);
+    permute(positionZ);
+    permute(rotationX);
+    permute(rotationY);
+    permute(rotationZ);
+    permute(rotationW);
+    permute(scaleX);
+    permute(scaleY);
+    permute(scaleZ);
+    permute(nodeOfSlot);
+    permute(worlds);
+    permute(pendingWrites);
+
+    vector<uint32_t> sortedParents(count);
+    for (uint32_t slot = 0; slot < count; ++slot)
+        sortedParents[newSlot[slot]] = (parentSlot[slot] == InvalidNode) ? InvalidNode : newSlot[parentSlot[slot]];
+
+    parentSlot.swap(sortedParents);
+
+    for (uint32_t slot = 0; slot < count; ++slot)
+        slotOfNode[nodeOfSlot[slot]] = slot;
+
+    // everything is recomputed and written to every copy once
+    localDirty.assign(count, 1);
+    changed.assign(count, 0);
+
+    sorted = true;
+}
+
+
+void TransformHierarchy::update(JobSystem* pJobSystem, void* pOutput, size_t stride)
+{
+    if (!sorted)
+        sortByDepth();
+
+    recomputed = 0;
+    written = 0;
+
+    char* pBytes = static_cast<char*>(pOutput);
+
+    // one level at a time, the levels below read the worlds of this one
+    for (size_t d = 0; d + 1 < levelStart.size(); ++d)
+    {
+        uint32_t levelBegin = levelStart[d];
+        uint32_t levelCount = levelStart[d + 1] - levelBegin;
+
+        auto updateLevel = [this, levelBegin, pBytes, stride](uint32_t begin, uint32_t end)
+        {
+            updateRange(levelBegin + begin, levelBegin + end, pBytes, stride);
+        };
+
+        // the SSE groups start at each chunk's begin, every lane stays inside its own chunk
+        if (pJobSystem != nullptr)
+            pJobSystem->parallelFor(levelCount, 1024, updateLevel);
+        else
+            updateLevel(0, levelCount);
+    }
+
+    stats.nodeCount = getNodeCount();
+    stats.depthCount = static_cast<uint32_t>(levelStart.empty() ? 0 : levelStart.size() - 1);
+    stats.recomputed = recomputed;
+    stats.written = written;
+}
+
+
+void TransformHierarchy::invalidateOutput()
+{
+    std::fill(pendingWrites.begin(), pendingWrites.end(), static_cast<uint8_t>(outputCopies));
+}
+
+
+void TransformHierarchy::updateRange(uint32_t begin, uint32_t end, char* pOutput, size_t stride)
+{
+    uint32_t rangeRecomputed = 0;
+    uint32_t rangeWritten = 0;
+
+    // a node changes with its local transform or with its parent, whose level is already done
+    for (uint32_t slot = begin; slot < end; ++slot)
+    {
+        uint32_t parent = parentSlot[slot];
+        changed[slot] = localDirty[slot] | ((parent != InvalidNode) ? changed[parent] : uint8_t(0));
+        localDirty[slot] = 0;
+
+        if (changed[slot])
+        {
+            pendingWrites[slot] = static_cast<uint8_t>(outputCopies);
+            ++rangeRecomputed;
+        }
+    }
+
+    uint32_t slot = begin;
+
+#ifdef TRANSFORM_SSE
+    if (simd)
+    {
+        for (; slot + 4 <= end; slot += 4)
+        {
+            if (changed[slot] | changed[slot + 1] | changed[slot + 2] | changed[slot + 3])
+                computeSimd4(slot);
+        }
+    }
+#endif
+
+    for (; slot < end; ++slot)
+    {
+        if (changed[slot])
+            computeScalar(slot);
+    }
+
+    // straight into the instance buffer - every node that is stale in this copy, no staging
+    for (slot = begin; slot < end; ++slot)
+    {
+        if (pendingWrites[slot] == 0)
+            continue;
+
+        --pendingWrites[slot];
+        ++rangeWritten;
+
+        float* pDst = reinterpret_cast<float*>(pOutput + nodeOfSlot[slot] * stride);
+        const float* pSrc = &worlds[slot].value[0][0];
+
+#ifdef TRANSFORM_SSE
+        _mm_storeu_ps(pDst + 0, _mm_load_ps(pSrc + 0));
+        _mm_storeu_ps(pDst + 4, _mm_load_ps(pSrc + 4));
+        _mm_storeu_ps(pDst + 8, _mm_load_ps(pSrc + 8));
+        _mm_storeu_ps(pDst + 12, _mm_load_ps(pSrc + 12));
+#else
+        memcpy(pDst, pSrc, sizeof(glm::mat4));
+#endif
+    }
+
+    recomputed.fetch_add(rangeRecomputed, std::memory_order_relaxed);
+    written.fetch_add(rangeWritten, std::memory_order_relaxed);
+}
+
+
+void TransformHierarchy::computeScalar(uint32_t slot)
+{
+    glm::mat4 local;
+    composeLocal(positionX[slot], positionY[slot], positionZ[slot], rotationX[slot], rotationY[slot], rotationZ[slot], rotationW[slot],
+        scaleX[slot], scaleY[slot], scaleZ[slot], &local[0][0]);
+
+    uint32_t parent = parentSlot[slot];
+    worlds[slot].value = (parent != InvalidNode) ? worlds[parent].value * local : local;
+}
+
+
+#ifdef TRANSFORM_SSE
+
+// the local matrices of 4 neighbouring slots from their SoA components, one lane per slot, then transposed
+// to a column per register and multiplied with each parent's world
+void TransformHierarchy::computeSimd4(uint32_t slot)
+{
+    __m128 qx = _mm_loadu_ps(&rotationX[slot]);
+    __m128 qy = _mm_loadu_ps(&rotationY[slot]);
+    __m128 qz = _mm_loadu_ps(&rotationZ[slot]);
+    __m128 qw = _mm_loadu_ps(&rotationW[slot]);
+    __m128 sx = _mm_loadu_ps(&scaleX[slot]);
+    __m128 sy = _mm_loadu_ps(&scaleY[slot]);
+    __m128 sz = _mm_loadu_ps(&scaleZ[slot]);
+
+    __m128 x2 = _mm_add_ps(qx, qx), y2 = _mm_add_ps(qy, qy), z2 = _mm_add_ps(qz, qz);
+    __m128 xx = _mm_mul_ps(qx, x2), yy = _mm_mul_ps(qy, y2), zz = _mm_mul_ps(qz, z2);
+    __m128 xy = _mm_mul_ps(qx, y2), xz = _mm_mul_ps(qx, z2), yz = _mm_mul_ps(qy, z2);
+    __m128 wx = _mm_mul_ps(qw, x2), wy = _mm_mul_ps(qw, y2), wz = _mm_mul_ps(qw, z2);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 zero = _mm_setzero_ps();
+
+    __m128 c0x = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(yy, zz)), sx);
+    __m128 c0y = _mm_mul_ps(_mm_add_ps(xy, wz), sx);
+    __m128 c0z = _mm_mul_ps(_mm_sub_ps(xz, wy), sx);
+    __m128 c0w = zero;
+
+    __m128 c1x = _mm_mul_ps(_mm_sub_ps(xy, wz), sy);
+    __m128 c1y = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, zz)), sy);
+    __m128 c1z = _mm_mul_ps(_mm_add_ps(yz, wx), sy);
+    __m128 c1w = zero;
+
+    __m128 c2x = _mm_mul_ps(_mm_add_ps(xz, wy), sz);
+    __m128 c2y = _mm_mul_ps(_mm_sub_ps(yz, wx), sz);
+    __m128 c2z = _mm_mul_ps(_mm_sub_ps(one, _mm_add_ps(xx, yy)), sz);
+    __m128 c2w = zero;
+
+    __m128 c3x = _mm_loadu_ps(&positionX[slot]);
+    __m128 c3y = _mm_loadu_ps(&positionY[slot]);
+    __m128 c3z = _mm_loadu_ps(&positionZ[slot]);
+    __m128 c3w = one;
+
+    // afterwards cNx holds column N of the first slot, cNy of the second and so on
+    _MM_TRANSPOSE4_PS(c0x, c0y, c0z, c0w);
+    _MM_TRANSPOSE4_PS(c1x, c1y, c1z, c1w);
+    _MM_TRANSPOSE4_PS(c2x, c2y, c2z, c2w);
+    _MM_TRANSPOSE4_PS(c3x, c3y, c3z, c3w);
+
+    __m128 locals[4][4] =
+    {
+        { c0x, c1x, c2x, c3x },
+        { c0y, c1y, c2y, c3y },
+        { c0z, c1z, c2z, c3z },
+        { c0w, c1w, c2w, c3w },
+    };
+
+    for (uint32_t lane = 0; lane < 4; ++lane)
+    {
+        if (!changed[slot + lane])
+            continue;
+
+        float* pWorld = &worlds[slot + lane].value[0][0];
+        uint32_t parent = parentSlot[slot + lane];
+
+        if (parent == InvalidNode)
+        {
+            for (uint32_t c = 0; c < 4; ++c)
+                _mm_store_ps(pWorld + c * 4, locals[lane][c]);
+
+            continue;
+        }
+
+        // world column c = parent * local column c
+        const float* pParent = &worlds[parent].value[0][0];
+        __m128 p0 = _mm_load_ps(pParent + 0);
+        __m128 p1 = _mm_load_ps(pParent + 4);
+        __m128 p2 = _mm_load_ps(pParent + 8);
+        __m128 p3 = _mm_load_ps(pParent + 12);
+
+        for (uint32_t c = 0; c < 4; ++c)
+        {
+            __m128 l = locals[lane][c];
+            __m128 column = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(p0, _mm_shuffle_ps(l, l, _MM_SHUFFLE(0, 0, 0, 0))), _mm_mul_ps(p1, _mm_shuffle_ps(l, l, _MM_SHUFFLE(1, 1, 1, 1)))),
+                _mm_add_ps(_mm_mul_ps(p2, _mm_shuffle_ps(l, l, _MM_SHUFFLE(2, 2, 2, 2))), _mm_mul_ps(p3, _mm_shuffle_ps(l, l, _MM_SHUFFLE(3, 3, 3, 3)))));
+
+            _mm_store_ps(pWorld + c * 4, column);
+        }
+    }
+}
+
+#else
+
+void TransformHierarchy::computeSimd4(uint32_t slot)
+{
+    for (uint32_t lane = 0; lane < 4; ++lane)
+    {
+        if (changed[slot + lane])
+            computeScalar(slot + lane);
+    }
+}
+
+#endif
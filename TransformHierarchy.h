@@ -0,0 +1,107 @@
+#pragma once
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class JobSystem;
+
+
+struct TransformStats
+{
+    uint32_t nodeCount = 0;
+    uint32_t depthCount = 0;
+
+    // of the last update
+    uint32_t recomputed = 0;
+    uint32_t written = 0;
+};
+
+
+// parents, local translation/rotation/scale and world matrices of a whole scene in flat arrays, one per
+// component, ordered by depth so every parent is finished before the level of its children starts
+// an update only recomputes the nodes whose local transform changed and everything below them, 4 nodes
+// at a time with SSE, and writes the world matrices straight into the caller's (mapped) instance buffer
+// outputCopies is the number of buffers written in turn (frames in flight) - a node that changed is written
+// to each of them once, a node that did not is not written at all
+class TransformHierarchy
+{
+public:
+
+    static constexpr uint32_t InvalidNode = 0xFFFFFFFF;
+
+    void create(uint32_t outputCopies);
+    void clear();
+
+    // parent has to exist already, InvalidNode for a root - returns the node, which is also its instance index in the output
+    uint32_t addNode(uint32_t parent, const glm::vec3& position, const glm::quat& rotation = glm::quat(1.0f, 0.0f, 0.0f, 0.0f), const glm::vec3& scale = glm::vec3(1.0f));
+
+    void setLocal(uint32_t node, const glm::vec3& position, const glm::quat& rotation, const glm::vec3& scale);
+    void setRotation(uint32_t node, const glm::quat& rotation);
+
+    // pOutput + node * stride receives the node's world matrix (64 bytes, column major) when it has to
+    // pOutput must be the copy after the one of the previous update, pJobSystem nullptr - on the calling thread
+    void update(JobSystem* pJobSystem, void* pOutput, size_t stride);
+
+    // every node is written to every copy again, from the next update on - after the copies were replaced or reordered
+    void invalidateOutput();
+
+    const glm::mat4& getWorld(uint32_t node) const { return worlds[slotOfNode[node]].value; }
+    uint32_t getNodeCount() const { return static_cast<uint32_t>(slotOfNode.size()); }
+
+    // the SSE path where the CPU has it, false for the reference scalar path
+    void setSimd(bool enable);
+
+    const TransformStats& getStats() const { return stats; }
+
+private:
+
+    struct alignas(16) WorldMatrix
+    {
+        glm::mat4 value;
+    };
+
+    // sorts the slots by depth after nodes were added, the node ids stay the same
+    void sortByDepth();
+    void updateRange(uint32_t begin, uint32_t end, char* pOutput, size_t stride);
+    void computeScalar(uint32_t slot);
+    void computeSimd4(uint32_t slot);
+
+    uint32_t outputCopies = 1;
+    bool simd = true;
+    bool sorted = true;
+
+    // by slot
+    std::vector<float> positionX;
+    std::vector<float> positionY;
+    std::vector<float> positionZ;
+    std::vector<float> rotationX;
+    std::vector<float> rotationY;
+    std::vector<float> rotationZ;
+    std::vector<float> rotationW;
+    std::vector<float> scaleX;
+    std::vector<float> scaleY;
+    std::vector<float> scaleZ;
+    std::vector<uint32_t> parentSlot;
+    std::vector<uint32_t> nodeOfSlot;
+    std::vector<WorldMatrix> worlds;
+
+    // localDirty - set by setLocal(), changed - recomputed this update, pendingWrites - output copies still stale
+    std::vector<uint8_t> localDirty;
+    std::vector<uint8_t> changed;
+    std::vector<uint8_t> pendingWrites;
+
+    // by node
+    std::vector<uint32_t> slotOfNode;
+    std::vector<uint32_t> depthOfNode;
+
+    // slots [levelStart[d], levelStart[d + 1]) are at depth d
+    std::vector<uint32_t> levelStart;
+
+    std::atomic<uint32_t> recomputed{ 0 };
+    std::atomic<uint32_t> written{ 0 };
+    TransformStats stats;
+};
@@ -0,0 +1,112 @@
+#include "UniformRing.h"
+#include "Utils.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+using std::runtime_error;
+
+
+void UniformRing::create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice, uint32_t frameCount, VkDeviceSize bytesPerFrame, VkBufferUsageFlags usage, VkDeviceSize minAlignment)
+{
+    this->pDevice = pDevice;
+    this->frameCount = frameCount;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(pPhysicalDevice, &deviceProperties);
+
+    // dynamic offsets must be multiples of this (power of two)
+    alignment = (usage & VK_BUFFER_USAGE_STORAGE_BUFFER_BIT)
+        ? std::max(deviceProperties.limits.minUniformBufferOffsetAlignment, deviceProperties.limits.minStorageBufferOffsetAlignment)
+        : deviceProperties.limits.minUniformBufferOffsetAlignment;
+
+    // both are powers of two, so the larger one is a multiple of the smaller
+    alignment = std::max(alignment, minAlignment);
+
+    this->bytesPerFrame = (bytesPerFrame + alignment - 1) & ~(alignment - 1);
+
+    VkBufferCreateInfo buffInfo{};
+    buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffInfo.size = this->bytesPerFrame * frameCount;
+    buffInfo.usage = usage;
+    buffInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(pDevice, &buffInfo, nullptr, &pBuffer) != VK_SUCCESS)
+        throw runtime_error("failed to create uniform ring buffer");
+
+    VkMemoryRequirements memReqs{};
+    vkGetBufferMemoryRequirements(pDevice, pBuffer, &memReqs);
+
+    VkMemoryAllocateInfo memAlloc{};
+    memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = Utils::findMemoryType(pPhysicalDevice, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    // a buffer whose address shaders read needs memory allocated for it
+    VkMemoryAllocateFlagsInfo allocFlags{};
+    allocFlags.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+        memAlloc.pNext = &allocFlags;
+
+    if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &pMemory) != VK_SUCCESS)
+        throw runtime_error("failed to allocate uniform ring memory");
+
+    vkBindBufferMemory(pDevice, pBuffer, pMemory, 0);
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+    {
+        VkBufferDeviceAddressInfo addressInfo{};
+        addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+        addressInfo.buffer = pBuffer;
+        deviceAddress = vkGetBufferDeviceAddress(pDevice, &addressInfo);
+    }
+
+    void* pData = nullptr;
+    if (vkMapMemory(pDevice, pMemory, 0, VK_WHOLE_SIZE, 0, &pData) != VK_SUCCESS)
+        throw runtime_error("failed to map uniform ring memory");
+
+    pMapped = static_cast<char*>(pData);
+
+    beginFrame(0);
+}
+
+
+void UniformRing::destroy()
+{
+    // vkFreeMemory unmaps
+    vkDestroyBuffer(pDevice, pBuffer, nullptr);
+    vkFreeMemory(pDevice, pMemory, nullptr);
+
+    pBuffer = nullptr;
+    pMemory = nullptr;
+    pMapped = nullptr;
+    deviceAddress = 0;
+}
+
+
+void UniformRing::beginFrame(uint32_t frameIndex)
+{
+    frameBegin = bytesPerFrame * (frameIndex % frameCount);
+    frameEnd = frameBegin + bytesPerFrame;
+    head = frameBegin;
+}
+
+
+UniformAllocation UniformRing::allocate(VkDeviceSize size)
+{
+    VkDeviceSize offset = head;
+    VkDeviceSize next = (offset + size + alignment - 1) & ~(alignment - 1);
+
+    if (next > frameEnd)
+        throw runtime_error("uniform ring frame region is full");
+
+    head = next;
+
+    UniformAllocation allocation;
+    allocation.offset = static_cast<uint32_t>(offset);
+    allocation.pData = pMapped + offset;
+
+    return allocation;
+}
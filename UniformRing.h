@@ -0,0 +1,64 @@
+#pragma once
+#include <vulkan/vulkan.h>
+
+#include <cstdint>
+#include <cstring>
+
+
+struct UniformAllocation
+{
+    // dynamic offset for vkCmdBindDescriptorSets
+    uint32_t offset = 0;
+    void* pData = nullptr;
+};
+
+
+// one persistently mapped, host coherent buffer split into a region per frame in flight
+// each frame bump allocates from its own region, so per draw data is a memcpy plus a dynamic offset
+class UniformRing
+{
+public:
+
+    // minAlignment (power of two) raises the device alignment, e.g. to keep offsets a whole number of array elements
+    void create(VkPhysicalDevice pPhysicalDevice, VkDevice pDevice, uint32_t frameCount, VkDeviceSize bytesPerFrame, VkBufferUsageFlags usage = VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VkDeviceSize minAlignment = 0);
+    void destroy();
+
+    // the frame's fence must have been waited on - its region is overwritten from the start
+    void beginFrame(uint32_t frameIndex);
+
+    UniformAllocation allocate(VkDeviceSize size);
+
+    template<typename T>
+    uint32_t push(const T& value)
+    {
+        UniformAllocation allocation = allocate(sizeof(T));
+        memcpy(allocation.pData, &value, sizeof(T));
+        return allocation.offset;
+    }
+
+    VkBuffer getBuffer() const { return pBuffer; }
+
+    // 0 unless usage had VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT, add an allocation's offset to reach its data
+    VkDeviceAddress getDeviceAddress() const { return deviceAddress; }
+    VkDeviceSize getAlignment() const { return alignment; }
+    VkDeviceSize getBytesPerFrame() const { return bytesPerFrame; }
+
+    // bytes handed out in the current frame
+    VkDeviceSize getFrameUsage() const { return head - frameBegin; }
+
+private:
+
+    VkDevice pDevice = nullptr;
+    VkBuffer pBuffer = nullptr;
+    VkDeviceMemory pMemory = nullptr;
+    char* pMapped = nullptr;
+    VkDeviceAddress deviceAddress = 0;
+
+    VkDeviceSize alignment = 256;
+    VkDeviceSize bytesPerFrame = 0;
+    uint32_t frameCount = 0;
+
+    VkDeviceSize frameBegin = 0;
+    VkDeviceSize frameEnd = 0;
+    VkDeviceSize head = 0;
+};
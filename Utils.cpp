@@ -49,3 +49,28 @@ vector<unsigned char> Utils::readFile(const string& filename)
 
     return buffer;
 }
+
+
+std::optional<uint32_t> Utils::tryFindMemoryType(VkPhysicalDevice pPhysicalDevice, uint32_t filter, VkMemoryPropertyFlags propFlags)
+{
+    VkPhysicalDeviceMemoryProperties memProps{};
+    vkGetPhysicalDeviceMemoryProperties(pPhysicalDevice, &memProps);
+
+    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
+    {
+        if (filter & (1 << i) && (memProps.memoryTypes[i].propertyFlags & propFlags) == propFlags)
+            return i;
+    }
+
+    return std::nullopt;
+}
+
+
+uint32_t Utils::findMemoryType(VkPhysicalDevice pPhysicalDevice, uint32_t filter, VkMemoryPropertyFlags propFlags)
+{
+    std::optional<uint32_t> memoryType = tryFindMemoryType(pPhysicalDevice, filter, propFlags);
+    if (!memoryType.has_value())
+        throw std::runtime_error("failed to find suitable memory type");
+
+    return memoryType.value();
+}
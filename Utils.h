@@ -1,6 +1,7 @@
 #pragma once
 #include <vulkan/vulkan.h>
 
+#include <optional>
 #include <string>
 #include <vector>
 
@@ -18,4 +19,10 @@ namespace Utils
 
 
     std::vector<unsigned char> readFile(const std::string& filename);
+
+    // index of the first memory type allowed by filter that has all propFlags
+    uint32_t findMemoryType(VkPhysicalDevice pPhysicalDevice, uint32_t filter, VkMemoryPropertyFlags propFlags);
+
+    // same search, empty instead of throwing - for optional properties like VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT
+    std::optional<uint32_t> tryFindMemoryType(VkPhysicalDevice pPhysicalDevice, uint32_t filter, VkMemoryPropertyFlags propFlags);
 }
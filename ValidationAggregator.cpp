@@ -0,0 +1,197 @@
+#include "ValidationAggregator.h"
+
+#include <algorithm>
+#include <functional>
+#include <string_view>
+
+using std::string;
+using std::string_view;
+using std::vector;
+using std::mutex;
+using std::lock_guard;
+
+
+ValidationAggregator::ValidationAggregator(const ValidationAggregatorConfig& config)
+    : config(config), lastSummary(Clock::now())
+{
+}
+
+
+uint64_t ValidationAggregator::makeKey(int32_t messageId, const char* pIdName, const char* pMessage)
+{
+    // loader and driver messages often come with messageIdNumber 0, fall back to the name/text
+    if (messageId != 0)
+        return static_cast<uint32_t>(messageId);
+
+    string_view text = (pIdName != nullptr && pIdName[0] != '\0') ? pIdName : (pMessage != nullptr ? pMessage : "");
+    return (1ull << 32) | std::hash<string_view>{}(text);
+}
+
+
+bool ValidationAggregator::report(int32_t messageId, const char* pIdName, LogLevel level, const char* pMessage)
+{
+    bool print = false;
+    uint64_t occurrence = 0;
+    Clock::time_point now = Clock::now();
+
+    {
+        lock_guard<mutex> lock(entriesMutex);
+
+        auto [it, inserted] = entries.try_emplace(makeKey(messageId, pIdName, pMessage));
+        Entry& entry = it->second;
+
+        if (inserted)
+        {
+            entry.stats.messageId = messageId;
+            entry.stats.idName = (pIdName != nullptr) ? pIdName : "";
+            entry.tokens = static_cast<double>(config.burst);
+            entry.lastRefill = now;
+        }
+
+        // token bucket - burst tokens up front, refilled at ratePerSecond up to one second's worth
+        double elapsed = std::chrono::duration<double>(now - entry.lastRefill).count();
+        entry.lastRefill = now;
+
+        if (entry.stats.count >= config.burst)
+            entry.tokens = std::min(entry.tokens + elapsed * config.ratePerSecond, std::max(1.0, config.ratePerSecond));
+
+        ++entry.stats.count;
+        entry.stats.maxLevel = std::max(entry.stats.maxLevel, level);
+        ++totalCount;
+
+        if (entry.tokens >= 1.0)
+        {
+            entry.tokens -= 1.0;
+            ++entry.stats.printed;
+            print = true;
+        }
+        else
+        {
+            ++entry.stats.suppressed;
+            ++entry.pendingSuppressed;
+            ++suppressedCount;
+        }
+
+        occurrence = entry.stats.count;
+    }
+
+    if (print)
+    {
+        Logging::LogStream out(level);
+        out << "validation layer: " << pMessage;
+
+        if (occurrence > 1)
+            out << " [seen " << occurrence << "x]";
+
+        out << std::endl;
+    }
+
+    tick();
+
+    return print;
+}
+
+
+void ValidationAggregator::tick()
+{
+    if (config.summaryIntervalSeconds <= 0.0)
+        return;
+
+    Clock::time_point now = Clock::now();
+
+    lock_guard<mutex> lock(entriesMutex);
+
+    if (std::chrono::duration<double>(now - lastSummary).count() >= config.summaryIntervalSeconds)
+        writeSummary(now);
+}
+
+
+void ValidationAggregator::flushSummary()
+{
+    lock_guard<mutex> lock(entriesMutex);
+    writeSummary(Clock::now());
+}
+
+
+// caller holds entriesMutex
+void ValidationAggregator::writeSummary(Clock::time_point now)
+{
+    double seconds = std::chrono::duration<double>(now - lastSummary).count();
+    lastSummary = now;
+
+    for (auto& [key, entry] : entries)
+    {
+        if (entry.pendingSuppressed == 0)
+            continue;
+
+        Logging::LogStream out(entry.stats.maxLevel);
+        out << "validation summary: " << entry.stats.idName
+            << " (0x" << std::hex << static_cast<uint32_t>(entry.stats.messageId) << std::dec << ")"
+            << " suppressed " << entry.pendingSuppressed << " in " << seconds << "s"
+            << ", " << entry.stats.count << " total" << std::endl;
+
+        entry.pendingSuppressed = 0;
+    }
+}
+
+
+vector<ValidationMessageStats> ValidationAggregator::getStats() const
+{
+    vector<ValidationMessageStats> stats;
+
+    {
+        lock_guard<mutex> lock(entriesMutex);
+
+        stats.reserve(entries.size());
+        for (const auto& [key, entry] : entries)
+            stats.push_back(entry.stats);
+    }
+
+    // noisiest first
+    std::sort(stats.begin(), stats.end(), [](const ValidationMessageStats& a, const ValidationMessageStats& b)
+    {
+        return a.count > b.count;
+    });
+
+    return stats;
+}
+
+
+uint64_t ValidationAggregator::getCount(int32_t messageId) const
+{
+    lock_guard<mutex> lock(entriesMutex);
+
+    uint64_t count = 0;
+    for (const auto& [key, entry] : entries)
+    {
+        if (entry.stats.messageId == messageId)
+            count += entry.stats.count;
+    }
+
+    return count;
+}
+
+
+uint64_t ValidationAggregator::getTotalCount() const
+{
+    lock_guard<mutex> lock(entriesMutex);
+    return totalCount;
+}
+
+
+uint64_t ValidationAggregator::getSuppressedCount() const
+{
+    lock_guard<mutex> lock(entriesMutex);
+    return suppressedCount;
+}
+
+
+void ValidationAggregator::reset()
+{
+    lock_guard<mutex> lock(entriesMutex);
+
+    entries.clear();
+    totalCount = 0;
+    suppressedCount = 0;
+    lastSummary = Clock::now();
+}
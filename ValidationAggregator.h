@@ -0,0 +1,89 @@
+#pragma once
+#include "LogBackend.h"
+
+#include <chrono>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+struct ValidationAggregatorConfig
+{
+    // occurrences of an ID that are always printed
+    uint32_t burst = 5;
+
+    // after the burst, at most this many per ID per second (0 = only the burst)
+    double ratePerSecond = 1.0;
+
+    // how often suppressed counts are summarised (0 = only on flushSummary)
+    double summaryIntervalSeconds = 5.0;
+};
+
+
+struct ValidationMessageStats
+{
+    int32_t messageId = 0;
+    std::string idName;
+    LogLevel maxLevel = LogLevel::Trace;
+    uint64_t count = 0;
+    uint64_t printed = 0;
+    uint64_t suppressed = 0;
+};
+
+
+// deduplicates debug utils messages by messageIdNumber, rate limits each ID and periodically
+// prints how many were swallowed - callbacks can arrive from any thread so everything is locked
+class ValidationAggregator
+{
+public:
+
+    explicit ValidationAggregator(const ValidationAggregatorConfig& config = {});
+
+    // counts the message and prints it unless the ID is over its budget
+    // returns true if it was printed
+    bool report(int32_t messageId, const char* pIdName, LogLevel level, const char* pMessage);
+
+    // prints the summary if summaryIntervalSeconds has elapsed - cheap enough to call every frame
+    void tick();
+
+    // prints suppressed counts now
+    void flushSummary();
+
+    std::vector<ValidationMessageStats> getStats() const;
+    uint64_t getCount(int32_t messageId) const;
+    uint64_t getTotalCount() const;
+    uint64_t getSuppressedCount() const;
+
+    void reset();
+
+private:
+
+    using Clock = std::chrono::steady_clock;
+
+    struct Entry
+    {
+        ValidationMessageStats stats;
+
+        double tokens = 0.0;
+        Clock::time_point lastRefill;
+
+        // suppressed since the last summary
+        uint64_t pendingSuppressed = 0;
+    };
+
+    static uint64_t makeKey(int32_t messageId, const char* pIdName, const char* pMessage);
+
+    void writeSummary(Clock::time_point now);
+
+    ValidationAggregatorConfig config;
+
+    mutable std::mutex entriesMutex;
+    std::unordered_map<uint64_t, Entry> entries;
+
+    uint64_t totalCount = 0;
+    uint64_t suppressedCount = 0;
+
+    Clock::time_point lastSummary;
+};
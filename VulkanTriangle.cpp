@@ -1,6 +1,15 @@
 #include "VulkanTriangle.h"
 #include "Vertex.h"
 #include "Utils.h"
+#include "LogBackend.h"
+#include "FrameCapture.h"
+#include "ShaderTypes.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <iterator>
+#include <random>
+#include <thread>
 
 using std::optional;
 using std::string;
@@ -29,27 +38,18 @@ const vector<const char*> validationLayers =
     "VK_LAYER_KHRONOS_validation"
 };
 
-//#define USE_SHADER_OBJ
-
+// emulates VK_EXT_shader_object on drivers that lack it, enabled with --shader-objects when installed
 // https://github.com/KhronosGroup/Vulkan-ValidationLayers/pull/5570
-#ifdef USE_SHADER_OBJ
-const char* VK_EXT_SHADER_OBJ = "VK_EXT_shader_object";
-const char* VK_EXT_EXTENDED_DYNAMIC_STATE = "VK_EXT_extended_dynamic_state";
-const char* VK_EXT_EXTENDED_DYNAMIC_STATE2 = "VK_EXT_extended_dynamic_state2";
-const char* VK_EXT_EXTENDED_DYNAMIC_STATE3 = "VK_EXT_extended_dynamic_state3";
-const char* VK_EXT_VERTEX_INPUT_DYNAMIC_STATE = "VK_EXT_vertex_input_dynamic_state";
-#endif
+const char* shaderObjectLayer = "VK_LAYER_KHRONOS_shader_object";
+
+// PipelineDesc::layoutId
+const uint32_t DrawLayoutId = 0;
+const uint32_t BindlessLayoutId = 1;
+const uint32_t MeshletLayoutId = 2;
 
 const vector<const char*> deviceExtensions =
 {
     VK_KHR_SWAPCHAIN_EXTENSION_NAME
-#if defined WIN32 && defined USE_SHADER_OBJ
-    , VK_EXT_SHADER_OBJ
-    , VK_EXT_EXTENDED_DYNAMIC_STATE
-    , VK_EXT_EXTENDED_DYNAMIC_STATE2
-    , VK_EXT_EXTENDED_DYNAMIC_STATE3
-    , VK_EXT_VERTEX_INPUT_DYNAMIC_STATE
-#endif
 };
 
 
@@ -63,11 +63,38 @@ const std::vector<Vertex> vertices =
 };
 
 
+VulkanTriangleApp::VulkanTriangleApp(const AppOptions& options)
+    : options(options)
+{
+}
+
+
 void VulkanTriangleApp::run()
 {
     initWindow();
     initVulkan();
-    mainLoop();
+
+    if (options.benchPipelineVariants)
+        benchmarkPipelineVariants();
+    else if (options.benchOverdrawCount > 0)
+        benchmarkOverdraw();
+    else if (options.benchRenderGraph)
+        benchmarkRenderGraph();
+    else if (options.benchJobs)
+        benchmarkJobSystem();
+    else if (options.benchCullCount > 0)
+        benchmarkCulling();
+    else if (options.benchTransformCount > 0)
+        benchmarkTransforms();
+    else if (options.benchResizeCount > 0)
+        benchmarkResize();
+    else if (options.benchDrawCount > 0)
+        benchmarkDrawData();
+    else if (isHeadless())
+        replayLoop();
+    else
+        mainLoop();
+
     cleanUp();
 }
 
@@ -77,14 +104,25 @@ void VulkanTriangleApp::initWindow()
     glfwInit();
     glfwWindowHint(GLFW_CLIENT_API, GLFW_NO_API);
 
+    // replay never presents, the window only exists to pick a device and surface format
+    if (isHeadless())
+        glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+
     pWindow = glfwCreateWindow(WIDTH, HEIGHT, "Vulkan", nullptr, nullptr);
     glfwSetWindowUserPointer(pWindow, this);
     glfwSetFramebufferSizeCallback(pWindow, framebufferResizeCallback);
+
+    // later sizes arrive through windowEvents
+    int width = 0, height = 0;
+    glfwGetFramebufferSize(pWindow, &width, &height);
+    framebufferExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
 }
 
 
 void VulkanTriangleApp::initVulkan()
 {
+    jobSystem.create(options.jobWorkers);
+
     createInstance();
     setupDebugMessenger();
     createSurface();
@@ -92,37 +130,159 @@ void VulkanTriangleApp::initVulkan()
     createLogicalDevice();
     createSwapChain();
     createImageViews();
+
+    // per frame resources are sized once, a recreated swap chain may come back with a different image count
+    framesInFlight = static_cast<uint32_t>(swapChainImageViews.size());
+
+    createTransientAttachments();
     createRenderPass();
+    createDescriptorSetLayout();
     createGraphicsPipeline();
     createFramebuffers();
     createCommandPool();
     createVertexBuffer();
+    createUniformBuffers();
+    createDescriptorSets();
     createCommandBuffers();
     createSyncObjects();
+    createQueryPool();
+    createScene();
+    createMesh();
+
+    if (!options.captureFilename.empty())
+        frameRecorder.open(options.captureFilename);
 }
 
 
+// GLFW wants its events handled on the main thread, frames are produced on a render thread of their own
+// so dragging or resizing the window (which blocks the event loop on some platforms) does not stall rendering
+// the simulation runs on a third thread at a fixed step, the render thread interpolates its snapshots
 void VulkanTriangleApp::mainLoop()
 {
+    simulation.create(options.simInstances, 1000000000ull / options.simStepHz);
+    simulation.start(snapshotMailbox);
+
+    std::thread renderThread(&VulkanTriangleApp::renderLoop, this);
+
     while (!glfwWindowShouldClose(pWindow))
-    {
-        glfwPollEvents();
-        drawFrame();
-    }
+        glfwWaitEvents();
+
+    windowEvents.push({ WindowEventType::Close });
+    renderThread.join();
+
+    simulation.stop();
 
     // wait for the logical device to finish operations before exiting
     vkDeviceWaitIdle(pDevice);
+
+    if (renderThreadException)
+        std::rethrow_exception(renderThreadException);
+}
+
+
+void VulkanTriangleApp::renderLoop()
+{
+    try
+    {
+        for (;;)
+        {
+            pollWindowEvents();
+            if (windowClosed)
+                break;
+
+            drawFrame();
+
+            if (enableValidationLayers)
+                validationAggregator.tick();
+        }
+    }
+    catch (...)
+    {
+        // hand the error to the main thread and wake it up
+        renderThreadException = std::current_exception();
+
+        glfwSetWindowShouldClose(pWindow, GLFW_TRUE);
+        glfwPostEmptyEvent();
+    }
+}
+
+
+// drains the window events, returns true if the framebuffer size changed
+bool VulkanTriangleApp::pollWindowEvents()
+{
+    bool resized = windowEvents.popResize(framebufferExtent.width, framebufferExtent.height);
+
+    WindowEvent event;
+    while (windowEvents.pop(event))
+    {
+        switch (event.type)
+        {
+        case WindowEventType::Close:
+            windowClosed = true;
+            break;
+        }
+    }
+
+    swapChainOutOfDate |= resized;
+    return resized;
 }
 
 
 void VulkanTriangleApp::cleanUp()
 {
+    logFrameStats();
+    submitBatcher.logStats();
+
+    if (frameRecorder.isOpen())
+    {
+        Logging::LogStream out(LogLevel::Info);
+        out << "captured " << frameRecorder.getFrameCount() << " frames to " << options.captureFilename << endl;
+
+        frameRecorder.close();
+    }
+
+    destroyOffscreenTarget();
+
+    if (!options.frameTraceFilename.empty() && !frameProfiler.writeChromeTrace(options.frameTraceFilename))
+        cerr << "failed to write frame trace " << options.frameTraceFilename << endl;
+
+    if (enableValidationLayers)
+        validationAggregator.flushSummary();
+
     cleanupSwapChain();
 
     vkDestroyBuffer(pDevice, pVertexBuffer, nullptr);
     vkFreeMemory(pDevice, pVertexBufferMemory, nullptr);
 
+    uniformRing.destroy();
+    descriptorAllocator.destroy();
+
+    occlusionCuller.destroy();
+
+    destroyHostBuffer(meshBuffer);
+    destroyHostBuffer(meshletBuffer);
+    destroyHostBuffer(meshletVertexBuffer);
+    destroyHostBuffer(meshletTriangleBuffer);
+
+    if (deviceCaps.HasBindless())
+    {
+        if (instanceBufferIndex != BindlessTable::InvalidIndex)
+            instanceRing.destroy();
+
+        drawDataRing.destroy();
+        bindlessTable.destroy();
+    }
+
+    vkDestroyDescriptorSetLayout(pDevice, pDrawSetLayout, nullptr);
+    vkDestroyDescriptorSetLayout(pDevice, pMeshletSetLayout, nullptr);
+
+    // the device is idle, so whatever still waits resumes right away
+    gpuWaiter.destroy();
+    gpuWaiter.logStats();
+    gpuTasks.clear();
+
     vkDestroySemaphore(pDevice, pAppSemaphore, nullptr);
+    vkDestroySemaphore(pDevice, pFrameTimeline, nullptr);
 
     for (auto pSemaphore : imageAvailableSemaphores)
         vkDestroySemaphore(pDevice, pSemaphore, nullptr);
@@ -135,9 +295,34 @@ void VulkanTriangleApp::cleanUp()
 
     vkDestroyCommandPool(pDevice, pCommandPool, nullptr);
 
-    vkDestroyPipeline(pDevice, pGraphicsPipeline, nullptr);
+    for (VkCommandPool pPool : recordPools)
+        vkDestroyCommandPool(pDevice, pPool, nullptr);
+
+    vkDestroyQueryPool(pDevice, pStatsQueryPool, nullptr);
+
+    renderGraph.destroy();
+    submitBatcher.destroy();
+
+    if (options.shaderObjects)
+        shaderObjects.destroy();
+
+    if (options.pipelineLibrary)
+        pipelineLibrary.destroy();
+
+    if (!options.shaderObjects && !options.pipelineLibrary)
+    {
+        pipelineRegistry.logStats();
+
+        if (!options.pipelineListFilename.empty())
+            pipelineRegistry.save(options.pipelineListFilename);
+
+        pipelineRegistry.destroy();
+    }
+    vkDestroyPipelineLayout(pDevice, pBindlessPipelineLayout, nullptr);
+    vkDestroyPipelineLayout(pDevice, pMeshletPipelineLayout, nullptr);
     vkDestroyPipelineLayout(pDevice, pPipelineLayout, nullptr);
     vkDestroyRenderPass(pDevice, pRenderPass, nullptr);
+    vkDestroyRenderPass(pDevice, pLateRenderPass, nullptr);
 
     vkDestroyDevice(pDevice, nullptr);
 
@@ -149,6 +334,26 @@ void VulkanTriangleApp::cleanUp()
 
     glfwDestroyWindow(pWindow);
     glfwTerminate();
+
+    jobSystem.destroy();
+}
+
+
+static bool isInstanceLayerAvailable(const char* pLayerName)
+{
+    uint32_t layerCount = 0;
+    vkEnumerateInstanceLayerProperties(&layerCount, nullptr);
+
+    vector<VkLayerProperties> availableLayers(layerCount);
+    vkEnumerateInstanceLayerProperties(&layerCount, availableLayers.data());
+
+    for (const auto& layerProperties : availableLayers)
+    {
+        if (strcmp(pLayerName, layerProperties.layerName) == 0)
+            return true;
+    }
+
+    return false;
 }
 
 
@@ -165,18 +370,28 @@ void VulkanTriangleApp::createInstance()
     appInfo.applicationVersion = VK_MAKE_VERSION(1, 0, 0);
     appInfo.pEngineName = "No Engine";
     appInfo.engineVersion = VK_MAKE_VERSION(1, 0, 0);
-    appInfo.apiVersion = VK_API_VERSION_1_0;
+    // 1.2 for descriptor indexing (bindless), 1.3 for dynamic rendering - older devices keep the 1.0 paths
+    appInfo.apiVersion = VK_API_VERSION_1_3;
 
     VkInstanceCreateInfo createInfo{};
     createInfo.sType = VK_STRUCTURE_TYPE_INSTANCE_CREATE_INFO;
     createInfo.pApplicationInfo = &appInfo;
 
+    // validation first so it checks the application's calls, the emulation layer sits below it
+    vector<const char*> layers;
+    if (enableValidationLayers)
+        layers = validationLayers;
+
+    // the layer only intercepts VK_EXT_shader_object when the driver does not expose it
+    if (options.shaderObjects && isInstanceLayerAvailable(shaderObjectLayer))
+        layers.push_back(shaderObjectLayer);
+
+    createInfo.enabledLayerCount = static_cast<uint32_t>(layers.size());
+    createInfo.ppEnabledLayerNames = layers.data();
+
     VkDebugUtilsMessengerCreateInfoEXT debugCreateInfo{};
     if (enableValidationLayers)
     {
-        createInfo.enabledLayerCount = static_cast<uint32_t>(validationLayers.size());
-        createInfo.ppEnabledLayerNames = validationLayers.data();
-
         populateDebugMessengerCreateInfo(debugCreateInfo);
         createInfo.pNext = (VkDebugUtilsMessengerCreateInfoEXT*)&debugCreateInfo;
     }
@@ -226,16 +441,36 @@ void VulkanTriangleApp::pickPhysicalDevice()
     vector<VkPhysicalDevice> devices(deviceCount);
     vkEnumeratePhysicalDevices(pInstance, &deviceCount, devices.data());
 
-    multimap<uint32_t, VkPhysicalDevice> candidates;
-    for (const auto& device : devices)
+    // every device is probed in a job of its own - the queries go to different drivers and do not depend on each other
+    // the jobs log nothing, their reports would interleave line by line; each device's report follows in device order
+    vector<uint32_t> scores(deviceCount, 0);
+    vector<QueueFamilyIndices> deviceQueueIndices(deviceCount);
+    const LogProfile quietProfile = LogProfile::none();
+
+    JobCounter probes;
+    for (uint32_t i = 0; i < deviceCount; ++i)
     {
-        uint32_t score = rateDeviceSuitability(device, logProfile);
-        candidates.insert(std::make_pair(score, device));
+        jobSystem.run(probes, [this, &devices, &scores, &deviceQueueIndices, &quietProfile, i]()
+        {
+            scores[i] = rateDeviceSuitability(devices[i], quietProfile, deviceQueueIndices[i]);
+        });
     }
 
+    jobSystem.wait(probes);
+
+    for (uint32_t i = 0; i < deviceCount; ++i)
+        logDeviceReport(devices[i], logProfile);
+
+    multimap<uint32_t, uint32_t> candidates;
+    for (uint32_t i = 0; i < deviceCount; ++i)
+        candidates.insert(std::make_pair(scores[i], i));
+
     // find the best candidate
     if (candidates.rbegin()->first > 0)
-        pPhysicalDevice = candidates.rbegin()->second;
+    {
+        pPhysicalDevice = devices[candidates.rbegin()->second];
+        queueFamilyIndices = deviceQueueIndices[candidates.rbegin()->second];
+    }
 
     if (pPhysicalDevice == VK_NULL_HANDLE)
         throw runtime_error("failed to find suitable GPU");
@@ -246,9 +481,20 @@ void VulkanTriangleApp::createLogicalDevice()
 {
     LogProfile logProfile;
 
+    queryDeviceCapabilities();
+
     createGraphicsQueue(queueFamilyIndices);
     createComputeQueue(queueFamilyIndices);
     createXferQueue(queueFamilyIndices);
+
+    submitBatcher.create(pDevice, deviceCaps.synchronization2);
+    gpuWaiter.create(pDevice, deviceCaps.timelineSemaphore);
+
+    if (options.shaderObjects)
+        shaderObjects.create(pDevice);
+
+    if (options.renderGraph || options.benchRenderGraph)
+        renderGraph.create(pPhysicalDevice, pDevice);
 }
 
 
@@ -343,8 +589,118 @@ void VulkanTriangleApp::createImageViews()
 }
 
 
+void VulkanTriangleApp::createTransientAttachments()
+{
+    if (depthFormat == VK_FORMAT_UNDEFINED)
+        depthFormat = findDepthFormat();
+
+    // the render graph creates its own, aliased with its other transient resources
+    if (options.renderGraph)
+        return;
+
+    // the occlusion culler reads what the last frame left in it, so it cannot stay in tile memory
+    VkImageUsageFlags depthUsage = VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT | (useOcclusionCulling() ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+    createTransientAttachment(swapChainDepth, depthFormat, depthUsage, VK_IMAGE_ASPECT_DEPTH_BIT, swapChainExtent);
+
+    // resolved into the swapchain image at the end of the subpass
+    if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+        createTransientAttachment(swapChainColor, swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, swapChainExtent);
+}
+
+
+VkFormat VulkanTriangleApp::findDepthFormat()
+{
+    // D32 first, the stencil formats only because some devices lack a depth only format
+    const VkFormat candidates[] = { VK_FORMAT_D32_SFLOAT, VK_FORMAT_D32_SFLOAT_S8_UINT, VK_FORMAT_D24_UNORM_S8_UINT };
+
+    for (VkFormat format : candidates)
+    {
+        VkFormatProperties properties{};
+        vkGetPhysicalDeviceFormatProperties(pPhysicalDevice, format, &properties);
+
+        if (properties.optimalTilingFeatures & VK_FORMAT_FEATURE_DEPTH_STENCIL_ATTACHMENT_BIT)
+            return format;
+    }
+
+    throw runtime_error("failed to find a supported depth format");
+}
+
+
+void VulkanTriangleApp::createTransientAttachment(TransientAttachment& attachment, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkExtent2D extent)
+{
+    // never sampled or stored - VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT lets a tiler keep it in tile memory only
+    // (an attachment that is also sampled is a plain image)
+    bool transient = (usage & ~(VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT)) == 0;
+
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = format;
+    imageInfo.extent = { extent.width, extent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = msaaSamples;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = transient ? (usage | VK_IMAGE_USAGE_TRANSIENT_ATTACHMENT_BIT) : usage;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(pDevice, &imageInfo, nullptr, &attachment.pImage) != VK_SUCCESS)
+        throw runtime_error("failed to create transient attachment image");
+
+    VkMemoryRequirements memReqs{};
+    vkGetImageMemoryRequirements(pDevice, attachment.pImage, &memReqs);
+
+    // lazily allocated memory is only committed if the tiles spill, desktop GPUs do not offer it
+    optional<uint32_t> lazyType;
+    if (transient)
+        lazyType = Utils::tryFindMemoryType(pPhysicalDevice, memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT | VK_MEMORY_PROPERTY_LAZILY_ALLOCATED_BIT);
+
+    VkMemoryAllocateInfo memAlloc{};
+    memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = lazyType ? *lazyType : findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &attachment.pMemory) != VK_SUCCESS)
+        throw runtime_error("failed to allocate transient attachment memory");
+
+    vkBindImageMemory(pDevice, attachment.pImage, attachment.pMemory, 0);
+
+    VkImageViewCreateInfo imageViewCreateInfo{};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = attachment.pImage;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = format;
+    imageViewCreateInfo.subresourceRange.aspectMask = aspect;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(pDevice, &imageViewCreateInfo, nullptr, &attachment.pImageView) != VK_SUCCESS)
+        throw runtime_error("failed to create transient attachment view");
+
+    attachment.extent = extent;
+    attachment.lazilyAllocated = lazyType.has_value();
+}
+
+
+void VulkanTriangleApp::destroyTransientAttachment(TransientAttachment& attachment)
+{
+    vkDestroyImageView(pDevice, attachment.pImageView, nullptr);
+    vkDestroyImage(pDevice, attachment.pImage, nullptr);
+    vkFreeMemory(pDevice, attachment.pMemory, nullptr);
+
+    attachment = TransientAttachment{};
+}
+
+
 void VulkanTriangleApp::createRenderPass()
 {
+    // dynamic rendering describes the attachments when recording, pipelines only need the formats
+    if (options.dynamicRendering)
+        return;
+
     // loadOp and storeOp determine what to do with the data in the attachment before rendering and after rendering
     // loadOp  : VK_ATTACHMENT_LOAD_OP_LOAD       - preserve existing contents of the attachment
     //         : VK_ATTACHMENT_LOAD_OP_CLEAR      - clear to constant
@@ -362,6 +718,8 @@ void VulkanTriangleApp::createRenderPass()
     // 
     // initialLayout : specifies which layout the image will have before the render pass begins
     // finalLayout   : specifies the layout to automatically transition to when the render pass finishes
+    bool multisampled = (msaaSamples != VK_SAMPLE_COUNT_1_BIT);
+
     VkAttachmentDescription colorAttachment{};
     colorAttachment.format = swapChainImageFormat;
     colorAttachment.samples = VK_SAMPLE_COUNT_1_BIT;
@@ -370,7 +728,18 @@ void VulkanTriangleApp::createRenderPass()
     colorAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
     colorAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
     colorAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
-    colorAttachment.finalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    colorAttachment.finalLayout = isHeadless() ? VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+
+    // MSAA - the samples only live for the subpass, the resolve at its end writes the single sample image
+    VkAttachmentDescription resolveAttachment = colorAttachment;
+    resolveAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+
+    if (multisampled)
+    {
+        colorAttachment.samples = msaaSamples;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.finalLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
 
     // attachment - index of attachment
     //            - layout(location = 0) out vec4 outColor
@@ -380,15 +749,35 @@ void VulkanTriangleApp::createRenderPass()
     colorAttachmentRef.attachment = 0;
     colorAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
 
+    // depth is cleared on load and never stored, so a tiler can keep it on chip (see createTransientAttachment)
+    // unless occlusion culling builds its pyramid from it, between the two passes and in the next frame
+    VkAttachmentDescription depthAttachment{};
+    depthAttachment.format = depthFormat;
+    depthAttachment.samples = msaaSamples;
+    depthAttachment.loadOp = VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = useOcclusionCulling() ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+    depthAttachment.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    depthAttachment.finalLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference depthAttachmentRef{};
+    depthAttachmentRef.attachment = 1;
+    depthAttachmentRef.layout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    VkAttachmentReference resolveAttachmentRef{};
+    resolveAttachmentRef.attachment = 2;
+    resolveAttachmentRef.layout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
     // VK_SUBPASS_EXTERNAL - refers to the implicit subpass before or after the render pass depending on
     //                     - srcSubpass 
     VkSubpassDependency dependency{};
     dependency.srcSubpass = VK_SUBPASS_EXTERNAL;
     dependency.dstSubpass = 0;
-    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.srcAccessMask = 0;
-    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT;
-    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    dependency.srcStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT;
+    dependency.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    dependency.dstStageMask = VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT | VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT;
+    dependency.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
 
     // pDepthStencilAttachment - attachment for depthStencil
     // pInputAttachments       - attachments that are read from a shader
@@ -398,11 +787,15 @@ void VulkanTriangleApp::createRenderPass()
     subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
     subpass.colorAttachmentCount = 1;
     subpass.pColorAttachments = &colorAttachmentRef;
+    subpass.pDepthStencilAttachment = &depthAttachmentRef;
+    subpass.pResolveAttachments = multisampled ? &resolveAttachmentRef : nullptr;
+
+    VkAttachmentDescription attachments[] = { colorAttachment, depthAttachment, resolveAttachment };
 
     VkRenderPassCreateInfo renderPassCreateInfo{};
     renderPassCreateInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO;
-    renderPassCreateInfo.attachmentCount = 1;
-    renderPassCreateInfo.pAttachments = &colorAttachment;
+    renderPassCreateInfo.attachmentCount = multisampled ? 3 : 2;
+    renderPassCreateInfo.pAttachments = attachments;
     renderPassCreateInfo.subpassCount = 1;
     renderPassCreateInfo.pSubpasses = &subpass;
     renderPassCreateInfo.dependencyCount = 1;
@@ -410,6 +803,66 @@ void VulkanTriangleApp::createRenderPass()
 
     if (vkCreateRenderPass(pDevice, &renderPassCreateInfo, nullptr, &pRenderPass) != VK_SUCCESS)
         throw runtime_error("failed to create render pass");
+
+    // the second occlusion culling pass draws over the first one - compatible with it, so the framebuffers serve both
+    if (!useOcclusionCulling())
+        return;
+
+    attachments[0].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[0].initialLayout = attachments[0].finalLayout;
+    attachments[1].loadOp = VK_ATTACHMENT_LOAD_OP_LOAD;
+    attachments[1].initialLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+
+    // the first pass's color writes, its depth reached the culler through an explicit barrier
+    dependency.dstAccessMask |= VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT;
+
+    if (vkCreateRenderPass(pDevice, &renderPassCreateInfo, nullptr, &pLateRenderPass) != VK_SUCCESS)
+        throw runtime_error("failed to create late render pass");
+}
+
+
+void VulkanTriangleApp::createDescriptorSetLayout()
+{
+    // binding 0 - per draw uniforms, the offset into the uniform ring is supplied at bind time
+    VkDescriptorSetLayoutBinding drawBinding{};
+    drawBinding.binding = 0;
+    drawBinding.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    drawBinding.descriptorCount = 1;
+    drawBinding.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    drawBinding.pImmutableSamplers = nullptr;
+
+    VkDescriptorSetLayoutCreateInfo layoutInfo{};
+    layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+    layoutInfo.bindingCount = 1;
+    layoutInfo.pBindings = &drawBinding;
+
+    if (vkCreateDescriptorSetLayout(pDevice, &layoutInfo, nullptr, &pDrawSetLayout) != VK_SUCCESS)
+        throw runtime_error("failed to create descriptor set layout");
+
+    // bindless set - every buffer/image the bindless pipeline can reach
+    if (deviceCaps.HasBindless())
+        bindlessTable.create(pPhysicalDevice, pDevice, 1024, 4096);
+
+    // meshlet set - meshlets, meshlet vertices, meshlet triangles and the mesh's vertices (see shaders/meshlet.mesh)
+    if (useMeshShaders())
+    {
+        VkDescriptorSetLayoutBinding meshletBindings[4]{};
+        for (uint32_t b = 0; b < 4; ++b)
+        {
+            meshletBindings[b].binding = b;
+            meshletBindings[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+            meshletBindings[b].descriptorCount = 1;
+            meshletBindings[b].stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT;
+        }
+
+        VkDescriptorSetLayoutCreateInfo meshletLayoutInfo{};
+        meshletLayoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
+        meshletLayoutInfo.bindingCount = 4;
+        meshletLayoutInfo.pBindings = meshletBindings;
+
+        if (vkCreateDescriptorSetLayout(pDevice, &meshletLayoutInfo, nullptr, &pMeshletSetLayout) != VK_SUCCESS)
+            throw runtime_error("failed to create meshlet descriptor set layout");
+    }
 }
 
 
@@ -422,11 +875,20 @@ void VulkanTriangleApp::createGraphicsPipeline()
     const char* newDimVertShaderFilename = "shaders/newDimVert.spv";
     const char* newDimFragShaderFilename = "shaders/newDimFrag.spv";
 
-    auto vertShaderCode = Utils::readFile(newDimVertShaderFilename);
+    const char* uniformDrawVertShaderFilename = "shaders/uniformDrawVert.spv";
+    const char* pushDrawVertShaderFilename = "shaders/pushDrawVert.spv";
+    const char* bindlessDrawVertShaderFilename = "shaders/bindlessDrawVert.spv";
+    const char* pulledDrawVertShaderFilename = "shaders/pulledDrawVert.spv";
+    const char* meshletTaskShaderFilename = "shaders/meshletTask.spv";
+    const char* meshletMeshShaderFilename = "shaders/meshletMesh.spv";
+
+    auto vertShaderCode = Utils::readFile(uniformDrawVertShaderFilename);
+    auto pushVertShaderCode = Utils::readFile(pushDrawVertShaderFilename);
     auto fragShaderCode = Utils::readFile(newDimFragShaderFilename);
 
     // compilation from byteCode to machineCode for execution on the GPU does not happen until it is created in the pipeline
     VkShaderModule vertShaderModule = createShaderModule(vertShaderCode);
+    VkShaderModule pushVertShaderModule = createShaderModule(pushVertShaderCode);
     VkShaderModule fragShaderModule = createShaderModule(fragShaderCode);
 
     // assign shader to specific pipeline stage (VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | ...)
@@ -524,13 +986,21 @@ void VulkanTriangleApp::createGraphicsPipeline()
     VkPipelineMultisampleStateCreateInfo multisampleStateCreateInfo{};
     multisampleStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO;
     multisampleStateCreateInfo.sampleShadingEnable = VK_FALSE;
-    multisampleStateCreateInfo.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    multisampleStateCreateInfo.rasterizationSamples = msaaSamples;
     multisampleStateCreateInfo.minSampleShading = 1.0f;
     multisampleStateCreateInfo.pSampleMask = nullptr;
     multisampleStateCreateInfo.alphaToCoverageEnable = VK_FALSE;
     multisampleStateCreateInfo.alphaToOneEnable = VK_FALSE;
 
     // Depth and Stencil Testing
+    // newDim.frag neither discards nor writes gl_FragDepth, so the test runs before the fragment shader (early-Z)
+    VkPipelineDepthStencilStateCreateInfo depthStencilStateCreateInfo{};
+    depthStencilStateCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO;
+    depthStencilStateCreateInfo.depthTestEnable = VK_TRUE;
+    depthStencilStateCreateInfo.depthWriteEnable = VK_TRUE;
+    depthStencilStateCreateInfo.depthCompareOp = VK_COMPARE_OP_LESS;
+    depthStencilStateCreateInfo.depthBoundsTestEnable = VK_FALSE;
+    depthStencilStateCreateInfo.stencilTestEnable = VK_FALSE;
 
     // Color Blending
     VkPipelineColorBlendAttachmentState colorBlendAttachmentState{};
@@ -548,45 +1018,240 @@ void VulkanTriangleApp::createGraphicsPipeline()
     colorBlendStateCreateInfo.blendConstants[3] = 0.0f;
 
     // PipelineLayout
+    // push constants cover everything the device offers (see Logging::logDeviceLimits), at least 128 bytes
+    // one layout for both pipelines, so switching between them keeps set 0 and the pushed values bound
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(pPhysicalDevice, &deviceProperties);
+    pushConstantsSize = deviceProperties.limits.maxPushConstantsSize;
+
+    VkPushConstantRange pushConstantRange{};
+    pushConstantRange.stageFlags = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    pushConstantRange.offset = 0;
+    pushConstantRange.size = pushConstantsSize;
+
     VkPipelineLayoutCreateInfo pipelineLayoutCreateInfo{};
     pipelineLayoutCreateInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
-    pipelineLayoutCreateInfo.setLayoutCount = 0;
-    pipelineLayoutCreateInfo.pSetLayouts = nullptr;
-    pipelineLayoutCreateInfo.pushConstantRangeCount = 0;
-    pipelineLayoutCreateInfo.pPushConstantRanges = nullptr;
+    pipelineLayoutCreateInfo.setLayoutCount = 1;
+    pipelineLayoutCreateInfo.pSetLayouts = &pDrawSetLayout;
+    pipelineLayoutCreateInfo.pushConstantRangeCount = 1;
+    pipelineLayoutCreateInfo.pPushConstantRanges = &pushConstantRange;
 
     if (vkCreatePipelineLayout(pDevice, &pipelineLayoutCreateInfo, nullptr, &pPipelineLayout) != VK_SUCCESS)
         throw runtime_error("failed to create pipeline layout");
 
-    VkGraphicsPipelineCreateInfo graphicsPipelineCreateInfo{};
-    graphicsPipelineCreateInfo.sType = VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO;
-    graphicsPipelineCreateInfo.stageCount = 2;
-    graphicsPipelineCreateInfo.pStages = shaderStages;
-    graphicsPipelineCreateInfo.pVertexInputState = &vertexInputStateCreateInfo;
-    graphicsPipelineCreateInfo.pInputAssemblyState = &inputAssemblyCreateInfo;
-    graphicsPipelineCreateInfo.pViewportState = &viewportStateCreateInfo;
-    graphicsPipelineCreateInfo.pRasterizationState = &rasterizerStateCreateInfo;
-    graphicsPipelineCreateInfo.pMultisampleState = &multisampleStateCreateInfo;
-    graphicsPipelineCreateInfo.pDepthStencilState = nullptr;
-    graphicsPipelineCreateInfo.pColorBlendState = &colorBlendStateCreateInfo;
-    graphicsPipelineCreateInfo.pDynamicState = &dynamicStateCreateInfo;
-    graphicsPipelineCreateInfo.layout = pPipelineLayout;
-    graphicsPipelineCreateInfo.renderPass = pRenderPass;
-    graphicsPipelineCreateInfo.subpass = 0;
-    graphicsPipelineCreateInfo.basePipelineHandle = VK_NULL_HANDLE;
-    graphicsPipelineCreateInfo.basePipelineIndex = -1;
-
-    if (vkCreateGraphicsPipelines(pDevice, VK_NULL_HANDLE, 1, &graphicsPipelineCreateInfo, nullptr, &pGraphicsPipeline) != VK_SUCCESS)
-        throw runtime_error("failed to create graphics pipeline");
-
-    // cleanup shader modules
+    // bindless layout - set 0 is the bindless table, push constants say where the draw data is
+    VkDescriptorSetLayout pBindlessSetLayout = nullptr;
+
+    if (deviceCaps.HasBindless())
+    {
+        VkPipelineLayoutCreateInfo bindlessLayoutCreateInfo = pipelineLayoutCreateInfo;
+        pBindlessSetLayout = bindlessTable.getLayout();
+        bindlessLayoutCreateInfo.pSetLayouts = &pBindlessSetLayout;
+
+        if (vkCreatePipelineLayout(pDevice, &bindlessLayoutCreateInfo, nullptr, &pBindlessPipelineLayout) != VK_SUCCESS)
+            throw runtime_error("failed to create bindless pipeline layout");
+    }
+
+    // meshlet layout - set 0 is the meshlet set, push constants carry the transform and the culling camera
+    if (useMeshShaders())
+    {
+        VkPushConstantRange meshletPushConstantRange{};
+        meshletPushConstantRange.stageFlags = VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_FRAGMENT_BIT;
+        meshletPushConstantRange.offset = 0;
+        meshletPushConstantRange.size = sizeof(MeshletPushConstants);
+
+        VkPipelineLayoutCreateInfo meshletLayoutCreateInfo = pipelineLayoutCreateInfo;
+        meshletLayoutCreateInfo.pSetLayouts = &pMeshletSetLayout;
+        meshletLayoutCreateInfo.pPushConstantRanges = &meshletPushConstantRange;
+
+        if (vkCreatePipelineLayout(pDevice, &meshletLayoutCreateInfo, nullptr, &pMeshletPipelineLayout) != VK_SUCCESS)
+            throw runtime_error("failed to create meshlet pipeline layout");
+    }
+
+    // shader objects - same shaders and layouts, the fixed function state above is set while recording
+    if (options.shaderObjects)
+    {
+        shaderObjectState.topology = inputAssemblyCreateInfo.topology;
+        shaderObjectState.polygonMode = rasterizerStateCreateInfo.polygonMode;
+        shaderObjectState.cullMode = rasterizerStateCreateInfo.cullMode;
+        shaderObjectState.frontFace = rasterizerStateCreateInfo.frontFace;
+        shaderObjectState.lineWidth = rasterizerStateCreateInfo.lineWidth;
+        shaderObjectState.samples = multisampleStateCreateInfo.rasterizationSamples;
+        shaderObjectState.depthTestEnable = depthStencilStateCreateInfo.depthTestEnable == VK_TRUE;
+        shaderObjectState.depthWriteEnable = depthStencilStateCreateInfo.depthWriteEnable == VK_TRUE;
+        shaderObjectState.depthCompareOp = depthStencilStateCreateInfo.depthCompareOp;
+        shaderObjectState.blendEnable = colorBlendAttachmentState.blendEnable == VK_TRUE;
+        shaderObjectState.blendEquation =
+        {
+            colorBlendAttachmentState.srcColorBlendFactor, colorBlendAttachmentState.dstColorBlendFactor, colorBlendAttachmentState.colorBlendOp,
+            colorBlendAttachmentState.srcAlphaBlendFactor, colorBlendAttachmentState.dstAlphaBlendFactor, colorBlendAttachmentState.alphaBlendOp
+        };
+        shaderObjectState.colorWriteMask = colorBlendAttachmentState.colorWriteMask;
+        shaderObjectState.setVertexInput(vertexInputBindings, vertexInputAttrDescriptions.data(), static_cast<uint32_t>(vertexInputAttrDescriptions.size()));
+
+        // added in DrawPipelineId order
+        shaderObjects.addProgram(vertShaderCode, fragShaderCode, { pDrawSetLayout }, pushConstantRange);
+        shaderObjects.addProgram(pushVertShaderCode, fragShaderCode, { pDrawSetLayout }, pushConstantRange);
+
+        if (deviceCaps.HasBindless())
+            shaderObjects.addProgram(Utils::readFile(bindlessDrawVertShaderFilename), fragShaderCode, { pBindlessSetLayout }, pushConstantRange);
+
+        vkDestroyShaderModule(pDevice, vertShaderModule, nullptr);
+        vkDestroyShaderModule(pDevice, pushVertShaderModule, nullptr);
+        vkDestroyShaderModule(pDevice, fragShaderModule, nullptr);
+        return;
+    }
+
+    // pipeline libraries - the four pipeline parts are compiled here, variants are linked from them on first use (selectPipeline)
+    if (options.pipelineLibrary)
+    {
+        PipelineLibraryState libraryState;
+        libraryState.vertexBindings = { vertexInputBindings };
+        libraryState.vertexAttributes.assign(vertexInputAttrDescriptions.begin(), vertexInputAttrDescriptions.end());
+        libraryState.rasterizationState = rasterizerStateCreateInfo;
+        libraryState.dynamicStates = dynamicStates;
+        libraryState.multisampleState = multisampleStateCreateInfo;
+        libraryState.depthStencilState = depthStencilStateCreateInfo;
+        libraryState.depthFormat = depthFormat;
+        disableAlphaBlending(libraryState.blendAttachments[0]);
+        enableAlphaBlending(libraryState.blendAttachments[1]);
+        libraryState.pRenderPass = options.dynamicRendering ? nullptr : pRenderPass;
+        libraryState.colorFormat = swapChainImageFormat;
+
+        pipelineLibrary.create(pDevice, libraryState);
+
+        // added in DrawPipelineId order
+        pipelineLibrary.addProgram(vertShaderModule, fragShaderModule, pPipelineLayout);
+        pipelineLibrary.addProgram(pushVertShaderModule, fragShaderModule, pPipelineLayout);
+
+        VkShaderModule bindlessVertShaderModule = nullptr;
+        if (deviceCaps.HasBindless())
+        {
+            bindlessVertShaderModule = createShaderModule(Utils::readFile(bindlessDrawVertShaderFilename));
+            pipelineLibrary.addProgram(bindlessVertShaderModule, fragShaderModule, pBindlessPipelineLayout);
+        }
+
+        // the default variant is linked now so the first frame does not pay for it
+        drawVariant.program = static_cast<uint32_t>(options.drawPipeline);
+        drawVariant.topology = inputAssemblyCreateInfo.topology;
+        drawVariant.cullMode = rasterizerStateCreateInfo.cullMode;
+        drawVariant.blendEnable = colorBlendAttachmentState.blendEnable == VK_TRUE;
+        pipelineLibrary.getPipeline(drawVariant);
+
+        vkDestroyShaderModule(pDevice, vertShaderModule, nullptr);
+        vkDestroyShaderModule(pDevice, pushVertShaderModule, nullptr);
+        vkDestroyShaderModule(pDevice, bindlessVertShaderModule, nullptr);
+        vkDestroyShaderModule(pDevice, fragShaderModule, nullptr);
+        return;
+    }
+
+    // monolithic pipelines - one description per DrawPipelineId, created and deduplicated by the registry
+    PipelineDesc desc;
+    desc.setShaders(uniformDrawVertShaderFilename, newDimFragShaderFilename);
+    desc.layoutId = DrawLayoutId;
+    desc.setVertexInput(vertexInputBindings, vertexInputAttrDescriptions.data(), static_cast<uint32_t>(vertexInputAttrDescriptions.size()));
+    desc.topology = inputAssemblyCreateInfo.topology;
+    desc.primitiveRestartEnable = inputAssemblyCreateInfo.primitiveRestartEnable;
+    desc.setRasterization(rasterizerStateCreateInfo);
+    desc.rasterizationSamples = multisampleStateCreateInfo.rasterizationSamples;
+    desc.depthTestEnable = depthStencilStateCreateInfo.depthTestEnable;
+    desc.depthWriteEnable = depthStencilStateCreateInfo.depthWriteEnable;
+    desc.depthCompareOp = depthStencilStateCreateInfo.depthCompareOp;
+    desc.setBlend(colorBlendAttachmentState);
+    desc.setDynamicStates(dynamicStates);
+    desc.colorFormat = swapChainImageFormat;
+    desc.depthFormat = depthFormat;
+    desc.dynamicRendering = options.dynamicRendering ? VK_TRUE : VK_FALSE;
+
+    drawPipelineDescs = { desc, desc };
+    drawPipelineDescs[static_cast<uint32_t>(DrawPipelineId::PushConstants)].setShaders(pushDrawVertShaderFilename, newDimFragShaderFilename);
+
+    if (deviceCaps.HasBindless())
+    {
+        PipelineDesc bindlessDesc = desc;
+        bindlessDesc.setShaders(bindlessDrawVertShaderFilename, newDimFragShaderFilename);
+        bindlessDesc.layoutId = BindlessLayoutId;
+
+        // the shader fetches its own vertices, so the pipeline has no vertex input and any vertex layout draws with it
+        if (useVertexPulling())
+        {
+            bindlessDesc.setShaders(pulledDrawVertShaderFilename, newDimFragShaderFilename);
+            bindlessDesc.setVertexInput(VkVertexInputBindingDescription{}, nullptr, 0);
+        }
+        drawPipelineDescs.push_back(bindlessDesc);
+    }
+
+    pipelineRegistry.create(pDevice);
+    pipelineRegistry.setLayout(DrawLayoutId, pPipelineLayout);
+    pipelineRegistry.setLayout(BindlessLayoutId, pBindlessPipelineLayout);
+    pipelineRegistry.setRenderPass(options.dynamicRendering ? nullptr : pRenderPass);
+    pipelineRegistry.setJobSystem(&jobSystem);
+
+    if (pMeshletPipelineLayout != nullptr)
+        pipelineRegistry.setLayout(MeshletLayoutId, pMeshletPipelineLayout);
+
+    // a list saved by a run in another mode may hold pipelines this one has no features, shaders or render target for
+    // the pulled pipeline also needs bufferDeviceAddress, which only vertex pulling runs enable
+    pipelineRegistry.setListFilter([this, desc, pulledDrawVertShaderFilename](const PipelineDesc& listDesc)
+    {
+        // every pipeline of this run draws into the target desc describes - sample count, formats and render pass or dynamic rendering
+        if (listDesc.rasterizationSamples != desc.rasterizationSamples || listDesc.dynamicRendering != desc.dynamicRendering ||
+            listDesc.colorFormat != desc.colorFormat || listDesc.depthFormat != desc.depthFormat)
+            return false;
+
+        if (listDesc.meshShader[0] != '\0')
+            return useMeshShaders();
+
+        if (strcmp(listDesc.vertShader, pulledDrawVertShaderFilename) == 0)
+            return useVertexPulling();
+
+        return true;
+    });
+
+    // everything a previous run used, before the first frame asks for it
+    if (!options.pipelineListFilename.empty())
+    {
+        uint64_t startNs = FrameProfiler::nowNs();
+        uint32_t prewarmed = pipelineRegistry.prewarm(options.pipelineListFilename);
+
+        Logging::LogStream out(LogLevel::Info);
+        out << "prewarmed " << prewarmed << " pipelines from " << options.pipelineListFilename << " in " << (FrameProfiler::nowNs() - startNs) * 1e-6 << " ms" << endl;
+    }
+
+    // all variants in one vkCreateGraphicsPipelines call, whatever the list did not already create
+    pipelineRegistry.prewarm(drawPipelineDescs);
+
+    // non-owning, the registry destroys them
+    pGraphicsPipeline = pipelineRegistry.get(drawPipelineDescs[static_cast<uint32_t>(DrawPipelineId::UniformRing)]);
+    pPushConstantPipeline = pipelineRegistry.get(drawPipelineDescs[static_cast<uint32_t>(DrawPipelineId::PushConstants)]);
+
+    if (deviceCaps.HasBindless())
+        pBindlessPipeline = pipelineRegistry.get(drawPipelineDescs[static_cast<uint32_t>(DrawPipelineId::Bindless)]);
+
+    // task + mesh + the same fragment shader and fixed function state, no vertex input
+    if (useMeshShaders())
+    {
+        PipelineDesc meshletDesc = desc;
+        meshletDesc.setMeshShaders(meshletTaskShaderFilename, meshletMeshShaderFilename, newDimFragShaderFilename);
+        meshletDesc.setVertexInput(VkVertexInputBindingDescription{}, nullptr, 0);
+        meshletDesc.layoutId = MeshletLayoutId;
+
+        pMeshletPipeline = pipelineRegistry.get(meshletDesc);
+    }
+
+    // cleanup shader modules - the registry keeps its own
     vkDestroyShaderModule(pDevice, vertShaderModule, nullptr);
+    vkDestroyShaderModule(pDevice, pushVertShaderModule, nullptr);
     vkDestroyShaderModule(pDevice, fragShaderModule, nullptr);
 }
 
 
 void VulkanTriangleApp::createFramebuffers()
 {
+    // nothing to rebuild on resize when rendering straight to the image views
+    if (options.dynamicRendering)
+        return;
+
     // create a framebuffer for each imageView in the swapChain
     swapChainFramebuffers.resize(swapChainImageViews.size());
 
@@ -595,16 +1260,16 @@ void VulkanTriangleApp::createFramebuffers()
         // a temporary to allow for colorBuffer, depthBuffer, etc. ?
         // attachmentCount needs to match array size
         // layers stereoscopic rendering?
-        VkImageView attachments[] =
-        {
-            swapChainImageViews[i]
-        };
+        // in createRenderPass() order - with MSAA the swapchain image is the resolve attachment
+        vector<VkImageView> attachments = { swapChainImageViews[i], swapChainDepth.pImageView };
+        if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+            attachments = { swapChainColor.pImageView, swapChainDepth.pImageView, swapChainImageViews[i] };
 
         VkFramebufferCreateInfo framebufferCreateInfo{};
         framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
         framebufferCreateInfo.renderPass = pRenderPass;
-        framebufferCreateInfo.attachmentCount = 1;
-        framebufferCreateInfo.pAttachments = attachments;
+        framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+        framebufferCreateInfo.pAttachments = attachments.data();
         framebufferCreateInfo.width = swapChainExtent.width;
         framebufferCreateInfo.height = swapChainExtent.height;
         framebufferCreateInfo.layers = 1;
@@ -631,18 +1296,18 @@ void VulkanTriangleApp::createCommandPool()
 
 uint32_t VulkanTriangleApp::findMemoryType(uint32_t filter, VkMemoryPropertyFlags propFlags)
 {
-    VkPhysicalDeviceMemoryProperties memProps{};
-    vkGetPhysicalDeviceMemoryProperties(pPhysicalDevice, &memProps);
+    return Utils::findMemoryType(pPhysicalDevice, filter, propFlags);
+}
 
-    for (uint32_t i = 0; i < memProps.memoryTypeCount; ++i)
-    {
-        if (filter & (1 << i) && (memProps.memoryTypes[i].propertyFlags & propFlags ) == propFlags)
-            return i;
-    }
 
-    throw runtime_error("failed to find suitable memory type");
+// the buffer needs VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT and memory allocated with VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT
+VkDeviceAddress VulkanTriangleApp::getBufferAddress(VkBuffer pBuffer) const
+{
+    VkBufferDeviceAddressInfo addressInfo{};
+    addressInfo.sType = VK_STRUCTURE_TYPE_BUFFER_DEVICE_ADDRESS_INFO;
+    addressInfo.buffer = pBuffer;
 
-    return 0;
+    return vkGetBufferDeviceAddress(pDevice, &addressInfo);
 }
 
 
@@ -651,7 +1316,7 @@ void VulkanTriangleApp::createVertexBuffer()
     VkBufferCreateInfo buffInfo{};
     buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
     buffInfo.size = sizeof(Vertex) * vertices.size();
-    buffInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT;
+    buffInfo.usage = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | (useVertexPulling() ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0);
     buffInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
     buffInfo.flags = 0;
 
@@ -666,44 +1331,147 @@ void VulkanTriangleApp::createVertexBuffer()
     memAlloc.allocationSize = memReqs.size;
     memAlloc.memoryTypeIndex = findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
 
+    VkMemoryAllocateFlagsInfo allocFlags{};
+    allocFlags.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    if (useVertexPulling())
+        memAlloc.pNext = &allocFlags;
+
     if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &pVertexBufferMemory) != VK_SUCCESS)
         throw runtime_error("failed to alloate vertex buffer memory");
 
     vkBindBufferMemory(pDevice, pVertexBuffer, pVertexBufferMemory, 0);
 
-    void* pData = nullptr;
-    vkMapMemory(pDevice, pVertexBufferMemory, 0, buffInfo.size, 0, &pData);
-    memcpy(pData, vertices.data(), (size_t)buffInfo.size);
-    vkUnmapMemory(pDevice, pVertexBufferMemory);
-}
-
+    if (useVertexPulling())
+        vertexBufferAddress = getBufferAddress(pVertexBuffer);
 
-void VulkanTriangleApp::createCommandBuffers()
-{
-    // should it be tied to swapChainFramebuffers?
-    commandBuffers.resize(swapChainImageViews.size());
+    // stays mapped so applyBufferUpdates() can write to it, unmapped implicitly by vkFreeMemory
+    vkMapMemory(pDevice, pVertexBufferMemory, 0, buffInfo.size, 0, &pVertexBufferMapped);
+    memcpy(pVertexBufferMapped, vertices.data(), (size_t)buffInfo.size);
 
-    // VK_COMMAND_BUFFER_LEVEL_PRIMARY   - can be submitted to a queue for execution but cannot be called from other command buffers
-    // VK_COMMAND_BUFFER_LEVEL_SECONDARY - cannot be submitted directly but can be called from primary command buffers
-    VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
-    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-    commandBufferAllocateInfo.commandPool = pCommandPool;
-    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-    commandBufferAllocateInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+    vertexBufferSize = buffInfo.size;
 
-    if (vkAllocateCommandBuffers(pDevice, &commandBufferAllocateInfo, commandBuffers.data()) != VK_SUCCESS)
-        throw runtime_error("failed to allocate command buffers");
+    for (const Vertex& vertex : vertices)
+        modelRadius = std::max(modelRadius, glm::length(vertex.pos));
 }
 
 
-void VulkanTriangleApp::createSyncObjects()
+void VulkanTriangleApp::createUniformBuffers()
 {
-    // should it be tied to swapChainFramebuffers?
-    imageAvailableSemaphores.resize(swapChainImageViews.size());
-    renderFinishedSemaphores.resize(swapChainImageViews.size());
-    inFlightFences.resize(swapChainImageViews.size());
+    // the benchmark frame needs a slot per draw, 256 is the largest minUniformBufferOffsetAlignment allowed
+    VkDeviceSize bytesPerFrame = std::max<VkDeviceSize>(options.uniformBytesPerFrame, VkDeviceSize(options.benchDrawCount) * 256);
 
-    VkSemaphoreCreateInfo semaphoreInfo{};
+    // one region per frame in flight (same count as the command buffers and fences)
+    uniformRing.create(pPhysicalDevice, pDevice, framesInFlight, bytesPerFrame);
+
+    if (deviceCaps.HasBindless())
+    {
+        // draw data plus the indirect commands that point at it, offsets stay whole BindlessDrawData elements
+        // the culled mesh instances take a block of draw data and two of commands on top of the frame's draws
+        VkDeviceSize drawDataBytes = bytesPerFrame;
+        if (useOcclusionCulling())
+            drawDataBytes += VkDeviceSize(options.meshInstances) * (sizeof(BindlessDrawData) + 2 * sizeof(VkDrawIndexedIndirectCommand)) + 3 * sizeof(BindlessDrawData);
+
+        // vertex pulling reads the draw data through its address, the table entry stays for the culling pass
+        VkBufferUsageFlags addressUsage = useVertexPulling() ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0;
+
+        drawDataRing.create(pPhysicalDevice, pDevice, framesInFlight, drawDataBytes,
+            VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | addressUsage, sizeof(BindlessDrawData));
+
+        drawDataBufferIndex = bindlessTable.addBuffer(drawDataRing.getBuffer());
+
+        if (options.sceneNodes > 0 && !isHeadless())
+        {
+            instanceRing.create(pPhysicalDevice, pDevice, framesInFlight, VkDeviceSize(options.sceneNodes) * sizeof(BindlessDrawData),
+                VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | addressUsage, sizeof(BindlessDrawData));
+
+            instanceBufferIndex = bindlessTable.addBuffer(instanceRing.getBuffer());
+        }
+    }
+}
+
+
+void VulkanTriangleApp::createDescriptorSets()
+{
+    // a handful of sets per pool is plenty until materials show up
+    descriptorAllocator.init(pDevice, 16, { { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 }, { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 4 } });
+
+    pDrawDescriptorSet = descriptorAllocator.allocate(pDrawSetLayout);
+
+    // written once - the dynamic offset selects the draw's slice, so nothing is updated per frame
+    VkDescriptorBufferInfo bufferInfo{};
+    bufferInfo.buffer = uniformRing.getBuffer();
+    bufferInfo.offset = 0;
+    bufferInfo.range = sizeof(DrawUniforms);
+
+    VkWriteDescriptorSet descriptorWrite{};
+    descriptorWrite.sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+    descriptorWrite.dstSet = pDrawDescriptorSet;
+    descriptorWrite.dstBinding = 0;
+    descriptorWrite.dstArrayElement = 0;
+    descriptorWrite.descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC;
+    descriptorWrite.descriptorCount = 1;
+    descriptorWrite.pBufferInfo = &bufferInfo;
+
+    vkUpdateDescriptorSets(pDevice, 1, &descriptorWrite, 0, nullptr);
+}
+
+
+void VulkanTriangleApp::createCommandBuffers()
+{
+    // should it be tied to swapChainFramebuffers?
+    commandBuffers.resize(framesInFlight);
+
+    // VK_COMMAND_BUFFER_LEVEL_PRIMARY   - can be submitted to a queue for execution but cannot be called from other command buffers
+    // VK_COMMAND_BUFFER_LEVEL_SECONDARY - cannot be submitted directly but can be called from primary command buffers
+    VkCommandBufferAllocateInfo commandBufferAllocateInfo{};
+    commandBufferAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+    commandBufferAllocateInfo.commandPool = pCommandPool;
+    commandBufferAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+    commandBufferAllocateInfo.commandBufferCount = (uint32_t)commandBuffers.size();
+
+    if (vkAllocateCommandBuffers(pDevice, &commandBufferAllocateInfo, commandBuffers.data()) != VK_SUCCESS)
+        throw runtime_error("failed to allocate command buffers");
+
+    if (!options.parallelRecord)
+        return;
+
+    // a command pool must only be used by one thread at a time, so every job records from a pool of its own
+    recordChunkCount = jobSystem.getThreadCount();
+    recordPools.resize(commandBuffers.size() * recordChunkCount);
+    recordCommandBuffers.resize(recordPools.size());
+
+    VkCommandPoolCreateInfo poolInfo{};
+    poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
+    poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
+    poolInfo.queueFamilyIndex = queueFamilyIndices.graphicsFamily.value();
+
+    for (size_t i = 0; i < recordPools.size(); ++i)
+    {
+        if (vkCreateCommandPool(pDevice, &poolInfo, nullptr, &recordPools[i]) != VK_SUCCESS)
+            throw runtime_error("failed to create command pool");
+
+        VkCommandBufferAllocateInfo secondaryAllocateInfo{};
+        secondaryAllocateInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+        secondaryAllocateInfo.commandPool = recordPools[i];
+        secondaryAllocateInfo.level = VK_COMMAND_BUFFER_LEVEL_SECONDARY;
+        secondaryAllocateInfo.commandBufferCount = 1;
+
+        if (vkAllocateCommandBuffers(pDevice, &secondaryAllocateInfo, &recordCommandBuffers[i]) != VK_SUCCESS)
+            throw runtime_error("failed to allocate command buffers");
+    }
+}
+
+
+void VulkanTriangleApp::createSyncObjects()
+{
+    // should it be tied to swapChainFramebuffers?
+    imageAvailableSemaphores.resize(framesInFlight);
+    renderFinishedSemaphores.resize(framesInFlight);
+    inFlightFences.resize(framesInFlight);
+
+    VkSemaphoreCreateInfo semaphoreInfo{};
     semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
 
     VkFenceCreateInfo fenceInfo{};
@@ -714,7 +1482,7 @@ void VulkanTriangleApp::createSyncObjects()
     if (vkCreateSemaphore(pDevice, &semaphoreInfo, nullptr, &pAppSemaphore) != VK_SUCCESS)
         throw runtime_error("failed to create App semaphore");
 
-    for (size_t i = 0; i < swapChainImageViews.size(); ++i)
+    for (size_t i = 0; i < framesInFlight; ++i)
     {
         if (vkCreateSemaphore(pDevice, &semaphoreInfo, nullptr, &imageAvailableSemaphores[i]) != VK_SUCCESS)
             throw runtime_error("failed to create image available semaphore");
@@ -725,29 +1493,75 @@ void VulkanTriangleApp::createSyncObjects()
         if (vkCreateFence(pDevice, &fenceInfo, nullptr, &inFlightFences[i]) != VK_SUCCESS)
             throw runtime_error("failed to create inflight fence");
     }
+
+    if (!deviceCaps.timelineSemaphore)
+        return;
+
+    VkSemaphoreTypeCreateInfo timelineInfo{};
+    timelineInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_TYPE_CREATE_INFO;
+    timelineInfo.semaphoreType = VK_SEMAPHORE_TYPE_TIMELINE;
+    timelineInfo.initialValue = 0;
+
+    VkSemaphoreCreateInfo timelineSemaphoreInfo{};
+    timelineSemaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
+    timelineSemaphoreInfo.pNext = &timelineInfo;
+
+    if (vkCreateSemaphore(pDevice, &timelineSemaphoreInfo, nullptr, &pFrameTimeline) != VK_SUCCESS)
+        throw runtime_error("failed to create frame timeline semaphore");
+}
+
+
+void VulkanTriangleApp::createQueryPool()
+{
+    if (!deviceCaps.pipelineStatisticsQuery)
+        return;
+
+    // fragment shader invocations / covered pixels is the overdraw early-Z did not reject
+    VkQueryPoolCreateInfo queryPoolInfo{};
+    queryPoolInfo.sType = VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO;
+    queryPoolInfo.queryType = VK_QUERY_TYPE_PIPELINE_STATISTICS;
+    queryPoolInfo.queryCount = static_cast<uint32_t>(commandBuffers.size());
+    queryPoolInfo.pipelineStatistics = VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT;
+
+    if (vkCreateQueryPool(pDevice, &queryPoolInfo, nullptr, &pStatsQueryPool) != VK_SUCCESS)
+        throw runtime_error("failed to create pipeline statistics query pool");
+
+    statsQueryValues = std::make_unique<std::atomic<uint64_t>[]>(queryPoolInfo.queryCount);
 }
 
 
 void VulkanTriangleApp::recreateSwapChain()
 {
-    // poor pause implementation
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(pWindow, &width, &height);
-    while (width == 0 || height == 0)
+    // minimized - sleep until the window has a size again (or is closed)
+    pollWindowEvents();
+    while ((framebufferExtent.width == 0 || framebufferExtent.height == 0) && !windowClosed)
     {
-        glfwGetFramebufferSize(pWindow, &width, &height);
-        glfwWaitEvents();
+        windowEvents.wait();
+        pollWindowEvents();
     }
 
+    if (windowClosed)
+        return;
+
+    swapChainOutOfDate = false;
+
     vkDeviceWaitIdle(pDevice);
 
     cleanupSwapChain();
 
     currentFrame = 0;
 
+    // the frames no longer take the instance regions in the order the hierarchy last wrote them
+    if (sceneInstances.pData != nullptr)
+        sceneHierarchy.invalidateOutput();
+
     createSwapChain();
     createImageViews();
+    createTransientAttachments();
     createFramebuffers();
+
+    if (useOcclusionCulling())
+        occlusionCuller.setDepth(swapChainDepth.pImage, swapChainDepth.pImageView, depthFormat, swapChainExtent);
 }
 
 
@@ -756,54 +1570,86 @@ void VulkanTriangleApp::cleanupSwapChain()
     for (auto pFramebuffer : swapChainFramebuffers)
         vkDestroyFramebuffer(pDevice, pFramebuffer, nullptr);
 
+    swapChainFramebuffers.clear();
+
     for (auto imageView : swapChainImageViews)
         vkDestroyImageView(pDevice, imageView, nullptr);
 
+    destroyTransientAttachment(swapChainDepth);
+    destroyTransientAttachment(swapChainColor);
+
     vkDestroySwapchainKHR(pDevice, pSwapChain, nullptr);
 }
 
 
 void VulkanTriangleApp::drawFrame()
 {
+    FrameProfiler::ScopedFrame scopedFrame(frameProfiler);
+
     // wait for the previous frame to finish - VK_TRUE wait for all fences and timeout parameter (UINT64_MAX disables timeout)
-    vkWaitForFences(pDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::FenceWait);
+        vkWaitForFences(pDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
 
     // pImageAvailableSemaphore and VK_NULL_HANDLE - synchronization objects can be sempahore or fence or both
     uint32_t imageIndex = 0;
-    VkResult result = vkAcquireNextImageKHR(pDevice, pSwapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    VkResult result = VK_SUCCESS;
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Acquire);
+        result = vkAcquireNextImageKHR(pDevice, pSwapChain, UINT64_MAX, imageAvailableSemaphores[currentFrame], VK_NULL_HANDLE, &imageIndex);
+    }
     
-    bool bRecreateSwapChain = (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized ? true : false);
+    bool bRecreateSwapChain = (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || swapChainOutOfDate ? true : false);
+
+    reapGpuTasks();
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Reset);
 
-    // only reset the fences if work has been sent to the queues
-    vkResetFences(pDevice, 1, &inFlightFences[currentFrame]);
+        // only reset the fences if work has been sent to the queues
+        vkResetFences(pDevice, 1, &inFlightFences[currentFrame]);
 
-    // reset the command buffer - VkCommandBufferResetFlags : 0
-    vkResetCommandBuffer(commandBuffers[currentFrame], 0);
-    recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+        // reset the command buffer - VkCommandBufferResetFlags : 0
+        vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+    }
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Record);
+
+        buildFrameInputs();
+        frameRecorder.record(frameInputs);
+        applyBufferUpdates(frameInputs);
+        updateScene();
 
-    // submit the command buffer
-    // each entry in VkPipelineStageFlags corresponds to VkSemaphore
-    VkSemaphore waitSemaphores[] = { imageAvailableSemaphores[currentFrame] };
-    VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
+        recordCommandBuffer(commandBuffers[currentFrame], imageIndex);
+    }
 
+    // the frame's graphics work goes to the driver in one submit
+    // only the color output has to wait for the swapchain image, everything before it can start right away
     VkSemaphore signalSemaphores[] = { renderFinishedSemaphores[currentFrame] };
 
-    VkSubmitInfo submitInfo{};
-    submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-    submitInfo.waitSemaphoreCount = 1;
-    submitInfo.pWaitSemaphores = waitSemaphores;
-    submitInfo.pWaitDstStageMask = waitStages;
-    submitInfo.commandBufferCount = 1;
-    submitInfo.pCommandBuffers = &commandBuffers[currentFrame];
-    submitInfo.signalSemaphoreCount = 1;
-    submitInfo.pSignalSemaphores = signalSemaphores;
+    submitBatcher.addWait(pGraphicsQueue, imageAvailableSemaphores[currentFrame], VK_PIPELINE_STAGE_2_COLOR_ATTACHMENT_OUTPUT_BIT);
+    submitBatcher.addCommandBuffer(pGraphicsQueue, commandBuffers[currentFrame]);
+    submitBatcher.addSignal(pGraphicsQueue, renderFinishedSemaphores[currentFrame], VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT);
+
+    if (pFrameTimeline != nullptr)
+        submitBatcher.addSignal(pGraphicsQueue, pFrameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, ++frameTimelineValue);
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Submit);
+
+        submitBatcher.submitAll(inFlightFences[currentFrame]);
+        submitBatcher.endFrame();
+    }
 
-    // submit the command buffer to the graphics queue
-    if (vkQueueSubmit(pGraphicsQueue, 1, &submitInfo, inFlightFences[currentFrame]) != VK_SUCCESS)
-        throw runtime_error("failed to submit draw command buffer");
+    // read back on the waiter thread once the frame is done, this thread moves on to the next one
+    if (pStatsQueryPool != nullptr && pFrameTimeline != nullptr)
+        gpuTasks.push_back(readFrameStatistics(frameTimelineValue, currentFrame));
 
     VkSwapchainKHR swapChains[] = { pSwapChain };
 
+    // present on the queue that supports it, the semaphore orders it after the graphics submit
     VkPresentInfoKHR presentInfo{};
     presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
     presentInfo.waitSemaphoreCount = 1;
@@ -813,83 +1659,1994 @@ void VulkanTriangleApp::drawFrame()
     presentInfo.pImageIndices = &imageIndex;
     presentInfo.pResults = nullptr;
 
-    result = vkQueuePresentKHR(pGraphicsQueue, &presentInfo);
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Present);
+        result = vkQueuePresentKHR(pPresentQueue, &presentInfo);
+    }
+
+    // notice that bRecreateSwapChain is set to its current value if the other checks are false
+    bRecreateSwapChain = (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || swapChainOutOfDate ? true : bRecreateSwapChain);
+
+    if (bRecreateSwapChain)
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Recreate);
+
+        recreateSwapChain();
+        return;
+    }
+
+    currentFrame = (currentFrame + 1) % framesInFlight;
+}
+
+
+void VulkanTriangleApp::logFrameStats()
+{
+    FrameStats stats = frameProfiler.getStats();
+    if (stats.frameCount == 0)
+        return;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "Frame CPU time over the last " << stats.frameCount << " frames (avg / min / max ms)" << endl;
+    out << "\tFrame: " << stats.frame.avgMs << " / " << stats.frame.minMs << " / " << stats.frame.maxMs << endl;
+
+    for (uint32_t p = 0; p < FramePhaseCount; ++p)
+    {
+        const FramePhaseStats& phase = stats.phases[p];
+        if (phase.samples == 0)
+            continue;
+
+        out << "\t" << framePhaseName(static_cast<FramePhase>(p)) << ": " << phase.avgMs << " / " << phase.minMs << " / " << phase.maxMs
+            << " (" << phase.samples << " frames)" << endl;
+    }
+
+    uint64_t readFrames = statisticsFrames.load(std::memory_order_relaxed);
+    if (readFrames > 0)
+        out << "\tFragment shader invocations: " << fragmentInvocations.load(std::memory_order_relaxed) / readFrames << " per frame (" << readFrames << " frames read back)" << endl;
+
+    if (meshTrianglesFull > 0)
+        out << "\tMesh levels: " << 100.0 * meshTrianglesDrawn / meshTrianglesFull << "% of the full detail triangles drawn" << endl;
+
+    const OcclusionStats& occlusion = occlusionCuller.getStats();
+    if (occlusion.tested > 0)
+    {
+        out << "\tOcclusion culling: " << 100.0 * occlusion.occluded / occlusion.tested << "% of the instances occluded, "
+            << 100.0 * occlusion.frustumCulled / occlusion.tested << "% outside the frustum, " << 100.0 * occlusion.lateVisible / occlusion.tested
+            << "% drawn by the second pass (" << occlusion.tested / occlusion.frames << " per frame, " << occlusion.frames << " frames read back)" << endl;
+
+        if (occlusion.timedFrames > 0)
+            out << "\tOcclusion culling GPU time: pyramid " << occlusion.pyramidMs / occlusion.timedFrames << " ms, cull " << occlusion.cullMs / occlusion.timedFrames << " ms" << endl;
+    }
+}
+
+
+// resumed on the waiter thread once the frame's submit has finished
+GpuTask VulkanTriangleApp::readFrameStatistics(uint64_t timelineValue, uint32_t query)
+{
+    co_await (gpuWaiter.getTimeline(pFrameTimeline) >= timelineValue);
+
+    uint64_t results[2] = {};
+    VkResult result = vkGetQueryPoolResults(pDevice, pStatsQueryPool, query, 1, sizeof(results), results, sizeof(results),
+        VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WITH_AVAILABILITY_BIT);
+
+    // by the time this runs the slot may have been recorded and finished again, and would hold a later frame's count
+    // the tag is checked after the read - still this frame's value means the reuse had not been submitted when it was read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    bool current = (statsQueryValues[query].load(std::memory_order_relaxed) == timelineValue);
+
+    if (result == VK_SUCCESS && results[1] != 0 && current)
+    {
+        fragmentInvocations.fetch_add(results[0], std::memory_order_relaxed);
+        statisticsFrames.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+
+// drops finished tasks, what escaped one is rethrown here on the render thread
+void VulkanTriangleApp::reapGpuTasks()
+{
+    auto running = std::partition(gpuTasks.begin(), gpuTasks.end(), [](const GpuTask& task) { return !task.isDone(); });
+
+    for (auto it = running; it != gpuTasks.end(); ++it)
+        it->rethrow();
+
+    gpuTasks.erase(running, gpuTasks.end());
+}
+
+
+void VulkanTriangleApp::buildFrameInputs()
+{
+    frameInputs.clear();
+    frameInputs.pipelineId = static_cast<uint32_t>(options.drawPipeline);
+    frameInputs.width = swapChainExtent.width;
+    frameInputs.height = swapChainExtent.height;
+
+    // createVertexBuffer() filled the buffer before the first frame - repeat it in the capture so a replay starts from the same contents
+    if (frameRecorder.isOpen() && frameRecorder.getFrameCount() == 0)
+    {
+        BufferUpdate update;
+        update.bufferId = static_cast<uint32_t>(FrameBufferId::Vertex);
+        update.offset = 0;
+        update.data.resize(sizeof(Vertex) * vertices.size());
+        memcpy(update.data.data(), vertices.data(), update.data.size());
+
+        frameInputs.bufferUpdates.push_back(std::move(update));
+    }
+
+    // one draw per simulated instance, placed between the two states of the newest step
+    // until the first snapshot arrives just the NDC triangle
+    if (const SimSnapshot* pSnapshot = snapshotMailbox.acquire())
+    {
+        float alpha = pSnapshot->getAlpha(FrameProfiler::nowNs());
+
+        for (size_t i = 0; i < pSnapshot->current.size(); ++i)
+        {
+            DrawCommand draw;
+            draw.vertexCount = static_cast<uint32_t>(vertices.size());
+            draw.transform = pSnapshot->getTransform(i, alpha);
+            draw.color = pSnapshot->colors[i];
+
+            frameInputs.draws.push_back(draw);
+        }
+    }
+    else
+    {
+        frameInputs.draws.push_back({ (uint32_t)vertices.size(), 1, 0, 0 });
+    }
+
+    // culled and sorted before capture, so a replay records the same draws in the same order
+    if (options.cullDraws)
+        drawCuller.cull(jobSystem, frameInputs.draws, modelRadius);
+
+    if (options.sortDraws)
+        drawSorter.sort(frameInputs.draws);
+}
+
+
+void VulkanTriangleApp::applyBufferUpdates(const FrameInputs& frame)
+{
+    if (frame.bufferUpdates.empty())
+        return;
+
+    // the vertex buffer is shared by every frame in flight, so let the GPU finish with it first
+    vkQueueWaitIdle(pGraphicsQueue);
+
+    for (const BufferUpdate& update : frame.bufferUpdates)
+    {
+        if (update.bufferId != static_cast<uint32_t>(FrameBufferId::Vertex) || update.offset + update.data.size() > vertexBufferSize)
+            throw runtime_error("buffer update does not fit the vertex buffer");
+
+        memcpy(static_cast<char*>(pVertexBufferMapped) + update.offset, update.data.data(), update.data.size());
+    }
+}
+
+
+VkPipeline VulkanTriangleApp::selectPipeline(uint32_t pipelineId)
+{
+    // libraries are shared by all programs, only the program changes per frame
+    if (options.pipelineLibrary)
+    {
+        PipelineVariant variant = drawVariant;
+        variant.program = pipelineId;
+        return pipelineLibrary.getPipeline(variant);
+    }
+
+    if (pipelineId == static_cast<uint32_t>(DrawPipelineId::Bindless) && !deviceCaps.HasBindless())
+        throw runtime_error("bindless pipeline needs descriptor indexing");
+
+    if (pipelineId >= drawPipelineDescs.size())
+        throw runtime_error("unknown pipeline id");
+
+    // a lookup rather than the cached handle, so the registry counts every use
+    return pipelineRegistry.get(drawPipelineDescs[pipelineId]);
+}
+
+
+void VulkanTriangleApp::pushDrawConstants(VkCommandBuffer pCommandBuffer, const glm::mat4& transform, const glm::vec4& color)
+{
+    DrawPushConstants constants;
+    constants.transform = transform;
+    constants.color = color;
+
+    // the values are copied into the command buffer, nothing to keep alive or synchronise
+    vkCmdPushConstants(pCommandBuffer, pPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+}
+
+
+// where the bindless pipeline finds drawData - a table index and element, or with vertex pulling the addresses of
+// the draw data and of the vertices (vertexAddress is ignored otherwise, the caller binds a vertex buffer)
+void VulkanTriangleApp::pushBindlessConstants(VkCommandBuffer pCommandBuffer, const UniformRing& ring, uint32_t bufferIndex, UniformAllocation drawData, VkDeviceAddress vertexAddress)
+{
+    static_assert(offsetof(Vertex, color) == 3 * sizeof(float) && sizeof(Vertex) % sizeof(float) == 0, "shaders/pulledDraw.vert reads Vertex as floats");
+
+    if (useVertexPulling())
+    {
+        PulledPushConstants constants{};
+        constants.vertexAddress = vertexAddress;
+        constants.drawAddress = ring.getDeviceAddress() + drawData.offset;
+        constants.vertexStride = sizeof(Vertex) / sizeof(float);
+        vkCmdPushConstants(pCommandBuffer, pBindlessPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+        return;
+    }
+
+    bindlessTable.bind(pCommandBuffer, pBindlessPipelineLayout);
+
+    BindlessPushConstants constants{};
+    constants.drawBufferIndex = bufferIndex;
+    constants.firstDraw = static_cast<uint32_t>(drawData.offset / sizeof(BindlessDrawData));
+    vkCmdPushConstants(pCommandBuffer, pBindlessPipelineLayout, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+}
+
+
+void VulkanTriangleApp::recordCommandBuffer(VkCommandBuffer pCommandBuffer, uint32_t imageIndex)
+{
+    RenderTarget target;
+    target.pFramebuffer = options.dynamicRendering ? nullptr : swapChainFramebuffers[imageIndex];
+    target.pImage = swapChainImages[imageIndex];
+    target.pImageView = swapChainImageViews[imageIndex];
+    target.pColorImage = swapChainColor.pImage;
+    target.pColorImageView = swapChainColor.pImageView;
+    target.pDepthImage = swapChainDepth.pImage;
+    target.pDepthImageView = swapChainDepth.pImageView;
+    target.extent = swapChainExtent;
+    target.present = true;
+
+    recordCommandBuffer(pCommandBuffer, target, frameInputs);
+}
+
+
+void VulkanTriangleApp::recordCommandBuffer(VkCommandBuffer pCommandBuffer, const RenderTarget& target, const FrameInputs& frame)
+{
+    // the fence for currentFrame has been waited on, so its uniform region is free again
+    uniformRing.beginFrame(currentFrame);
+
+    if (deviceCaps.HasBindless())
+        drawDataRing.beginFrame(currentFrame);
+
+    // VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT      - command buffer will be rerecorded right after excution
+    // VK_COMMAND_BUFFER_USAGE_RENDER_PASS_COMTINUE_BIT - a secondary command buffer that will be entirely within a single render pass
+    // VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT     - command buffer can be resubmitted while it is also already pending execution
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = 0;
+    beginInfo.pInheritanceInfo = nullptr;
+
+    // if the command buffer was already recorded it will be implicitly reset
+    if (vkBeginCommandBuffer(pCommandBuffer, &beginInfo) != VK_SUCCESS)
+        throw runtime_error("failed to begin command buffer recording");
+
+    // resets are not allowed inside a render pass
+    // the tag moves to the timeline value this frame signals before its submit can reset the query on the GPU
+    if (pStatsQueryPool != nullptr)
+    {
+        vkCmdResetQueryPool(pCommandBuffer, pStatsQueryPool, currentFrame, 1);
+        statsQueryValues[currentFrame].store(frameTimelineValue + 1, std::memory_order_release);
+    }
+
+    if (options.renderGraph)
+    {
+        // the scene pass records the draws, the graph places the barriers around it
+        if (!renderGraph.isCompiled() || target.extent.width != renderGraphExtent.width || target.extent.height != renderGraphExtent.height || target.present != renderGraphPresent)
+            buildRenderGraph(target);
+
+        pGraphFrame = &frame;
+        renderGraph.setImportedImage(graphBackbuffer, target.pImage, target.pImageView);
+        renderGraph.execute(pCommandBuffer);
+        pGraphFrame = nullptr;
+    }
+    else if (useParallelRecording(frame))
+    {
+        // queries cannot begin inside secondary command buffers, they inherit the one running in the primary
+        if (pStatsQueryPool != nullptr)
+            vkCmdBeginQuery(pCommandBuffer, pStatsQueryPool, currentFrame, 0);
+
+        RenderTarget secondaryTarget = target;
+        secondaryTarget.secondaryContents = true;
+
+        beginRenderTarget(pCommandBuffer, secondaryTarget);
+        recordDrawsParallel(pCommandBuffer, secondaryTarget, frame);
+        endRenderTarget(pCommandBuffer, secondaryTarget);
+
+        if (pStatsQueryPool != nullptr)
+            vkCmdEndQuery(pCommandBuffer, pStatsQueryPool, currentFrame);
+    }
+    else if (useOcclusionCulling())
+    {
+        // compute work cannot run inside a render pass - cull, draw what passed, cull what was occluded again
+        // against the depth just drawn, draw what passed now on top; the image is presented from the second pass
+        // (the statistics query runs inside the first one only)
+        RenderTarget firstTarget = target;
+        firstTarget.present = false;
+
+        RenderTarget lateTarget = target;
+        lateTarget.load = true;
+
+        recordOcclusionCull(pCommandBuffer, target.extent);
+
+        beginRenderTarget(pCommandBuffer, firstTarget);
+        recordDraws(pCommandBuffer, target.extent, frame);
+        endRenderTarget(pCommandBuffer, firstTarget);
+
+        occlusionCuller.recordLate(pCommandBuffer, currentFrame, meshLateCommands.offset);
+
+        beginRenderTarget(pCommandBuffer, lateTarget);
+        recordCulledMeshDraw(pCommandBuffer, target.extent, meshLateCommands);
+        endRenderTarget(pCommandBuffer, lateTarget);
+    }
+    else
+    {
+        beginRenderTarget(pCommandBuffer, target);
+        recordDraws(pCommandBuffer, target.extent, frame);
+        endRenderTarget(pCommandBuffer, target);
+    }
+
+    // end command buffer recording
+    if (vkEndCommandBuffer(pCommandBuffer) != VK_SUCCESS)
+        throw runtime_error("failed to end command buffer");
+}
+
+
+void VulkanTriangleApp::recordDraws(VkCommandBuffer pCommandBuffer, VkExtent2D extent, const FrameInputs& frame)
+{
+    if (pStatsQueryPool != nullptr)
+        vkCmdBeginQuery(pCommandBuffer, pStatsQueryPool, currentFrame, 0);
+
+    recordDrawState(pCommandBuffer, extent, frame.pipelineId, options.shaderObjects ? nullptr : selectPipeline(frame.pipelineId));
+
+    if (frame.pipelineId == static_cast<uint32_t>(DrawPipelineId::Bindless))
+        recordBindlessDraws(pCommandBuffer, frame);
+    else
+        recordDrawRange(pCommandBuffer, frame, 0, static_cast<uint32_t>(frame.draws.size()), UniformAllocation{});
+
+    if (sceneInstances.pData != nullptr)
+        recordSceneDraw(pCommandBuffer);
+
+    if (meshBuffer.pBuffer != nullptr)
+        recordMeshDraw(pCommandBuffer, extent);
+
+    if (pStatsQueryPool != nullptr)
+        vkCmdEndQuery(pCommandBuffer, pStatsQueryPool, currentFrame);
+}
+
+
+// pipeline, dynamic state and vertex buffer - everything a command buffer needs before its first draw
+void VulkanTriangleApp::recordDrawState(VkCommandBuffer pCommandBuffer, VkExtent2D extent, uint32_t pipelineId, VkPipeline pPipeline)
+{
+    if (options.shaderObjects)
+    {
+        // nothing is baked - every piece of state the draws depend on is set here, viewport and scissor included
+        shaderObjects.bind(pCommandBuffer, pipelineId);
+        shaderObjects.setState(pCommandBuffer, shaderObjectState, extent);
+    }
+    else
+    {
+        vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipeline);
+
+        VkViewport viewport{};
+        viewport.x = 0.0f;
+        viewport.y = 0.0f;
+        viewport.width = static_cast<float>(extent.width);
+        viewport.height = static_cast<float>(extent.height);
+        viewport.minDepth = 0.0f;
+        viewport.maxDepth = 1.0f;
+        vkCmdSetViewport(pCommandBuffer, 0, 1, &viewport);
+
+        VkRect2D scissor{};
+        scissor.offset = { 0, 0 };
+        scissor.extent = extent;
+        vkCmdSetScissor(pCommandBuffer, 0, 1, &scissor);
+    }
+
+    // the pulled pipeline gets the vertex buffer's address with the draw data instead
+    if (useVertexPulling() && pipelineId == static_cast<uint32_t>(DrawPipelineId::Bindless))
+        return;
+
+    VkBuffer vertexBuffers[] = { pVertexBuffer };
+    VkDeviceSize offsets[] = { 0 };
+    vkCmdBindVertexBuffers(pCommandBuffer, 0, 1, vertexBuffers, offsets);
+}
+
+
+// uniforms.pData null - every draw pushes its uniforms to the ring
+// otherwise draw i writes at uniforms + (i - begin) * stride, a block the caller allocated for the range, so jobs never touch the ring
+void VulkanTriangleApp::recordDrawRange(VkCommandBuffer pCommandBuffer, const FrameInputs& frame, uint32_t begin, uint32_t end, UniformAllocation uniforms)
+{
+    bool usePushConstants = (frame.pipelineId == static_cast<uint32_t>(DrawPipelineId::PushConstants));
+
+    VkDeviceSize alignment = uniformRing.getAlignment();
+    uint32_t stride = static_cast<uint32_t>((sizeof(DrawUniforms) + alignment - 1) & ~(alignment - 1));
+
+    for (uint32_t i = begin; i < end; ++i)
+    {
+        const DrawCommand& draw = frame.draws[i];
+
+        if (usePushConstants)
+        {
+            // per draw data travels inside the command buffer, no memory or descriptor is touched
+            pushDrawConstants(pCommandBuffer, draw.transform, draw.color);
+        }
+        else
+        {
+            // per draw data is one memcpy into the ring and a dynamic offset, the descriptor set never changes
+            DrawUniforms drawUniforms;
+            drawUniforms.transform = draw.transform;
+            drawUniforms.color = draw.color;
+
+            uint32_t dynamicOffset = 0;
+            if (uniforms.pData == nullptr)
+            {
+                dynamicOffset = uniformRing.push(drawUniforms);
+            }
+            else
+            {
+                dynamicOffset = uniforms.offset + (i - begin) * stride;
+                memcpy(static_cast<char*>(uniforms.pData) + (i - begin) * stride, &drawUniforms, sizeof(drawUniforms));
+            }
+
+            vkCmdBindDescriptorSets(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pPipelineLayout, 0, 1, &pDrawDescriptorSet, 1, &dynamicOffset);
+        }
+
+        // vertexCount, instanceCount, firstVertex, firstInstance
+        vkCmdDraw(pCommandBuffer, draw.vertexCount, draw.instanceCount, draw.firstVertex, draw.firstInstance);
+    }
+}
+
+
+// below a few hundred draws the secondary command buffers cost more than the jobs save
+bool VulkanTriangleApp::useParallelRecording(const FrameInputs& frame) const
+{
+    if (!options.parallelRecord || recordPools.empty())
+        return false;
+
+    // bindless draws are a single indirect call, nothing to split - the scene and mesh draws are recorded with the other draws
+    if (frame.pipelineId == static_cast<uint32_t>(DrawPipelineId::Bindless) || sceneInstances.pData != nullptr || meshBuffer.pBuffer != nullptr)
+        return false;
+
+    // the primary owns the statistics query, the secondaries can only record inside it with inheritedQueries
+    if (pStatsQueryPool != nullptr && !deviceCaps.inheritedQueries)
+        return false;
+
+    return frame.draws.size() >= 256;
+}
+
+
+// one secondary command buffer per job, executed from the primary in draw order
+void VulkanTriangleApp::recordDrawsParallel(VkCommandBuffer pCommandBuffer, const RenderTarget& target, const FrameInputs& frame)
+{
+    uint32_t drawCount = static_cast<uint32_t>(frame.draws.size());
+    uint32_t chunkCount = std::min(recordChunkCount, drawCount);
+    uint32_t chunkSize = (drawCount + chunkCount - 1) / chunkCount;
+
+    // the registry and the ring are not thread safe - both are touched once here, before the jobs start
+    VkPipeline pPipeline = options.shaderObjects ? nullptr : selectPipeline(frame.pipelineId);
+
+    VkDeviceSize alignment = uniformRing.getAlignment();
+    VkDeviceSize stride = (sizeof(DrawUniforms) + alignment - 1) & ~(alignment - 1);
+
+    UniformAllocation uniforms{};
+    if (frame.pipelineId != static_cast<uint32_t>(DrawPipelineId::PushConstants))
+        uniforms = uniformRing.allocate(stride * drawCount);
+
+    VkCommandBufferInheritanceRenderingInfo inheritanceRendering{};
+    inheritanceRendering.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_RENDERING_INFO;
+    inheritanceRendering.colorAttachmentCount = 1;
+    inheritanceRendering.pColorAttachmentFormats = &swapChainImageFormat;
+    inheritanceRendering.depthAttachmentFormat = depthFormat;
+    inheritanceRendering.rasterizationSamples = msaaSamples;
+
+    VkCommandBufferInheritanceInfo inheritanceInfo{};
+    inheritanceInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+    inheritanceInfo.pNext = options.dynamicRendering ? &inheritanceRendering : nullptr;
+    inheritanceInfo.renderPass = options.dynamicRendering ? nullptr : pRenderPass;
+    inheritanceInfo.subpass = 0;
+    inheritanceInfo.framebuffer = target.pFramebuffer;
+    inheritanceInfo.occlusionQueryEnable = VK_FALSE;
+    inheritanceInfo.pipelineStatistics = (pStatsQueryPool != nullptr) ? VK_QUERY_PIPELINE_STATISTIC_FRAGMENT_SHADER_INVOCATIONS_BIT : 0;
+
+    VkCommandBufferBeginInfo beginInfo{};
+    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+    beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+    beginInfo.pInheritanceInfo = &inheritanceInfo;
+
+    // what a job needs beyond its index, the captures have to stay small
+    struct RecordChunk
+    {
+        VkCommandBuffer pCommandBuffer = nullptr;
+        uint32_t begin = 0;
+        uint32_t end = 0;
+        UniformAllocation uniforms{};
+        std::exception_ptr exception;
+    };
+
+    vector<RecordChunk> chunks(chunkCount);
+    for (uint32_t c = 0; c < chunkCount; ++c)
+    {
+        RecordChunk& chunk = chunks[c];
+        chunk.pCommandBuffer = recordCommandBuffers[currentFrame * recordChunkCount + c];
+        chunk.begin = std::min(drawCount, c * chunkSize);
+        chunk.end = std::min(drawCount, chunk.begin + chunkSize);
+
+        if (uniforms.pData != nullptr)
+        {
+            chunk.uniforms.offset = uniforms.offset + static_cast<uint32_t>(chunk.begin * stride);
+            chunk.uniforms.pData = static_cast<char*>(uniforms.pData) + chunk.begin * stride;
+        }
+    }
+
+    // the jobs capture this block by reference, a job only has room for a few pointers
+    struct RecordContext
+    {
+        const FrameInputs* pFrame;
+        const VkCommandBufferBeginInfo* pBeginInfo;
+        VkPipeline pPipeline;
+        VkExtent2D extent;
+        RecordChunk* pChunks;
+    };
+
+    RecordContext context = { &frame, &beginInfo, pPipeline, target.extent, chunks.data() };
+
+    JobCounter recorded;
+    for (uint32_t c = 0; c < chunkCount; ++c)
+    {
+        jobSystem.run(recorded, [this, &context, c]()
+        {
+            RecordChunk& chunk = context.pChunks[c];
+
+            try
+            {
+                if (vkBeginCommandBuffer(chunk.pCommandBuffer, context.pBeginInfo) != VK_SUCCESS)
+                    throw runtime_error("failed to begin command buffer recording");
+
+                recordDrawState(chunk.pCommandBuffer, context.extent, context.pFrame->pipelineId, context.pPipeline);
+                recordDrawRange(chunk.pCommandBuffer, *context.pFrame, chunk.begin, chunk.end, chunk.uniforms);
+
+                if (vkEndCommandBuffer(chunk.pCommandBuffer) != VK_SUCCESS)
+                    throw runtime_error("failed to end command buffer");
+            }
+            catch (...)
+            {
+                chunk.exception = std::current_exception();
+            }
+        });
+    }
+
+    jobSystem.wait(recorded);
+
+    vector<VkCommandBuffer> secondaries(chunkCount);
+    for (uint32_t c = 0; c < chunkCount; ++c)
+    {
+        if (chunks[c].exception)
+            std::rethrow_exception(chunks[c].exception);
+
+        secondaries[c] = chunks[c].pCommandBuffer;
+    }
+
+    vkCmdExecuteCommands(pCommandBuffer, chunkCount, secondaries.data());
+}
+
+
+void VulkanTriangleApp::beginRenderTarget(VkCommandBuffer pCommandBuffer, const RenderTarget& target)
+{
+    VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+
+    // far plane, VK_COMPARE_OP_LESS lets everything in front of it through
+    VkClearValue clearDepth{};
+    clearDepth.depthStencil = { 1.0f, 0 };
+
+    if (!options.dynamicRendering)
+    {
+        // VK_SUBPASS_CONTENTS_INLINE                    - render pass commands are embedded in the primary command buffer
+        // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS - renedr pass commands will be executed from seconday command buffers
+        VkRenderPassBeginInfo renderPassInfo{};
+        renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+        renderPassInfo.renderPass = target.load ? pLateRenderPass : pRenderPass;
+        renderPassInfo.framebuffer = target.pFramebuffer;
+        renderPassInfo.renderArea.offset = { 0, 0 };
+        renderPassInfo.renderArea.extent = target.extent;
+
+        VkClearValue clearValues[] = { clearColor, clearDepth };
+        renderPassInfo.clearValueCount = 2;
+        renderPassInfo.pClearValues = clearValues;
+
+        vkCmdBeginRenderPass(pCommandBuffer, &renderPassInfo, target.secondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+        return;
+    }
+
+    // the earlier pass left color in the attachment layout and whoever ran in between handed depth back in it
+    if (target.load)
+    {
+        VkMemoryBarrier colorBarrier{};
+        colorBarrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+        colorBarrier.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        colorBarrier.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+
+        vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+            1, &colorBarrier, 0, nullptr, 0, nullptr);
+
+        beginRendering(pCommandBuffer, target);
+        return;
+    }
+
+    // the render pass did this transition through initialLayout and its external dependency
+    // the offscreen replay target is shared by the frames in flight like the depth buffer - wait for the previous frame's color writes
+    VkImageMemoryBarrier toAttachment{};
+    toAttachment.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toAttachment.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toAttachment.dstAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toAttachment.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+    toAttachment.newLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    toAttachment.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toAttachment.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toAttachment.image = target.pImage;
+    toAttachment.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    // the depth buffer is shared by the frames in flight - wait for the previous frame's depth writes
+    VkImageMemoryBarrier toDepthAttachment = toAttachment;
+    toDepthAttachment.srcAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    toDepthAttachment.dstAccessMask = VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT;
+    toDepthAttachment.newLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    toDepthAttachment.image = target.pDepthImage;
+    toDepthAttachment.subresourceRange = { VK_IMAGE_ASPECT_DEPTH_BIT, 0, 1, 0, 1 };
+
+    // without separateDepthStencilLayouts the transition covers the stencil aspect of the fallback formats as well
+    if (depthFormat == VK_FORMAT_D32_SFLOAT_S8_UINT || depthFormat == VK_FORMAT_D24_UNORM_S8_UINT)
+        toDepthAttachment.subresourceRange.aspectMask |= VK_IMAGE_ASPECT_STENCIL_BIT;
+
+    // the multisampled image needs the same transition as the image it resolves into
+    VkImageMemoryBarrier toColorAttachments[] = { toAttachment, toAttachment };
+    toColorAttachments[1].image = target.pColorImage;
+    uint32_t colorBarrierCount = (target.pColorImage != nullptr) ? 2 : 1;
+
+    vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0,
+        0, nullptr, 0, nullptr, colorBarrierCount, toColorAttachments);
+
+    vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toDepthAttachment);
+
+    beginRendering(pCommandBuffer, target);
+}
+
+
+// the attachments must already be in their attachment layouts
+void VulkanTriangleApp::beginRendering(VkCommandBuffer pCommandBuffer, const RenderTarget& target)
+{
+    VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+
+    VkClearValue clearDepth{};
+    clearDepth.depthStencil = { 1.0f, 0 };
+
+    VkRenderingAttachmentInfo colorAttachment{};
+    colorAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    colorAttachment.imageView = target.pImageView;
+    colorAttachment.imageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    colorAttachment.loadOp = target.load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_STORE;
+    colorAttachment.clearValue = clearColor;
+
+    // MSAA - resolved at the end of rendering, the samples themselves are never stored
+    if (target.pColorImage != nullptr)
+    {
+        colorAttachment.imageView = target.pColorImageView;
+        colorAttachment.storeOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        colorAttachment.resolveMode = VK_RESOLVE_MODE_AVERAGE_BIT;
+        colorAttachment.resolveImageView = target.pImageView;
+        colorAttachment.resolveImageLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    }
+
+    VkRenderingAttachmentInfo depthAttachment{};
+    depthAttachment.sType = VK_STRUCTURE_TYPE_RENDERING_ATTACHMENT_INFO;
+    depthAttachment.imageView = target.pDepthImageView;
+    depthAttachment.imageLayout = VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL;
+    depthAttachment.loadOp = target.load ? VK_ATTACHMENT_LOAD_OP_LOAD : VK_ATTACHMENT_LOAD_OP_CLEAR;
+    depthAttachment.storeOp = useOcclusionCulling() ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+    depthAttachment.clearValue = clearDepth;
+
+    VkRenderingInfo renderingInfo{};
+    renderingInfo.sType = VK_STRUCTURE_TYPE_RENDERING_INFO;
+    renderingInfo.renderArea.offset = { 0, 0 };
+    renderingInfo.renderArea.extent = target.extent;
+    renderingInfo.layerCount = 1;
+    renderingInfo.colorAttachmentCount = 1;
+    renderingInfo.pColorAttachments = &colorAttachment;
+    renderingInfo.pDepthAttachment = &depthAttachment;
+
+    if (target.secondaryContents)
+        renderingInfo.flags = VK_RENDERING_CONTENTS_SECONDARY_COMMAND_BUFFERS_BIT;
+
+    vkCmdBeginRendering(pCommandBuffer, &renderingInfo);
+}
+
+
+// one scene pass today - the graph already owns the transitions, the present barrier and the transient attachments
+void VulkanTriangleApp::buildRenderGraph(const RenderTarget& target)
+{
+    // the transient images of the previous graph may still be used by frames in flight
+    vkDeviceWaitIdle(pDevice);
+    renderGraph.reset();
+
+    bool multisampled = (msaaSamples != VK_SAMPLE_COUNT_1_BIT);
+    VkImageLayout finalLayout = target.present ? VK_IMAGE_LAYOUT_PRESENT_SRC_KHR : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+    // the acquire semaphore is waited on at VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT
+    graphBackbuffer = renderGraph.importImage("backbuffer", target.pImage, target.pImageView,
+        { swapChainImageFormat, target.extent, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT },
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, finalLayout);
+
+    graphDepth = renderGraph.createImage("depth", { depthFormat, target.extent, msaaSamples, VK_IMAGE_ASPECT_DEPTH_BIT });
+
+    if (multisampled)
+        graphMsaaColor = renderGraph.createImage("msaa color", { swapChainImageFormat, target.extent, msaaSamples, VK_IMAGE_ASPECT_COLOR_BIT });
+
+    uint32_t scene = renderGraph.addPass("scene", [this, multisampled](VkCommandBuffer pCommandBuffer)
+    {
+        RenderTarget sceneTarget;
+        sceneTarget.pImageView = renderGraph.getImageView(graphBackbuffer);
+        sceneTarget.pColorImage = multisampled ? renderGraph.getImage(graphMsaaColor) : nullptr;
+        sceneTarget.pColorImageView = multisampled ? renderGraph.getImageView(graphMsaaColor) : nullptr;
+        sceneTarget.pDepthImageView = renderGraph.getImageView(graphDepth);
+        sceneTarget.extent = renderGraphExtent;
+
+        beginRendering(pCommandBuffer, sceneTarget);
+        recordDraws(pCommandBuffer, renderGraphExtent, *pGraphFrame);
+        vkCmdEndRendering(pCommandBuffer);
+    });
+
+    renderGraph.write(scene, graphBackbuffer, RenderGraphUsage::ColorAttachment);
+    renderGraph.write(scene, graphDepth, RenderGraphUsage::DepthAttachment);
+
+    if (multisampled)
+        renderGraph.write(scene, graphMsaaColor, RenderGraphUsage::ColorAttachment);
+
+    renderGraph.compile();
+    renderGraph.logStats();
+
+    renderGraphExtent = target.extent;
+    renderGraphPresent = target.present;
+}
+
+
+void VulkanTriangleApp::endRenderTarget(VkCommandBuffer pCommandBuffer, const RenderTarget& target)
+{
+    if (!options.dynamicRendering)
+    {
+        vkCmdEndRenderPass(pCommandBuffer);
+        return;
+    }
+
+    vkCmdEndRendering(pCommandBuffer);
+
+    // offscreen images stay in the attachment layout, same as the render pass finalLayout when headless
+    if (!target.present)
+        return;
+
+    VkImageMemoryBarrier toPresent{};
+    toPresent.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+    toPresent.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+    toPresent.dstAccessMask = 0;
+    toPresent.oldLayout = VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+    toPresent.newLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    toPresent.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toPresent.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+    toPresent.image = target.pImage;
+    toPresent.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1 };
+
+    // the present semaphore wait covers everything after this
+    vkCmdPipelineBarrier(pCommandBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+        0, nullptr, 0, nullptr, 1, &toPresent);
+}
+
+
+// the whole frame's draw data is written in one pass and drawn with as few indirect calls as the device allows
+// each draw's firstInstance is its first slot, so instance i of a draw reads slot firstInstance + i
+// (DrawCommand::firstInstance is not used on this path)
+void VulkanTriangleApp::recordBindlessDraws(VkCommandBuffer pCommandBuffer, const FrameInputs& frame)
+{
+    if (frame.draws.empty())
+        return;
+
+    uint32_t slotCount = 0;
+    for (const DrawCommand& draw : frame.draws)
+        slotCount += draw.instanceCount;
+
+    UniformAllocation drawData = drawDataRing.allocate(slotCount * sizeof(BindlessDrawData));
+    UniformAllocation indirect = drawDataRing.allocate(frame.draws.size() * sizeof(VkDrawIndirectCommand));
+
+    BindlessDrawData* pDrawData = static_cast<BindlessDrawData*>(drawData.pData);
+    VkDrawIndirectCommand* pCommands = static_cast<VkDrawIndirectCommand*>(indirect.pData);
+
+    uint32_t slot = 0;
+    for (size_t d = 0; d < frame.draws.size(); ++d)
+    {
+        const DrawCommand& draw = frame.draws[d];
+
+        BindlessDrawData data{};
+        data.transform = draw.transform;
+        data.color = draw.color;
+        data.resources = glm::uvec4(BindlessTable::InvalidIndex);
+
+        for (uint32_t i = 0; i < draw.instanceCount; ++i)
+            pDrawData[slot + i] = data;
+
+        pCommands[d].vertexCount = draw.vertexCount;
+        pCommands[d].instanceCount = draw.instanceCount;
+        pCommands[d].firstVertex = draw.firstVertex;
+        pCommands[d].firstInstance = slot;
+
+        slot += draw.instanceCount;
+    }
+
+    pushBindlessConstants(pCommandBuffer, drawDataRing, drawDataBufferIndex, drawData, vertexBufferAddress);
+
+    uint32_t drawCount = static_cast<uint32_t>(frame.draws.size());
+
+    // host coherent writes before vkQueueSubmit are visible to the indirect read, no barrier needed
+    if (deviceCaps.multiDrawIndirect && deviceCaps.drawIndirectFirstInstance)
+    {
+        for (uint32_t first = 0; first < drawCount; first += deviceCaps.maxDrawIndirectCount)
+        {
+            uint32_t count = std::min(drawCount - first, deviceCaps.maxDrawIndirectCount);
+            vkCmdDrawIndirect(pCommandBuffer, drawDataRing.getBuffer(), indirect.offset + first * sizeof(VkDrawIndirectCommand), count, sizeof(VkDrawIndirectCommand));
+        }
+    }
+    else
+    {
+        // still no per draw binding, only the draw call itself
+        for (uint32_t d = 0; d < drawCount; ++d)
+            vkCmdDraw(pCommandBuffer, pCommands[d].vertexCount, pCommands[d].instanceCount, pCommands[d].firstVertex, pCommands[d].firstInstance);
+    }
+}
+
+
+// options.sceneNodes - the hierarchy is not part of FrameInputs, so captures and replays leave it out
+void VulkanTriangleApp::createScene()
+{
+    if (options.sceneNodes == 0 || isHeadless())
+        return;
+
+    if (instanceBufferIndex == BindlessTable::InvalidIndex || pBindlessPipeline == nullptr || options.shaderObjects)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "--scene-nodes needs the bindless pipeline, the scene is not drawn" << endl;
+        return;
+    }
+
+    uint32_t frameCount = framesInFlight;
+
+    sceneHierarchy.create(frameCount);
+    buildSceneHierarchy(sceneHierarchy, options.sceneNodes);
+
+    // the same block in every region - only the transforms change, and the hierarchy writes those itself
+    for (uint32_t f = 0; f < frameCount; ++f)
+    {
+        instanceRing.beginFrame(f);
+        sceneInstances = instanceRing.allocate(VkDeviceSize(options.sceneNodes) * sizeof(BindlessDrawData));
+
+        BindlessDrawData* pInstances = static_cast<BindlessDrawData*>(sceneInstances.pData);
+        for (uint32_t node = 0; node < options.sceneNodes; ++node)
+        {
+            uint32_t hash = node * 2654435761u;
+
+            BindlessDrawData data{};
+            data.color = glm::vec4(0.4f + 0.6f * ((hash >> 8) & 0xFF) / 255.0f, 0.4f + 0.6f * ((hash >> 16) & 0xFF) / 255.0f, 0.4f + 0.6f * ((hash >> 24) & 0xFF) / 255.0f, 1.0f);
+            data.resources = glm::uvec4(BindlessTable::InvalidIndex);
+
+            pInstances[node] = data;
+        }
+    }
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "scene: " << options.sceneNodes << " nodes in " << frameCount << " instance buffers" << endl;
+}
+
+
+// a 64th of the nodes are roots on a grid, every other node hangs below (node - roots) / 4, so the tree is 4 wide
+// a slice of the nodes turns each frame, which moves everything below it as well
+void VulkanTriangleApp::buildSceneHierarchy(TransformHierarchy& hierarchy, uint32_t nodeCount)
+{
+    uint32_t rootCount = std::max(1u, nodeCount / 64);
+    uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(rootCount))));
+    float cellSize = 2.0f / gridSize;
+
+    for (uint32_t node = 0; node < nodeCount; ++node)
+    {
+        if (node < rootCount)
+        {
+            glm::vec3 position(-1.0f + cellSize * (node % gridSize + 0.5f), -1.0f + cellSize * (node / gridSize + 0.5f), 0.5f);
+            hierarchy.addNode(TransformHierarchy::InvalidNode, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(cellSize * 0.5f));
+        }
+        else
+        {
+            // the 4 children of a node sit on a circle around it, at 0.45 of its size
+            float angle = glm::radians(90.0f * ((node - rootCount) % 4) + 45.0f);
+            glm::vec3 position(std::cos(angle) * 0.6f, std::sin(angle) * 0.6f, 0.0f);
+            hierarchy.addNode((node - rootCount) / 4, position, glm::quat(1.0f, 0.0f, 0.0f, 0.0f), glm::vec3(0.45f));
+        }
+    }
+}
+
+
+void VulkanTriangleApp::updateScene()
+{
+    if (sceneInstances.pData == nullptr)
+        return;
+
+    // every 8th node turns, a different eighth each frame
+    float seconds = static_cast<float>(FrameProfiler::nowNs() * 1e-9);
+    uint32_t nodeCount = sceneHierarchy.getNodeCount();
+
+    for (uint32_t node = static_cast<uint32_t>(sceneFrame % 8); node < nodeCount; node += 8)
+        sceneHierarchy.setRotation(node, glm::angleAxis(seconds * (0.2f + (node % 5) * 0.1f), glm::vec3(0.0f, 0.0f, 1.0f)));
+
+    ++sceneFrame;
+
+    // the frame's fence has been waited on, its region is free - same block offset every time, so the copies cycle in order
+    instanceRing.beginFrame(currentFrame);
+    sceneInstances = instanceRing.allocate(VkDeviceSize(nodeCount) * sizeof(BindlessDrawData));
+
+    sceneHierarchy.update(&jobSystem, sceneInstances.pData, sizeof(BindlessDrawData));
+}
+
+
+// every node is an instance of the one triangle, gl_InstanceIndex picks its slot
+void VulkanTriangleApp::recordSceneDraw(VkCommandBuffer pCommandBuffer)
+{
+    vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pBindlessPipeline);
+    pushBindlessConstants(pCommandBuffer, instanceRing, instanceBufferIndex, sceneInstances, vertexBufferAddress);
+
+    // recordDrawState() bound the triangle's vertex buffer unless the vertices are pulled
+    vkCmdDraw(pCommandBuffer, static_cast<uint32_t>(vertices.size()), sceneHierarchy.getNodeCount(), 0, 0);
+}
+
+
+// options.meshSegments - like the scene, the mesh is not part of FrameInputs
+void VulkanTriangleApp::createMesh()
+{
+    if (options.meshSegments == 0 || isHeadless())
+        return;
+
+    mesh = makeSphereMesh(std::max(2u, options.meshSegments / 2), std::max(3u, options.meshSegments));
+    meshRadius = mesh.getRadius();
+
+    uint64_t lodStartNs = FrameProfiler::nowNs();
+    buildLodChain(mesh, meshLods, options.meshLods ? 8 : 1);
+    double lodMs = (FrameProfiler::nowNs() - lodStartNs) * 1e-6;
+
+    // the mesh shader reads the vertices as a storage buffer, the fallback binds the same bytes as vertex and index buffer
+    // (vertex pulling reads them through the buffer's address)
+    // sizeof(Vertex) keeps the index offset a multiple of 4
+    VkDeviceSize vertexBytes = mesh.vertices.size() * sizeof(Vertex);
+    VkDeviceSize indexBytes = meshLods.indices.size() * sizeof(uint32_t);
+
+    vector<uint8_t> meshBytes(vertexBytes + indexBytes);
+    memcpy(meshBytes.data(), mesh.vertices.data(), vertexBytes);
+    memcpy(meshBytes.data() + vertexBytes, meshLods.indices.data(), indexBytes);
+
+    meshIndexOffset = vertexBytes;
+    createHostBuffer(meshBuffer, meshBytes.data(), meshBytes.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_STORAGE_BUFFER_BIT
+        | (useVertexPulling() ? VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT : 0));
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "mesh: " << mesh.vertices.size() << " vertices, " << meshLods.lods.size() << " levels built in " << lodMs << " ms" << endl;
+
+    for (size_t l = 0; l < meshLods.lods.size(); ++l)
+        out << "\tlevel " << l << ": " << meshLods.lods[l].indexCount / 3 << " triangles, estimated error " << meshLods.lods[l].error << endl;
+
+    out << "mesh: " << options.meshInstances << " instances";
+
+    if (useOcclusionCulling())
+    {
+        occlusionCuller.create(pPhysicalDevice, pDevice, framesInFlight, drawDataRing.getBuffer(),
+            Utils::readFile("shaders/depthPyramidComp.spv"), Utils::readFile("shaders/occlusionCullComp.spv"));
+        occlusionCuller.setDepth(swapChainDepth.pImage, swapChainDepth.pImageView, depthFormat, swapChainExtent);
+
+        out << ", culled in two passes against a " << occlusionCuller.getLevelCount() << " level depth pyramid and drawn indirectly" << endl;
+        return;
+    }
+
+    if (!useMeshShaders())
+    {
+        out << ", drawn from vertex and index buffers" << endl;
+        return;
+    }
+
+    uint64_t startNs = FrameProfiler::nowNs();
+
+    // the meshlets are built per level, so the chain is part of the key
+    uint64_t meshHash = mesh.hash() ^ meshLods.hash();
+
+    bool loaded = !options.meshletCacheFilename.empty() && meshletData.load(options.meshletCacheFilename, meshHash, mesh.vertices.size())
+        && meshletData.getLodCount() == meshLods.lods.size();
+
+    if (!loaded)
+    {
+        buildMeshlets(mesh, meshLods, meshletData);
+
+        if (!options.meshletCacheFilename.empty())
+            meshletData.save(options.meshletCacheFilename, meshHash);
+    }
+
+    double meshletMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+    createHostBuffer(meshletBuffer, meshletData.meshlets.data(), meshletData.meshlets.size() * sizeof(MeshletDesc), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    createHostBuffer(meshletVertexBuffer, meshletData.vertices.data(), meshletData.vertices.size() * sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+    createHostBuffer(meshletTriangleBuffer, meshletData.triangles.data(), meshletData.triangles.size(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT);
+
+    // written once, in the binding order of shaders/meshlet.mesh
+    pMeshletDescriptorSet = descriptorAllocator.allocate(pMeshletSetLayout);
+
+    const HostBuffer* pBuffers[4] = { &meshletBuffer, &meshletVertexBuffer, &meshletTriangleBuffer, &meshBuffer };
+    VkDescriptorBufferInfo bufferInfos[4]{};
+    VkWriteDescriptorSet descriptorWrites[4]{};
+
+    for (uint32_t b = 0; b < 4; ++b)
+    {
+        bufferInfos[b].buffer = pBuffers[b]->pBuffer;
+        bufferInfos[b].offset = 0;
+        bufferInfos[b].range = (pBuffers[b] == &meshBuffer) ? meshIndexOffset : VK_WHOLE_SIZE;
+
+        descriptorWrites[b].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        descriptorWrites[b].dstSet = pMeshletDescriptorSet;
+        descriptorWrites[b].dstBinding = b;
+        descriptorWrites[b].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        descriptorWrites[b].descriptorCount = 1;
+        descriptorWrites[b].pBufferInfo = &bufferInfos[b];
+    }
+
+    vkUpdateDescriptorSets(pDevice, 4, descriptorWrites, 0, nullptr);
+
+    size_t meshletCount = meshletData.meshlets.size();
+    uint64_t meshletVertices = 0;
+    uint64_t meshletTriangles = 0;
+    for (const MeshletDesc& meshlet : meshletData.meshlets)
+    {
+        meshletVertices += meshlet.vertexCount;
+        meshletTriangles += meshlet.triangleCount;
+    }
+
+    out << ", " << meshletCount << " meshlets over all levels, " << static_cast<double>(meshletVertices) / meshletCount << " vertices and "
+        << static_cast<double>(meshletTriangles) / meshletCount << " triangles on average, "
+        << (loaded ? "loaded from " + options.meshletCacheFilename : string("built")) << " in " << meshletMs << " ms" << endl;
+}
+
+
+// options.meshInstances copies of the mesh turn in front of the frame's draws, one per grid cell - each later one is drawn
+// smaller, as if further away, and gets the coarsest level that keeps its error under options.lodErrorPixels
+// past 64 instances the grid fills again one layer further back, behind the larger instances of the layers in front
+glm::mat4 VulkanTriangleApp::getMeshInstanceTransform(uint32_t instance, float seconds, float& radius) const
+{
+    uint32_t instanceCount = options.meshInstances;
+    uint32_t gridSize = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<float>(std::min(instanceCount, 64u)))));
+    uint32_t cell = instance % (gridSize * gridSize);
+    float cellSize = 2.0f / gridSize;
+
+    // the depth range holds the largest sphere (0.45) at 0.5, the further ones are smaller and go back to below 0.8
+    float distance = 1.0f + 7.0f * instance / instanceCount;
+    radius = std::min(0.4f * cellSize, 0.45f) / distance;
+
+    glm::vec3 center(-1.0f + cellSize * (cell % gridSize + 0.5f), -1.0f + cellSize * (cell / gridSize + 0.5f), 0.5f + 0.04f * (distance - 1.0f));
+
+    return glm::translate(glm::mat4(1.0f), center)
+        * glm::rotate(glm::mat4(1.0f), seconds * 0.5f + instance, glm::normalize(glm::vec3(0.3f, 1.0f, 0.1f)))
+        * glm::scale(glm::mat4(1.0f), glm::vec3(radius / meshRadius));
+}
+
+
+void VulkanTriangleApp::recordMeshDraw(VkCommandBuffer pCommandBuffer, VkExtent2D extent)
+{
+    // the transforms have no perspective and no aspect correction, so an instance's radius is the same fraction of the larger side
+    float pixelsPerNdc = 0.5f * std::max(extent.width, extent.height);
+    float seconds = static_cast<float>(FrameProfiler::nowNs() * 1e-9);
+
+    uint32_t instanceCount = options.meshInstances;
+
+    // recordOcclusionCull() wrote the instances and commands, the culled ones have instanceCount 0 by now
+    if (useOcclusionCulling())
+    {
+        recordCulledMeshDraw(pCommandBuffer, extent, meshCullCommands);
+        return;
+    }
+
+    bool meshShaders = (pMeshletPipeline != nullptr);
+
+    if (meshShaders)
+    {
+        // viewport and scissor are dynamic in every pipeline, recordDraws() already set them
+        vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pMeshletPipeline);
+        vkCmdBindDescriptorSets(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pMeshletPipelineLayout, 0, 1, &pMeshletDescriptorSet, 0, nullptr);
+    }
+    else
+    {
+        // the push constant pipeline with the mesh's buffer in place of the triangle
+        uint32_t pipelineId = static_cast<uint32_t>(DrawPipelineId::PushConstants);
+        recordDrawState(pCommandBuffer, extent, pipelineId, options.shaderObjects ? nullptr : selectPipeline(pipelineId));
+
+        VkDeviceSize offset = 0;
+        vkCmdBindVertexBuffers(pCommandBuffer, 0, 1, &meshBuffer.pBuffer, &offset);
+        vkCmdBindIndexBuffer(pCommandBuffer, meshBuffer.pBuffer, meshIndexOffset, VK_INDEX_TYPE_UINT32);
+    }
+
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        float radius = 0.0f;
+        glm::mat4 transform = getMeshInstanceTransform(instance, seconds, radius);
+
+        uint32_t lod = meshLods.selectLod(meshRadius, radius * pixelsPerNdc, options.lodErrorPixels);
+
+        meshTrianglesDrawn += meshLods.lods[lod].indexCount / 3;
+        meshTrianglesFull += meshLods.lods[0].indexCount / 3;
+
+        if (!meshShaders)
+        {
+            pushDrawConstants(pCommandBuffer, transform, glm::vec4(1.0f));
+            vkCmdDrawIndexed(pCommandBuffer, meshLods.lods[lod].indexCount, 1, meshLods.lods[lod].indexOffset, 0, 0);
+            continue;
+        }
+
+        // the transform has no perspective, so one view direction serves every meshlet - clip space +z taken back to model space
+        // (the cone test compares angles, which holds for rotation and uniform scale)
+        MeshletPushConstants constants{};
+        constants.transform = transform;
+        constants.camera = glm::vec4(glm::normalize(glm::inverse(glm::mat3(transform)) * glm::vec3(0.0f, 0.0f, 1.0f)), 0.0f);
+        constants.color = glm::vec4(1.0f);
+        constants.meshletOffset = meshletData.lodOffsets[lod];
+        constants.meshletCount = meshletData.lodOffsets[lod + 1] - meshletData.lodOffsets[lod];
+        vkCmdPushConstants(pCommandBuffer, pMeshletPipelineLayout, VK_SHADER_STAGE_TASK_BIT_EXT | VK_SHADER_STAGE_MESH_BIT_EXT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(constants), &constants);
+
+        // one task workgroup per 32 meshlets (local_size_x of shaders/meshlet.task)
+        pfnCmdDrawMeshTasks(pCommandBuffer, (constants.meshletCount + 31) / 32, 1, 1);
+    }
+}
+
+
+// the mesh instances recordOcclusionCull() wrote, through commands whose instanceCount one of the culls has set
+void VulkanTriangleApp::recordCulledMeshDraw(VkCommandBuffer pCommandBuffer, VkExtent2D extent, const UniformAllocation& commands)
+{
+    uint32_t instanceCount = options.meshInstances;
+
+    // the second pass starts with nothing bound, so the viewport and scissor are set here as well
+    recordDrawState(pCommandBuffer, extent, static_cast<uint32_t>(DrawPipelineId::Bindless), pBindlessPipeline);
+    pushBindlessConstants(pCommandBuffer, drawDataRing, drawDataBufferIndex, meshCullInstances, meshBuffer.address);
+
+    // indices still come through the index buffer, the pulled vertices are read at the fetched index
+    VkDeviceSize offset = 0;
+    if (!useVertexPulling())
+        vkCmdBindVertexBuffers(pCommandBuffer, 0, 1, &meshBuffer.pBuffer, &offset);
+    vkCmdBindIndexBuffer(pCommandBuffer, meshBuffer.pBuffer, meshIndexOffset, VK_INDEX_TYPE_UINT32);
+
+    // one command per instance either way, only multiDrawIndirect takes them in one call
+    uint32_t drawsPerCall = deviceCaps.multiDrawIndirect ? deviceCaps.maxDrawIndirectCount : 1;
+    for (uint32_t first = 0; first < instanceCount; first += drawsPerCall)
+    {
+        uint32_t count = std::min(instanceCount - first, drawsPerCall);
+        vkCmdDrawIndexedIndirect(pCommandBuffer, drawDataRing.getBuffer(), commands.offset + first * sizeof(VkDrawIndexedIndirectCommand),
+            count, sizeof(VkDrawIndexedIndirectCommand));
+    }
+}
+
+
+// before the first render pass - every instance gets its draw data and an indexed indirect command for its level, twice,
+// the culler then zeroes the instanceCount of the ones outside the frustum or hidden in the previous frame's depth
+// (occlusionCuller.recordLate() decides about the second set once the first pass has drawn)
+void VulkanTriangleApp::recordOcclusionCull(VkCommandBuffer pCommandBuffer, VkExtent2D extent)
+{
+    float pixelsPerNdc = 0.5f * std::max(extent.width, extent.height);
+    float seconds = static_cast<float>(FrameProfiler::nowNs() * 1e-9);
+
+    uint32_t instanceCount = options.meshInstances;
+
+    meshCullInstances = drawDataRing.allocate(VkDeviceSize(instanceCount) * sizeof(BindlessDrawData));
+    meshCullCommands = drawDataRing.allocate(VkDeviceSize(instanceCount) * sizeof(VkDrawIndexedIndirectCommand));
+    meshLateCommands = drawDataRing.allocate(VkDeviceSize(instanceCount) * sizeof(VkDrawIndexedIndirectCommand));
+
+    BindlessDrawData* pInstances = static_cast<BindlessDrawData*>(meshCullInstances.pData);
+    VkDrawIndexedIndirectCommand* pCommands = static_cast<VkDrawIndexedIndirectCommand*>(meshCullCommands.pData);
+    VkDrawIndexedIndirectCommand* pLateCommands = static_cast<VkDrawIndexedIndirectCommand*>(meshLateCommands.pData);
+
+    for (uint32_t instance = 0; instance < instanceCount; ++instance)
+    {
+        float radius = 0.0f;
+
+        BindlessDrawData data{};
+        data.transform = getMeshInstanceTransform(instance, seconds, radius);
+        data.color = glm::vec4(1.0f);
+        data.resources = glm::uvec4(BindlessTable::InvalidIndex);
+        pInstances[instance] = data;
+
+        uint32_t lod = meshLods.selectLod(meshRadius, radius * pixelsPerNdc, options.lodErrorPixels);
+
+        meshTrianglesDrawn += meshLods.lods[lod].indexCount / 3;
+        meshTrianglesFull += meshLods.lods[0].indexCount / 3;
+
+        VkDrawIndexedIndirectCommand command{};
+        command.indexCount = meshLods.lods[lod].indexCount;
+        command.instanceCount = 1;
+        command.firstIndex = meshLods.lods[lod].indexOffset;
+        command.vertexOffset = 0;
+        command.firstInstance = instance;
+
+        // the second pass draws the same commands, the late cull sets the instanceCount of the ones it takes back
+        pCommands[instance] = command;
+        pLateCommands[instance] = command;
+    }
+
+    occlusionCuller.recordEarly(pCommandBuffer, currentFrame, static_cast<uint32_t>(meshCullInstances.offset / sizeof(BindlessDrawData)), meshCullCommands.offset,
+        instanceCount, meshRadius);
+}
+
+
+void VulkanTriangleApp::createHostBuffer(HostBuffer& buffer, const void* pData, VkDeviceSize size, VkBufferUsageFlags usage)
+{
+    VkBufferCreateInfo buffInfo{};
+    buffInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
+    buffInfo.size = size;
+    buffInfo.usage = usage;
+    buffInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+    if (vkCreateBuffer(pDevice, &buffInfo, nullptr, &buffer.pBuffer) != VK_SUCCESS)
+        throw runtime_error("failed to create host buffer");
+
+    VkMemoryRequirements memReqs{};
+    vkGetBufferMemoryRequirements(pDevice, buffer.pBuffer, &memReqs);
+
+    VkMemoryAllocateInfo memAlloc{};
+    memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+
+    VkMemoryAllocateFlagsInfo allocFlags{};
+    allocFlags.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_FLAGS_INFO;
+    allocFlags.flags = VK_MEMORY_ALLOCATE_DEVICE_ADDRESS_BIT;
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+        memAlloc.pNext = &allocFlags;
+
+    if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &buffer.pMemory) != VK_SUCCESS)
+        throw runtime_error("failed to allocate host buffer memory");
+
+    vkBindBufferMemory(pDevice, buffer.pBuffer, buffer.pMemory, 0);
+
+    if (usage & VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT)
+        buffer.address = getBufferAddress(buffer.pBuffer);
+
+    void* pMapped = nullptr;
+    vkMapMemory(pDevice, buffer.pMemory, 0, size, 0, &pMapped);
+    memcpy(pMapped, pData, static_cast<size_t>(size));
+    vkUnmapMemory(pDevice, buffer.pMemory);
+
+    buffer.size = size;
+}
+
+
+void VulkanTriangleApp::destroyHostBuffer(HostBuffer& buffer)
+{
+    vkDestroyBuffer(pDevice, buffer.pBuffer, nullptr);
+    vkFreeMemory(pDevice, buffer.pMemory, nullptr);
+    buffer = HostBuffer{};
+}
+
+void VulkanTriangleApp::createOffscreenTarget(VkExtent2D extent)
+{
+    VkImageCreateInfo imageInfo{};
+    imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+    imageInfo.imageType = VK_IMAGE_TYPE_2D;
+    imageInfo.format = swapChainImageFormat;
+    imageInfo.extent = { extent.width, extent.height, 1 };
+    imageInfo.mipLevels = 1;
+    imageInfo.arrayLayers = 1;
+    imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+    imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+    imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT;
+    imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+    if (vkCreateImage(pDevice, &imageInfo, nullptr, &pOffscreenImage) != VK_SUCCESS)
+        throw runtime_error("failed to create offscreen image");
+
+    VkMemoryRequirements memReqs{};
+    vkGetImageMemoryRequirements(pDevice, pOffscreenImage, &memReqs);
+
+    VkMemoryAllocateInfo memAlloc{};
+    memAlloc.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+    memAlloc.allocationSize = memReqs.size;
+    memAlloc.memoryTypeIndex = findMemoryType(memReqs.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+
+    if (vkAllocateMemory(pDevice, &memAlloc, nullptr, &pOffscreenImageMemory) != VK_SUCCESS)
+        throw runtime_error("failed to allocate offscreen image memory");
+
+    vkBindImageMemory(pDevice, pOffscreenImage, pOffscreenImageMemory, 0);
+
+    VkImageViewCreateInfo imageViewCreateInfo{};
+    imageViewCreateInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+    imageViewCreateInfo.image = pOffscreenImage;
+    imageViewCreateInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+    imageViewCreateInfo.format = swapChainImageFormat;
+    imageViewCreateInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+    imageViewCreateInfo.subresourceRange.baseMipLevel = 0;
+    imageViewCreateInfo.subresourceRange.levelCount = 1;
+    imageViewCreateInfo.subresourceRange.baseArrayLayer = 0;
+    imageViewCreateInfo.subresourceRange.layerCount = 1;
+
+    if (vkCreateImageView(pDevice, &imageViewCreateInfo, nullptr, &pOffscreenImageView) != VK_SUCCESS)
+        throw runtime_error("failed to create offscreen image view");
+
+    offscreenExtent = extent;
+
+    if (options.renderGraph)
+        return;
+
+    createTransientAttachment(offscreenDepth, depthFormat, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, VK_IMAGE_ASPECT_DEPTH_BIT, extent);
+
+    if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+        createTransientAttachment(offscreenColor, swapChainImageFormat, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT, VK_IMAGE_ASPECT_COLOR_BIT, extent);
+
+    // dynamic rendering renders to the views directly
+    if (options.dynamicRendering)
+        return;
+
+    vector<VkImageView> attachments = { pOffscreenImageView, offscreenDepth.pImageView };
+    if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+        attachments = { offscreenColor.pImageView, offscreenDepth.pImageView, pOffscreenImageView };
+
+    VkFramebufferCreateInfo framebufferCreateInfo{};
+    framebufferCreateInfo.sType = VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO;
+    framebufferCreateInfo.renderPass = pRenderPass;
+    framebufferCreateInfo.attachmentCount = static_cast<uint32_t>(attachments.size());
+    framebufferCreateInfo.pAttachments = attachments.data();
+    framebufferCreateInfo.width = extent.width;
+    framebufferCreateInfo.height = extent.height;
+    framebufferCreateInfo.layers = 1;
+
+    if (vkCreateFramebuffer(pDevice, &framebufferCreateInfo, nullptr, &pOffscreenFramebuffer) != VK_SUCCESS)
+        throw runtime_error("failed to create offscreen framebuffer");
+}
+
+
+void VulkanTriangleApp::destroyOffscreenTarget()
+{
+    vkDestroyFramebuffer(pDevice, pOffscreenFramebuffer, nullptr);
+    vkDestroyImageView(pDevice, pOffscreenImageView, nullptr);
+    vkDestroyImage(pDevice, pOffscreenImage, nullptr);
+    vkFreeMemory(pDevice, pOffscreenImageMemory, nullptr);
+
+    destroyTransientAttachment(offscreenDepth);
+    destroyTransientAttachment(offscreenColor);
+
+    pOffscreenFramebuffer = nullptr;
+    pOffscreenImageView = nullptr;
+    pOffscreenImage = nullptr;
+    pOffscreenImageMemory = nullptr;
+    offscreenExtent = { 0, 0 };
+}
+
+
+void VulkanTriangleApp::replayLoop()
+{
+    vector<FrameInputs> replayFrames = FrameCapture::load(options.replayFilename);
+    if (replayFrames.empty())
+        throw runtime_error("frame capture has no frames");
+
+    frameProfiler.reset();
+
+    uint64_t framesReplayed = 0;
+    uint64_t startNs = FrameProfiler::nowNs();
+
+    for (uint32_t loop = 0; loop < options.replayLoops; ++loop)
+    {
+        for (const FrameInputs& frame : replayFrames)
+        {
+            drawReplayFrame(frame);
+            ++framesReplayed;
+        }
+    }
+
+    vkDeviceWaitIdle(pDevice);
+
+    double elapsedMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "replayed " << framesReplayed << " frames (" << replayFrames.size() << " x " << options.replayLoops << ") in "
+        << elapsedMs << " ms, " << (framesReplayed * 1000.0 / elapsedMs) << " frames/s" << endl;
+}
+
+
+// same work as drawFrame() without acquire/present so frames are only bound by CPU recording and GPU execution
+void VulkanTriangleApp::drawReplayFrame(const FrameInputs& frame)
+{
+    FrameProfiler::ScopedFrame scopedFrame(frameProfiler);
+
+    VkExtent2D extent = { frame.width, frame.height };
+    if (extent.width == 0 || extent.height == 0)
+        extent = swapChainExtent;
+
+    if (pOffscreenImage == nullptr || extent.width != offscreenExtent.width || extent.height != offscreenExtent.height)
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Recreate);
+
+        vkDeviceWaitIdle(pDevice);
+        destroyOffscreenTarget();
+        createOffscreenTarget(extent);
+    }
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::FenceWait);
+        vkWaitForFences(pDevice, 1, &inFlightFences[currentFrame], VK_TRUE, UINT64_MAX);
+    }
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Reset);
+
+        vkResetFences(pDevice, 1, &inFlightFences[currentFrame]);
+        vkResetCommandBuffer(commandBuffers[currentFrame], 0);
+    }
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Record);
+
+        RenderTarget target;
+        target.pFramebuffer = pOffscreenFramebuffer;
+        target.pImage = pOffscreenImage;
+        target.pImageView = pOffscreenImageView;
+        target.pColorImage = offscreenColor.pImage;
+        target.pColorImageView = offscreenColor.pImageView;
+        target.pDepthImage = offscreenDepth.pImage;
+        target.pDepthImageView = offscreenDepth.pImageView;
+        target.extent = offscreenExtent;
+
+        applyBufferUpdates(frame);
+        recordCommandBuffer(commandBuffers[currentFrame], target, frame);
+    }
+
+    submitBatcher.addCommandBuffer(pGraphicsQueue, commandBuffers[currentFrame]);
+
+    if (pFrameTimeline != nullptr)
+        submitBatcher.addSignal(pGraphicsQueue, pFrameTimeline, VK_PIPELINE_STAGE_2_ALL_COMMANDS_BIT, ++frameTimelineValue);
+
+    {
+        FrameProfiler::ScopedPhase phase(frameProfiler, FramePhase::Submit);
+
+        submitBatcher.submitAll(inFlightFences[currentFrame]);
+        submitBatcher.endFrame();
+    }
+
+    currentFrame = (currentFrame + 1) % commandBuffers.size();
+}
+
+
+// deterministic field of small triangles so every run and every path records identical draws
+// each triangle gets its own depth, so the draw order decides how much early-Z rejects
+FrameInputs VulkanTriangleApp::buildStressFrame(uint32_t drawCount)
+{
+    FrameInputs stressFrame;
+    stressFrame.width = swapChainExtent.width;
+    stressFrame.height = swapChainExtent.height;
+    stressFrame.draws.resize(drawCount);
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> position(-1.0f, 1.0f);
+    std::uniform_real_distribution<float> depth(0.05f, 0.95f);
+    std::uniform_real_distribution<float> scale(0.02f, 0.05f);
+    std::uniform_real_distribution<float> channel(0.25f, 1.0f);
+
+    for (DrawCommand& draw : stressFrame.draws)
+    {
+        float s = scale(rng);
+        glm::vec3 origin(position(rng), position(rng), depth(rng));
+
+        draw.vertexCount = static_cast<uint32_t>(vertices.size());
+        draw.transform = glm::scale(glm::translate(glm::mat4(1.0f), origin), glm::vec3(s, s, 1.0f));
+        draw.color = glm::vec4(channel(rng), channel(rng), channel(rng), 1.0f);
+    }
+
+    return stressFrame;
+}
+
+
+void VulkanTriangleApp::benchmarkDrawData()
+{
+    FrameInputs stressFrame = buildStressFrame(options.benchDrawCount);
+
+    if (options.sortDraws)
+        drawSorter.sort(stressFrame.draws);
+
+    const DrawPipelineId paths[] = { DrawPipelineId::UniformRing, DrawPipelineId::PushConstants, DrawPipelineId::Bindless };
+    const char* pathNames[] = { "uniform ring", "push constants", "bindless indirect" };
+    uint32_t pathCount = deviceCaps.HasBindless() ? 3 : 2;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "per draw data benchmark: " << options.benchDrawCount << " draws x " << options.benchFrames << " frames" << endl;
+
+    for (uint32_t p = 0; p < pathCount; ++p)
+    {
+        stressFrame.pipelineId = static_cast<uint32_t>(paths[p]);
+
+        // warm up outside the measured window (offscreen target, driver caches)
+        drawReplayFrame(stressFrame);
+        vkDeviceWaitIdle(pDevice);
+        frameProfiler.reset();
+
+        uint64_t startNs = FrameProfiler::nowNs();
+
+        for (uint32_t frame = 0; frame < options.benchFrames; ++frame)
+            drawReplayFrame(stressFrame);
+
+        vkDeviceWaitIdle(pDevice);
+
+        double elapsedMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+        FrameStats stats = frameProfiler.getStats();
+        const FramePhaseStats& record = stats.phases[static_cast<uint32_t>(FramePhase::Record)];
+
+        out << "\t" << pathNames[p] << ": record " << record.avgMs << " ms avg (" << record.minMs << " / " << record.maxMs << ")"
+            << ", frame " << stats.frame.avgMs << " ms avg, " << (options.benchFrames * 1000.0 / elapsedMs) << " frames/s" << endl;
+    }
+}
+
+
+// the same stress scene submitted in each DrawSorter::Order, overdraw = fragment shader invocations per covered pixel
+void VulkanTriangleApp::benchmarkOverdraw()
+{
+    if (pStatsQueryPool == nullptr)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "pipeline statistics queries are not supported, overdraw can not be measured" << endl;
+        return;
+    }
+
+    // larger triangles than the draw data benchmark so they overlap
+    FrameInputs baseFrame = buildStressFrame(options.benchOverdrawCount);
+    for (DrawCommand& draw : baseFrame.draws)
+        draw.transform = glm::scale(draw.transform, glm::vec3(8.0f, 8.0f, 1.0f));
+
+    const DrawSorter::Order orders[] = { DrawSorter::Order::Submission, DrawSorter::Order::BackToFront, DrawSorter::Order::FrontToBack };
+    const char* orderNames[] = { "submission", "back to front", "front to back" };
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "overdraw benchmark: " << options.benchOverdrawCount << " draws x " << options.benchFrames << " frames" << endl;
+
+    for (size_t o = 0; o < std::size(orders); ++o)
+    {
+        FrameInputs frame = baseFrame;
+        drawSorter.sort(frame.draws, orders[o]);
+
+        // warm up outside the measured window
+        drawReplayFrame(frame);
+        vkDeviceWaitIdle(pDevice);
+        frameProfiler.reset();
+
+        uint64_t startNs = FrameProfiler::nowNs();
+
+        for (uint32_t i = 0; i < options.benchFrames; ++i)
+            drawReplayFrame(frame);
+
+        vkDeviceWaitIdle(pDevice);
+        double elapsedMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+        // every frame is identical, the query of the last one recorded is representative
+        uint32_t query = static_cast<uint32_t>((currentFrame + commandBuffers.size() - 1) % commandBuffers.size());
+        uint64_t invocations = 0;
+        vkGetQueryPoolResults(pDevice, pStatsQueryPool, query, 1, sizeof(invocations), &invocations, sizeof(invocations), VK_QUERY_RESULT_64_BIT | VK_QUERY_RESULT_WAIT_BIT);
+
+        double pixels = static_cast<double>(offscreenExtent.width) * offscreenExtent.height;
+        FrameStats stats = frameProfiler.getStats();
+
+        out << "\t" << orderNames[o] << ": " << invocations << " fragment invocations, overdraw " << (invocations / pixels)
+            << "x, frame " << stats.frame.avgMs << " ms avg, " << (options.benchFrames * 1000.0 / elapsedMs) << " frames/s" << endl;
+    }
+}
+
+
+// a deferred style frame compiled but never executed - shows culling, barrier count and how much aliasing saves
+void VulkanTriangleApp::benchmarkRenderGraph()
+{
+    VkExtent2D full = swapChainExtent;
+    VkExtent2D half = { std::max(1u, full.width / 2), std::max(1u, full.height / 2) };
+
+    const RenderGraphImageDesc hdrDesc = { VK_FORMAT_R16G16B16A16_SFLOAT, full, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
+    const RenderGraphImageDesc bloomDesc = { VK_FORMAT_R16G16B16A16_SFLOAT, half, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT };
+
+    RenderGraph::Execute nothing = [](VkCommandBuffer) {};
+
+    renderGraph.reset();
+
+    uint32_t backbuffer = renderGraph.importImage("backbuffer", nullptr, nullptr, { swapChainImageFormat, full, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT },
+        VK_IMAGE_LAYOUT_UNDEFINED, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+
+    uint32_t depth = renderGraph.createImage("depth", { depthFormat, full, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_DEPTH_BIT });
+    uint32_t albedo = renderGraph.createImage("albedo", hdrDesc);
+    uint32_t ao = renderGraph.createImage("ao", { VK_FORMAT_R8_UNORM, full, VK_SAMPLE_COUNT_1_BIT, VK_IMAGE_ASPECT_COLOR_BIT });
+    uint32_t lit = renderGraph.createImage("lit", hdrDesc);
+    uint32_t bright = renderGraph.createImage("bright", bloomDesc);
+    uint32_t blurH = renderGraph.createImage("blur h", bloomDesc);
+    uint32_t blurV = renderGraph.createImage("blur v", bloomDesc);
+    uint32_t debugView = renderGraph.createImage("debug view", hdrDesc);
+
+    uint32_t pass = renderGraph.addPass("gbuffer", nothing);
+    renderGraph.write(pass, albedo, RenderGraphUsage::ColorAttachment);
+    renderGraph.write(pass, depth, RenderGraphUsage::DepthAttachment);
+
+    pass = renderGraph.addPass("ssao", nothing);
+    renderGraph.read(pass, depth, RenderGraphUsage::SampledCompute);
+    renderGraph.write(pass, ao, RenderGraphUsage::StorageCompute);
+
+    pass = renderGraph.addPass("lighting", nothing);
+    renderGraph.read(pass, albedo, RenderGraphUsage::SampledFragment);
+    renderGraph.read(pass, ao, RenderGraphUsage::SampledFragment);
+    renderGraph.write(pass, lit, RenderGraphUsage::ColorAttachment);
+
+    // nothing reads it, so it is culled and gets no memory
+    pass = renderGraph.addPass("debug view", nothing);
+    renderGraph.read(pass, depth, RenderGraphUsage::SampledFragment);
+    renderGraph.write(pass, debugView, RenderGraphUsage::ColorAttachment);
+
+    pass = renderGraph.addPass("bright pass", nothing);
+    renderGraph.read(pass, lit, RenderGraphUsage::SampledFragment);
+    renderGraph.write(pass, bright, RenderGraphUsage::ColorAttachment);
+
+    pass = renderGraph.addPass("blur h", nothing);
+    renderGraph.read(pass, bright, RenderGraphUsage::SampledFragment);
+    renderGraph.write(pass, blurH, RenderGraphUsage::ColorAttachment);
+
+    pass = renderGraph.addPass("blur v", nothing);
+    renderGraph.read(pass, blurH, RenderGraphUsage::SampledFragment);
+    renderGraph.write(pass, blurV, RenderGraphUsage::ColorAttachment);
+
+    pass = renderGraph.addPass("tonemap", nothing);
+    renderGraph.read(pass, lit, RenderGraphUsage::SampledFragment);
+    renderGraph.read(pass, blurV, RenderGraphUsage::SampledFragment);
+    renderGraph.write(pass, backbuffer, RenderGraphUsage::ColorAttachment);
+
+    renderGraph.compile();
+    renderGraph.logStats();
+
+    renderGraph.reset();
+}
+
+
+// swapchain rebuild cost of the active path - the render pass path also recreates a framebuffer per image
+void VulkanTriangleApp::benchmarkResize()
+{
+    const VkExtent2D sizes[] = { { WIDTH, HEIGHT }, { WIDTH * 3 / 4, HEIGHT * 3 / 4 } };
+
+    double totalMs = 0.0;
+    double minMs = std::numeric_limits<double>::max();
+    double maxMs = 0.0;
+
+    for (uint32_t i = 0; i < options.benchResizeCount; ++i)
+    {
+        const VkExtent2D& size = sizes[i % 2];
+        glfwSetWindowSize(pWindow, static_cast<int>(size.width), static_cast<int>(size.height));
+        glfwPollEvents();
+
+        uint64_t startNs = FrameProfiler::nowNs();
+        recreateSwapChain();
+        double elapsedMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+        totalMs += elapsedMs;
+        minMs = std::min(minMs, elapsedMs);
+        maxMs = std::max(maxMs, elapsedMs);
+    }
+
+    uint32_t pipelineCount = 0;
+    for (VkPipeline pPipeline : { pGraphicsPipeline, pPushConstantPipeline, pBindlessPipeline })
+        pipelineCount += (pPipeline != nullptr) ? 1 : 0;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << (options.dynamicRendering ? "dynamic rendering" : "render pass") << " resize: " << options.benchResizeCount << " swapchain recreations, "
+        << (totalMs / options.benchResizeCount) << " ms avg (" << minMs << " / " << maxMs << ")" << endl;
+    out << "\tpipelines " << pipelineCount << ", render passes " << (pRenderPass != nullptr ? 1 : 0)
+        << ", framebuffers " << swapChainFramebuffers.size() << endl;
+}
+
+
+void VulkanTriangleApp::benchmarkPipelineVariants()
+{
+    if (!options.pipelineLibrary)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "graphics pipeline libraries are not available, no variants to link" << endl;
+        return;
+    }
+
+    // every combination of program, topology, cull mode and blending - the state explosion a monolithic compile pays for each
+    vector<PipelineVariant> variants;
+    uint32_t programCount = deviceCaps.HasBindless() ? 3 : 2;
+
+    for (uint32_t program = 0; program < programCount; ++program)
+        for (VkPrimitiveTopology topology : PipelineLibrary::Topologies)
+            for (VkCullModeFlags cullMode : PipelineLibrary::CullModes)
+                for (bool blendEnable : { false, true })
+                    variants.push_back({ program, topology, cullMode, blendEnable });
+
+    double maxMs = 0.0;
+    uint64_t startNs = FrameProfiler::nowNs();
+
+    for (const PipelineVariant& variant : variants)
+    {
+        uint64_t linkStartNs = FrameProfiler::nowNs();
+        pipelineLibrary.getPipeline(variant);
+        maxMs = std::max(maxMs, (FrameProfiler::nowNs() - linkStartNs) * 1e-6);
+    }
+
+    double fastLinkMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+    pipelineLibrary.waitForOptimized();
+    double optimizedMs = (FrameProfiler::nowNs() - startNs) * 1e-6;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "pipeline library: " << pipelineLibrary.getLibraryCount() << " libraries, " << variants.size() << " variants" << endl;
+    out << "\tfast link " << fastLinkMs << " ms total, " << (fastLinkMs / variants.size()) << " ms avg, " << maxMs << " ms max"
+        << " (fastLinking " << boolalpha << deviceCaps.graphicsPipelineLibraryFastLinking << noboolalpha << ")" << endl;
+    out << "\toptimized links done after " << optimizedMs << " ms" << endl;
+}
+
+
+// spawn cost, stealing and parallelFor scaling of the job system, then serial against parallel recording
+void VulkanTriangleApp::benchmarkJobSystem()
+{
+    const uint32_t spawnCount = 100000;
+    const uint32_t workCount = 1 << 20;
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "job system benchmark: " << jobSystem.getThreadCount() << " threads" << endl;
+
+    // empty jobs - what scheduling alone costs
+    jobSystem.resetStats();
+    {
+        std::atomic<uint32_t> ran{ 0 };
+        std::atomic<uint32_t>* pRan = &ran;
+
+        uint64_t startNs = FrameProfiler::nowNs();
+
+        JobCounter counter;
+        for (uint32_t i = 0; i < spawnCount; ++i)
+            jobSystem.run(counter, [pRan]() { pRan->fetch_add(1, std::memory_order_relaxed); });
+
+        jobSystem.wait(counter);
+
+        double elapsedNs = static_cast<double>(FrameProfiler::nowNs() - startNs);
+        JobSystemStats stats = jobSystem.getStats();
+
+        out << "\tspawn: " << spawnCount << " empty jobs in " << elapsedNs * 1e-6 << " ms, " << elapsedNs / spawnCount << " ns per job, "
+            << stats.jobsStolen << " stolen, " << stats.jobsInlined << " inlined" << endl;
+    }
+
+    // a fixed amount of arithmetic per element, so the time only depends on how well it spreads
+    vector<float> values(workCount);
+    float* pValues = values.data();
+
+    auto work = [pValues](uint32_t begin, uint32_t end)
+    {
+        for (uint32_t i = begin; i < end; ++i)
+        {
+            float x = static_cast<float>(i);
+            for (uint32_t k = 0; k < 64; ++k)
+                x = x * 0.999f + 0.5f;
+
+            pValues[i] = x;
+        }
+    };
+
+    uint32_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    uint32_t restoreWorkers = jobSystem.getWorkerCount();
+    double singleMs = 0.0;
+
+    // doubling, then all cores as the last step when that is not a power of two
+    for (uint32_t threads = 1;; threads = std::min(threads * 2, maxThreads))
+    {
+        jobSystem.create(threads - 1);
+
+        // warm up, the workers start asleep
+        jobSystem.parallelFor(workCount, 1024, work);
+
+        uint64_t startNs = FrameProfiler::nowNs();
+        for (uint32_t repeat = 0; repeat < 8; ++repeat)
+            jobSystem.parallelFor(workCount, 1024, work);
+
+        double elapsedMs = (FrameProfiler::nowNs() - startNs) * 1e-6 / 8;
+        if (threads == 1)
+            singleMs = elapsedMs;
+
+        out << "\tparallelFor " << threads << " threads: " << elapsedMs << " ms, speedup " << singleMs / elapsedMs << endl;
+
+        if (threads == maxThreads)
+            break;
+    }
+
+    jobSystem.create(restoreWorkers);
+
+    // the secondary command buffers were sized for the original thread count, which is back now
+    if (recordPools.empty())
+        return;
+
+    // --bench-draw-data sizes the uniform ring for its draw count, otherwise as many draws as the default ring holds
+    uint32_t drawCount = options.benchDrawCount > 0 ? options.benchDrawCount : static_cast<uint32_t>(uniformRing.getBytesPerFrame() / 256);
+    FrameInputs stressFrame = buildStressFrame(drawCount);
+
+    const bool modes[] = { false, true };
+    for (bool parallel : modes)
+    {
+        options.parallelRecord = parallel;
+
+        drawReplayFrame(stressFrame);
+        vkDeviceWaitIdle(pDevice);
+        frameProfiler.reset();
+
+        for (uint32_t frame = 0; frame < options.benchFrames; ++frame)
+            drawReplayFrame(stressFrame);
+
+        vkDeviceWaitIdle(pDevice);
+
+        FrameStats stats = frameProfiler.getStats();
+        const FramePhaseStats& record = stats.phases[static_cast<uint32_t>(FramePhase::Record)];
+
+        out << "\t" << (parallel ? "parallel" : "serial") << " record of " << stressFrame.draws.size() << " draws: " << record.avgMs << " ms avg ("
+            << record.minMs << " / " << record.maxMs << ")" << endl;
+    }
+}
+
+
+// a third of the objects or so end up inside, so both the test and the index writes are measured
+// every instruction set has to produce the scalar result, anything else is a bug in a kernel
+void VulkanTriangleApp::benchmarkCulling()
+{
+    const uint32_t repeats = 16;
+    uint32_t count = options.benchCullCount;
+
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-30.0f, 30.0f);
+    std::uniform_real_distribution<float> size(0.1f, 2.0f);
+
+    SphereBounds spheres;
+    BoxBounds boxes;
+    spheres.resize(count);
+    boxes.resize(count);
+
+    for (uint32_t i = 0; i < count; ++i)
+    {
+        glm::vec3 center(position(rng), position(rng), position(rng) - 40.0f);
+        spheres.set(i, center, size(rng));
+        boxes.set(i, center, glm::vec3(size(rng), size(rng), size(rng)));
+    }
+
+    glm::mat4 view = glm::lookAt(glm::vec3(0.0f), glm::vec3(0.0f, 0.0f, -1.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+    // zero to one depth, the range Frustum::fromMatrix() expects
+    glm::mat4 projection = glm::perspectiveRH_ZO(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 100.0f);
+    Frustum frustum = Frustum::fromMatrix(projection * view);
+
+    FrustumCuller culler;
+    CullIsa best = FrustumCuller::detectIsa();
+
+    vector<uint32_t> referenceSpheres;
+    vector<uint32_t> referenceBoxes;
+    culler.setIsa(CullIsa::Scalar);
+    culler.cullSpheres(nullptr, frustum, spheres, referenceSpheres);
+    culler.cullBoxes(nullptr, frustum, boxes, referenceBoxes);
+
+    Logging::LogStream out(LogLevel::Info);
+    out << "culling benchmark: " << count << " objects, " << referenceSpheres.size() << " spheres and " << referenceBoxes.size()
+        << " boxes visible, best instruction set " << cullIsaName(best) << endl;
+
+    vector<uint32_t> visibleIndices;
+
+    for (CullIsa isa : { CullIsa::Scalar, CullIsa::Sse, CullIsa::Avx2 })
+    {
+        if (isa > best)
+            break;
+
+        culler.setIsa(isa);
 
-    // notice that bRecreateSwapChain is set to its current value if the other checks are false
-    bRecreateSwapChain = (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR || framebufferResized ? true : bRecreateSwapChain);
+        for (JobSystem* pJobs : { static_cast<JobSystem*>(nullptr), &jobSystem })
+        {
+            uint64_t startNs = FrameProfiler::nowNs();
+            for (uint32_t r = 0; r < repeats; ++r)
+                culler.cullSpheres(pJobs, frustum, spheres, visibleIndices);
+            double sphereMs = (FrameProfiler::nowNs() - startNs) * 1e-6 / repeats;
+            bool spheresMatch = visibleIndices == referenceSpheres;
 
-    if (bRecreateSwapChain)
-    {
-        framebufferResized = false;
-        recreateSwapChain();
-        return;
-    }
+            startNs = FrameProfiler::nowNs();
+            for (uint32_t r = 0; r < repeats; ++r)
+                culler.cullBoxes(pJobs, frustum, boxes, visibleIndices);
+            double boxMs = (FrameProfiler::nowNs() - startNs) * 1e-6 / repeats;
+            bool boxesMatch = visibleIndices == referenceBoxes;
 
-    currentFrame = (currentFrame + 1) % swapChainImageViews.size();
+            uint32_t threads = (pJobs != nullptr) ? jobSystem.getThreadCount() : 1;
+
+            out << "\t" << cullIsaName(isa) << ", " << threads << " thread(s): spheres " << count / sphereMs << " objects/ms, boxes " << count / boxMs << " objects/ms" << endl;
+
+            if (!spheresMatch || !boxesMatch)
+            {
+                Logging::LogStream warning(LogLevel::Warning);
+                warning << cullIsaName(isa) << " culling differs from the scalar result" << endl;
+            }
+        }
+    }
 }
 
 
-void VulkanTriangleApp::recordCommandBuffer(VkCommandBuffer pCommandBuffer, uint32_t imageIndex)
+// the same tree as --scene-nodes, written to host memory laid out like the instance buffer
+// the last path's worlds have to match a scalar single thread run of the same updates
+void VulkanTriangleApp::benchmarkTransforms()
 {
-    // VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT      - command buffer will be rerecorded right after excution
-    // VK_COMMAND_BUFFER_USAGE_RENDER_PASS_COMTINUE_BIT - a secondary command buffer that will be entirely within a single render pass
-    // VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT     - command buffer can be resubmitted while it is also already pending execution
-    VkCommandBufferBeginInfo beginInfo{};
-    beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-    beginInfo.flags = 0;
-    beginInfo.pInheritanceInfo = nullptr;
+    const uint32_t repeats = 8;
+    uint32_t count = options.benchTransformCount;
 
-    // if the command buffer was already recorded it will be implicitly reset
-    if (vkBeginCommandBuffer(pCommandBuffer, &beginInfo) != VK_SUCCESS)
-        throw runtime_error("failed to begin command buffer recording");
+    vector<BindlessDrawData> instances(count);
 
-    // starting render pass
-    VkClearValue clearColor = { {{0.0f, 0.0f, 0.0f, 1.0f}} };
+    // every node, or every 10th node, turns - with all the subtrees below them
+    auto turn = [count](TransformHierarchy& hierarchy, uint32_t step, uint32_t every)
+    {
+        for (uint32_t node = step % every; node < count; node += every)
+            hierarchy.setRotation(node, glm::angleAxis(0.01f * (step + 1) * (1 + node % 7), glm::vec3(0.0f, 0.0f, 1.0f)));
+    };
 
-    // VK_SUBPASS_CONTENTS_INLINE                    - render pass commands are embedded in the primary command buffer
-    // VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS - renedr pass commands will be executed from seconday command buffers
-    VkRenderPassBeginInfo renderPassInfo{};
-    renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-    renderPassInfo.renderPass = pRenderPass;
-    renderPassInfo.framebuffer = swapChainFramebuffers[imageIndex];
-    renderPassInfo.renderArea.offset = { 0, 0 };
-    renderPassInfo.renderArea.extent = swapChainExtent;
+    TransformHierarchy hierarchy;
+    hierarchy.create(1);
+    buildSceneHierarchy(hierarchy, count);
 
-    renderPassInfo.clearValueCount = 1;
-    renderPassInfo.pClearValues = &clearColor;
+    // sorts the tree, so the first measured update does not
+    hierarchy.update(nullptr, instances.data(), sizeof(BindlessDrawData));
 
-    vkCmdBeginRenderPass(pCommandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+    Logging::LogStream out(LogLevel::Info);
+    out << "transform benchmark: " << count << " nodes, " << hierarchy.getStats().depthCount << " levels" << endl;
 
-    vkCmdBindPipeline(pCommandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pGraphicsPipeline);
+    for (bool simd : { false, true })
+    {
+        hierarchy.setSimd(simd);
 
-    VkViewport viewport{};
-    viewport.x = 0.0f;
-    viewport.y = 0.0f;
-    viewport.width = static_cast<float>(swapChainExtent.width);
-    viewport.height = static_cast<float>(swapChainExtent.height);
-    viewport.minDepth = 0.0f;
-    viewport.maxDepth = 1.0f;
-    vkCmdSetViewport(pCommandBuffer, 0, 1, &viewport);
+        for (JobSystem* pJobs : { static_cast<JobSystem*>(nullptr), &jobSystem })
+        {
+            double ms[2] = {};
+            uint64_t recomputed[2] = {};
 
-    VkRect2D scissor{};
-    scissor.offset = { 0, 0 };
-    scissor.extent = swapChainExtent;
-    vkCmdSetScissor(pCommandBuffer, 0, 1, &scissor);
+            for (uint32_t pass = 0; pass < 2; ++pass)
+            {
+                for (uint32_t r = 0; r < repeats; ++r)
+                {
+                    turn(hierarchy, r, (pass == 0) ? 1 : 10);
+
+                    uint64_t startNs = FrameProfiler::nowNs();
+                    hierarchy.update(pJobs, instances.data(), sizeof(BindlessDrawData));
+                    ms[pass] += (FrameProfiler::nowNs() - startNs) * 1e-6;
+                    recomputed[pass] += hierarchy.getStats().recomputed;
+                }
+            }
 
-    VkBuffer vertexBuffers[] = { pVertexBuffer };
-    VkDeviceSize offsets[] = { 0 };
-    vkCmdBindVertexBuffers(pCommandBuffer, 0, 1, vertexBuffers, offsets);
+            uint32_t threads = (pJobs != nullptr) ? jobSystem.getThreadCount() : 1;
 
-    // draw NDC triangle
-    // vertexCount, instanceCount, firstVertex, firstInstance
-    vkCmdDraw(pCommandBuffer, (uint32_t)vertices.size(), 1, 0, 0);
+            out << "\t" << (simd ? "sse" : "scalar") << ", " << threads << " thread(s): all dirty " << recomputed[0] / ms[0] << " transforms/ms, a tenth dirty "
+                << recomputed[1] / ms[1] << " transforms/ms (" << recomputed[1] / repeats << " recomputed per update)" << endl;
+        }
+    }
 
-    // end render pass
-    vkCmdEndRenderPass(pCommandBuffer);
+    TransformHierarchy reference;
+    reference.create(1);
+    reference.setSimd(false);
+    buildSceneHierarchy(reference, count);
 
-    // end command buffer recording
-    if (vkEndCommandBuffer(pCommandBuffer) != VK_SUCCESS)
-        throw runtime_error("failed to end command buffer");
+    for (uint32_t pass = 0; pass < 2; ++pass)
+    {
+        for (uint32_t r = 0; r < repeats; ++r)
+            turn(reference, r, (pass == 0) ? 1 : 10);
+    }
+
+    reference.update(nullptr, instances.data(), sizeof(BindlessDrawData));
+
+    float maxError = 0.0f;
+    for (uint32_t node = 0; node < count; ++node)
+    {
+        const glm::mat4& world = hierarchy.getWorld(node);
+        const glm::mat4& expected = reference.getWorld(node);
+
+        for (int c = 0; c < 4; ++c)
+        {
+            for (int r = 0; r < 4; ++r)
+                maxError = std::max(maxError, std::abs(world[c][r] - expected[c][r]));
+        }
+    }
+
+    if (maxError > 1e-4f)
+    {
+        Logging::LogStream warning(LogLevel::Warning);
+        warning << "transform updates differ from the scalar result by " << maxError << endl;
+    }
 }
 
 
@@ -1013,34 +3770,12 @@ bool VulkanTriangleApp::isDeviceSuitable(const VkPhysicalDevice& physicalDevice,
 }
 
 
-uint32_t VulkanTriangleApp::rateDeviceSuitability(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile)
+// runs on the job system, so it only writes queueIndices - the properties and features are logged by logDeviceReport
+uint32_t VulkanTriangleApp::rateDeviceSuitability(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile, QueueFamilyIndices& queueIndices)
 {
     VkPhysicalDeviceProperties deviceProperties;
     vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
 
-    if (logProfile.logProps) {
-        Logging::logDeviceProps(deviceProperties);
-    }
-
-    if (logProfile.logLimits) {
-        Logging::logDeviceLimits(deviceProperties.limits);
-    }
-
-    if (logProfile.logSparseProps) {
-        Logging::logDeviceSparseProps(deviceProperties.sparseProperties);
-    }
-
-    VkPhysicalDeviceFeatures deviceFeatures;
-    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
-
-    if (logProfile.logFeatures) {
-        Logging::logDeviceFeatures(deviceFeatures);
-    }
-
-    // need geometry shader
-    if (!deviceFeatures.geometryShader)
-        return 0;
-
     // need swapchain
     if (!checkDeviceExtensionSupport(physicalDevice, logProfile))
         return 0;
@@ -1052,18 +3787,18 @@ uint32_t VulkanTriangleApp::rateDeviceSuitability(const VkPhysicalDevice& physic
     if (!swapChainAdequate)
         return false;
 
-    queueFamilyIndices = findQueueFamilies(physicalDevice, logProfile);
+    queueIndices = findQueueFamilies(physicalDevice, logProfile);
 
     // need graphics queue
-    if (!queueFamilyIndices.HasGraphicsQueue())
+    if (!queueIndices.HasGraphicsQueue())
         return 0;
 
     // need present queue
-    if (!queueFamilyIndices.HasPresentQueue())
+    if (!queueIndices.HasPresentQueue())
         return 0;
 
     // need compute queue
-    if (!queueFamilyIndices.HasComputeQueue())
+    if (!queueIndices.HasComputeQueue())
         return 0;
 
     uint32_t score = 0;
@@ -1079,6 +3814,40 @@ uint32_t VulkanTriangleApp::rateDeviceSuitability(const VkPhysicalDevice& physic
 }
 
 
+// everything rateDeviceSuitability looks at, from one thread so the lines of one device stay together
+void VulkanTriangleApp::logDeviceReport(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile)
+{
+    if constexpr (!Logging::isCompiledIn(LogLevel::Debug))
+        return;
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(physicalDevice, &deviceProperties);
+
+    if (logProfile.logProps) {
+        Logging::logDeviceProps(deviceProperties);
+    }
+
+    if (logProfile.logLimits) {
+        Logging::logDeviceLimits(deviceProperties.limits);
+    }
+
+    if (logProfile.logSparseProps) {
+        Logging::logDeviceSparseProps(deviceProperties.sparseProperties);
+    }
+
+    VkPhysicalDeviceFeatures deviceFeatures;
+    vkGetPhysicalDeviceFeatures(physicalDevice, &deviceFeatures);
+
+    if (logProfile.logFeatures) {
+        Logging::logDeviceFeatures(deviceFeatures);
+    }
+
+    checkDeviceExtensionSupport(physicalDevice, logProfile);
+    querySwapChainSupport(physicalDevice, logProfile);
+    findQueueFamilies(physicalDevice, logProfile);
+}
+
+
 bool VulkanTriangleApp::checkDeviceExtensionSupport(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile)
 {
     uint32_t extensionCount = 0;
@@ -1143,6 +3912,275 @@ QueueFamilyIndices VulkanTriangleApp::findQueueFamilies(const VkPhysicalDevice&
 }
 
 
+void VulkanTriangleApp::queryDeviceCapabilities()
+{
+    deviceCaps = {};
+
+    VkPhysicalDeviceProperties deviceProperties;
+    vkGetPhysicalDeviceProperties(pPhysicalDevice, &deviceProperties);
+
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+
+    VkPhysicalDeviceSynchronization2Features synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+
+    VkPhysicalDeviceBufferDeviceAddressFeatures bufferAddressFeatures{};
+    bufferAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+
+    // reported by the driver, or by VK_LAYER_KHRONOS_shader_object when it is enabled
+    uint32_t extensionCount = 0;
+    vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extensionCount, nullptr);
+
+    vector<VkExtensionProperties> availableExtensions(extensionCount);
+    vkEnumerateDeviceExtensionProperties(pPhysicalDevice, nullptr, &extensionCount, availableExtensions.data());
+
+    auto hasExtension = [&availableExtensions](const char* pName)
+    {
+        for (const auto& extension : availableExtensions)
+        {
+            if (strcmp(extension.extensionName, pName) == 0)
+                return true;
+        }
+        return false;
+    };
+
+    bool hasShaderObjectExtension = hasExtension(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+    bool hasPipelineLibraryExtension = hasExtension(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME) && hasExtension(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{};
+    shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+
+    bool hasMeshShaderExtension = hasExtension(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+
+    VkPhysicalDeviceFeatures2 deviceFeatures{};
+    deviceFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+    deviceFeatures.pNext = &dynamicRenderingFeatures;
+
+    // only chain extension structs when the extension exists
+    void* pExtensionFeatures = &indexingFeatures;
+
+    if (hasShaderObjectExtension)
+    {
+        shaderObjectFeatures.pNext = pExtensionFeatures;
+        pExtensionFeatures = &shaderObjectFeatures;
+    }
+
+    if (hasPipelineLibraryExtension)
+    {
+        pipelineLibraryFeatures.pNext = pExtensionFeatures;
+        pExtensionFeatures = &pipelineLibraryFeatures;
+    }
+
+    if (hasMeshShaderExtension)
+    {
+        meshShaderFeatures.pNext = pExtensionFeatures;
+        pExtensionFeatures = &meshShaderFeatures;
+    }
+
+    dynamicRenderingFeatures.pNext = &synchronization2Features;
+    synchronization2Features.pNext = &timelineFeatures;
+    timelineFeatures.pNext = &bufferAddressFeatures;
+    bufferAddressFeatures.pNext = pExtensionFeatures;
+
+    vkGetPhysicalDeviceFeatures2(pPhysicalDevice, &deviceFeatures);
+
+    // core since 1.2 (VK_EXT_descriptor_indexing before that)
+    deviceCaps.descriptorIndexing = deviceProperties.apiVersion >= VK_API_VERSION_1_2
+        && indexingFeatures.runtimeDescriptorArray
+        && indexingFeatures.descriptorBindingPartiallyBound
+        && indexingFeatures.descriptorBindingVariableDescriptorCount
+        && indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind
+        && indexingFeatures.descriptorBindingSampledImageUpdateAfterBind;
+
+    deviceCaps.multiDrawIndirect = deviceFeatures.features.multiDrawIndirect == VK_TRUE;
+    deviceCaps.drawIndirectFirstInstance = deviceFeatures.features.drawIndirectFirstInstance == VK_TRUE;
+    deviceCaps.maxDrawIndirectCount = std::max(1u, deviceProperties.limits.maxDrawIndirectCount);
+    deviceCaps.pipelineStatisticsQuery = deviceFeatures.features.pipelineStatisticsQuery == VK_TRUE;
+    deviceCaps.inheritedQueries = deviceFeatures.features.inheritedQueries == VK_TRUE;
+
+    // the color and depth attachments of a subpass must have the same sample count
+    VkSampleCountFlags sampleCounts = deviceProperties.limits.framebufferColorSampleCounts & deviceProperties.limits.framebufferDepthSampleCounts;
+    for (VkSampleCountFlagBits count : { VK_SAMPLE_COUNT_64_BIT, VK_SAMPLE_COUNT_32_BIT, VK_SAMPLE_COUNT_16_BIT, VK_SAMPLE_COUNT_8_BIT, VK_SAMPLE_COUNT_4_BIT, VK_SAMPLE_COUNT_2_BIT })
+    {
+        if (sampleCounts & count)
+        {
+            deviceCaps.maxMsaaSamples = count;
+            break;
+        }
+    }
+
+    // core since 1.3 (VK_KHR_dynamic_rendering before that)
+    deviceCaps.dynamicRendering = deviceProperties.apiVersion >= VK_API_VERSION_1_3 && dynamicRenderingFeatures.dynamicRendering;
+
+    // core since 1.3 (VK_KHR_synchronization2 before that), without it submits go through vkQueueSubmit
+    deviceCaps.synchronization2 = deviceProperties.apiVersion >= VK_API_VERSION_1_3 && synchronization2Features.synchronization2;
+
+    // core since 1.2 (VK_KHR_timeline_semaphore before that), without it the statistics readback is skipped
+    deviceCaps.timelineSemaphore = deviceProperties.apiVersion >= VK_API_VERSION_1_2 && timelineFeatures.timelineSemaphore;
+
+    // core since 1.2 (VK_KHR_buffer_device_address before that)
+    deviceCaps.bufferDeviceAddress = deviceProperties.apiVersion >= VK_API_VERSION_1_2 && bufferAddressFeatures.bufferDeviceAddress;
+
+    // shader objects have no render pass to be compatible with, so they only draw inside vkCmdBeginRendering
+    deviceCaps.shaderObject = hasShaderObjectExtension && shaderObjectFeatures.shaderObject && deviceCaps.dynamicRendering;
+
+    deviceCaps.graphicsPipelineLibrary = hasPipelineLibraryExtension && pipelineLibraryFeatures.graphicsPipelineLibrary;
+
+    if (deviceCaps.graphicsPipelineLibrary)
+    {
+        VkPhysicalDeviceGraphicsPipelineLibraryPropertiesEXT pipelineLibraryProperties{};
+        pipelineLibraryProperties.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_PROPERTIES_EXT;
+
+        VkPhysicalDeviceProperties2 deviceProperties2{};
+        deviceProperties2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2;
+        deviceProperties2.pNext = &pipelineLibraryProperties;
+        vkGetPhysicalDeviceProperties2(pPhysicalDevice, &deviceProperties2);
+
+        deviceCaps.graphicsPipelineLibraryFastLinking = pipelineLibraryProperties.graphicsPipelineLibraryFastLinking == VK_TRUE;
+    }
+
+    // the extension needs SPIR-V 1.4, core since 1.2
+    deviceCaps.meshShader = hasMeshShaderExtension && deviceProperties.apiVersion >= VK_API_VERSION_1_2
+        && meshShaderFeatures.taskShader && meshShaderFeatures.meshShader;
+
+    if (options.drawPipeline == DrawPipelineId::Bindless && !deviceCaps.HasBindless())
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "bindless draw data needs descriptor indexing, using the uniform ring instead" << endl;
+
+        options.drawPipeline = DrawPipelineId::UniformRing;
+    }
+
+    if (options.shaderObjects && !deviceCaps.shaderObject)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "shader objects are not supported (install " << shaderObjectLayer << " to emulate them), using pipelines instead" << endl;
+
+        options.shaderObjects = false;
+    }
+
+    if (options.shaderObjects || options.renderGraph)
+        options.dynamicRendering = true;
+
+    if (options.pipelineLibrary && (!deviceCaps.graphicsPipelineLibrary || options.shaderObjects))
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << (options.shaderObjects ? "pipeline libraries are not used with shader objects" : "graphics pipeline libraries are not supported, using monolithic pipelines instead") << endl;
+
+        options.pipelineLibrary = false;
+    }
+
+    if (options.pipelineLibrary && !deviceCaps.graphicsPipelineLibraryFastLinking)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "graphicsPipelineLibraryFastLinking is not set, linking variants may not be cheap on this device" << endl;
+    }
+
+    if (options.dynamicRendering && !deviceCaps.dynamicRendering)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "dynamic rendering is not supported, using the render pass path instead" << endl;
+
+        options.dynamicRendering = false;
+    }
+
+    // the mesh shader pipeline only goes through PipelineRegistry
+    if (options.meshSegments > 0 && options.meshShaders && (!deviceCaps.meshShader || options.shaderObjects || options.pipelineLibrary))
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << (deviceCaps.meshShader ? "mesh shaders are only used with monolithic pipelines" : "mesh shaders are not supported")
+            << ", drawing the mesh from vertex and index buffers instead" << endl;
+
+        options.meshShaders = false;
+    }
+
+    // graph passes open their own vkCmdBeginRendering scopes, there is no render pass to split into subpasses
+    if (options.renderGraph && !options.dynamicRendering)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << "the render graph needs dynamic rendering, using the render pass path instead" << endl;
+
+        options.renderGraph = false;
+    }
+
+    // largest power of two not above the request, clamped to the device
+    uint32_t samples = 1;
+    while (samples * 2 <= options.msaaSamples && samples * 2 <= static_cast<uint32_t>(deviceCaps.maxMsaaSamples))
+        samples *= 2;
+
+    if (samples != options.msaaSamples)
+    {
+        Logging::LogStream out(LogLevel::Warning);
+        out << options.msaaSamples << "x MSAA is not supported, using " << samples << "x instead" << endl;
+
+        options.msaaSamples = samples;
+    }
+
+    msaaSamples = static_cast<VkSampleCountFlagBits>(samples);
+
+    // the pulled pipeline takes the bindless pipeline's place and only goes through PipelineRegistry
+    if (options.vertexPulling)
+    {
+        const char* pReason = nullptr;
+        if (!deviceCaps.HasBindless())
+            pReason = "replaces the bindless pipeline, which needs descriptor indexing";
+        else if (!deviceCaps.bufferDeviceAddress)
+            pReason = "needs bufferDeviceAddress";
+        else if (options.shaderObjects || options.pipelineLibrary)
+            pReason = "is only used with monolithic pipelines";
+
+        if (pReason != nullptr)
+        {
+            Logging::LogStream out(LogLevel::Warning);
+            out << "vertex pulling " << pReason << ", using vertex buffers instead" << endl;
+
+            options.vertexPulling = false;
+        }
+    }
+
+    // the culled instances are bindless indexed indirect draws, the pyramid is built from a single sampled depth buffer
+    // that the swapchain path owns (the render graph keeps its depth transient)
+    if (useOcclusionCulling())
+    {
+        VkFormatProperties depthProperties{};
+        vkGetPhysicalDeviceFormatProperties(pPhysicalDevice, findDepthFormat(), &depthProperties);
+
+        const char* pReason = nullptr;
+        if (!deviceCaps.HasBindless() || !deviceCaps.drawIndirectFirstInstance)
+            pReason = "needs descriptor indexing and drawIndirectFirstInstance";
+        else if (options.shaderObjects || options.pipelineLibrary)
+            pReason = "is only used with monolithic pipelines";
+        else if (options.renderGraph)
+            pReason = "does not run inside the render graph";
+        else if (msaaSamples != VK_SAMPLE_COUNT_1_BIT)
+            pReason = "needs a single sampled depth buffer";
+        else if (!(depthProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT))
+            pReason = "needs a depth format that can be sampled";
+
+        if (pReason != nullptr)
+        {
+            Logging::LogStream out(LogLevel::Warning);
+            out << "occlusion culling " << pReason << ", every mesh instance is drawn" << endl;
+
+            options.occlusionCull = false;
+        }
+    }
+}
+
+
 void VulkanTriangleApp::createGraphicsQueue(const QueueFamilyIndices& queueIndices)
 {
     // use set to make sure the same queue (graphics/present) are
@@ -1161,15 +4199,119 @@ void VulkanTriangleApp::createGraphicsQueue(const QueueFamilyIndices& queueIndic
     }
 
     VkPhysicalDeviceFeatures physicalDeviceFeatures{};
+    physicalDeviceFeatures.multiDrawIndirect = deviceCaps.multiDrawIndirect ? VK_TRUE : VK_FALSE;
+    physicalDeviceFeatures.drawIndirectFirstInstance = deviceCaps.drawIndirectFirstInstance ? VK_TRUE : VK_FALSE;
+    physicalDeviceFeatures.pipelineStatisticsQuery = deviceCaps.pipelineStatisticsQuery ? VK_TRUE : VK_FALSE;
+    physicalDeviceFeatures.inheritedQueries = (options.parallelRecord && deviceCaps.inheritedQueries) ? VK_TRUE : VK_FALSE;
+
+    // only what BindlessTable and shaders/bindlessDraw.vert use
+    VkPhysicalDeviceDescriptorIndexingFeatures indexingFeatures{};
+    indexingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DESCRIPTOR_INDEXING_FEATURES;
+    indexingFeatures.runtimeDescriptorArray = VK_TRUE;
+    indexingFeatures.descriptorBindingPartiallyBound = VK_TRUE;
+    indexingFeatures.descriptorBindingVariableDescriptorCount = VK_TRUE;
+    indexingFeatures.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+    indexingFeatures.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+
+    VkPhysicalDeviceDynamicRenderingFeatures dynamicRenderingFeatures{};
+    dynamicRenderingFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_DYNAMIC_RENDERING_FEATURES;
+    dynamicRenderingFeatures.dynamicRendering = VK_TRUE;
+
+    // feature structs of the optional paths in use, chained into VkDeviceCreateInfo
+    void* pFeatureChain = nullptr;
+
+    if (deviceCaps.HasBindless())
+    {
+        indexingFeatures.pNext = pFeatureChain;
+        pFeatureChain = &indexingFeatures;
+    }
+
+    if (options.dynamicRendering)
+    {
+        dynamicRenderingFeatures.pNext = pFeatureChain;
+        pFeatureChain = &dynamicRenderingFeatures;
+    }
+
+    VkPhysicalDeviceSynchronization2Features synchronization2Features{};
+    synchronization2Features.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SYNCHRONIZATION_2_FEATURES;
+    synchronization2Features.synchronization2 = VK_TRUE;
+
+    if (deviceCaps.synchronization2)
+    {
+        synchronization2Features.pNext = pFeatureChain;
+        pFeatureChain = &synchronization2Features;
+    }
+
+    VkPhysicalDeviceTimelineSemaphoreFeatures timelineFeatures{};
+    timelineFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_TIMELINE_SEMAPHORE_FEATURES;
+    timelineFeatures.timelineSemaphore = VK_TRUE;
+
+    if (deviceCaps.timelineSemaphore)
+    {
+        timelineFeatures.pNext = pFeatureChain;
+        pFeatureChain = &timelineFeatures;
+    }
+
+    VkPhysicalDeviceBufferDeviceAddressFeatures bufferAddressFeatures{};
+    bufferAddressFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_BUFFER_DEVICE_ADDRESS_FEATURES;
+    bufferAddressFeatures.bufferDeviceAddress = VK_TRUE;
+
+    if (useVertexPulling())
+    {
+        bufferAddressFeatures.pNext = pFeatureChain;
+        pFeatureChain = &bufferAddressFeatures;
+    }
+
+    // extended dynamic state 1/2 are core in 1.3, the shader object extension brings the 3/vertex input setters it needs
+    VkPhysicalDeviceShaderObjectFeaturesEXT shaderObjectFeatures{};
+    shaderObjectFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SHADER_OBJECT_FEATURES_EXT;
+    shaderObjectFeatures.shaderObject = VK_TRUE;
+
+    vector<const char*> extensions = deviceExtensions;
+
+    if (options.shaderObjects)
+    {
+        shaderObjectFeatures.pNext = pFeatureChain;
+        pFeatureChain = &shaderObjectFeatures;
+
+        extensions.push_back(VK_EXT_SHADER_OBJECT_EXTENSION_NAME);
+    }
+
+    VkPhysicalDeviceGraphicsPipelineLibraryFeaturesEXT pipelineLibraryFeatures{};
+    pipelineLibraryFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_GRAPHICS_PIPELINE_LIBRARY_FEATURES_EXT;
+    pipelineLibraryFeatures.graphicsPipelineLibrary = VK_TRUE;
+
+    if (options.pipelineLibrary)
+    {
+        pipelineLibraryFeatures.pNext = pFeatureChain;
+        pFeatureChain = &pipelineLibraryFeatures;
+
+        extensions.push_back(VK_KHR_PIPELINE_LIBRARY_EXTENSION_NAME);
+        extensions.push_back(VK_EXT_GRAPHICS_PIPELINE_LIBRARY_EXTENSION_NAME);
+    }
+
+    VkPhysicalDeviceMeshShaderFeaturesEXT meshShaderFeatures{};
+    meshShaderFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_MESH_SHADER_FEATURES_EXT;
+    meshShaderFeatures.taskShader = VK_TRUE;
+    meshShaderFeatures.meshShader = VK_TRUE;
+
+    if (useMeshShaders())
+    {
+        meshShaderFeatures.pNext = pFeatureChain;
+        pFeatureChain = &meshShaderFeatures;
+
+        extensions.push_back(VK_EXT_MESH_SHADER_EXTENSION_NAME);
+    }
 
     VkDeviceCreateInfo logicalDeviceCreateInfo{};
     logicalDeviceCreateInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+    logicalDeviceCreateInfo.pNext = pFeatureChain;
 
     logicalDeviceCreateInfo.queueCreateInfoCount = static_cast<uint32_t>(queuesCreateInfo.size());
     logicalDeviceCreateInfo.pQueueCreateInfos = queuesCreateInfo.data();
 
-    logicalDeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(deviceExtensions.size());
-    logicalDeviceCreateInfo.ppEnabledExtensionNames = deviceExtensions.data();
+    logicalDeviceCreateInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
+    logicalDeviceCreateInfo.ppEnabledExtensionNames = extensions.data();
 
     logicalDeviceCreateInfo.pEnabledFeatures = &physicalDeviceFeatures;
 
@@ -1186,6 +4328,13 @@ void VulkanTriangleApp::createGraphicsQueue(const QueueFamilyIndices& queueIndic
 
     // get present queue - logicalDevice, queueFamily, queueIndex, pHandle
     vkGetDeviceQueue(pDevice, queueIndices.presentFamily.value(), 0, &pPresentQueue);
+
+    if (useMeshShaders())
+    {
+        pfnCmdDrawMeshTasks = reinterpret_cast<PFN_vkCmdDrawMeshTasksEXT>(vkGetDeviceProcAddr(pDevice, "vkCmdDrawMeshTasksEXT"));
+        if (pfnCmdDrawMeshTasks == nullptr)
+            throw runtime_error("failed to load vkCmdDrawMeshTasksEXT");
+    }
 }
 
 
@@ -1278,10 +4427,7 @@ VkExtent2D VulkanTriangleApp::chooseSwapExtent(const VkSurfaceCapabilitiesKHR& c
     if (caps.currentExtent.width != std::numeric_limits<uint32_t>::max())
         return caps.currentExtent;
 
-    int width = 0, height = 0;
-    glfwGetFramebufferSize(pWindow, &width, &height);
-
-    VkExtent2D actualExtent = { static_cast<uint32_t>(width), static_cast<uint32_t>(height) };
+    VkExtent2D actualExtent = framebufferExtent;
     actualExtent.width = std::clamp(actualExtent.width, caps.minImageExtent.width, caps.maxImageExtent.width);
     actualExtent.height = std::clamp(actualExtent.height, caps.minImageExtent.height, caps.maxImageExtent.height);
 
@@ -1336,7 +4482,8 @@ void VulkanTriangleApp::framebufferResizeCallback(GLFWwindow* pWindow, int width
     auto pThis = reinterpret_cast<VulkanTriangleApp*>(glfwGetWindowUserPointer(pWindow));
     if (pThis == nullptr) return;
 
-    pThis->framebufferResized = true;
+    // the render thread picks the new size up before its next frame
+    pThis->windowEvents.pushResize(static_cast<uint32_t>(width), static_cast<uint32_t>(height));
 }
 
 
@@ -1348,6 +4495,24 @@ VKAPI_ATTR VkBool32 VKAPI_CALL VulkanTriangleApp::debugCallback
     void* pUserData
 )
 {
-    cerr << "validation layer: " << pCallbackData->pMessage << endl;
+    LogLevel level = LogLevel::Info;
+    if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_ERROR_BIT_EXT)
+        level = LogLevel::Error;
+    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_WARNING_BIT_EXT)
+        level = LogLevel::Warning;
+    else if (messageSeverity & VK_DEBUG_UTILS_MESSAGE_SEVERITY_VERBOSE_BIT_EXT)
+        level = LogLevel::Trace;
+
+    // pUserData is set in populateDebugMessengerCreateInfo
+    auto pThis = reinterpret_cast<VulkanTriangleApp*>(pUserData);
+    if (pThis == nullptr)
+    {
+        Logging::LogStream out(level);
+        out << "validation layer: " << pCallbackData->pMessage << endl;
+        return VK_FALSE;
+    }
+
+    pThis->validationAggregator.report(pCallbackData->messageIdNumber, pCallbackData->pMessageIdName, level, pCallbackData->pMessage);
+
     return VK_FALSE;
 }
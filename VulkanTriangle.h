@@ -1,15 +1,21 @@
 #pragma once
 
+#ifdef _MSC_VER
 #pragma comment(lib, "vulkan-1.lib")
 #pragma comment(lib, "glfw3.lib")
+#endif
 
 #define NOMINMAX
 
+#ifdef _WIN32
 #define VK_USE_PLATFORM_WIN32_KHR
+#endif
 #define GLFW_INCLUDE_VULKAN
 #include <GLFW/glfw3.h>
+#ifdef _WIN32
 #define GLFW_EXPOSE_NATIVE_WIN32
 #include <GLFW/glfw3native.h>
+#endif
 
 #include <glm/glm.hpp>
 
@@ -28,8 +34,34 @@
 #include <set>
 #include <map>
 #include <optional>
+#include <string>
+#include <memory>
+#include <exception>
 
 #include "Logging.h"
+#include "ValidationAggregator.h"
+#include "FrameProfiler.h"
+#include "FrameInputs.h"
+#include "FrameCapture.h"
+#include "DescriptorAllocator.h"
+#include "UniformRing.h"
+#include "BindlessTable.h"
+#include "ShaderObjects.h"
+#include "PipelineLibrary.h"
+#include "PipelineRegistry.h"
+#include "DrawSorter.h"
+#include "RenderGraph.h"
+#include "SubmitBatcher.h"
+#include "WindowEvents.h"
+#include "Simulation.h"
+#include "JobSystem.h"
+#include "DrawCuller.h"
+#include "GpuAwait.h"
+#include "TransformHierarchy.h"
+#include "Mesh.h"
+#include "MeshletBuilder.h"
+#include "MeshSimplifier.h"
+#include "OcclusionCuller.h"
 
 
 struct QueueFamilyIndices
@@ -63,14 +95,225 @@ struct SwapChainSupportDetails
 };
 
 
+// optional device features, decided in queryDeviceCapabilities() before the logical device is created
+struct DeviceCapabilities
+{
+    // Vulkan 1.2 descriptor indexing - runtime arrays, partially bound, update after bind, variable count
+    bool descriptorIndexing = false;
+
+    // one vkCmdDrawIndirect for many draws, each with its own firstInstance
+    bool multiDrawIndirect = false;
+    bool drawIndirectFirstInstance = false;
+    uint32_t maxDrawIndirectCount = 1;
+
+    // Vulkan 1.3 dynamic rendering - no VkRenderPass/VkFramebuffer objects
+    bool dynamicRendering = false;
+
+    // Vulkan 1.3 synchronization2 - vkQueueSubmit2 and 64 bit stage masks
+    bool synchronization2 = false;
+
+    // VK_EXT_shader_object - native or through VK_LAYER_KHRONOS_shader_object, requires dynamicRendering
+    bool shaderObject = false;
+
+    // VK_EXT_graphics_pipeline_library - fastLinking says linking libraries is cheap enough to do while recording
+    bool graphicsPipelineLibrary = false;
+    bool graphicsPipelineLibraryFastLinking = false;
+
+    // fragment shader invocation counts for the overdraw benchmark
+    bool pipelineStatisticsQuery = false;
+
+    // secondary command buffers may run while a query of the primary is active
+    bool inheritedQueries = false;
+
+    // Vulkan 1.2 timeline semaphores - the frame timeline and GpuTimeline awaits
+    bool timelineSemaphore = false;
+
+    // VK_EXT_mesh_shader with task shaders - the meshlet path, vertex input and index buffers otherwise
+    bool meshShader = false;
+
+    // Vulkan 1.2 bufferDeviceAddress - vertex pulling through addresses in push constants
+    bool bufferDeviceAddress = false;
+
+    // highest count both color and depth framebuffer attachments support
+    VkSampleCountFlagBits maxMsaaSamples = VK_SAMPLE_COUNT_1_BIT;
+
+    bool HasBindless() const { return descriptorIndexing; }
+};
+
+
+// host visible buffer written once at creation, for data the GPU only reads
+struct HostBuffer
+{
+    VkBuffer pBuffer = nullptr;
+    VkDeviceMemory pMemory = nullptr;
+    VkDeviceSize size = 0;
+
+    // only with VK_BUFFER_USAGE_SHADER_DEVICE_ADDRESS_BIT
+    VkDeviceAddress address = 0;
+};
+
+
+// depth or multisampled color attachment of the swapchain or the offscreen target
+// only used within a frame, so it is transient and lazily allocated where the device offers that
+struct TransientAttachment
+{
+    VkImage pImage = nullptr;
+    VkDeviceMemory pMemory = nullptr;
+    VkImageView pImageView = nullptr;
+    VkExtent2D extent = { 0, 0 };
+    bool lazilyAllocated = false;
+};
+
+
+// what a frame is recorded into - a swapchain image or the offscreen image
+// pFramebuffer is only used by the render pass path, the image and view handles only by dynamic rendering
+// with MSAA pColorImage is rendered to and resolved into pImage, without it pColorImage is nullptr
+struct RenderTarget
+{
+    VkFramebuffer pFramebuffer = nullptr;
+    VkImage pImage = nullptr;
+    VkImageView pImageView = nullptr;
+    VkImage pColorImage = nullptr;
+    VkImageView pColorImageView = nullptr;
+    VkImage pDepthImage = nullptr;
+    VkImageView pDepthImageView = nullptr;
+    VkExtent2D extent = { 0, 0 };
+
+    // leave the image in VK_IMAGE_LAYOUT_PRESENT_SRC_KHR
+    bool present = false;
+
+    // the draws come from secondary command buffers (VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS)
+    bool secondaryContents = false;
+
+    // continue on what an earlier pass of the frame left - color and depth are loaded instead of cleared
+    bool load = false;
+};
+
+
+// command line controlled settings (see main.cpp)
+struct AppOptions
+{
+    // write the drawFrame() phase history as chrome://tracing json on exit
+    std::string frameTraceFilename;
+
+    // record the per frame inputs of the live loop
+    std::string captureFilename;
+
+    // replay a capture offscreen as fast as possible instead of running the window loop
+    std::string replayFilename;
+    uint32_t replayLoops = 1;
+
+    // per frame region of the uniform ring (per draw data)
+    uint32_t uniformBytesPerFrame = 4 * 1024 * 1024;
+
+    // how the live loop hands per draw data to the shaders
+    DrawPipelineId drawPipeline = DrawPipelineId::UniformRing;
+
+    // draw the same stress frame through every DrawPipelineId offscreen and log the CPU cost of each
+    uint32_t benchDrawCount = 0;
+    uint32_t benchFrames = 500;
+
+    // render straight to image views with core 1.3 vkCmdBeginRendering instead of a render pass and framebuffers
+    bool dynamicRendering = false;
+
+    // recreate the swapchain this many times at alternating sizes and log the cost
+    uint32_t benchResizeCount = 0;
+
+    // bind VK_EXT_shader_object shaders and set all state while recording instead of binding pipelines
+    bool shaderObjects = false;
+
+    // build pipelines from precompiled VK_EXT_graphics_pipeline_library parts instead of monolithic compiles
+    bool pipelineLibrary = false;
+
+    // link every variant the pipeline library covers and log the fast and optimised link times
+    bool benchPipelineVariants = false;
+
+    // pipeline descriptions to create at startup, rewritten on exit with every description the run used
+    std::string pipelineListFilename;
+
+    // order draws with DrawSorter before recording (opaque front to back)
+    bool sortDraws = true;
+
+    // render the stress scene in each DrawSorter::Order and log the fragment shader invocations
+    uint32_t benchOverdrawCount = 0;
+
+    // samples per pixel, rounded down to a power of two the device supports
+    uint32_t msaaSamples = 1;
+
+    // record frames through RenderGraph (implies dynamicRendering)
+    bool renderGraph = false;
+
+    // compile a multi pass graph and log its barriers and transient memory
+    bool benchRenderGraph = false;
+
+    // moving triangles the simulation thread adds to the live loop, and its fixed step rate
+    uint32_t simInstances = 0;
+    uint32_t simStepHz = 60;
+
+    // JobSystem workers, 0 - one per core besides the main thread
+    uint32_t jobWorkers = 0;
+
+    // drop draws outside the clip volume before sorting
+    bool cullDraws = true;
+
+    // record large frames into secondary command buffers, one per job
+    bool parallelRecord = false;
+
+    // job spawn/steal overhead and parallelFor scaling from 1 thread to every core
+    bool benchJobs = false;
+
+    // random spheres and boxes tested against a frustum per instruction set, in objects/ms
+    uint32_t benchCullCount = 0;
+
+    // nodes of the animated transform hierarchy drawn as instances next to the frame's draws (needs bindless)
+    uint32_t sceneNodes = 0;
+
+    // TransformHierarchy updates over this many nodes, all and a tenth dirty, in transforms/ms
+    uint32_t benchTransformCount = 0;
+
+    // segments around a sphere mesh (half as many rings) drawn next to the frame's draws, 0 - no mesh
+    uint32_t meshSegments = 0;
+
+    // draw the mesh as meshlets through task and mesh shaders where the device has them
+    bool meshShaders = true;
+
+    // meshlets built by an earlier run for the same mesh, written when missing or stale
+    std::string meshletCacheFilename;
+
+    // copies of the mesh, each smaller than the one before as if further away
+    uint32_t meshInstances = 1;
+
+    // simplified levels of the mesh, each instance draws the coarsest one whose error stays under lodErrorPixels
+    bool meshLods = true;
+    float lodErrorPixels = 1.0f;
+
+    // test the mesh instances against a depth pyramid of the previous frame on the GPU, draw the survivors indirectly,
+    // then test the rejected ones again against this frame's depth and draw what became visible in a second pass
+    bool occlusionCull = false;
+
+    // the bindless pipeline reads vertices and draw data through buffer addresses in push constants, with no vertex input state
+    bool vertexPulling = false;
+};
+
+
 class VulkanTriangleApp
 {
 public:
 
     const uint32_t MaxFramesInFlight = 3;
 
+    VulkanTriangleApp() = default;
+    explicit VulkanTriangleApp(const AppOptions& options);
+
     void run();
 
+    // CPU time per drawFrame() phase over the last FrameProfiler::HistorySize frames
+    FrameStats getFrameStats() const { return frameProfiler.getStats(); }
+    const FrameProfiler& getFrameProfiler() const { return frameProfiler; }
+
+    // per message ID counts of validation output (debug builds)
+    const ValidationAggregator& getValidationAggregator() const { return validationAggregator; }
+
 protected:
 
     void initWindow();
@@ -83,13 +326,18 @@ protected:
     void createLogicalDevice();
     void createSwapChain();
     void createImageViews();
+    void createTransientAttachments();
     void createRenderPass();
+    void createDescriptorSetLayout();
     void createGraphicsPipeline();
     void createFramebuffers();
     void createCommandPool();
     void createVertexBuffer();
+    void createUniformBuffers();
+    void createDescriptorSets();
     void createCommandBuffers();
     void createSyncObjects();
+    void createQueryPool();
 
     void mainLoop();
 
@@ -107,11 +355,13 @@ protected:
 
     // pickPhysicalDevice
     bool isDeviceSuitable(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile);
-    uint32_t rateDeviceSuitability(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile);
+    uint32_t rateDeviceSuitability(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile, QueueFamilyIndices& queueIndices);
+    void logDeviceReport(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile);
     bool checkDeviceExtensionSupport(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile);
     QueueFamilyIndices findQueueFamilies(const VkPhysicalDevice& physicalDevice, const LogProfile& logProfile);
 
     // createLogicalDevice
+    void queryDeviceCapabilities();
     void createGraphicsQueue(const QueueFamilyIndices& queueIndices);
     void createComputeQueue(const QueueFamilyIndices& queueIndices);
     void createXferQueue(const QueueFamilyIndices& queueIndices);
@@ -124,6 +374,11 @@ protected:
 
     // createImageViews
 
+    // createTransientAttachments
+    VkFormat findDepthFormat();
+    void createTransientAttachment(TransientAttachment& attachment, VkFormat format, VkImageUsageFlags usage, VkImageAspectFlags aspect, VkExtent2D extent);
+    void destroyTransientAttachment(TransientAttachment& attachment);
+
     // createRenderPass
 
     // createGraphicsPipeline
@@ -140,14 +395,69 @@ protected:
     // createSyncObjects
 
     // mainLoop
+    void renderLoop();
+    bool pollWindowEvents();
     void drawFrame();
 
+    void buildFrameInputs();
+    void applyBufferUpdates(const FrameInputs& frame);
+    VkPipeline selectPipeline(uint32_t pipelineId);
+
     void recordCommandBuffer(VkCommandBuffer pCommmandBuffer, uint32_t imageIndex);
+    void recordCommandBuffer(VkCommandBuffer pCommandBuffer, const RenderTarget& target, const FrameInputs& frame);
+    void recordDraws(VkCommandBuffer pCommandBuffer, VkExtent2D extent, const FrameInputs& frame);
+    void recordDrawState(VkCommandBuffer pCommandBuffer, VkExtent2D extent, uint32_t pipelineId, VkPipeline pPipeline);
+    void recordDrawRange(VkCommandBuffer pCommandBuffer, const FrameInputs& frame, uint32_t begin, uint32_t end, UniformAllocation uniforms);
+    bool useParallelRecording(const FrameInputs& frame) const;
+    void recordDrawsParallel(VkCommandBuffer pCommandBuffer, const RenderTarget& target, const FrameInputs& frame);
+    void beginRenderTarget(VkCommandBuffer pCommandBuffer, const RenderTarget& target);
+    void beginRendering(VkCommandBuffer pCommandBuffer, const RenderTarget& target);
+    void endRenderTarget(VkCommandBuffer pCommandBuffer, const RenderTarget& target);
+    void buildRenderGraph(const RenderTarget& target);
+    void pushDrawConstants(VkCommandBuffer pCommandBuffer, const glm::mat4& transform, const glm::vec4& color);
+    void pushBindlessConstants(VkCommandBuffer pCommandBuffer, const UniformRing& ring, uint32_t bufferIndex, UniformAllocation drawData, VkDeviceAddress vertexAddress);
+    void recordBindlessDraws(VkCommandBuffer pCommandBuffer, const FrameInputs& frame);
+    void createScene();
+    void updateScene();
+    void recordSceneDraw(VkCommandBuffer pCommandBuffer);
+    static void buildSceneHierarchy(TransformHierarchy& hierarchy, uint32_t nodeCount);
+    void createMesh();
+    void recordMeshDraw(VkCommandBuffer pCommandBuffer, VkExtent2D extent);
+    void recordCulledMeshDraw(VkCommandBuffer pCommandBuffer, VkExtent2D extent, const UniformAllocation& commands);
+    glm::mat4 getMeshInstanceTransform(uint32_t instance, float seconds, float& radius) const;
+    void recordOcclusionCull(VkCommandBuffer pCommandBuffer, VkExtent2D extent);
+    bool useMeshShaders() const { return options.meshSegments > 0 && options.meshShaders && deviceCaps.meshShader && !isHeadless() && !useOcclusionCulling(); }
+    bool useOcclusionCulling() const { return options.meshSegments > 0 && options.occlusionCull && !isHeadless(); }
+    bool useVertexPulling() const { return options.vertexPulling && deviceCaps.HasBindless() && deviceCaps.bufferDeviceAddress; }
+    void createHostBuffer(HostBuffer& buffer, const void* pData, VkDeviceSize size, VkBufferUsageFlags usage);
+    void destroyHostBuffer(HostBuffer& buffer);
+    GpuTask readFrameStatistics(uint64_t timelineValue, uint32_t query);
+    void reapGpuTasks();
+    void logFrameStats();
 
     uint32_t findMemoryType(uint32_t filter, VkMemoryPropertyFlags propFlags);
+    VkDeviceAddress getBufferAddress(VkBuffer pBuffer) const;
 
     void recreateSwapChain();
     void cleanupSwapChain();
+
+    // replay
+    bool isHeadless() const { return !options.replayFilename.empty() || options.benchDrawCount > 0 || options.benchResizeCount > 0 || options.benchPipelineVariants || options.benchOverdrawCount > 0 || options.benchRenderGraph || options.benchJobs || options.benchCullCount > 0 || options.benchTransformCount > 0; }
+    void replayLoop();
+    void drawReplayFrame(const FrameInputs& frame);
+    void createOffscreenTarget(VkExtent2D extent);
+    void destroyOffscreenTarget();
+
+    // benchmark
+    void benchmarkDrawData();
+    void benchmarkResize();
+    void benchmarkPipelineVariants();
+    void benchmarkOverdraw();
+    void benchmarkRenderGraph();
+    void benchmarkJobSystem();
+    void benchmarkCulling();
+    void benchmarkTransforms();
+    FrameInputs buildStressFrame(uint32_t drawCount);
     
     // callbacks
     static void framebufferResizeCallback(GLFWwindow* pWindow, int width, int height);
@@ -162,15 +472,35 @@ protected:
 
 private:
 
+    AppOptions options;
+    FrameProfiler frameProfiler;
+
     GLFWwindow* pWindow = nullptr;
     VkInstance pInstance = nullptr;
     VkDebugUtilsMessengerEXT pDebugMessenger = nullptr;
+    ValidationAggregator validationAggregator;
 
     VkPhysicalDevice pPhysicalDevice = nullptr;
+    DeviceCapabilities deviceCaps;
 
     VkDevice pDevice = nullptr;
 
-    bool framebufferResized = false;
+    // filled by the GLFW callbacks on the main thread, drained by whoever draws (the render thread in mainLoop)
+    WindowEventQueue windowEvents;
+
+    // render thread state, only changed by pollWindowEvents()
+    VkExtent2D framebufferExtent = { 0, 0 };
+    bool swapChainOutOfDate = false;
+    bool windowClosed = false;
+
+    std::exception_ptr renderThreadException;
+
+    // mainLoop only - the simulation thread publishes, buildFrameInputs() interpolates the newest snapshot
+    Simulation simulation;
+    SnapshotMailbox snapshotMailbox;
+
+    // the swap chain's first image count - command buffers, sync objects and the per frame rings, currentFrame wraps at it
+    uint32_t framesInFlight = 0;
     uint32_t currentFrame = 0;;
     VkSurfaceKHR pSurface = nullptr;
     VkSwapchainKHR pSwapChain = nullptr;
@@ -183,21 +513,162 @@ private:
     VkColorSpaceKHR swapChainColorSpace;
     VkExtent2D swapChainExtent;
 
+    // one depth buffer (and multisampled color buffer) is shared by all frames in flight, the render pass dependency orders their writes
+    VkFormat depthFormat = VK_FORMAT_UNDEFINED;
+    VkSampleCountFlagBits msaaSamples = VK_SAMPLE_COUNT_1_BIT;
+    TransientAttachment swapChainDepth;
+    TransientAttachment swapChainColor;
+
     VkRenderPass pRenderPass = nullptr;
+
+    // useOcclusionCulling() - pRenderPass with color and depth loaded, for the instances the second cull takes back
+    VkRenderPass pLateRenderPass = nullptr;
+    VkDescriptorSetLayout pDrawSetLayout = nullptr;
     VkPipelineLayout pPipelineLayout = nullptr;
+    // owns the monolithic pipelines, the handles below are lookups into it
+    PipelineRegistry pipelineRegistry;
+    std::vector<PipelineDesc> drawPipelineDescs;
+
     VkPipeline pGraphicsPipeline = nullptr;
+    VkPipeline pPushConstantPipeline = nullptr;
+
+    // bindless draw data, only created when deviceCaps.HasBindless()
+    BindlessTable bindlessTable;
+    VkPipelineLayout pBindlessPipelineLayout = nullptr;
+    VkPipeline pBindlessPipeline = nullptr;
+
+    // options.shaderObjects - one program per DrawPipelineId, replaces the pipelines above
+    ShaderObjectRenderer shaderObjects;
+    ShaderObjectState shaderObjectState;
+
+    // options.pipelineLibrary - replaces the pipelines above, drawVariant is the state selectPipeline() links
+    PipelineLibrary pipelineLibrary;
+    PipelineVariant drawVariant;
+
+    // whole range the device allows, shared by the vertex and fragment stages
+    uint32_t pushConstantsSize = 0;
 
     VkCommandPool pCommandPool = nullptr;
     VkSemaphore pAppSemaphore = nullptr;
 
     // per frame
     std::vector<VkCommandBuffer> commandBuffers;
+
+    // options.parallelRecord - a pool with one secondary command buffer per frame and job, frame f chunk c at f * recordChunkCount + c
+    std::vector<VkCommandPool> recordPools;
+    std::vector<VkCommandBuffer> recordCommandBuffers;
+    uint32_t recordChunkCount = 0;
     std::vector<VkSemaphore> imageAvailableSemaphores;
     std::vector<VkSemaphore> renderFinishedSemaphores;
     std::vector<VkFence> inFlightFences;
 
+    // deviceCaps.timelineSemaphore - every graphics submit signals the next value, so value n is done once frame n is
+    VkSemaphore pFrameTimeline = nullptr;
+    uint64_t frameTimelineValue = 0;
+
     VkBuffer pVertexBuffer = nullptr;
     VkDeviceMemory pVertexBufferMemory = nullptr;
+    VkDeviceSize vertexBufferSize = 0;
+    void* pVertexBufferMapped = nullptr;
+
+    // useVertexPulling() - what shaders/pulledDraw.vert reads instead of the bound vertex buffer
+    VkDeviceAddress vertexBufferAddress = 0;
+
+    // per draw uniforms, bound with dynamic offsets
+    UniformRing uniformRing;
+    DescriptorAllocator descriptorAllocator;
+    VkDescriptorSet pDrawDescriptorSet = nullptr;
+
+    // per frame BindlessDrawData and VkDrawIndirectCommand, registered in bindlessTable
+    UniformRing drawDataRing;
+    uint32_t drawDataBufferIndex = BindlessTable::InvalidIndex;
+
+    // options.sceneNodes - one BindlessDrawData per node and frame in flight, each frame's block starts its region
+    // sceneHierarchy writes the transforms straight into it, the colors are written once
+    UniformRing instanceRing;
+    uint32_t instanceBufferIndex = BindlessTable::InvalidIndex;
+    UniformAllocation sceneInstances;
+    TransformHierarchy sceneHierarchy;
+    uint64_t sceneFrame = 0;
+
+    // options.meshSegments - drawn as meshlets when useMeshShaders(), from the vertex and index buffers otherwise
+    // meshBuffer holds the vertices and then every level's indices from meshIndexOffset on
+    Mesh mesh;
+    float meshRadius = 0.0f;
+    MeshLodChain meshLods;
+    MeshletData meshletData;
+    HostBuffer meshBuffer;
+    VkDeviceSize meshIndexOffset = 0;
+    HostBuffer meshletBuffer;
+    HostBuffer meshletVertexBuffer;
+    HostBuffer meshletTriangleBuffer;
+    VkDescriptorSetLayout pMeshletSetLayout = nullptr;
+    VkDescriptorSet pMeshletDescriptorSet = nullptr;
+    VkPipelineLayout pMeshletPipelineLayout = nullptr;
+    VkPipeline pMeshletPipeline = nullptr;
+    PFN_vkCmdDrawMeshTasksEXT pfnCmdDrawMeshTasks = nullptr;
+
+    // triangles of the levels drawn and of level 0 for the same draws, logged with the frame stats
+    uint64_t meshTrianglesDrawn = 0;
+    uint64_t meshTrianglesFull = 0;
+
+    // useOcclusionCulling() - the frame's instances and indirect commands in drawDataRing, culled before the render pass,
+    // and the commands of the instances the second cull finds visible, drawn in a second render pass
+    OcclusionCuller occlusionCuller;
+    UniformAllocation meshCullInstances;
+    UniformAllocation meshCullCommands;
+    UniformAllocation meshLateCommands;
+
+    // inputs of the frame being recorded
+    FrameInputs frameInputs;
+    FrameRecorder frameRecorder;
+
+    // replay renders here instead of the swapchain
+    VkImage pOffscreenImage = nullptr;
+    VkDeviceMemory pOffscreenImageMemory = nullptr;
+    VkImageView pOffscreenImageView = nullptr;
+    VkFramebuffer pOffscreenFramebuffer = nullptr;
+    VkExtent2D offscreenExtent = { 0, 0 };
+    TransientAttachment offscreenDepth;
+    TransientAttachment offscreenColor;
+
+    // draws are culled and sorted in place while building the frame
+    DrawCuller drawCuller;
+    DrawSorter drawSorter;
+
+    // created first and destroyed last, everything from device probing to recording may use it
+    JobSystem jobSystem;
+
+    // largest distance of a vertex from the model origin, the draws' bounding sphere radius before their transform
+    float modelRadius = 0.0f;
+
+    // one VK_QUERY_TYPE_PIPELINE_STATISTICS query per frame in flight, only when deviceCaps.pipelineStatisticsQuery
+    VkQueryPool pStatsQueryPool = nullptr;
+
+    // per query, the frame timeline value of the frame that last reset it - tells readFrameStatistics() its slot was reused
+    std::unique_ptr<std::atomic<uint64_t>[]> statsQueryValues;
+
+    // summed by readFrameStatistics() on the waiter thread
+    std::atomic<uint64_t> fragmentInvocations{ 0 };
+    std::atomic<uint64_t> statisticsFrames{ 0 };
+
+    // resumes coroutines awaiting GPU work, gpuTasks holds the ones still running until they are reaped
+    GpuWaiter gpuWaiter;
+    std::vector<GpuTask> gpuTasks;
+
+    // options.renderGraph - rebuilt when the target's extent or present flag changes
+    RenderGraph renderGraph;
+    uint32_t graphBackbuffer = 0;
+    uint32_t graphDepth = 0;
+    uint32_t graphMsaaColor = 0;
+    VkExtent2D renderGraphExtent = { 0, 0 };
+    bool renderGraphPresent = false;
+
+    // the frame the scene pass records, only set while the graph executes
+    const FrameInputs* pGraphFrame = nullptr;
+
+    // each frame's command buffers and semaphores, one submit call per queue
+    SubmitBatcher submitBatcher;
 
     VkQueue pPresentQueue = nullptr;
     VkQueue pGraphicsQueue = nullptr;
@@ -0,0 +1,73 @@
+#include "WindowEvents.h"
+
+
+bool WindowEventQueue::push(const WindowEvent& event)
+{
+    uint64_t h = head.load(std::memory_order_relaxed);
+
+    if (h - tail.load(std::memory_order_acquire) >= Capacity)
+    {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    events[h & Mask] = event;
+
+    head.store(h + 1, std::memory_order_release);
+    signal();
+    return true;
+}
+
+
+bool WindowEventQueue::pop(WindowEvent& event)
+{
+    uint64_t t = tail.load(std::memory_order_relaxed);
+
+    if (t == head.load(std::memory_order_acquire))
+        return false;
+
+    event = events[t & Mask];
+
+    tail.store(t + 1, std::memory_order_release);
+    return true;
+}
+
+
+void WindowEventQueue::pushResize(uint32_t width, uint32_t height)
+{
+    latestSize.store((static_cast<uint64_t>(width) << 32) | height, std::memory_order_relaxed);
+    resizePending.store(true, std::memory_order_release);
+    signal();
+}
+
+
+bool WindowEventQueue::popResize(uint32_t& width, uint32_t& height)
+{
+    if (!resizePending.exchange(false, std::memory_order_acquire))
+        return false;
+
+    // a resize landing in between is read here already and reported once more on the next call, which is harmless
+    uint64_t size = latestSize.load(std::memory_order_relaxed);
+    width = static_cast<uint32_t>(size >> 32);
+    height = static_cast<uint32_t>(size);
+    return true;
+}
+
+
+void WindowEventQueue::wait() const
+{
+    // sample the counter before checking, a push in between changes it and the wait returns straight away
+    uint32_t seen = signals.load(std::memory_order_acquire);
+
+    if (resizePending.load(std::memory_order_acquire) || tail.load(std::memory_order_relaxed) != head.load(std::memory_order_acquire))
+        return;
+
+    signals.wait(seen, std::memory_order_acquire);
+}
+
+
+void WindowEventQueue::signal()
+{
+    signals.fetch_add(1, std::memory_order_release);
+    signals.notify_one();
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+
+enum class WindowEventType : uint8_t
+{
+    Close = 0
+};
+
+
+struct WindowEvent
+{
+    WindowEventType type = WindowEventType::Close;
+};
+
+
+// single producer (the GLFW event thread) / single consumer (the render thread)
+// push and pop never block or allocate, so window callbacks can not stall on the renderer and the other way round
+// resizes are not queued - only the latest size matters, so a resize storm can neither fill the ring nor lose its final size
+class WindowEventQueue
+{
+public:
+
+    static constexpr uint32_t Capacity = 256;
+
+    // false when the queue is full and the event was dropped
+    bool push(const WindowEvent& event);
+    bool pop(WindowEvent& event);
+
+    // framebuffer size in pixels, 0 x 0 while minimized - overwrites a size the consumer has not taken yet
+    void pushResize(uint32_t width, uint32_t height);
+
+    // false when the size did not change since the last call
+    bool popResize(uint32_t& width, uint32_t& height);
+
+    // blocks the consumer until something was pushed
+    void wait() const;
+
+    uint64_t getDroppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+
+    static constexpr uint64_t Mask = Capacity - 1;
+    static_assert((Capacity & Mask) == 0, "Capacity must be a power of two");
+
+    void signal();
+
+    std::array<WindowEvent, Capacity> events{};
+
+    alignas(64) std::atomic<uint64_t> head{ 0 };     // written by producer
+    std::atomic<uint64_t> latestSize{ 0 };           // written by producer, width in the high half
+    std::atomic<uint32_t> signals{ 0 };              // written by producer, bumped after every push
+    alignas(64) std::atomic<uint64_t> tail{ 0 };     // written by consumer
+    std::atomic<bool> resizePending{ false };        // set by producer, cleared by consumer
+    std::atomic<uint64_t> dropped{ 0 };
+};
@@ -1,17 +1,127 @@
 #include "VulkanTriangle.h"
 #include "Logging.h"
+#include "LogBackend.h"
 
 using std::endl;
 using std::cerr;
 using std::exception;
+using std::string;
 
 
-int main()
+static AppOptions parseOptions(int argc, char** argv)
+{
+    AppOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        string arg = argv[i];
+
+        if (arg == "--frame-trace" && i + 1 < argc)
+            options.frameTraceFilename = argv[++i];
+        else if (arg == "--capture" && i + 1 < argc)
+            options.captureFilename = argv[++i];
+        else if (arg == "--replay" && i + 1 < argc)
+            options.replayFilename = argv[++i];
+        else if (arg == "--replay-loops" && i + 1 < argc)
+            options.replayLoops = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        else if (arg == "--draw-data" && i + 1 < argc)
+        {
+            string path = argv[++i];
+            if (path == "push")
+                options.drawPipeline = DrawPipelineId::PushConstants;
+            else if (path == "bindless")
+                options.drawPipeline = DrawPipelineId::Bindless;
+            else if (path == "uniform")
+                options.drawPipeline = DrawPipelineId::UniformRing;
+            else
+            {
+                cerr << "ignoring unknown --draw-data value " << path << ", using uniform" << endl;
+                options.drawPipeline = DrawPipelineId::UniformRing;
+            }
+        }
+        else if (arg == "--bench-draw-data" && i + 1 < argc)
+            options.benchDrawCount = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--bench-frames" && i + 1 < argc)
+            options.benchFrames = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        else if (arg == "--dynamic-rendering")
+            options.dynamicRendering = true;
+        else if (arg == "--bench-resize" && i + 1 < argc)
+            options.benchResizeCount = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--shader-objects")
+            options.shaderObjects = true;
+        else if (arg == "--pipeline-list" && i + 1 < argc)
+            options.pipelineListFilename = argv[++i];
+        else if (arg == "--pipeline-library")
+            options.pipelineLibrary = true;
+        else if (arg == "--bench-pipeline-variants")
+        {
+            options.pipelineLibrary = true;
+            options.benchPipelineVariants = true;
+        }
+        else if (arg == "--msaa" && i + 1 < argc)
+            options.msaaSamples = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        else if (arg == "--render-graph")
+            options.renderGraph = true;
+        else if (arg == "--bench-render-graph")
+            options.benchRenderGraph = true;
+        else if (arg == "--no-sort-draws")
+            options.sortDraws = false;
+        else if (arg == "--bench-overdraw" && i + 1 < argc)
+            options.benchOverdrawCount = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--sim-instances" && i + 1 < argc)
+            options.simInstances = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--sim-hz" && i + 1 < argc)
+            options.simStepHz = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        else if (arg == "--job-workers" && i + 1 < argc)
+            options.jobWorkers = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--no-cull-draws")
+            options.cullDraws = false;
+        else if (arg == "--parallel-record")
+            options.parallelRecord = true;
+        else if (arg == "--bench-jobs")
+        {
+            options.parallelRecord = true;
+            options.benchJobs = true;
+        }
+        else if (arg == "--bench-cull" && i + 1 < argc)
+            options.benchCullCount = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--scene-nodes" && i + 1 < argc)
+            options.sceneNodes = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--bench-transforms" && i + 1 < argc)
+            options.benchTransformCount = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--mesh" && i + 1 < argc)
+            options.meshSegments = static_cast<uint32_t>(std::max(0, atoi(argv[++i])));
+        else if (arg == "--no-mesh-shaders")
+            options.meshShaders = false;
+        else if (arg == "--meshlet-cache" && i + 1 < argc)
+            options.meshletCacheFilename = argv[++i];
+        else if (arg == "--mesh-instances" && i + 1 < argc)
+            options.meshInstances = static_cast<uint32_t>(std::max(1, atoi(argv[++i])));
+        else if (arg == "--no-mesh-lods")
+            options.meshLods = false;
+        else if (arg == "--lod-error" && i + 1 < argc)
+            options.lodErrorPixels = std::max(0.0f, static_cast<float>(atof(argv[++i])));
+        else if (arg == "--occlusion-cull")
+            options.occlusionCull = true;
+        else if (arg == "--vertex-pulling")
+            options.vertexPulling = true;
+        else
+            cerr << "ignoring unknown argument " << arg << endl;
+    }
+
+    return options;
+}
+
+
+int main(int argc, char** argv)
 {
     std::cout.setf(std::ios::boolalpha);
     std::cerr.setf(std::ios::boolalpha);
 
-    VulkanTriangleApp app;
+    // all Logging:: output goes through the background writer from here on
+    Logging::startBackend(LogConfig{});
+
+    VulkanTriangleApp app(parseOptions(argc, argv));
 
     try
     {
@@ -19,9 +129,12 @@ int main()
     }
     catch (const exception& e)
     {
+        Logging::stopBackend();
         cerr << e.what() << endl;
         return EXIT_FAILURE;
     }
 
+    Logging::stopBackend();
+
     return EXIT_SUCCESS;
 }
@@ -0,0 +1,39 @@
+#version 450
+#extension GL_EXT_nonuniform_qualifier : require
+
+// per draw data for every draw of the frame, found through the bindless table
+struct BindlessDrawData
+{
+    mat4 transform;
+    vec4 color;
+    uvec4 resources;
+    vec4 reserved[2];
+};
+
+layout(set = 0, binding = 0) readonly buffer DrawDataBuffer
+{
+    BindlessDrawData draws[];
+} drawBuffers[];
+
+// which table entry holds the draw data and where this frame starts in it
+layout(push_constant) uniform BindlessPushConstants
+{
+    uint drawBufferIndex;
+    uint firstDraw;
+} bindless;
+
+// inputs
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec4 inColor;
+
+// outputs
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    // firstInstance of each draw is its slot, so indirect draws need no other per draw state
+    BindlessDrawData draw = drawBuffers[bindless.drawBufferIndex].draws[bindless.firstDraw + gl_InstanceIndex];
+
+    gl_Position = draw.transform * vec4(inPosition, 1.0);
+    fragColor = inColor * draw.color;
+}
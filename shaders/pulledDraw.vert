@@ -0,0 +1,47 @@
+#version 450
+#extension GL_EXT_buffer_reference : require
+
+// vertices as plain floats - position xyz then color rgba at the start of every vertexStride floats
+layout(buffer_reference, std430, buffer_reference_align = 4) readonly buffer VertexBuffer
+{
+    float values[];
+};
+
+struct BindlessDrawData
+{
+    mat4 transform;
+    vec4 color;
+    uvec4 resources;
+    vec4 reserved[2];
+};
+
+layout(buffer_reference, std430, buffer_reference_align = 16) readonly buffer DrawDataBuffer
+{
+    BindlessDrawData draws[];
+};
+
+// addresses of the vertices and of the draw that firstInstance 0 would read, nothing is bound but the pipeline
+layout(push_constant) uniform PulledPushConstants
+{
+    VertexBuffer vertices;
+    DrawDataBuffer drawData;
+    uint vertexStride;
+} pulled;
+
+// outputs
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    // gl_VertexIndex already has firstVertex or the fetched index plus vertexOffset in it
+    uint base = uint(gl_VertexIndex) * pulled.vertexStride;
+
+    vec3 position = vec3(pulled.vertices.values[base], pulled.vertices.values[base + 1], pulled.vertices.values[base + 2]);
+    vec4 color = vec4(pulled.vertices.values[base + 3], pulled.vertices.values[base + 4], pulled.vertices.values[base + 5], pulled.vertices.values[base + 6]);
+
+    // firstInstance of each draw is its slot, as in bindlessDraw.vert
+    BindlessDrawData draw = pulled.drawData.draws[gl_InstanceIndex];
+
+    gl_Position = draw.transform * vec4(position, 1.0);
+    fragColor = color * draw.color;
+}
@@ -0,0 +1,21 @@
+#version 450
+
+// per draw data, bound with a dynamic offset into the uniform ring
+layout(set = 0, binding = 0) uniform DrawUniforms
+{
+    mat4 transform;
+    vec4 color;
+} draw;
+
+// inputs
+layout (location = 0) in vec3 inPosition;
+layout (location = 1) in vec4 inColor;
+
+// outputs
+layout (location = 0) out vec4 fragColor;
+
+void main()
+{
+    gl_Position = draw.transform * vec4(inPosition, 1.0);
+    fragColor = inColor * draw.color;
+}